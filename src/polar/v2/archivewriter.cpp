@@ -0,0 +1,160 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "archivewriter.h"
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QTextStream>
+
+namespace polar {
+namespace v2 {
+
+namespace {
+
+// Placeholder for the sessions, when splitting template documents.
+const char MARKER[] = "bipolar-archive-sessions";
+
+}
+
+/// Constructs a GPX archive writer, with \a gpxOptions applied to all sessions.
+ArchiveWriter::ArchiveWriter(QIODevice &device, const TrainingSession::GpxOptions gpxOptions,
+                             QIODevice * const indexDevice, const Timeline::Alignment alignment)
+    : device(device), indexDevice(indexDevice), format(GpxArchive), gpxOptions(gpxOptions),
+      alignment(alignment), position(0), started(false), closed(false)
+{
+    // The template is an otherwise empty GPX document, whose metadata describes
+    // the archive rather than any one session.
+    const QDomDocument document = TrainingSession::toGPX(ParsedSession(), gpxOptions);
+    QDomElement gpx = document.documentElement();
+    QDomElement metaData = gpx.firstChildElement(QLatin1String("metadata"));
+    metaData.removeChild(metaData.firstChildElement(QLatin1String("name")));
+    metaData.removeChild(metaData.firstChildElement(QLatin1String("desc")));
+    setTemplate(document, gpx);
+}
+
+/// Constructs a TCX archive writer, with \a tcxOptions applied to all sessions.
+ArchiveWriter::ArchiveWriter(QIODevice &device, const TrainingSession::TcxOptions tcxOptions,
+                             QIODevice * const indexDevice, const Timeline::Alignment alignment)
+    : device(device), indexDevice(indexDevice), format(TcxArchive), tcxOptions(tcxOptions),
+      alignment(alignment), position(0), started(false), closed(false)
+{
+    // Empty sessions have no Activities element, so add one to hold all sessions.
+    QDomDocument document = TrainingSession::toTCX(ParsedSession(), tcxOptions);
+    QDomElement tcx = document.documentElement();
+    QDomElement activities = document.createElement(QLatin1String("Activities"));
+    tcx.insertBefore(activities, QDomNode());
+    setTemplate(document, activities);
+}
+
+/**
+ * @brief Completes the archive, and its index.
+ *
+ * Archives with no sessions are still written, as valid (empty) documents.
+ */
+bool ArchiveWriter::close()
+{
+    if (closed) {
+        return false;
+    }
+    closed = true;
+    return (((started) || (writeBytes(header))) && (writeBytes(footer)));
+}
+
+/// Converts \a session, with this archive's sample alignment, and writes it to the archive.
+bool ArchiveWriter::write(const ParsedSession &session)
+{
+    const QDomDocument document = (format == GpxArchive)
+        ? TrainingSession::toGPX(session, gpxOptions, QDateTime::currentDateTimeUtc(), alignment)
+        : TrainingSession::toTCX(session, tcxOptions, QString(), alignment);
+    return write(QFileInfo(session.baseName()).fileName(), toFragment(document, format));
+}
+
+/**
+ * @brief Writes a session's pre-formatted \a fragment to the archive.
+ *
+ * This allows sessions to be formatted (see toFragment) on other threads, and
+ * only written, in any order, by the thread that owns the archive.
+ *
+ * @param name Name to record for the session in the archive's index.
+ * @param fragment The session's elements, as returned by toFragment.
+ */
+bool ArchiveWriter::write(const QString &name, const QByteArray &fragment)
+{
+    if (closed) {
+        qWarning() << "Cannot write to a closed archive";
+        return false;
+    }
+    if ((!started) && (!writeBytes(header))) {
+        return false;
+    }
+    started = true;
+    if (fragment.isEmpty()) {
+        return true; // Nothing to write, nor to index.
+    }
+
+    const qint64 offset = position;
+    if (!writeBytes(fragment)) {
+        return false;
+    }
+    if (indexDevice != NULL) {
+        const QByteArray entry = QString::fromLatin1("%1\t%2\t%3\n")
+            .arg(offset).arg(fragment.size()).arg(name).toUtf8();
+        if (indexDevice->write(entry) != entry.size()) {
+            qWarning() << "Failed to write archive index" << indexDevice->errorString();
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Extracts a session's archivable elements from its \a document.
+ *
+ * @return The session's \c trk (for GPX) or \c Activity (for TCX) elements,
+ *         serialized as UTF-8, or an empty array if there are none.
+ */
+QByteArray ArchiveWriter::toFragment(const QDomDocument &document, const Format format)
+{
+    const QDomNodeList elements = document.elementsByTagName(
+        QLatin1String((format == GpxArchive) ? "trk" : "Activity"));
+    QByteArray fragment;
+    QTextStream stream(&fragment);
+    stream.setCodec("UTF-8");
+    for (int index = 0; index < elements.length(); ++index) {
+        elements.at(index).save(stream, 1);
+    }
+    stream.flush();
+    return fragment;
+}
+
+/// Splits the serialized \a document around a marker appended to \a parent.
+void ArchiveWriter::setTemplate(const QDomDocument &document, QDomElement parent)
+{
+    parent.appendChild(parent.ownerDocument().createComment(QLatin1String(MARKER)));
+    const QByteArray bytes = document.toByteArray();
+    const QByteArray marker = QByteArray("<!--") + MARKER + "-->";
+    const int markerStart = bytes.indexOf(marker);
+    Q_ASSERT(markerStart > 0);
+
+    // Drop the marker's whole line, including its indentation.
+    const int lineStart = bytes.lastIndexOf('\n', markerStart) + 1;
+    int lineEnd = markerStart + marker.size();
+    if ((lineEnd < bytes.size()) && (bytes.at(lineEnd) == '\n')) {
+        ++lineEnd;
+    }
+    header = bytes.left(lineStart);
+    footer = bytes.mid(lineEnd);
+}
+
+bool ArchiveWriter::writeBytes(const QByteArray &bytes)
+{
+    if (device.write(bytes) != bytes.size()) {
+        qWarning() << "Failed to write archive" << device.errorString();
+        return false;
+    }
+    position += bytes.size();
+    return true;
+}
+
+}}
@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_ARCHIVE_WRITER_H__
+#define __POLAR_V2_ARCHIVE_WRITER_H__
+
+#include "trainingsession.h"
+
+#include <QByteArray>
+#include <QDomDocument>
+#include <QIODevice>
+#include <QString>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief Streams many training sessions into a single GPX or TCX archive.
+ *
+ * A GPX archive is one \c gpx document with a \c trk per exercise, and a TCX
+ * archive is one \c TrainingCenterDatabase with an \c Activity per exercise
+ * (multi-sport sessions are flattened into their individual activities). Each
+ * session is written as soon as it is given, so only one session is ever held
+ * in memory, regardless of the size of the archive.
+ *
+ * If an index device is given, a line of the form "<offset>\t<length>\t<name>"
+ * is written to it for each session, giving the byte range of that session's
+ * elements within the archive, so that consumers can seek to (and parse) any
+ * one session without reading the whole archive.
+ */
+class ArchiveWriter {
+
+public:
+    enum Format {
+        GpxArchive,
+        TcxArchive,
+    };
+
+    ArchiveWriter(QIODevice &device, const TrainingSession::GpxOptions gpxOptions,
+                  QIODevice * const indexDevice = NULL,
+                  const Timeline::Alignment alignment = Timeline::IndexAlignment);
+    ArchiveWriter(QIODevice &device, const TrainingSession::TcxOptions tcxOptions,
+                  QIODevice * const indexDevice = NULL,
+                  const Timeline::Alignment alignment = Timeline::IndexAlignment);
+
+    bool close();
+    bool write(const ParsedSession &session);
+    bool write(const QString &name, const QByteArray &fragment);
+
+    static QByteArray toFragment(const QDomDocument &document, const Format format);
+
+protected:
+    QIODevice &device;
+    QIODevice * indexDevice;
+    Format format;
+    TrainingSession::GpxOptions gpxOptions;
+    TrainingSession::TcxOptions tcxOptions;
+    Timeline::Alignment alignment; ///< Sample alignment for sessions given to write().
+    QByteArray header;   ///< Archive content preceding the first session.
+    QByteArray footer;   ///< Archive content following the last session.
+    qint64 position;     ///< Number of bytes written to the archive so far.
+    bool started;
+    bool closed;
+
+    void setTemplate(const QDomDocument &document, QDomElement parent);
+    bool writeBytes(const QByteArray &bytes);
+
+};
+
+}}
+
+#endif // __POLAR_V2_ARCHIVE_WRITER_H__
@@ -0,0 +1,392 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "arrowwriter.h"
+
+#include <QDebug>
+#include <QMap>
+#include <QVector>
+
+namespace polar {
+namespace v2 {
+
+namespace {
+
+// Enumerator values, per Arrow's Schema.fbs, Message.fbs and File.fbs.
+const quint16 METADATA_VERSION_V5 = 4;
+const quint8 MESSAGE_HEADER_SCHEMA = 1;
+const quint8 MESSAGE_HEADER_RECORD_BATCH = 3;
+const quint8 TYPE_INT = 2;
+const quint8 TYPE_FLOATING_POINT = 3;
+const quint8 TYPE_TIMESTAMP = 10;
+const quint16 PRECISION_SINGLE = 1;
+const quint16 PRECISION_DOUBLE = 2;
+const quint16 TIME_UNIT_MILLISECOND = 1;
+
+/*
+ * A minimal FlatBuffers builder, sufficient for Arrow's IPC metadata.
+ *
+ * As with the reference implementation, buffers are built back to front, so
+ * that child objects (strings, vectors and tables) are always created before
+ * their parents, which then refer to them via forward offsets. All offsets are
+ * measured from the end of the buffer, which is held in reverse byte order
+ * until finished.
+ */
+class FlatBufferBuilder {
+
+public:
+    FlatBufferBuilder() : minAlign(1), tableStart(0)
+    {
+
+    }
+
+    quint32 size() const
+    {
+        return static_cast<quint32>(reversed.size());
+    }
+
+    // Pads, such that size() will be a multiple of alignment after extra bytes.
+    void align(const int alignment, const int extra = 0)
+    {
+        minAlign = qMax(minAlign, alignment);
+        while (((reversed.size() + extra) % alignment) != 0) {
+            reversed.append('\0');
+        }
+    }
+
+    void prepend(const quint64 value, const int size)
+    {
+        align(size);
+        for (int index = size - 1; index >= 0; --index) {
+            reversed.append(static_cast<char>((value >> (index * 8)) & 0xFF));
+        }
+    }
+
+    void prependOffset(const quint32 offset)
+    {
+        align(4);
+        prepend(size() + 4 - offset, 4);
+    }
+
+    quint32 createString(const QByteArray &string)
+    {
+        align(4, string.size() + 1);
+        reversed.append('\0');
+        for (int index = string.size() - 1; index >= 0; --index) {
+            reversed.append(string.at(index));
+        }
+        prepend(string.size(), 4);
+        return size();
+    }
+
+    void startVector(const int elementSize, const int count, const int alignment)
+    {
+        align(4, elementSize * count);
+        align(alignment, elementSize * count);
+    }
+
+    quint32 endVector(const int count)
+    {
+        prepend(count, 4);
+        return size();
+    }
+
+    quint32 createOffsetVector(const QVector<quint32> &offsets)
+    {
+        startVector(4, offsets.size(), 4);
+        for (int index = offsets.size() - 1; index >= 0; --index) {
+            prependOffset(offsets.at(index));
+        }
+        return endVector(offsets.size());
+    }
+
+    void startTable()
+    {
+        fieldOffsets.clear();
+        tableStart = size();
+    }
+
+    void addField(const int field, const quint64 value, const int size)
+    {
+        prepend(value, size);
+        fieldOffsets.insert(field, this->size());
+    }
+
+    void addOffsetField(const int field, const quint32 offset)
+    {
+        prependOffset(offset);
+        fieldOffsets.insert(field, size());
+    }
+
+    quint32 endTable()
+    {
+        prepend(0, 4); // Placeholder for the (signed) offset to the vtable.
+        const quint32 tableOffset = size();
+
+        // Add the vtable: its size, the table's size, then each field's offset.
+        const int fieldCount = (fieldOffsets.isEmpty()) ? 0 : (fieldOffsets.lastKey() + 1);
+        for (int field = fieldCount - 1; field >= 0; --field) {
+            prepend((fieldOffsets.contains(field)) ? (tableOffset - fieldOffsets.value(field)) : 0, 2);
+        }
+        prepend(tableOffset - tableStart, 2);
+        prepend(4 + (2 * fieldCount), 2);
+
+        // Point the table at its vtable, which precedes it in the final buffer.
+        const quint32 vtableDistance = size() - tableOffset;
+        for (int index = 0; index < 4; ++index) {
+            reversed[tableOffset - 1 - index] = static_cast<char>((vtableDistance >> (index * 8)) & 0xFF);
+        }
+        return tableOffset;
+    }
+
+    QByteArray finish(const quint32 root)
+    {
+        align(minAlign, 4);
+        prependOffset(root);
+        QByteArray buffer(reversed.size(), '\0');
+        for (int index = 0; index < reversed.size(); ++index) {
+            buffer[index] = reversed.at(reversed.size() - 1 - index);
+        }
+        return buffer;
+    }
+
+protected:
+    QByteArray reversed;
+    int minAlign;
+    quint32 tableStart;
+    QMap<int, quint32> fieldOffsets;
+
+};
+
+quint32 createSchema(FlatBufferBuilder &builder,
+                     const QList<QPair<QString, SampleTable::Type> > &columns)
+{
+    QVector<quint32> fields;
+    for (int index = 0; index < columns.size(); ++index) {
+        const quint32 name = builder.createString(columns.at(index).first.toUtf8());
+        quint8 typeType = 0;
+        quint32 type = 0;
+        switch (columns.at(index).second) {
+        case SampleTable::Int32:
+            builder.startTable();
+            builder.addField(0, 32, 4); // bitWidth
+            builder.addField(1, 1, 1);  // is_signed
+            type = builder.endTable();
+            typeType = TYPE_INT;
+            break;
+        case SampleTable::Float32:
+        case SampleTable::Float64:
+            builder.startTable();
+            builder.addField(0, (columns.at(index).second == SampleTable::Float32)
+                ? PRECISION_SINGLE : PRECISION_DOUBLE, 2);
+            type = builder.endTable();
+            typeType = TYPE_FLOATING_POINT;
+            break;
+        case SampleTable::TimestampMSecs: {
+            const quint32 timezone = builder.createString(QByteArray("UTC"));
+            builder.startTable();
+            builder.addField(0, TIME_UNIT_MILLISECOND, 2);
+            builder.addOffsetField(1, timezone);
+            type = builder.endTable();
+            typeType = TYPE_TIMESTAMP;
+        }   break;
+        }
+        builder.startVector(4, 0, 4);
+        const quint32 children = builder.endVector(0);
+
+        builder.startTable();
+        builder.addOffsetField(0, name);
+        builder.addField(1, 1, 1);        // nullable
+        builder.addField(2, typeType, 1); // type_type
+        builder.addOffsetField(3, type);
+        builder.addOffsetField(5, children);
+        fields.append(builder.endTable());
+    }
+    const quint32 fieldVector = builder.createOffsetVector(fields);
+
+    builder.startTable();
+    builder.addField(0, 0, 2); // endianness: Little
+    builder.addOffsetField(1, fieldVector);
+    return builder.endTable();
+}
+
+quint32 createMessage(FlatBufferBuilder &builder, const quint8 headerType,
+                      const quint32 header, const qint64 bodyLength)
+{
+    builder.startTable();
+    builder.addField(0, METADATA_VERSION_V5, 2);
+    builder.addField(1, headerType, 1);
+    builder.addOffsetField(2, header);
+    builder.addField(3, static_cast<quint64>(bodyLength), 8);
+    return builder.endTable();
+}
+
+void appendBuffer(QByteArray &body, QList<QPair<qint64, qint64> > &buffers,
+                  const QByteArray &data)
+{
+    buffers.append(qMakePair(static_cast<qint64>(body.size()), static_cast<qint64>(data.size())));
+    body.append(data);
+    body.append(QByteArray((8 - (data.size() % 8)) % 8, '\0')); // Buffers are 8-byte aligned.
+}
+
+}
+
+ArrowWriter::ArrowWriter(QIODevice &device) : device(device), position(0), closed(false)
+{
+
+}
+
+/**
+ * @brief Completes the Arrow file, by writing its footer.
+ *
+ * @return \c true if the footer was written successfully, \c false if no tables
+ *         have been written, or writing failed.
+ */
+bool ArrowWriter::close()
+{
+    if (closed) {
+        return false;
+    }
+    if (schema.isEmpty()) {
+        qWarning() << "No tables to write to Arrow file";
+        return false;
+    }
+    closed = true;
+
+    // Write the end-of-stream marker, since the file contains a valid stream.
+    if (!writeBytes(QByteArray::fromHex("ffffffff00000000"))) {
+        return false;
+    }
+
+    FlatBufferBuilder builder;
+    const quint32 schemaTable = createSchema(builder, schema);
+    builder.startVector(24, recordBatches.size(), 8);
+    for (int index = recordBatches.size() - 1; index >= 0; --index) {
+        builder.prepend(static_cast<quint64>(recordBatches.at(index).bodyLength), 8);
+        builder.prepend(0, 4); // Padding.
+        builder.prepend(static_cast<quint32>(recordBatches.at(index).metaDataLength), 4);
+        builder.prepend(static_cast<quint64>(recordBatches.at(index).offset), 8);
+    }
+    const quint32 blocks = builder.endVector(recordBatches.size());
+    builder.startTable();
+    builder.addField(0, METADATA_VERSION_V5, 2);
+    builder.addOffsetField(1, schemaTable);
+    builder.addOffsetField(3, blocks); // recordBatches
+    const QByteArray footer = builder.finish(builder.endTable());
+
+    QByteArray trailer;
+    for (int index = 0; index < 4; ++index) {
+        trailer.append(static_cast<char>((footer.size() >> (index * 8)) & 0xFF));
+    }
+    trailer.append("ARROW1");
+    return ((writeBytes(footer)) && (writeBytes(trailer)));
+}
+
+/**
+ * @brief Writes \a table as a record batch.
+ *
+ * The first table written also writes the file's header and schema. All other
+ * tables must have the same column names and types as the first.
+ */
+bool ArrowWriter::write(const SampleTable &table)
+{
+    if (closed) {
+        qWarning() << "Cannot write to a closed Arrow file";
+        return false;
+    }
+
+    if (schema.isEmpty()) {
+        foreach (const SampleTable::Column &column, table.columns()) {
+            schema.append(qMakePair(column.name(), column.type()));
+        }
+        if (schema.isEmpty()) {
+            qWarning() << "Cannot write an Arrow table with no columns";
+            return false;
+        }
+        FlatBufferBuilder builder;
+        const quint32 schemaTable = createSchema(builder, schema);
+        if ((!writeBytes(QByteArray("ARROW1\0\0", 8))) ||
+            (!writeMessage(builder.finish(createMessage(builder,
+                MESSAGE_HEADER_SCHEMA, schemaTable, 0)), QByteArray()))) {
+            return false;
+        }
+    } else {
+        bool matches = (table.columns().size() == schema.size());
+        for (int index = 0; (matches) && (index < schema.size()); ++index) {
+            matches = ((table.columns().at(index).name() == schema.at(index).first) &&
+                       (table.columns().at(index).type() == schema.at(index).second));
+        }
+        if (!matches) {
+            qWarning() << "Arrow table does not match the file's schema";
+            return false;
+        }
+    }
+
+    // Build the record batch body, with a validity and a values buffer per column.
+    QByteArray body;
+    QList<QPair<qint64, qint64> > buffers;
+    foreach (const SampleTable::Column &column, table.columns()) {
+        appendBuffer(body, buffers, column.validity());
+        appendBuffer(body, buffers, column.values());
+    }
+
+    FlatBufferBuilder builder;
+    builder.startVector(16, table.columns().size(), 8);
+    for (int index = table.columns().size() - 1; index >= 0; --index) {
+        builder.prepend(static_cast<quint64>(table.columns().at(index).nullCount()), 8);
+        builder.prepend(static_cast<quint64>(table.columns().at(index).size()), 8);
+    }
+    const quint32 nodes = builder.endVector(table.columns().size());
+    builder.startVector(16, buffers.size(), 8);
+    for (int index = buffers.size() - 1; index >= 0; --index) {
+        builder.prepend(static_cast<quint64>(buffers.at(index).second), 8); // length
+        builder.prepend(static_cast<quint64>(buffers.at(index).first), 8);  // offset
+    }
+    const quint32 bufferVector = builder.endVector(buffers.size());
+    builder.startTable();
+    builder.addField(0, static_cast<quint64>(table.rowCount()), 8); // length
+    builder.addOffsetField(1, nodes);
+    builder.addOffsetField(2, bufferVector);
+    const quint32 recordBatch = builder.endTable();
+
+    Block block;
+    if (!writeMessage(builder.finish(createMessage(builder,
+            MESSAGE_HEADER_RECORD_BATCH, recordBatch, body.size())), body, &block)) {
+        return false;
+    }
+    recordBatches.append(block);
+    return true;
+}
+
+bool ArrowWriter::writeBytes(const QByteArray &bytes)
+{
+    if (device.write(bytes) != bytes.size()) {
+        qWarning() << "Failed to write Arrow data" << device.errorString();
+        return false;
+    }
+    position += bytes.size();
+    return true;
+}
+
+/// Writes an encapsulated IPC message, padding its metadata to 8 bytes.
+bool ArrowWriter::writeMessage(const QByteArray &metadata, const QByteArray &body, Block *block)
+{
+    const int padding = (8 - (metadata.size() % 8)) % 8;
+    QByteArray prefix("\xff\xff\xff\xff", 4); // Continuation marker.
+    for (int index = 0; index < 4; ++index) {
+        prefix.append(static_cast<char>(((metadata.size() + padding) >> (index * 8)) & 0xFF));
+    }
+    const qint64 offset = position;
+    if ((!writeBytes(prefix)) || (!writeBytes(metadata)) ||
+        (!writeBytes(QByteArray(padding, '\0'))) || (!writeBytes(body))) {
+        return false;
+    }
+    if (block != NULL) {
+        block->offset = offset;
+        block->metaDataLength = prefix.size() + metadata.size() + padding;
+        block->bodyLength = body.size();
+    }
+    return true;
+}
+
+}}
@@ -0,0 +1,57 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_ARROW_WRITER_H__
+#define __POLAR_V2_ARROW_WRITER_H__
+
+#include "sampletable.h"
+
+#include <QIODevice>
+#include <QList>
+#include <QPair>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief Writes SampleTables to an Apache Arrow IPC file.
+ *
+ * The first table written defines the file's schema, and each table (including
+ * the first) is then written as one record batch, so tables are streamed to the
+ * device as they are written, rather than being held until the file is closed.
+ * The file's footer, which indexes the record batches, is written by close.
+ *
+ * This is a small, self-contained writer, supporting only the primitive column
+ * types of SampleTable, without compression or dictionaries.
+ *
+ * @see https://arrow.apache.org/docs/format/Columnar.html#ipc-file-format
+ */
+class ArrowWriter {
+
+public:
+    explicit ArrowWriter(QIODevice &device);
+
+    bool close();
+    bool write(const SampleTable &table);
+
+protected:
+    struct Block {
+        qint64 offset;
+        qint32 metaDataLength;
+        qint64 bodyLength;
+    };
+
+    QIODevice &device;
+    qint64 position;
+    QList<QPair<QString, SampleTable::Type> > schema;
+    QList<Block> recordBatches;
+    bool closed;
+
+    bool writeBytes(const QByteArray &bytes);
+    bool writeMessage(const QByteArray &metadata, const QByteArray &body, Block *block = NULL);
+
+};
+
+}}
+
+#endif // __POLAR_V2_ARROW_WRITER_H__
@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "chunkedformatter.h"
+
+#include "parallelmap.h"
+
+#include <QtGlobal>
+
+namespace polar {
+namespace v2 {
+
+const int ChunkedFormatter::DefaultChunkSize = 1024;
+
+ChunkedFormatter::ChunkedFormatter(const int chunkSize) : chunkSize(qMax(chunkSize, 1))
+{
+
+}
+
+ChunkedFormatter::~ChunkedFormatter()
+{
+
+}
+
+/**
+ * @brief Formats indexes 0 to \a count - 1, returning once all are formatted.
+ */
+void ChunkedFormatter::format(const int count)
+{
+    ParallelMap::map(count, chunkSize, [this](const int begin, const int end) {
+        formatChunk(begin, end);
+    });
+}
+
+}}
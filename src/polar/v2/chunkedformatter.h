@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_CHUNKED_FORMATTER_H__
+#define __POLAR_V2_CHUNKED_FORMATTER_H__
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief Base class for formatting long, indexed sequences in parallel.
+ *
+ * The index range is split into fixed-size chunks, and each chunk is passed to
+ * formatChunk via ParallelMap. Derived classes write each chunk's results to
+ * their own slots of a pre-sized buffer, so the caller can then consume the
+ * results in index order, exactly as if they had been formatted sequentially.
+ */
+class ChunkedFormatter {
+
+public:
+    static const int DefaultChunkSize;
+
+    explicit ChunkedFormatter(const int chunkSize = DefaultChunkSize);
+    virtual ~ChunkedFormatter();
+
+    void format(const int count);
+
+protected:
+    /// Formats indexes \a begin (inclusive) to \a end (exclusive).
+    /// @note May be called concurrently, for other (disjoint) ranges.
+    virtual void formatChunk(const int begin, const int end) = 0;
+
+private:
+    const int chunkSize;
+
+};
+
+}}
+
+#endif // __POLAR_V2_CHUNKED_FORMATTER_H__
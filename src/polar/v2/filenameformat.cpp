@@ -0,0 +1,111 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "filenameformat.h"
+
+#include <QProcessEnvironment>
+
+namespace polar {
+namespace v2 {
+
+namespace {
+
+struct PlaceholderName {
+    const char * name;
+    FileNameFormat::Placeholder placeholder;
+};
+
+// Note, where one name is a prefix of another (eg $date and $dateExt), the
+// longer name must come first, since the first match wins.
+const PlaceholderName placeholderNames[] = {
+    { "$baseName",    FileNameFormat::BaseName    },
+    { "$dateExtUTC",  FileNameFormat::DateExtUTC  },
+    { "$dateExt",     FileNameFormat::DateExt     },
+    { "$dateUTC",     FileNameFormat::DateUTC     },
+    { "$date",        FileNameFormat::Date        },
+    { "$timeExtUTC",  FileNameFormat::TimeExtUTC  },
+    { "$timeExt",     FileNameFormat::TimeExt     },
+    { "$timeUTC",     FileNameFormat::TimeUTC     },
+    { "$time",        FileNameFormat::Time        },
+    { "$userId",      FileNameFormat::UserId      },
+    { "$username",    FileNameFormat::Username    },
+    { "$sessionId",   FileNameFormat::SessionId   },
+    { "$sessionName", FileNameFormat::SessionName },
+};
+
+}
+
+FileNameFormat::FileNameFormat(const QString &format)
+    : format(format), usedPlaceholders(0)
+{
+    QString literal;
+    for (int index = 0; index < format.size();) {
+        const PlaceholderName * match = NULL;
+        if (format.at(index) == QLatin1Char('$')) {
+            for (size_t nameIndex = 0; (match == NULL) &&
+                 (nameIndex < (sizeof(placeholderNames)/sizeof(placeholderNames[0])));
+                 ++nameIndex) {
+                if (format.midRef(index).startsWith(QLatin1String(placeholderNames[nameIndex].name))) {
+                    match = &placeholderNames[nameIndex];
+                }
+            }
+        }
+
+        if (match == NULL) {
+            literal.append(format.at(index++));
+            continue;
+        }
+
+        if (!literal.isEmpty()) {
+            const Token token = { Literal, literal };
+            tokenList.append(token);
+            literal.clear();
+        }
+        const Token token = { match->placeholder, QString() };
+        tokenList.append(token);
+        usedPlaceholders |= match->placeholder;
+        index += static_cast<int>(qstrlen(match->name));
+    }
+
+    if (!literal.isEmpty()) {
+        const Token token = { Literal, literal };
+        tokenList.append(token);
+    }
+}
+
+bool FileNameFormat::isEmpty() const
+{
+    return format.isEmpty();
+}
+
+QString FileNameFormat::toString() const
+{
+    return format;
+}
+
+const QList<FileNameFormat::Token> &FileNameFormat::tokens() const
+{
+    return tokenList;
+}
+
+/// Returns \c true if the format uses any of the given \a placeholders.
+bool FileNameFormat::uses(const int placeholders) const
+{
+    return ((usedPlaceholders & placeholders) != 0);
+}
+
+/// Returns the current user's name, for the $username placeholder.
+QString FileNameFormat::username()
+{
+    static const QString user = QProcessEnvironment::systemEnvironment().value(
+        #ifdef Q_OS_WIN
+        QLatin1String("USERNAME"),
+        #else
+        QLatin1String("USER"),
+        #endif
+        QLatin1String("unknown")
+    );
+    return user;
+}
+
+}}
@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_FILE_NAME_FORMAT_H__
+#define __POLAR_V2_FILE_NAME_FORMAT_H__
+
+#include <QList>
+#include <QString>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief A pre-compiled output file name format.
+ *
+ * File name formats, such as "$dateExt $sessionName", are parsed into a list of
+ * literal and placeholder tokens once, on construction, so that the same format
+ * can be applied cheaply to any number of outputs and training sessions.
+ *
+ * @see TrainingSession::getOutputBaseFileName
+ */
+class FileNameFormat {
+
+public:
+    enum Placeholder {
+        Literal     = 0x0000,
+        BaseName    = 0x0001,
+        Date        = 0x0002,
+        DateUTC     = 0x0004,
+        DateExt     = 0x0008,
+        DateExtUTC  = 0x0010,
+        Time        = 0x0020,
+        TimeUTC     = 0x0040,
+        TimeExt     = 0x0080,
+        TimeExtUTC  = 0x0100,
+        UserId      = 0x0200,
+        Username    = 0x0400,
+        SessionId   = 0x0800,
+        SessionName = 0x1000,
+        AnyDateTime = Date|DateUTC|DateExt|DateExtUTC|Time|TimeUTC|TimeExt|TimeExtUTC
+    };
+
+    struct Token {
+        Placeholder placeholder;
+        QString text; ///< Literal text; empty for placeholders.
+    };
+
+    FileNameFormat(const QString &format = QString());
+
+    bool isEmpty() const;
+    QString toString() const;
+    const QList<Token> &tokens() const;
+    bool uses(const int placeholders) const;
+
+    static QString username();
+
+protected:
+    QString format;
+    QList<Token> tokenList;
+    int usedPlaceholders;
+
+};
+
+}}
+
+#endif // __POLAR_V2_FILE_NAME_FORMAT_H__
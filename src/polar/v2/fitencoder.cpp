@@ -0,0 +1,171 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "fitencoder.h"
+
+#include <QDebug>
+
+#include <limits>
+
+namespace polar {
+namespace v2 {
+
+namespace {
+
+const quint8 HEADER_SIZE = 14;
+const quint8 PROTOCOL_VERSION = 0x10;  // 1.0
+const quint16 PROFILE_VERSION = 2100;  // 21.00
+
+// Seconds between the Unix epoch, and the FIT epoch (1989-12-31T00:00:00Z).
+const qint64 FIT_EPOCH_OFFSET = 631065600;
+
+inline void appendLittleEndian(QByteArray &array, quint64 value, const int size)
+{
+    for (int index = 0; index < size; ++index, value >>= 8) {
+        array.append(static_cast<char>(value & 0xFF));
+    }
+}
+
+inline int sizeOf(const FitEncoder::BaseType type)
+{
+    switch (type) {
+    case FitEncoder::Enum:
+    case FitEncoder::Sint8:
+    case FitEncoder::Uint8:   return 1;
+    case FitEncoder::Sint16:
+    case FitEncoder::Uint16:  return 2;
+    case FitEncoder::Sint32:
+    case FitEncoder::Uint32:
+    case FitEncoder::Uint32z: return 4;
+    }
+    return 0;
+}
+
+}
+
+/// Sentinel for values that are not available; written as the type's invalid value.
+const qint64 FitEncoder::Invalid = std::numeric_limits<qint64>::min();
+
+FitEncoder::FitEncoder()
+{
+
+}
+
+void FitEncoder::defineMessage(const quint8 localType, const quint16 globalNumber,
+                               const Field * const fields, const int count)
+{
+    Q_ASSERT(localType < 16);
+    Q_ASSERT(count < 256);
+    data.append(static_cast<char>(0x40 | localType)); // Definition message header.
+    data.append('\0');                                // Reserved.
+    data.append('\0');                                // Little-endian architecture.
+    appendLittleEndian(data, globalNumber, 2);
+    data.append(static_cast<char>(count));
+    QVector<Field> &definition = definitions[localType & 0x0F];
+    definition.clear();
+    for (int index = 0; index < count; ++index) {
+        data.append(static_cast<char>(fields[index].number));
+        data.append(static_cast<char>(sizeOf(fields[index].type)));
+        data.append(static_cast<char>(fields[index].type));
+        definition.append(fields[index]);
+    }
+}
+
+bool FitEncoder::writeMessage(const quint8 localType, const qint64 * const values,
+                              const int count)
+{
+    const QVector<Field> &definition = definitions[localType & 0x0F];
+    if ((localType >= 16) || (definition.size() != count)) {
+        qWarning() << "Invalid FIT data message for local type" << static_cast<int>(localType);
+        return false;
+    }
+    data.append(static_cast<char>(localType)); // Data message header.
+    for (int index = 0; index < count; ++index) {
+        writeValue(definition.at(index).type, values[index]);
+    }
+    return true;
+}
+
+void FitEncoder::writeValue(const BaseType type, const qint64 value)
+{
+    qint64 min, max, invalid; // Valid values are within [min, max].
+    switch (type) {
+    case Enum:    min = 0;               max = 0xFE;          invalid = 0xFF;          break;
+    case Sint8:   min = -0x80;           max = 0x7E;          invalid = 0x7F;          break;
+    case Uint8:   min = 0;               max = 0xFE;          invalid = 0xFF;          break;
+    case Sint16:  min = -0x8000;         max = 0x7FFE;        invalid = 0x7FFF;        break;
+    case Uint16:  min = 0;               max = 0xFFFE;        invalid = 0xFFFF;        break;
+    case Sint32:  min = -0x80000000LL;   max = 0x7FFFFFFELL;  invalid = 0x7FFFFFFFLL;  break;
+    case Uint32:  min = 0;               max = 0xFFFFFFFELL;  invalid = 0xFFFFFFFFLL;  break;
+    case Uint32z: min = 1;               max = 0xFFFFFFFFLL;  invalid = 0;             break;
+    default:
+        Q_ASSERT_X(false, "FitEncoder::writeValue", "unsupported base type");
+        return;
+    }
+    appendLittleEndian(data, static_cast<quint64>(
+        ((min <= value) && (value <= max)) ? value : invalid), sizeOf(type));
+}
+
+/// Returns the size, in bytes, of the messages written so far.
+int FitEncoder::dataSize() const
+{
+    return data.size();
+}
+
+/**
+ * @brief Returns the complete FIT file.
+ *
+ * That is, the file header, followed by all messages written so far, followed
+ * by the file's CRC.
+ */
+QByteArray FitEncoder::toByteArray() const
+{
+    QByteArray file;
+    file.reserve(HEADER_SIZE + data.size() + 2);
+    file.append(static_cast<char>(HEADER_SIZE));
+    file.append(static_cast<char>(PROTOCOL_VERSION));
+    appendLittleEndian(file, PROFILE_VERSION, 2);
+    appendLittleEndian(file, static_cast<quint32>(data.size()), 4);
+    file.append(".FIT", 4);
+    appendLittleEndian(file, crc(file), 2);
+    file.append(data);
+    appendLittleEndian(file, crc(file), 2);
+    return file;
+}
+
+/**
+ * @brief Calculates the FIT CRC (CRC-16/ARC) of \a data.
+ *
+ * @param data Data to calculate the CRC of.
+ * @param crc  Initial CRC value, such as the CRC of any preceding data.
+ */
+quint16 FitEncoder::crc(const QByteArray &data, quint16 crc)
+{
+    static const quint16 table[16] = {
+        0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+        0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400
+    };
+    for (int index = 0; index < data.size(); ++index) {
+        const quint8 byte = static_cast<quint8>(data.at(index));
+        quint16 tmp = table[crc & 0xF];
+        crc = ((crc >> 4) & 0x0FFF) ^ tmp ^ table[byte & 0xF];
+        tmp = table[crc & 0xF];
+        crc = ((crc >> 4) & 0x0FFF) ^ tmp ^ table[(byte >> 4) & 0xF];
+    }
+    return crc;
+}
+
+/// Converts \a degrees of latitude or longitude to FIT semicircles.
+qint64 FitEncoder::semicircles(const double degrees)
+{
+    return qRound64(degrees * (2147483648.0 / 180.0));
+}
+
+/// Converts \a dateTime to a FIT timestamp, or Invalid if \a dateTime is not valid.
+qint64 FitEncoder::timestamp(const QDateTime &dateTime)
+{
+    return (dateTime.isValid())
+        ? (dateTime.toMSecsSinceEpoch() / 1000) - FIT_EPOCH_OFFSET : Invalid;
+}
+
+}}
@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_FIT_ENCODER_H__
+#define __POLAR_V2_FIT_ENCODER_H__
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QVector>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief Encodes Garmin FIT (Flexible and Interoperable Data Transfer) files.
+ *
+ * Messages are defined once per local message type, and then written as
+ * compact, fixed-layout binary records. Values that are missing, or cannot be
+ * represented by the field's base type, are written as that type's "invalid"
+ * value, as required by the FIT protocol.
+ *
+ * @see https://developer.garmin.com/fit/protocol/
+ */
+class FitEncoder {
+
+public:
+    enum BaseType {
+        Enum    = 0x00,
+        Sint8   = 0x01,
+        Uint8   = 0x02,
+        Sint16  = 0x83,
+        Uint16  = 0x84,
+        Sint32  = 0x85,
+        Uint32  = 0x86,
+        Uint32z = 0x8C,
+    };
+
+    struct Field {
+        quint8 number;
+        BaseType type;
+    };
+
+    static const qint64 Invalid;
+
+    FitEncoder();
+
+    template <int N>
+    void defineMessage(const quint8 localType, const quint16 globalNumber,
+                       const Field (&fields)[N])
+    {
+        defineMessage(localType, globalNumber, fields, N);
+    }
+
+    template <int N>
+    bool writeMessage(const quint8 localType, const qint64 (&values)[N])
+    {
+        return writeMessage(localType, values, N);
+    }
+
+    int dataSize() const;
+    QByteArray toByteArray() const;
+
+    static quint16 crc(const QByteArray &data, quint16 crc = 0);
+    static qint64 semicircles(const double degrees);
+    static qint64 timestamp(const QDateTime &dateTime);
+
+protected:
+    QByteArray data;
+    QVector<Field> definitions[16]; ///< Field definitions, by local message type.
+
+    void defineMessage(const quint8 localType, const quint16 globalNumber,
+                       const Field * const fields, const int count);
+    bool writeMessage(const quint8 localType, const qint64 * const values,
+                      const int count);
+    void writeValue(const BaseType type, const qint64 value);
+
+};
+
+}}
+
+#endif // __POLAR_V2_FIT_ENCODER_H__
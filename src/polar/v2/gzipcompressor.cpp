@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "gzipcompressor.h"
+
+#include "parallelmap.h"
+
+#include <QAtomicInt>
+#include <QDebug>
+#include <QVector>
+
+#ifdef Q_CC_MSVC
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+namespace polar {
+namespace v2 {
+
+const int GzipCompressor::DefaultBlockSize = 128 * 1024;
+
+namespace {
+
+const int DICTIONARY_SIZE = 32 * 1024;
+
+// Deflates one block of data as a raw deflate stream fragment.
+bool compressBlock(const QByteArray &data, const int level, const int blockSize,
+                   const int index, QByteArray &output, quint32 &crc)
+{
+    const int start = index * blockSize;
+    const int size = qMin(blockSize, data.size() - start);
+    const bool isLast = (start + size >= data.size());
+    const Bytef * const input = reinterpret_cast<const Bytef *>(data.constData() + start);
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        qWarning() << "deflateInit2 failed" << stream.msg;
+        return false;
+    }
+
+    // Prime the block with the end of the previous block, as a single stream would have.
+    if (index > 0) {
+        const int dictionarySize = qMin(DICTIONARY_SIZE, start);
+        deflateSetDictionary(&stream, input - dictionarySize, dictionarySize);
+    }
+
+    // A sync flush adds (at most) an empty stored block, of five bytes.
+    output.resize(static_cast<int>(deflateBound(&stream, size)) + 16);
+    stream.next_in = const_cast<Bytef *>(input);
+    stream.avail_in = size;
+    stream.next_out = reinterpret_cast<Bytef *>(output.data());
+    stream.avail_out = output.size();
+    const int result = deflate(&stream, (isLast) ? Z_FINISH : Z_SYNC_FLUSH);
+    const bool ok = (isLast) ? (result == Z_STREAM_END) : ((result == Z_OK) && (stream.avail_in == 0));
+    if (!ok) {
+        qWarning() << "deflate failed" << result << stream.msg;
+    }
+    output.resize(output.size() - stream.avail_out);
+    deflateEnd(&stream);
+
+    crc = crc32(0L, input, size);
+    return ok;
+}
+
+void appendLittleEndian(QByteArray &data, const quint32 value)
+{
+    for (int index = 0; index < 4; ++index) {
+        data.append(static_cast<char>((value >> (index * 8)) & 0xFF));
+    }
+}
+
+}
+
+/**
+ * @brief Compresses \a data to the gzip format.
+ *
+ * @param data      Data to compress.
+ * @param level     zlib compression level, from 0 to 9, or -1 for zlib's default.
+ * @param blockSize Size of the (uncompressed) blocks to compress in parallel.
+ *
+ * @return The gzip-compressed data, or an empty array on failure.
+ */
+QByteArray GzipCompressor::compress(const QByteArray &data, const int level, const int blockSize)
+{
+    Q_ASSERT(blockSize > 0);
+    const int blockCount = qMax((data.size() + blockSize - 1) / blockSize, 1);
+    QVector<QByteArray> blocks(blockCount);
+    QVector<quint32> crcs(blockCount);
+    QByteArray * const blockData = blocks.data(); // Fetched here, so workers never detach.
+    quint32 * const crcData = crcs.data();
+    QAtomicInt failed(0);
+
+    // Compress one block per chunk, on this thread, and on the global QThreadPool.
+    ParallelMap::map(blockCount, 1, [&](const int begin, const int end) {
+        for (int index = begin; index < end; ++index) {
+            if (!compressBlock(data, level, blockSize, index, blockData[index], crcData[index])) {
+                failed.storeRelease(1);
+            }
+        }
+    });
+    if (failed.loadAcquire()) {
+        return QByteArray();
+    }
+
+    // Header: magic, deflate, no flags, no mtime, no extra flags, unknown OS.
+    QByteArray gzip("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff", 10);
+    uLong crc = crc32(0L, Z_NULL, 0);
+    for (int index = 0; index < blockCount; ++index) {
+        gzip.append(blocks.at(index));
+        const int size = qMin(blockSize, data.size() - (index * blockSize));
+        crc = crc32_combine(crc, crcs.at(index), size);
+    }
+    appendLittleEndian(gzip, static_cast<quint32>(crc));
+    appendLittleEndian(gzip, static_cast<quint32>(data.size()));
+    return gzip;
+}
+
+}}
@@ -0,0 +1,38 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_GZIP_COMPRESSOR_H__
+#define __POLAR_V2_GZIP_COMPRESSOR_H__
+
+#include <QByteArray>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief Compresses data to the gzip format, using all available cores.
+ *
+ * In the style of pigz, the input is split into fixed-size blocks, and each
+ * block is deflated independently (on the global QThreadPool), but primed with
+ * the last 32KB of the preceding block as its dictionary, so the compression
+ * ratio is almost identical to a single deflate stream. Each non-final block
+ * ends on a byte boundary (via a sync flush), so the blocks' outputs can simply
+ * be concatenated into one valid deflate stream. The blocks' CRCs are combined
+ * for the gzip trailer.
+ *
+ * The output does not depend on the number of threads used, so the same input
+ * always produces the same output.
+ */
+class GzipCompressor {
+
+public:
+    static const int DefaultBlockSize;
+
+    static QByteArray compress(const QByteArray &data, const int level = -1,
+                               const int blockSize = DefaultBlockSize);
+
+};
+
+}}
+
+#endif // __POLAR_V2_GZIP_COMPRESSOR_H__
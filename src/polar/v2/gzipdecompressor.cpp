@@ -0,0 +1,134 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "gzipdecompressor.h"
+
+#include <QDebug>
+#include <QtEndian>
+
+#include <limits>
+
+#ifdef Q_CC_MSVC
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+namespace polar {
+namespace v2 {
+
+namespace {
+
+// Deflate cannot expand data by more than 1032:1, so larger ISIZE values must
+// be wrong (or modulo 2^32), and are left to the incremental path.
+const qint64 MAX_COMPRESSION_RATIO = 1032;
+
+}
+
+/**
+ * @brief Decompresses gzip or zlib \a data.
+ *
+ * @param data              Data to decompress.
+ * @param initialBufferSize Initial output buffer size, for data that cannot be
+ *                          decompressed in a single pass.
+ *
+ * @return The decompressed data, or an empty array on error.
+ */
+QByteArray GzipDecompressor::decompress(const QByteArray &data, const int initialBufferSize)
+{
+    QByteArray result;
+    return (decompressWhole(data, result)) ? result
+        : decompressIncrementally(data, initialBufferSize);
+}
+
+/**
+ * @brief Decompresses a single-member gzip file in one pass.
+ *
+ * @return \c true if \a data was decompressed (and verified) into \a result,
+ *         otherwise \c false, in which case \a data should be decompressed
+ *         incrementally instead.
+ */
+bool GzipDecompressor::decompressWhole(const QByteArray &data, QByteArray &result)
+{
+    // Minimal gzip header (10 bytes) and trailer (8 bytes), with deflate method.
+    if ((data.size() < 18) || (!data.startsWith("\x1f\x8b\x08"))) {
+        return false;
+    }
+    const quint32 size = qFromLittleEndian<quint32>(
+        reinterpret_cast<const uchar *>(data.constData() + data.size() - 4));
+    if (size > qMin(static_cast<qint64>(data.size()) * MAX_COMPRESSION_RATIO,
+                    static_cast<qint64>(std::numeric_limits<int>::max() - 1))) {
+        return false;
+    }
+
+    // Allocate one spare byte, so any output beyond ISIZE is detected.
+    result.resize(static_cast<int>(size) + 1);
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.next_in = (Bytef *) data.data();
+    stream.avail_in = data.length();
+    stream.next_out = (Bytef *) result.data();
+    stream.avail_out = result.size();
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+        qWarning() << "inflateInit2 failed" << stream.msg;
+        return false;
+    }
+
+    // With the gzip wrapper, zlib verifies the trailer's CRC32 and ISIZE itself.
+    const int z_result = inflate(&stream, Z_FINISH);
+    const bool ok = ((z_result == Z_STREAM_END) && (stream.avail_in == 0) &&
+                     (stream.total_out == size));
+    inflateEnd(&stream);
+    if (ok) {
+        result.chop(1);
+    }
+    return ok;
+}
+
+QByteArray GzipDecompressor::decompressIncrementally(const QByteArray &data,
+                                                     const int initialBufferSize)
+{
+    Q_ASSERT(initialBufferSize > 0);
+    QByteArray result;
+    result.resize(initialBufferSize);
+
+    // Prepare a zlib stream structure.
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.next_in = (Bytef *) data.data();
+    stream.avail_in = data.length();
+    stream.next_out = (Bytef *) result.data();
+    stream.avail_out = result.size();
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+
+    // Decompress the data.
+    int z_result;
+    for (z_result = inflateInit2(&stream, 15 + 32); z_result == Z_OK;) {
+        if ((z_result = inflate(&stream, Z_SYNC_FLUSH)) == Z_OK) {
+            const int oldSize = result.size();
+            result.resize(result.size() * 2);
+            stream.next_out = (Bytef *)(result.data() + oldSize);
+            stream.avail_out = oldSize;
+        }
+    }
+
+    // Check for errors.
+    if (z_result != Z_STREAM_END) {
+        qWarning() << "zlib error" << z_result << stream.msg;
+        inflateEnd(&stream);
+        return QByteArray();
+    }
+
+    // Free any allocated resources.
+    if ((z_result = inflateEnd(&stream)) != Z_OK) {
+        qWarning() << "inflateEnd returned" << z_result << stream.msg;
+    }
+
+    // Return the decompressed data.
+    result.chop(stream.avail_out);
+    return result;
+}
+
+}}
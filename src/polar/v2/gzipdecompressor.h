@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_GZIP_DECOMPRESSOR_H__
+#define __POLAR_V2_GZIP_DECOMPRESSOR_H__
+
+#include <QByteArray>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief Decompresses gzip (and zlib) data.
+ *
+ * Polar's gzipped sub-files are small, single-member gzip files, so these are
+ * decompressed in a single pass, straight into a buffer sized from the gzip
+ * ISIZE trailer, with zlib verifying the CRC32 and size as it finishes. Any
+ * data that doesn't fit that fast path (such as zlib streams, multi-member
+ * gzip files, or inconsistent trailers) falls back to incremental inflation
+ * into a growing buffer.
+ */
+class GzipDecompressor {
+
+public:
+    static QByteArray decompress(const QByteArray &data, const int initialBufferSize = 10240);
+
+protected:
+    static bool decompressWhole(const QByteArray &data, QByteArray &result);
+    static QByteArray decompressIncrementally(const QByteArray &data, const int initialBufferSize);
+
+};
+
+}}
+
+#endif // __POLAR_V2_GZIP_DECOMPRESSOR_H__
@@ -0,0 +1,282 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "hrvmetrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+namespace polar {
+namespace v2 {
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+// Intervals outside this range (in milliseconds) are treated as artifacts.
+const quint32 MIN_INTERVAL = 300;
+const quint32 MAX_INTERVAL = 2000;
+
+const double RESAMPLE_RATE = 4.0; // Hz.
+const int SEGMENT_SIZE     = 1024; // Resampled intervals per Welch segment (256s).
+const int MIN_SEGMENT_SIZE = 256;  // Shortest analysable window (64s).
+
+const double LF_LOW  = 0.04; // Hz.
+const double LF_HIGH = 0.15;
+const double HF_HIGH = 0.40;
+
+typedef std::complex<double> Complex;
+
+// In-place, iterative, radix-2 FFT; data's size must be a power of two.
+void fft(QVector<Complex> &data)
+{
+    const int size = data.size();
+    for (int index = 1, reversed = 0; index < size; ++index) {
+        int bit = size >> 1;
+        for (; reversed & bit; bit >>= 1) {
+            reversed ^= bit;
+        }
+        reversed ^= bit;
+        if (index < reversed) {
+            std::swap(data[index], data[reversed]);
+        }
+    }
+    for (int length = 2; length <= size; length <<= 1) {
+        const Complex step = std::polar(1.0, -2.0 * PI / length);
+        for (int start = 0; start < size; start += length) {
+            Complex twiddle(1.0, 0.0);
+            for (int offset = 0; offset < length / 2; ++offset) {
+                const Complex even = data[start + offset];
+                const Complex odd = data[start + offset + length / 2] * twiddle;
+                data[start + offset] = even + odd;
+                data[start + offset + length / 2] = even - odd;
+                twiddle *= step;
+            }
+        }
+    }
+}
+
+}
+
+HrvMetrics::HrvMetrics()
+    : nnCount(0), artifacts(0), differenceCount(0), nn50Count(0), mean(0.0),
+      sumOfSquares(0.0), sumOfSquaredDifferences(0.0), haveFrequency(false), lf(0.0), hf(0.0)
+{
+
+}
+
+/**
+ * @brief Analyses \a count contiguous \a intervals, in milliseconds.
+ */
+HrvMetrics::HrvMetrics(const quint32 * const intervals, const int count)
+    : nnCount(0), artifacts(0), differenceCount(0), nn50Count(0), mean(0.0),
+      sumOfSquares(0.0), sumOfSquaredDifferences(0.0), haveFrequency(false), lf(0.0), hf(0.0)
+{
+    // The (NN) intervals, and the times at which they ended, for resampling.
+    QVector<double> times, values;
+    times.reserve(count);
+    values.reserve(count);
+
+    double time = 0.0;
+    bool previousValid = false;
+    for (int index = 0; index < count; ++index) {
+        const quint32 interval = intervals[index];
+        time += interval;
+        if ((interval < MIN_INTERVAL) || (interval > MAX_INTERVAL)) {
+            ++artifacts;
+            previousValid = false;
+            continue;
+        }
+
+        // Welford's running mean and sum of squared deviations.
+        const double value = interval;
+        const double delta = value - mean;
+        mean += delta / ++nnCount;
+        sumOfSquares += delta * (value - mean);
+
+        if (previousValid) {
+            const double difference = value - values.last();
+            sumOfSquaredDifferences += difference * difference;
+            nn50Count += (std::fabs(difference) > 50.0) ? 1 : 0;
+            ++differenceCount;
+        }
+        previousValid = true;
+        times.append(time);
+        values.append(value);
+    }
+
+    analyseFrequencyDomain(times, values);
+}
+
+/// Returns the number of (NN) intervals analysed, excluding artifacts.
+int HrvMetrics::count() const
+{
+    return nnCount;
+}
+
+/// Returns the number of intervals skipped as artifacts.
+int HrvMetrics::artifactCount() const
+{
+    return artifacts;
+}
+
+/// Returns the mean NN interval, in milliseconds.
+double HrvMetrics::meanInterval() const
+{
+    return mean;
+}
+
+/// Returns the mean heart rate, in beats per minute, or 0 if there were no intervals.
+double HrvMetrics::meanHeartrate() const
+{
+    return (mean > 0.0) ? (60000.0 / mean) : 0.0;
+}
+
+/// Returns the (sample) standard deviation of the NN intervals, in milliseconds.
+double HrvMetrics::sdnn() const
+{
+    return (nnCount < 2) ? 0.0 : std::sqrt(sumOfSquares / (nnCount - 1));
+}
+
+/// Returns the root mean square of successive differences, in milliseconds.
+double HrvMetrics::rmssd() const
+{
+    return (differenceCount == 0) ? 0.0 : std::sqrt(sumOfSquaredDifferences / differenceCount);
+}
+
+/// Returns the percentage of successive differences greater than 50ms.
+double HrvMetrics::pnn50() const
+{
+    return (differenceCount == 0) ? 0.0 : (100.0 * nn50Count / differenceCount);
+}
+
+/// Returns \c true if the intervals spanned long enough for frequency-domain metrics.
+bool HrvMetrics::haveFrequencyDomain() const
+{
+    return haveFrequency;
+}
+
+/// Returns the low frequency (0.04 to 0.15Hz) power, in square milliseconds.
+double HrvMetrics::lfPower() const
+{
+    return lf;
+}
+
+/// Returns the high frequency (0.15 to 0.4Hz) power, in square milliseconds.
+double HrvMetrics::hfPower() const
+{
+    return hf;
+}
+
+/// Returns the ratio of LF to HF power, or 0 if there was no HF power.
+double HrvMetrics::lfHfRatio() const
+{
+    return (hf > 0.0) ? (lf / hf) : 0.0;
+}
+
+/**
+ * @brief Returns the metrics as a map, suitable for JSON output.
+ *
+ * The frequency-domain metrics are only included if haveFrequencyDomain().
+ */
+QVariantMap HrvMetrics::toMap() const
+{
+    QVariantMap map;
+    map.insert(QLatin1String("intervals"), nnCount);
+    map.insert(QLatin1String("artifacts"), artifacts);
+    if (nnCount > 0) {
+        map.insert(QLatin1String("mean-rr"), meanInterval());
+        map.insert(QLatin1String("mean-heartrate"), meanHeartrate());
+        map.insert(QLatin1String("sdnn"), sdnn());
+    }
+    if (differenceCount > 0) {
+        map.insert(QLatin1String("rmssd"), rmssd());
+        map.insert(QLatin1String("pnn50"), pnn50());
+    }
+    if (haveFrequency) {
+        map.insert(QLatin1String("lf-power"), lfPower());
+        map.insert(QLatin1String("hf-power"), hfPower());
+        map.insert(QLatin1String("lf-hf-ratio"), lfHfRatio());
+    }
+    return map;
+}
+
+/**
+ * @brief Estimates LF and HF power from NN \a values ending at \a times.
+ *
+ * The intervals are linearly interpolated at RESAMPLE_RATE, then Welch's method
+ * averages the periodograms of 50%-overlapping, Hann-windowed segments.
+ */
+void HrvMetrics::analyseFrequencyDomain(const QVector<double> &times, const QVector<double> &values)
+{
+    if (times.size() < 2) {
+        return;
+    }
+
+    // Resample the intervals evenly.
+    const double period = 1000.0 / RESAMPLE_RATE;
+    const int resampledCount = static_cast<int>((times.last() - times.first()) / period) + 1;
+    if (resampledCount < MIN_SEGMENT_SIZE) {
+        return;
+    }
+    QVector<double> resampled(resampledCount);
+    for (int index = 0, source = 0; index < resampledCount; ++index) {
+        const double time = times.first() + index * period;
+        while ((source < times.size() - 2) && (times.at(source + 1) < time)) {
+            ++source;
+        }
+        const double fraction = (time - times.at(source)) / (times.at(source + 1) - times.at(source));
+        resampled[index] = values.at(source) + fraction * (values.at(source + 1) - values.at(source));
+    }
+
+    // Prepare the segments' window, zero-padded to a power of two if need be.
+    const int segmentSize = qMin(SEGMENT_SIZE, resampledCount);
+    int fftSize = 1;
+    while (fftSize < segmentSize) {
+        fftSize <<= 1;
+    }
+    QVector<double> window(segmentSize);
+    double windowPower = 0.0;
+    for (int index = 0; index < segmentSize; ++index) {
+        window[index] = 0.5 - 0.5 * std::cos(2.0 * PI * index / (segmentSize - 1));
+        windowPower += window.at(index) * window.at(index);
+    }
+
+    // Average the segments' one-sided power spectra.
+    QVector<double> power(fftSize / 2 + 1, 0.0);
+    QVector<Complex> spectrum(fftSize);
+    int segmentCount = 0;
+    for (int start = 0; start + segmentSize <= resampledCount; start += segmentSize / 2) {
+        double segmentMean = 0.0;
+        for (int index = 0; index < segmentSize; ++index) {
+            segmentMean += resampled.at(start + index);
+        }
+        segmentMean /= segmentSize;
+        for (int index = 0; index < fftSize; ++index) {
+            spectrum[index] = (index < segmentSize)
+                ? Complex((resampled.at(start + index) - segmentMean) * window.at(index), 0.0)
+                : Complex(0.0, 0.0);
+        }
+        fft(spectrum);
+        for (int index = 0; index < power.size(); ++index) {
+            power[index] += std::norm(spectrum.at(index));
+        }
+        ++segmentCount;
+    }
+
+    // Integrate the power spectral density (in ms^2/Hz) over each band.
+    const double resolution = RESAMPLE_RATE / fftSize;
+    const double scale = 2.0 / (RESAMPLE_RATE * windowPower * segmentCount);
+    for (int index = 1; index < power.size(); ++index) {
+        const double frequency = index * resolution;
+        if ((frequency >= LF_LOW) && (frequency < LF_HIGH)) {
+            lf += power.at(index) * scale * resolution;
+        } else if ((frequency >= LF_HIGH) && (frequency < HF_HIGH)) {
+            hf += power.at(index) * scale * resolution;
+        }
+    }
+    haveFrequency = true;
+}
+
+}}
@@ -0,0 +1,64 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_HRV_METRICS_H__
+#define __POLAR_V2_HRV_METRICS_H__
+
+#include <QVariantMap>
+#include <QVector>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief Heart rate variability metrics of a run of R-R intervals.
+ *
+ * The time-domain metrics (SDNN, RMSSD and pNN50) are accumulated in a single
+ * pass over the intervals. The frequency-domain metrics (LF and HF power) are
+ * then estimated from the same intervals, resampled evenly at 4Hz, via Welch's
+ * method: averaging the FFTs of overlapping, Hann-windowed segments of 256s.
+ *
+ * Intervals outside the physiological range of 300 to 2000ms are treated as
+ * artifacts: they are skipped, along with any successive differences they are
+ * part of, but still count towards the elapsed time.
+ */
+class HrvMetrics {
+
+public:
+    HrvMetrics();
+    HrvMetrics(const quint32 * const intervals, const int count);
+
+    int count() const;
+    int artifactCount() const;
+    double meanInterval() const;
+    double meanHeartrate() const;
+    double sdnn() const;
+    double rmssd() const;
+    double pnn50() const;
+
+    bool haveFrequencyDomain() const;
+    double lfPower() const;
+    double hfPower() const;
+    double lfHfRatio() const;
+
+    QVariantMap toMap() const;
+
+protected:
+    int nnCount;
+    int artifacts;
+    int differenceCount;
+    int nn50Count;
+    double mean;
+    double sumOfSquares;            ///< Sum of squared deviations from the mean.
+    double sumOfSquaredDifferences; ///< Sum of squared successive differences.
+    bool haveFrequency;
+    double lf;
+    double hf;
+
+    void analyseFrequencyDomain(const QVector<double> &times, const QVector<double> &values);
+
+};
+
+}}
+
+#endif // __POLAR_V2_HRV_METRICS_H__
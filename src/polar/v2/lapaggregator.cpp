@@ -0,0 +1,124 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "lapaggregator.h"
+
+#include <limits>
+
+namespace polar {
+namespace v2 {
+
+namespace {
+
+// Index of the highest bit set in (positive) \a value, ie floor(log2(value)).
+inline int highestBit(int value)
+{
+    int bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+}
+
+}
+
+LapAggregator::LapAggregator()
+    : prefixSums(1, 0.0), prefixCounts(1, 0)
+{
+
+}
+
+LapAggregator::LapAggregator(const QVariantList &samples, const QBitArray &offline)
+{
+    QVector<double> values(samples.size());
+    QVector<quint8> valid(samples.size());
+    for (int index = 0; index < samples.size(); ++index) {
+        bool ok = false;
+        values[index] = samples.at(index).toDouble(&ok);
+        valid[index] = ((ok) && ((index >= offline.size()) || (!offline.testBit(index)))) ? 1 : 0;
+    }
+    aggregate(values.constData(), valid.constData(), values.size());
+}
+
+/**
+ * @brief Aggregates an already-decoded channel, such as from SampleChannels.
+ *
+ * @param values Sample values.
+ * @param valid  Non-zero for each sample in \a values that is valid.
+ * @param count  Number of samples in \a values and \a valid.
+ */
+LapAggregator::LapAggregator(const double * const values, const quint8 * const valid, const int count)
+{
+    aggregate(values, valid, count);
+}
+
+void LapAggregator::aggregate(const double * const values, const quint8 * const valid, const int count)
+{
+    const double infinity = std::numeric_limits<double>::infinity();
+    prefixSums.resize(count + 1);
+    prefixCounts.resize(count + 1);
+
+    // Level 0 of the sparse tables is the samples themselves, with invalid
+    // samples set to values that can never be a window's minimum or maximum.
+    minimums.append(QVector<double>(count));
+    maximums.append(QVector<double>(count));
+    prefixSums[0] = 0.0;
+    prefixCounts[0] = 0;
+    for (int index = 0; index < count; ++index) {
+        const double value = values[index];
+        const bool isValid = (valid[index] != 0) && (value == value); // ie !isnan.
+        prefixSums[index + 1] = prefixSums.at(index) + ((isValid) ? value : 0.0);
+        prefixCounts[index + 1] = prefixCounts.at(index) + ((isValid) ? 1 : 0);
+        minimums[0][index] = (isValid) ? value :  infinity;
+        maximums[0][index] = (isValid) ? value : -infinity;
+    }
+
+    // Each further level covers windows twice as long as the level before.
+    for (int level = 1, width = 2; width <= count; ++level, width *= 2) {
+        const QVector<double> &previousMinimums = minimums.at(level - 1);
+        const QVector<double> &previousMaximums = maximums.at(level - 1);
+        QVector<double> levelMinimums(count - width + 1), levelMaximums(count - width + 1);
+        for (int index = 0; index < levelMinimums.size(); ++index) {
+            levelMinimums[index] = qMin(previousMinimums.at(index), previousMinimums.at(index + width / 2));
+            levelMaximums[index] = qMax(previousMaximums.at(index), previousMaximums.at(index + width / 2));
+        }
+        minimums.append(levelMinimums);
+        maximums.append(levelMaximums);
+    }
+}
+
+/// Returns the number of samples (valid or not) being aggregated.
+int LapAggregator::size() const
+{
+    return prefixCounts.size() - 1;
+}
+
+/**
+ * @brief Summarises the samples from index \a begin (inclusive) to \a end (exclusive).
+ *
+ * Indexes outside the range of samples are ignored.
+ */
+LapAggregator::Stats LapAggregator::stats(int begin, int end) const
+{
+    begin = qMax(begin, 0);
+    end = qMin(end, size());
+
+    Stats stats = { 0, 0.0, 0.0, 0.0 };
+    if (begin >= end) {
+        return stats;
+    }
+    stats.count = prefixCounts.at(end) - prefixCounts.at(begin);
+    if (stats.count == 0) {
+        return stats;
+    }
+    stats.average = (prefixSums.at(end) - prefixSums.at(begin)) / stats.count;
+
+    // Two (possibly overlapping) power-of-two windows cover the whole range.
+    const int level = highestBit(end - begin);
+    const int second = end - (1 << level);
+    stats.minimum = qMin(minimums.at(level).at(begin), minimums.at(level).at(second));
+    stats.maximum = qMax(maximums.at(level).at(begin), maximums.at(level).at(second));
+    return stats;
+}
+
+}}
@@ -0,0 +1,53 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_LAP_AGGREGATOR_H__
+#define __POLAR_V2_LAP_AGGREGATOR_H__
+
+#include <QBitArray>
+#include <QVariantList>
+#include <QVector>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief Summarises arbitrary windows of a channel of samples in constant time.
+ *
+ * Prefix sums (for averages) and sparse tables (for minimums and maximums) are
+ * built once, in O(n log n) time, so that any number of laps, or user-defined
+ * splits, can then be summarised without re-scanning their samples.
+ *
+ * Samples that are not numeric, or are flagged in the \a offline mask, are left
+ * out of all statistics.
+ */
+class LapAggregator {
+
+public:
+    struct Stats {
+        int count;      ///< Number of samples summarised; the rest are only valid if > 0.
+        double average;
+        double minimum;
+        double maximum;
+    };
+
+    LapAggregator();
+    explicit LapAggregator(const QVariantList &samples, const QBitArray &offline = QBitArray());
+    LapAggregator(const double * const values, const quint8 * const valid, const int count);
+
+    int size() const;
+    Stats stats(int begin, int end) const;
+
+protected:
+    QVector<double> prefixSums;   ///< Sum of the valid samples before each index.
+    QVector<int>    prefixCounts; ///< Number of valid samples before each index.
+    QVector<QVector<double> > minimums; ///< Level k holds the minimum of 2^k samples.
+    QVector<QVector<double> > maximums; ///< Level k holds the maximum of 2^k samples.
+
+    void aggregate(const double * const values, const quint8 * const valid, const int count);
+
+};
+
+}}
+
+#endif // __POLAR_V2_LAP_AGGREGATOR_H__
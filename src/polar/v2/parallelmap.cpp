@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "parallelmap.h"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+namespace polar {
+namespace v2 {
+
+// State shared by all threads mapping one index range. Workers that start after
+// all chunks have been taken simply exit, without calling the function, whose
+// captured state may well have been destroyed by then.
+struct ParallelMap::Job {
+    ChunkFunction function;
+    int count;
+    int chunkSize;
+    int chunkCount;
+    QAtomicInt nextChunk;
+    QAtomicInt remainingChunks;
+    QMutex mutex;
+    QWaitCondition finished;
+};
+
+class ParallelMap::Worker : public QRunnable {
+
+public:
+    explicit Worker(const QSharedPointer<Job> &job) : job(job)
+    {
+
+    }
+
+    virtual void run()
+    {
+        mapChunks(*job);
+    }
+
+protected:
+    QSharedPointer<Job> job;
+
+};
+
+/**
+ * @brief Calls \a function for all indexes 0 to \a count - 1, in chunks of
+ *        \a chunkSize, returning once all are done.
+ */
+void ParallelMap::map(const int count, const int chunkSize, const ChunkFunction &function)
+{
+    const int size = qMax(chunkSize, 1);
+    if (count <= size) {
+        if (count > 0) {
+            function(0, count);
+        }
+        return;
+    }
+
+    QSharedPointer<Job> job(new Job);
+    job->function = function;
+    job->count = count;
+    job->chunkSize = size;
+    job->chunkCount = (count + size - 1) / size;
+    job->nextChunk.storeRelease(0);
+    job->remainingChunks.storeRelease(job->chunkCount);
+
+    // Map on this thread, and up to one other thread per remaining chunk.
+    QThreadPool * const pool = QThreadPool::globalInstance();
+    for (int threads = qMin(job->chunkCount, pool->maxThreadCount()) - 1; threads > 0; --threads) {
+        pool->start(new Worker(job));
+    }
+    mapChunks(*job);
+
+    QMutexLocker locker(&job->mutex);
+    while (job->remainingChunks.loadAcquire() > 0) {
+        job->finished.wait(&job->mutex);
+    }
+}
+
+void ParallelMap::mapChunks(Job &job)
+{
+    for (int chunk = job.nextChunk.fetchAndAddOrdered(1); chunk < job.chunkCount;
+         chunk = job.nextChunk.fetchAndAddOrdered(1)) {
+        const int begin = chunk * job.chunkSize;
+        job.function(begin, qMin(begin + job.chunkSize, job.count));
+        if (!job.remainingChunks.deref()) {
+            QMutexLocker locker(&job.mutex);
+            job.finished.wakeAll();
+        }
+    }
+}
+
+}}
@@ -0,0 +1,42 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_PARALLEL_MAP_H__
+#define __POLAR_V2_PARALLEL_MAP_H__
+
+#include <functional>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief Runs a function over an index range, in chunks, using all available cores.
+ *
+ * The index range is split into fixed-size chunks, and each chunk is passed to
+ * the function on the calling thread, and on the global QThreadPool. Functions
+ * write each chunk's results to their own slots of a pre-sized buffer, so the
+ * caller can then consume the results in index order, exactly as if they had
+ * been produced sequentially.
+ *
+ * The calling thread takes chunks too, so map never waits on pool threads that
+ * have not yet started, and is safe to call from a pool thread itself.
+ */
+class ParallelMap {
+
+public:
+    /// Processes indexes \a begin (inclusive) to \a end (exclusive).
+    /// @note May be called concurrently, for other (disjoint) ranges.
+    typedef std::function<void (const int begin, const int end)> ChunkFunction;
+
+    static void map(const int count, const int chunkSize, const ChunkFunction &function);
+
+private:
+    struct Job;
+    class Worker;
+    static void mapChunks(Job &job);
+
+};
+
+}}
+
+#endif // __POLAR_V2_PARALLEL_MAP_H__
@@ -0,0 +1,48 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "parsedsession.h"
+
+namespace polar {
+namespace v2 {
+
+ParsedSession::ParsedSession()
+{
+
+}
+
+ParsedSession::ParsedSession(const QString &baseName, const QVariantMap &exercises,
+                             const QVariantMap &physicalInformation,
+                             const QVariantMap &session)
+    : sessionBaseName(baseName), parsedExercises(exercises),
+      parsedPhysicalInformation(physicalInformation), parsedSession(session)
+{
+
+}
+
+QString ParsedSession::baseName() const
+{
+    return sessionBaseName;
+}
+
+const QVariantMap &ParsedSession::exercises() const
+{
+    return parsedExercises;
+}
+
+const QVariantMap &ParsedSession::physicalInformation() const
+{
+    return parsedPhysicalInformation;
+}
+
+const QVariantMap &ParsedSession::session() const
+{
+    return parsedSession;
+}
+
+bool ParsedSession::isValid() const
+{
+    return !parsedExercises.isEmpty();
+}
+
+}}
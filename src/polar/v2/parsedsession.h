@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_PARSED_SESSION_H__
+#define __POLAR_V2_PARSED_SESSION_H__
+
+#include <QString>
+#include <QVariantMap>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief An immutable snapshot of a parsed training session.
+ *
+ * A ParsedSession is built once, by TrainingSession::parse, and never modified
+ * after that. All members are implicitly shared, so snapshots are cheap to copy,
+ * and may be read concurrently from any number of threads (embedded messages
+ * that are decoded lazily serialise their own, one-off, decoding).
+ */
+class ParsedSession {
+
+public:
+    ParsedSession();
+    ParsedSession(const QString &baseName, const QVariantMap &exercises,
+                  const QVariantMap &physicalInformation, const QVariantMap &session);
+
+    QString baseName() const;
+    const QVariantMap &exercises() const;
+    const QVariantMap &physicalInformation() const;
+    const QVariantMap &session() const;
+
+    bool isValid() const;
+
+private:
+    QString sessionBaseName;
+    QVariantMap parsedExercises;
+    QVariantMap parsedPhysicalInformation;
+    QVariantMap parsedSession;
+
+};
+
+}}
+
+#endif // __POLAR_V2_PARSED_SESSION_H__
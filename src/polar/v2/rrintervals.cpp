@@ -0,0 +1,177 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "rrintervals.h"
+
+#include "lazymessage.h"
+#include "types.h"
+#include "varint.h"
+
+#include <QDebug>
+
+namespace polar {
+namespace v2 {
+
+using ProtoBuf::readLengthDelimited;
+using ProtoBuf::readVarint;
+
+namespace {
+
+// The field, in both "rrsamples" and "heartrate-variability" messages, that holds the intervals.
+const quint64 INTERVALS_TAG = 1;
+
+void appendInterval(QByteArray &intervals, const quint64 value)
+{
+    const quint32 interval = static_cast<quint32>(value); // uint32, as per ProtoBuf::Message.
+    intervals.append(reinterpret_cast<const char *>(&interval), sizeof(interval));
+}
+
+}
+
+RRIntervals::RRIntervals()
+{
+
+}
+
+/**
+ * @brief Wraps an existing array of intervals, such as from toByteArray().
+ *
+ * @param intervals Native-endian quint32 intervals. Any trailing partial
+ *                  interval is ignored.
+ */
+RRIntervals::RRIntervals(const QByteArray &intervals) : intervals(intervals)
+{
+
+}
+
+/**
+ * @brief Decodes the intervals of a (decompressed) "rrsamples" message.
+ *
+ * @param message Raw protobuf "rrsamples" data.
+ *
+ * @return The decoded intervals, or an empty array if \a message is malformed.
+ */
+RRIntervals RRIntervals::fromRRSamples(const QByteArray &message)
+{
+    QByteArray intervals;
+    // Reserve for the worst case, of one (single byte) interval per input byte.
+    intervals.reserve(message.size() * static_cast<int>(sizeof(quint32)));
+    if (!appendIntervals(message, intervals)) {
+        qWarning() << "Ignoring malformed rrsamples data";
+        return RRIntervals();
+    }
+    return RRIntervals(intervals);
+}
+
+/**
+ * @brief Flattens an exercise's "heartrate-variability" blocks into one array.
+ *
+ * Blocks that are still encoded (see ProtoBuf::LazyMessage) are decoded
+ * directly from their raw protobuf data.
+ *
+ * @note Any "offline" ranges are ignored, as there is no way to apply them to
+ *       a flat list of intervals.
+ *
+ * @param samples Parsed "samples" data.
+ */
+RRIntervals RRIntervals::fromSamples(const QVariantMap &samples)
+{
+    const QVariantList blocks = samples.value(QLatin1String("heartrate-variability")).toList();
+
+    // Reserve once, for the worst case of all blocks, rather than once per block.
+    int rawSize = 0;
+    foreach (const QVariant &hrv, blocks) {
+        if (hrv.userType() == qMetaTypeId<ProtoBuf::LazyMessage>()) {
+            rawSize += hrv.value<ProtoBuf::LazyMessage>().rawData().size();
+        }
+    }
+    QByteArray intervals;
+    intervals.reserve(rawSize * static_cast<int>(sizeof(quint32)));
+
+    foreach (const QVariant &hrv, blocks) {
+        if (hrv.userType() == qMetaTypeId<ProtoBuf::LazyMessage>()) {
+            const int size = intervals.size();
+            if (!appendIntervals(hrv.value<ProtoBuf::LazyMessage>().rawData(), intervals)) {
+                qWarning() << "Ignoring malformed heartrate-variability block";
+                intervals.truncate(size);
+            }
+        } else {
+            foreach (const QVariant &interval, hrv.toMap().value(QLatin1String("intervals")).toList()) {
+                appendInterval(intervals, interval.toUInt());
+            }
+        }
+    }
+    return RRIntervals(intervals);
+}
+
+/// @return \c true if there are no intervals.
+bool RRIntervals::isEmpty() const
+{
+    return size() == 0;
+}
+
+/// @return The number of intervals.
+int RRIntervals::size() const
+{
+    return intervals.size() / static_cast<int>(sizeof(quint32));
+}
+
+/// @return The interval at \a index, which must be valid.
+quint32 RRIntervals::at(const int index) const
+{
+    Q_ASSERT((index >= 0) && (index < size()));
+    return constData()[index];
+}
+
+/// @return A pointer to size() contiguous intervals.
+const quint32 * RRIntervals::constData() const
+{
+    return reinterpret_cast<const quint32 *>(intervals.constData());
+}
+
+/// @return The intervals as a (shared, not copied) byte array, for storing in a QVariant.
+QByteArray RRIntervals::toByteArray() const
+{
+    return intervals;
+}
+
+/**
+ * @brief Appends the (packed, or single) intervals in \a message to \a intervals.
+ *
+ * All other fields are skipped, without being decoded.
+ *
+ * @return \c false if \a message is malformed.
+ */
+bool RRIntervals::appendIntervals(const QByteArray &message, QByteArray &intervals)
+{
+    const char * pos = message.constData();
+    const char * const end = pos + message.size();
+
+    quint64 tagAndType;
+    quint64 value;
+    const char * fieldEnd = NULL;
+    while (pos < end) {
+        if (!readVarint(pos, end, tagAndType)) return false;
+        const quint64 tag = tagAndType >> 3;
+        const quint8 wireType = tagAndType & 0x07;
+        if (tag == 0) return false;
+        if (tag != INTERVALS_TAG) {
+            if (!ProtoBuf::skipField(pos, end, wireType)) return false;
+        } else if (wireType == ProtoBuf::Types::Varint) {
+            if (!readVarint(pos, end, value)) return false;
+            appendInterval(intervals, value);
+        } else if (wireType == ProtoBuf::Types::LengthDelimeted) {
+            if (!readLengthDelimited(pos, end, fieldEnd)) return false;
+            // Like ProtoBuf::Message, stop at (but keep what precedes) a truncated packed value.
+            while ((pos < fieldEnd) && (readVarint(pos, fieldEnd, value))) {
+                appendInterval(intervals, value);
+            }
+            pos = fieldEnd;
+        } else if (!ProtoBuf::skipField(pos, end, wireType)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}}
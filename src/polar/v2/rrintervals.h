@@ -0,0 +1,48 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_RR_INTERVALS_H__
+#define __POLAR_V2_RR_INTERVALS_H__
+
+#include <QByteArray>
+#include <QVariantMap>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief Typed array of an exercise's R-R intervals, in milliseconds.
+ *
+ * R-R intervals come either from a separate "rrsamples" file, or from the
+ * "heartrate-variability" blocks interspersed with an exercise's other samples.
+ * Either way, the (packed) intervals are decoded in bulk straight from their raw
+ * protobuf data into one contiguous array of native-endian quint32 values.
+ *
+ * The array is held in an implicitly shared QByteArray, so it can be stored in,
+ * and read back from, a parsed exercise's QVariantMap without being copied.
+ */
+class RRIntervals {
+
+public:
+    RRIntervals();
+    explicit RRIntervals(const QByteArray &intervals);
+
+    static RRIntervals fromRRSamples(const QByteArray &message);
+    static RRIntervals fromSamples(const QVariantMap &samples);
+
+    bool isEmpty() const;
+    int size() const;
+    quint32 at(const int index) const;
+    const quint32 * constData() const;
+    QByteArray toByteArray() const;
+
+protected:
+    QByteArray intervals; ///< Native-endian quint32 intervals.
+
+    static bool appendIntervals(const QByteArray &message, QByteArray &intervals);
+
+};
+
+}}
+
+#endif // __POLAR_V2_RR_INTERVALS_H__
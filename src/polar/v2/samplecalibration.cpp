@@ -0,0 +1,112 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "samplecalibration.h"
+
+#include "message.h"
+
+#include <QDebug>
+#include <QVariantMap>
+
+#include <algorithm>
+
+namespace polar {
+namespace v2 {
+
+using ProtoBuf::first;
+
+namespace {
+
+bool startsBefore(const SampleCalibration::Segment &a, const SampleCalibration::Segment &b)
+{
+    return a.startIndex < b.startIndex;
+}
+
+}
+
+SampleCalibration::SampleCalibration()
+{
+
+}
+
+/**
+ * @brief Constructs a calibration from parsed calibration \a entries.
+ *
+ * Entries with missing fields, or unknown operations, are skipped.
+ */
+SampleCalibration::SampleCalibration(const QVariantList &entries)
+{
+    foreach (const QVariant &entry, entries) {
+        const QVariantMap map = entry.toMap();
+        bool startOk = false, valueOk = false;
+        const Segment segment = {
+            first(map.value(QLatin1String("start-index"))).toInt(&startOk),
+            first(map.value(QLatin1String("value"))).toDouble(&valueOk),
+            static_cast<Operation>(first(map.value(QLatin1String("operation"))).toInt())
+        };
+        if ((!startOk) || (!valueOk) || (segment.startIndex < 0) ||
+            ((segment.operation != Multiply) && (segment.operation != Sum))) {
+            qWarning() << "Ignoring invalid calibration entry" << entry;
+            continue;
+        }
+        calibrationSegments.append(segment);
+    }
+    std::stable_sort(calibrationSegments.begin(), calibrationSegments.end(), startsBefore);
+}
+
+/**
+ * @brief Constructs a calibration from already-decoded \a segments, such as
+ *        those SampleChannels reads straight from intervalled samples blocks.
+ *
+ * Segments with negative start indexes, or unknown operations, are skipped.
+ */
+SampleCalibration::SampleCalibration(const QVector<Segment> &segments)
+{
+    foreach (const Segment &segment, segments) {
+        if ((segment.startIndex < 0) ||
+            ((segment.operation != Multiply) && (segment.operation != Sum))) {
+            qWarning() << "Ignoring invalid calibration segment" << segment.startIndex
+                       << segment.value << segment.operation;
+            continue;
+        }
+        calibrationSegments.append(segment);
+    }
+    std::stable_sort(calibrationSegments.begin(), calibrationSegments.end(), startsBefore);
+}
+
+bool SampleCalibration::isEmpty() const
+{
+    return calibrationSegments.isEmpty();
+}
+
+const QVector<SampleCalibration::Segment> &SampleCalibration::segments() const
+{
+    return calibrationSegments;
+}
+
+/**
+ * @brief Calibrates \a count \a values in place.
+ *
+ * Samples before the first entry's start index are left as-is.
+ */
+void SampleCalibration::apply(double * const values, const int count) const
+{
+    for (int index = 0; index < calibrationSegments.size(); ++index) {
+        const Segment &segment = calibrationSegments.at(index);
+        const int begin = qMin(segment.startIndex, count);
+        const int end = (index + 1 < calibrationSegments.size())
+            ? qMin(calibrationSegments.at(index + 1).startIndex, count) : count;
+        const double value = segment.value;
+        if (segment.operation == Multiply) {
+            for (int sample = begin; sample < end; ++sample) {
+                values[sample] *= value;
+            }
+        } else {
+            for (int sample = begin; sample < end; ++sample) {
+                values[sample] += value;
+            }
+        }
+    }
+}
+
+}}
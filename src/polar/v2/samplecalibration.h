@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_SAMPLE_CALIBRATION_H__
+#define __POLAR_V2_SAMPLE_CALIBRATION_H__
+
+#include <QVariantList>
+#include <QVector>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief Applies a channel's calibration entries to its samples.
+ *
+ * Each calibration entry (such as "altitude-calibration") applies from its
+ * start index up to the next entry's start index (or the end of the channel).
+ * So rather than testing every sample against every entry, each entry's span
+ * of samples is calibrated by a single, branch-free multiply or add loop.
+ */
+class SampleCalibration {
+
+public:
+    enum Operation {
+        Multiply = 1,
+        Sum      = 2,
+    };
+
+    struct Segment {
+        int startIndex;
+        double value;
+        Operation operation;
+    };
+
+    SampleCalibration();
+    explicit SampleCalibration(const QVariantList &entries);
+    explicit SampleCalibration(const QVector<Segment> &segments);
+
+    bool isEmpty() const;
+    const QVector<Segment> &segments() const;
+
+    void apply(double * const values, const int count) const;
+
+protected:
+    QVector<Segment> calibrationSegments; ///< Sorted by start index.
+
+};
+
+}}
+
+#endif // __POLAR_V2_SAMPLE_CALIBRATION_H__
@@ -0,0 +1,733 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "samplechannels.h"
+
+#include "lazymessage.h"
+#include "message.h"
+#include "samplecalibration.h"
+#include "types.h"
+#include "varint.h"
+
+#include <QDebug>
+#include <QtEndian>
+
+#include <algorithm>
+#include <limits>
+
+#include <string.h>
+
+namespace polar {
+namespace v2 {
+
+using ProtoBuf::first;
+using ProtoBuf::readLengthDelimited;
+using ProtoBuf::readVarint;
+using ProtoBuf::skipField;
+
+namespace {
+
+// Sample sources (in intervalled blocks) of this type mark the sensor offline.
+const quint64 OFFLINE_SOURCE_TYPE = 1;
+
+enum FieldKind {
+    UnsignedField, ///< (Packed) uint32 samples.
+    FloatField,    ///< (Packed) float samples.
+    PowerField,    ///< Embedded pedal power messages, with a "current-power".
+};
+
+// The intervalled block fields that hold each channel's samples.
+const struct IntervalledField {
+    quint32 tag;
+    const char * name;
+    SampleChannels::Channel channel;
+    FieldKind kind;
+} INTERVALLED_FIELDS[] = {
+    {  4, "hr-samples",                SampleChannels::Heartrate,           UnsignedField },
+    {  5, "cadence-samples",           SampleChannels::Cadence,             UnsignedField },
+    {  6, "speed-samples",             SampleChannels::Speed,               FloatField    },
+    {  7, "distance-samples",          SampleChannels::Distance,            FloatField    },
+    {  8, "fwd-acceleration",          SampleChannels::ForwardAcceleration, FloatField    },
+    { 10, "altitude-samples",          SampleChannels::Altitude,            FloatField    },
+    { 12, "temperature-samples",       SampleChannels::Temperature,         FloatField    },
+    { 13, "stride-length-samples",     SampleChannels::StrideLength,        UnsignedField },
+    { 15, "left-pedal-power-samples",  SampleChannels::LeftPedalPower,      PowerField    },
+    { 16, "right-pedal-power-samples", SampleChannels::RightPedalPower,     PowerField    },
+};
+const size_t INTERVALLED_FIELD_COUNT = sizeof(INTERVALLED_FIELDS)/sizeof(INTERVALLED_FIELDS[0]);
+
+// The intervalled block fields that hold each calibrated channel's calibration entries.
+const struct CalibrationField {
+    quint32 tag;
+    SampleChannels::Channel channel;
+} CALIBRATION_FIELDS[] = {
+    { 11, SampleChannels::Altitude        },
+    { 14, SampleChannels::StrideLength    },
+    { 17, SampleChannels::LeftPedalPower  },
+    { 18, SampleChannels::RightPedalPower },
+};
+const size_t CALIBRATION_FIELD_COUNT = sizeof(CALIBRATION_FIELDS)/sizeof(CALIBRATION_FIELDS[0]);
+
+struct SourceRange {
+    quint64 type;
+    quint64 start;
+    quint64 stop;
+};
+
+bool readFloat(const char * &pos, const char * const end, double &value)
+{
+    if ((end - pos) < 4) {
+        return false;
+    }
+    const quint32 bits = qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(pos));
+    float number;
+    memcpy(&number, &bits, sizeof(number));
+    value = number;
+    pos += 4;
+    return true;
+}
+
+// Appends the (packed, or single) sample at pos to values.
+bool readSamples(const char * &pos, const char * const end, const quint8 wireType,
+                 const FieldKind kind, QVector<double> &values)
+{
+    double value = 0.0;
+    quint64 number = 0;
+    const char * fieldEnd = NULL;
+    if (kind == PowerField) {
+        if ((wireType != ProtoBuf::Types::LengthDelimeted) || (!readLengthDelimited(pos, end, fieldEnd))) {
+            return false;
+        }
+        // Note, a pedal power sample with no current power is appended as NaN.
+        value = std::numeric_limits<double>::quiet_NaN();
+        while (pos < fieldEnd) {
+            if (!readVarint(pos, fieldEnd, number)) return false;
+            const quint8 innerWireType = number & 0x07;
+            if (((number >> 3) == 1) && (innerWireType == ProtoBuf::Types::Varint)) {
+                if (!readVarint(pos, fieldEnd, number)) return false;
+                value = static_cast<qint32>(number); // int32, so sign-extended to 64 bits.
+            } else if (!skipField(pos, fieldEnd, innerWireType)) {
+                return false;
+            }
+        }
+        values.append(value);
+        return true;
+    }
+
+    if (wireType == ProtoBuf::Types::LengthDelimeted) { // Packed.
+        if (!readLengthDelimited(pos, end, fieldEnd)) return false;
+        values.reserve(values.size() + static_cast<int>((kind == FloatField)
+            ? ((fieldEnd - pos) / 4) : (fieldEnd - pos)));
+        while (pos < fieldEnd) {
+            if (kind == FloatField) {
+                if (!readFloat(pos, fieldEnd, value)) return false;
+            } else {
+                if (!readVarint(pos, fieldEnd, number)) return false;
+                value = static_cast<double>(number);
+            }
+            values.append(value);
+        }
+        return true;
+    }
+
+    if ((kind == FloatField) && (wireType == ProtoBuf::Types::ThirtyTwoBit)) {
+        if (!readFloat(pos, end, value)) return false;
+    } else if ((kind == UnsignedField) && (wireType == ProtoBuf::Types::Varint)) {
+        if (!readVarint(pos, end, number)) return false;
+        value = static_cast<double>(number);
+    } else {
+        return false;
+    }
+    values.append(value);
+    return true;
+}
+
+bool readSourceRange(const char * &pos, const char * const end, SourceRange &range)
+{
+    const char * fieldEnd = NULL;
+    if (!readLengthDelimited(pos, end, fieldEnd)) {
+        return false;
+    }
+    range.type = range.start = range.stop = 0;
+    while (pos < fieldEnd) {
+        quint64 tagAndType;
+        if (!readVarint(pos, fieldEnd, tagAndType)) return false;
+        const quint8 wireType = tagAndType & 0x07;
+        quint64 * const value = ((tagAndType >> 3) == 1) ? &range.type
+                              : ((tagAndType >> 3) == 2) ? &range.start
+                              : ((tagAndType >> 3) == 3) ? &range.stop : NULL;
+        if ((value != NULL) && (wireType == ProtoBuf::Types::Varint)) {
+            if (!readVarint(pos, fieldEnd, *value)) return false;
+        } else if (!skipField(pos, fieldEnd, wireType)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool readCalibration(const char * &pos, const char * const end, SampleCalibration::Segment &segment)
+{
+    const char * fieldEnd = NULL;
+    if (!readLengthDelimited(pos, end, fieldEnd)) {
+        return false;
+    }
+    quint64 startIndex = 0, operation = 0;
+    segment.value = 0.0;
+    while (pos < fieldEnd) {
+        quint64 tagAndType;
+        if (!readVarint(pos, fieldEnd, tagAndType)) return false;
+        const quint8 wireType = tagAndType & 0x07;
+        if (((tagAndType >> 3) == 1) && (wireType == ProtoBuf::Types::Varint)) {
+            if (!readVarint(pos, fieldEnd, startIndex)) return false;
+        } else if (((tagAndType >> 3) == 2) && (wireType == ProtoBuf::Types::ThirtyTwoBit)) {
+            if (!readFloat(pos, fieldEnd, segment.value)) return false;
+        } else if (((tagAndType >> 3) == 3) && (wireType == ProtoBuf::Types::Varint)) {
+            if (!readVarint(pos, fieldEnd, operation)) return false;
+        } else if (!skipField(pos, fieldEnd, wireType)) {
+            return false;
+        }
+    }
+    segment.startIndex = static_cast<int>(qMin(startIndex, static_cast<quint64>(std::numeric_limits<int>::max())));
+    segment.operation = static_cast<SampleCalibration::Operation>(operation);
+    return true;
+}
+
+// Clears the valid flags of samples within any offline source ranges.
+void applySourceRanges(const QVector<double> &values, QVector<quint8> &valid,
+                       const QVector<SourceRange> &ranges)
+{
+    valid.resize(values.size());
+    for (int index = 0; index < values.size(); ++index) {
+        valid[index] = (values.at(index) == values.at(index)) ? 1 : 0; // ie !isnan.
+    }
+    foreach (const SourceRange &range, ranges) {
+        if (range.type != OFFLINE_SOURCE_TYPE) {
+            continue;
+        }
+        const quint64 stop = qMin(range.stop, static_cast<quint64>(valid.size() - 1));
+        for (quint64 index = range.start; index <= stop; ++index) {
+            valid[static_cast<int>(index)] = 0;
+        }
+    }
+}
+
+// Equal, treating NaN (ie unparsable) samples as equal to each other.
+bool sameValues(const QVector<double> &a, const QVector<double> &b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (int index = 0; index < a.size(); ++index) {
+        if ((a.at(index) != b.at(index)) &&
+            ((a.at(index) == a.at(index)) || (b.at(index) == b.at(index)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int registerSampleChannelsMetaType()
+{
+    const int typeId = qRegisterMetaType<SampleChannels>();
+    qRegisterMetaTypeStreamOperators<SampleChannels>("polar::v2::SampleChannels");
+    #if (QT_VERSION >= QT_VERSION_CHECK(5, 5, 0))
+    QMetaType::registerEqualsComparator<SampleChannels>();
+    #endif
+    return typeId;
+}
+
+}
+
+SampleChannels::SampleChannels() : baseInterval(0), count(0)
+{
+    registerMetaType();
+}
+
+/**
+ * @brief Decodes each of an exercise's sample channels.
+ *
+ * @param samples   Parsed "samples" data.
+ * @param calibrate If \c true, apply the channels' calibration entries.
+ */
+SampleChannels::SampleChannels(const QVariantMap &samples, const bool calibrate)
+    : baseInterval(0), count(0)
+{
+    registerMetaType();
+    const QVariantMap recordInterval = first(samples.value(QLatin1String("record-interval"))).toMap();
+    baseInterval =
+        ((( first(recordInterval.value(QLatin1String("hours"))).toLongLong()  * 60
+          + first(recordInterval.value(QLatin1String("minutes"))).toLongLong()) * 60
+          + first(recordInterval.value(QLatin1String("seconds"))).toLongLong()) * 1000
+          + first(recordInterval.value(QLatin1String("milliseconds"))).toLongLong());
+
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        addLegacyChannel(static_cast<Channel>(channel), samples, calibrate);
+    }
+
+    foreach (const QVariant &block, samples.value(QLatin1String("intervalled-samples")).toList()) {
+        if (block.userType() == qMetaTypeId<ProtoBuf::LazyMessage>()) {
+            if (!addIntervalledBlock(block.value<ProtoBuf::LazyMessage>().rawData(), calibrate)) {
+                qWarning() << "Ignoring malformed intervalled samples block";
+            }
+        } else {
+            addIntervalledBlock(block.toMap(), calibrate);
+        }
+    }
+
+    // With no legacy samples to set the record interval, use the finest intervalled one.
+    bool haveLegacy = false;
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        haveLegacy |= ((!series[channel].intervalled) && (!series[channel].values.isEmpty()));
+    }
+    if ((baseInterval <= 0) && (!haveLegacy)) {
+        for (int channel = 0; channel < ChannelCount; ++channel) {
+            const qint64 interval = series[channel].interval;
+            if ((interval > 0) && ((baseInterval <= 0) || (interval < baseInterval))) {
+                baseInterval = interval;
+            }
+        }
+    }
+
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        Series &channelSeries = series[channel];
+        if (!channelSeries.intervalled) {
+            channelSeries.interval = baseInterval;
+            count = qMax(count, channelSeries.values.size());
+        } else if ((baseInterval > 0) && (channelSeries.interval > 0)) {
+            const qint64 duration = channelSeries.values.size() * channelSeries.interval;
+            count = qMax(count, static_cast<int>((duration + baseInterval - 1) / baseInterval));
+        } else {
+            count = qMax(count, channelSeries.values.size());
+        }
+    }
+}
+
+/**
+ * @brief Maps an index into the record-interval timeline onto a channel's own samples.
+ *
+ * @return The index of the \a channel sample at, or just before, the time of
+ *         sample \a sampleIndex, or -1 if the channel has no such sample.
+ */
+int SampleChannels::channelIndex(const Channel channel, const int sampleIndex) const
+{
+    const Series &channelSeries = series[channel];
+    const int index = ((channelSeries.interval == baseInterval) ||
+                       (channelSeries.interval <= 0) || (baseInterval <= 0))
+        ? sampleIndex
+        : static_cast<int>((static_cast<qint64>(sampleIndex) * baseInterval) / channelSeries.interval);
+    return ((sampleIndex < 0) || (index >= channelSeries.values.size())) ? -1 : index;
+}
+
+/// @return Milliseconds between \a channel samples.
+qint64 SampleChannels::interval(const Channel channel) const
+{
+    return series[channel].interval;
+}
+
+/// @return \c true if \a channel was decoded from an intervalled samples block.
+bool SampleChannels::isIntervalled(const Channel channel) const
+{
+    return series[channel].intervalled;
+}
+
+/// @return Milliseconds between samples in the (common) sample timeline.
+qint64 SampleChannels::recordInterval() const
+{
+    return baseInterval;
+}
+
+/// @return Number of samples in the (common) sample timeline.
+int SampleChannels::sampleCount() const
+{
+    return count;
+}
+
+/// @return Number of samples in the (common) sample timeline that \a channel covers.
+int SampleChannels::sampleCount(const Channel channel) const
+{
+    const Series &channelSeries = series[channel];
+    if ((channelSeries.interval == baseInterval) ||
+        (channelSeries.interval <= 0) || (baseInterval <= 0)) {
+        return channelSeries.values.size();
+    }
+    const qint64 duration = channelSeries.values.size() * channelSeries.interval;
+    return static_cast<int>((duration + baseInterval - 1) / baseInterval);
+}
+
+/// @return Number of \a channel samples, at the channel's own interval.
+int SampleChannels::size(const Channel channel) const
+{
+    return series[channel].values.size();
+}
+
+const quint8 * SampleChannels::valid(const Channel channel) const
+{
+    return series[channel].valid.constData();
+}
+
+const double * SampleChannels::values(const Channel channel) const
+{
+    return series[channel].values.constData();
+}
+
+/**
+ * @brief Checks if \a channel has a sample at \a sampleIndex of the (common)
+ *        timeline, but recorded while its sensor was offline (or unparsable).
+ */
+bool SampleChannels::isOffline(const Channel channel, const int sampleIndex) const
+{
+    const int index = channelIndex(channel, sampleIndex);
+    return ((index >= 0) && (!series[channel].valid.at(index)));
+}
+
+/**
+ * @brief Checks if \a channel was offline at sample \a sampleIndex of the (common)
+ *        timeline, as the GPX, TCX and HRM writers have always checked.
+ *
+ * Those writers have only ever treated the first sample of each legacy "offline"
+ * range as offline, and that is kept here so that their output is unchanged.
+ * Intervalled channels are checked as per isOffline.
+ */
+bool SampleChannels::isLegacyOffline(const Channel channel, const int sampleIndex) const
+{
+    const Series &channelSeries = series[channel];
+    if (channelSeries.intervalled) {
+        return isOffline(channel, sampleIndex);
+    }
+    return std::binary_search(channelSeries.offlineStarts.constBegin(),
+                              channelSeries.offlineStarts.constEnd(), sampleIndex);
+}
+
+/**
+ * @brief Gets the \a channel value for sample \a sampleIndex of the (common)
+ *        timeline, whether or not its sensor was online.
+ *
+ * @return \c true if the channel had a (parsable) value at that time.
+ */
+bool SampleChannels::rawValue(const Channel channel, const int sampleIndex, double &value) const
+{
+    const int index = channelIndex(channel, sampleIndex);
+    if (index < 0) {
+        return false;
+    }
+    const double sample = series[channel].values.at(index);
+    if (sample != sample) { // ie isnan.
+        return false;
+    }
+    value = sample;
+    return true;
+}
+
+/**
+ * @brief Gets the \a channel value for sample \a sampleIndex of the (common) timeline.
+ *
+ * @return \c true if the channel had a valid value at that time.
+ */
+bool SampleChannels::value(const Channel channel, const int sampleIndex, double &value) const
+{
+    const int index = channelIndex(channel, sampleIndex);
+    if ((index < 0) || (!series[channel].valid.at(index))) {
+        return false;
+    }
+    value = series[channel].values.at(index);
+    return true;
+}
+
+bool SampleChannels::operator==(const SampleChannels &other) const
+{
+    if ((baseInterval != other.baseInterval) || (count != other.count)) {
+        return false;
+    }
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        const Series &a = series[channel], &b = other.series[channel];
+        if ((a.interval != b.interval) || (a.intervalled != b.intervalled) ||
+            (a.valid != b.valid) || (a.offlineStarts != b.offlineStarts) ||
+            (!sameValues(a.values, b.values))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @return The name of \a channel's legacy "samples" field.
+QString SampleChannels::channelName(const Channel channel)
+{
+    switch (channel) {
+    case Altitude:            return QLatin1String("altitude");
+    case Cadence:             return QLatin1String("cadence");
+    case Distance:            return QLatin1String("distance");
+    case ForwardAcceleration: return QLatin1String("fwd-acceleration");
+    case Heartrate:           return QLatin1String("heartrate");
+    case LeftPedalPower:      return QLatin1String("left-pedal-power");
+    case RightPedalPower:     return QLatin1String("right-pedal-power");
+    case Speed:               return QLatin1String("speed");
+    case StrideLength:        return QLatin1String("stride-length");
+    case Temperature:         return QLatin1String("temperature");
+    case ChannelCount:        break;
+    }
+    return QString();
+}
+
+/// @return The name of \a channel's legacy "samples" offline ranges field.
+QString SampleChannels::offlineName(const Channel channel)
+{
+    switch (channel) {
+    case Altitude:            return QLatin1String("altitude-offline");
+    case Cadence:             return QLatin1String("cadence-offline");
+    case Distance:            return QLatin1String("distance-offline");
+    case ForwardAcceleration: return QLatin1String("fwd-acceleration-offline");
+    case Heartrate:           return QLatin1String("heartrate-offline");
+    case LeftPedalPower:      return QLatin1String("left-pedal-power-offline");
+    case RightPedalPower:     return QLatin1String("right-pedal-power-offline");
+    case Speed:               return QLatin1String("speed-offline");
+    case StrideLength:        return QLatin1String("stride-offline");
+    case Temperature:         return QLatin1String("temperature-offline");
+    case ChannelCount:        break;
+    }
+    return QString();
+}
+
+/// @return The name of \a channel's calibration entries field, or a null string if none.
+QString SampleChannels::calibrationName(const Channel channel)
+{
+    switch (channel) {
+    case Altitude:        return QLatin1String("altitude-calibration");
+    case LeftPedalPower:  return QLatin1String("left-power-calibration");
+    case RightPedalPower: return QLatin1String("right-power-calibration");
+    case StrideLength:    return QLatin1String("stride-calibration");
+    default:              break;
+    }
+    return QString();
+}
+
+/// @return The type of \a channel's parsed values, such as writers format them as.
+QMetaType::Type SampleChannels::valueType(const Channel channel)
+{
+    switch (channel) {
+    case Cadence:
+    case Heartrate:
+    case StrideLength:
+        return QMetaType::UInt;
+    case LeftPedalPower:
+    case RightPedalPower:
+        return QMetaType::Int; // The pedal power messages' "current-power".
+    default:
+        return QMetaType::Float;
+    }
+}
+
+/**
+ * @brief Registers SampleChannels as a QVariant type, with the stream operators
+ *        the session cache needs, and an equality comparator.
+ *
+ * This is done by every constructor, but must also be done before reading any
+ * (cached) SampleChannels from a stream.
+ *
+ * @return The type's meta type ID.
+ */
+int SampleChannels::registerMetaType()
+{
+    static const int typeId = registerSampleChannelsMetaType();
+    return typeId;
+}
+
+void SampleChannels::addLegacyChannel(const Channel channel, const QVariantMap &samples,
+                                      const bool calibrate)
+{
+    const QString name = channelName(channel);
+    const QVariantList list = samples.value(name).toList();
+    if (list.isEmpty()) {
+        return;
+    }
+
+    Series &channelSeries = series[channel];
+    channelSeries.values.resize(list.size());
+    channelSeries.valid.resize(list.size());
+    const bool power = ((channel == LeftPedalPower) || (channel == RightPedalPower));
+    for (int index = 0; index < list.size(); ++index) {
+        bool ok = false;
+        channelSeries.values[index] = (power)
+            ? first(list.at(index).toMap().value(QLatin1String("current-power"))).toDouble(&ok)
+            : list.at(index).toDouble(&ok);
+        channelSeries.valid[index] = (ok) ? 1 : 0;
+    }
+    if ((calibrate) && (!calibrationName(channel).isNull())) {
+        const SampleCalibration calibration(samples.value(calibrationName(channel)).toList());
+        calibration.apply(channelSeries.values.data(), channelSeries.values.size());
+    }
+
+    foreach (const QVariant &entry, samples.value(offlineName(channel)).toList()) {
+        const QVariantMap map = entry.toMap();
+        const QVariant startIndex = first(map.value(QLatin1String("start-index")));
+        const QVariant stopIndex = first(map.value(QLatin1String("stop-index")));
+        if (startIndex.canConvert(QMetaType::Int)) {
+            channelSeries.offlineStarts.append(startIndex.toInt());
+        }
+        if ((!startIndex.canConvert(QMetaType::Int)) ||
+            (!stopIndex.canConvert(QMetaType::Int))) {
+            qWarning() << "Ignoring invalid 'offline' entry" << entry;
+            continue;
+        }
+        const int stop = qMin(stopIndex.toInt(), list.size() - 1);
+        for (int index = qMax(startIndex.toInt(), 0); index <= stop; ++index) {
+            channelSeries.valid[index] = 0;
+        }
+    }
+    std::sort(channelSeries.offlineStarts.begin(), channelSeries.offlineStarts.end());
+}
+
+// Decodes an (already parsed) intervalled block, such as from the session cache.
+void SampleChannels::addIntervalledBlock(const QVariantMap &block, const bool calibrate)
+{
+    QVector<SourceRange> ranges;
+    foreach (const QVariant &entry, block.value(QLatin1String("sample-source")).toList()) {
+        const QVariantMap map = entry.toMap();
+        const SourceRange range = {
+            first(map.value(QLatin1String("sample-source-type"))).toULongLong(),
+            first(map.value(QLatin1String("start-index"))).toULongLong(),
+            first(map.value(QLatin1String("stop-index"))).toULongLong()
+        };
+        ranges.append(range);
+    }
+
+    Series intervalled;
+    intervalled.intervalled = true;
+    intervalled.interval = first(block.value(QLatin1String("rec-interval-ms"))).toLongLong();
+    for (size_t field = 0; field < INTERVALLED_FIELD_COUNT; ++field) {
+        const QVariantList list = block.value(QLatin1String(INTERVALLED_FIELDS[field].name)).toList();
+        if (list.isEmpty()) {
+            continue;
+        }
+        intervalled.values.resize(list.size());
+        for (int index = 0; index < list.size(); ++index) {
+            bool ok = false;
+            intervalled.values[index] = (INTERVALLED_FIELDS[field].kind == PowerField)
+                ? first(list.at(index).toMap().value(QLatin1String("current-power"))).toDouble(&ok)
+                : list.at(index).toDouble(&ok);
+            if (!ok) {
+                intervalled.values[index] = std::numeric_limits<double>::quiet_NaN();
+            }
+        }
+        const QString calibrationKey = calibrationName(INTERVALLED_FIELDS[field].channel);
+        if ((calibrate) && (!calibrationKey.isNull())) {
+            const SampleCalibration calibration(block.value(calibrationKey).toList());
+            calibration.apply(intervalled.values.data(), intervalled.values.size());
+        }
+        applySourceRanges(intervalled.values, intervalled.valid, ranges);
+        addIntervalledSeries(INTERVALLED_FIELDS[field].channel, intervalled);
+    }
+}
+
+// Decodes an intervalled block directly from its raw protobuf data.
+bool SampleChannels::addIntervalledBlock(const QByteArray &block, const bool calibrate)
+{
+    QVector<SourceRange> ranges;
+    QVector<double> values[ChannelCount];
+    QVector<SampleCalibration::Segment> calibrations[ChannelCount];
+    qint64 blockInterval = 0;
+
+    const char * pos = block.constData();
+    const char * const end = pos + block.size();
+    while (pos < end) {
+        quint64 tagAndType;
+        if (!readVarint(pos, end, tagAndType)) {
+            return false;
+        }
+        const quint32 tag = static_cast<quint32>(tagAndType >> 3);
+        const quint8 wireType = tagAndType & 0x07;
+
+        if ((tag == 2) && (wireType == ProtoBuf::Types::Varint)) {
+            quint64 interval;
+            if (!readVarint(pos, end, interval)) return false;
+            blockInterval = static_cast<qint64>(interval);
+            continue;
+        }
+        if ((tag == 3) && (wireType == ProtoBuf::Types::LengthDelimeted)) {
+            SourceRange range;
+            if (!readSourceRange(pos, end, range)) return false;
+            ranges.append(range);
+            continue;
+        }
+
+        size_t calibrationField = 0;
+        while ((calibrationField < CALIBRATION_FIELD_COUNT) &&
+               (CALIBRATION_FIELDS[calibrationField].tag != tag)) {
+            ++calibrationField;
+        }
+        if ((calibrate) && (calibrationField < CALIBRATION_FIELD_COUNT) &&
+            (wireType == ProtoBuf::Types::LengthDelimeted)) {
+            SampleCalibration::Segment segment;
+            if (!readCalibration(pos, end, segment)) return false;
+            calibrations[CALIBRATION_FIELDS[calibrationField].channel].append(segment);
+            continue;
+        }
+
+        size_t field = 0;
+        while ((field < INTERVALLED_FIELD_COUNT) && (INTERVALLED_FIELDS[field].tag != tag)) {
+            ++field;
+        }
+        if (field < INTERVALLED_FIELD_COUNT) {
+            if (!readSamples(pos, end, wireType, INTERVALLED_FIELDS[field].kind,
+                             values[INTERVALLED_FIELDS[field].channel])) {
+                return false;
+            }
+        } else if (!skipField(pos, end, wireType)) {
+            return false;
+        }
+    }
+
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        if (values[channel].isEmpty()) {
+            continue;
+        }
+        Series intervalled;
+        intervalled.intervalled = true;
+        intervalled.interval = blockInterval;
+        intervalled.values = values[channel];
+        if (!calibrations[channel].isEmpty()) {
+            const SampleCalibration calibration(calibrations[channel]);
+            calibration.apply(intervalled.values.data(), intervalled.values.size());
+        }
+        applySourceRanges(intervalled.values, intervalled.valid, ranges);
+        addIntervalledSeries(static_cast<Channel>(channel), intervalled);
+    }
+    return true;
+}
+
+// Adds an intervalled series, unless the channel already has legacy samples, or
+// intervalled samples at a different interval; consecutive blocks for the same
+// channel (and interval) continue the channel.
+void SampleChannels::addIntervalledSeries(const Channel channel, Series &intervalled)
+{
+    Series &channelSeries = series[channel];
+    if (channelSeries.values.isEmpty()) {
+        channelSeries = intervalled;
+    } else if ((channelSeries.intervalled) && (channelSeries.interval == intervalled.interval)) {
+        channelSeries.values += intervalled.values;
+        channelSeries.valid += intervalled.valid;
+    }
+}
+
+QDataStream &operator<<(QDataStream &stream, const SampleChannels &channels)
+{
+    stream << channels.baseInterval << channels.count;
+    for (int channel = 0; channel < SampleChannels::ChannelCount; ++channel) {
+        const SampleChannels::Series &series = channels.series[channel];
+        stream << series.interval << series.intervalled << series.values << series.valid
+               << series.offlineStarts;
+    }
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, SampleChannels &channels)
+{
+    stream >> channels.baseInterval >> channels.count;
+    for (int channel = 0; channel < SampleChannels::ChannelCount; ++channel) {
+        SampleChannels::Series &series = channels.series[channel];
+        stream >> series.interval >> series.intervalled >> series.values >> series.valid
+               >> series.offlineStarts;
+    }
+    return stream;
+}
+
+}}
@@ -0,0 +1,110 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_SAMPLE_CHANNELS_H__
+#define __POLAR_V2_SAMPLE_CHANNELS_H__
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QMetaType>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief Typed view of an exercise's sample channels.
+ *
+ * Samples may be recorded as the legacy top-level channels (all at the one
+ * "record-interval"), or as "intervalled-samples" blocks (each at its own
+ * "rec-interval-ms"), as newer devices do. Either way, each channel is decoded
+ * once into contiguous arrays of values and validity flags, so that writers can
+ * read samples without per-sample QVariant conversions.
+ *
+ * Intervalled blocks that are still encoded (see ProtoBuf::LazyMessage) are
+ * decoded directly from their raw protobuf data. A legacy channel, if present,
+ * takes precedence over any intervalled block for the same channel.
+ *
+ * If requested, each channel's calibration entries (legacy, or each intervalled
+ * block's own) are applied to its decoded values in place (see SampleCalibration).
+ *
+ * Channels are implicitly shared, and may be held in a QVariant, so that each
+ * exercise's samples are decoded just once, when parsed (and cached).
+ */
+class SampleChannels {
+
+public:
+    enum Channel {
+        Altitude,
+        Cadence,
+        Distance,
+        ForwardAcceleration,
+        Heartrate,
+        LeftPedalPower,  ///< Current power, in watts.
+        RightPedalPower, ///< Current power, in watts.
+        Speed,
+        StrideLength,
+        Temperature,
+        ChannelCount
+    };
+
+    SampleChannels();
+    explicit SampleChannels(const QVariantMap &samples, const bool calibrate = false);
+
+    int channelIndex(const Channel channel, const int sampleIndex) const;
+    qint64 interval(const Channel channel) const;
+    bool isIntervalled(const Channel channel) const;
+    qint64 recordInterval() const;
+    int sampleCount() const;
+    int sampleCount(const Channel channel) const;
+    int size(const Channel channel) const;
+    const quint8 * valid(const Channel channel) const;
+    const double * values(const Channel channel) const;
+
+    bool isOffline(const Channel channel, const int sampleIndex) const;
+    bool isLegacyOffline(const Channel channel, const int sampleIndex) const;
+    bool rawValue(const Channel channel, const int sampleIndex, double &value) const;
+    bool value(const Channel channel, const int sampleIndex, double &value) const;
+
+    bool operator==(const SampleChannels &other) const;
+
+    static QString channelName(const Channel channel);
+    static QString offlineName(const Channel channel);
+    static QString calibrationName(const Channel channel);
+    static QMetaType::Type valueType(const Channel channel);
+    static int registerMetaType();
+
+protected:
+    struct Series {
+        qint64 interval;        ///< Milliseconds between samples.
+        bool intervalled;       ///< True if decoded from an intervalled block.
+        QVector<double> values;
+        QVector<quint8> valid;  ///< Non-zero where the sensor was online.
+        QVector<int> offlineStarts; ///< Sorted start indexes of any legacy "offline" ranges.
+        Series() : interval(0), intervalled(false) { }
+    };
+
+    Series series[ChannelCount];
+    qint64 baseInterval;
+    int count;
+
+    void addLegacyChannel(const Channel channel, const QVariantMap &samples, const bool calibrate);
+    void addIntervalledBlock(const QVariantMap &block, const bool calibrate);
+    bool addIntervalledBlock(const QByteArray &block, const bool calibrate);
+    void addIntervalledSeries(const Channel channel, Series &intervalled);
+
+    friend QDataStream &operator<<(QDataStream &stream, const SampleChannels &channels);
+    friend QDataStream &operator>>(QDataStream &stream, SampleChannels &channels);
+
+};
+
+QDataStream &operator<<(QDataStream &stream, const SampleChannels &channels);
+QDataStream &operator>>(QDataStream &stream, SampleChannels &channels);
+
+}}
+
+Q_DECLARE_METATYPE(polar::v2::SampleChannels)
+
+#endif // __POLAR_V2_SAMPLE_CHANNELS_H__
@@ -0,0 +1,104 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "samplesummary.h"
+
+#include <limits>
+
+namespace polar {
+namespace v2 {
+
+namespace {
+
+// Number of independent accumulators for each statistic. Four doubles fill one
+// AVX register (or two SSE2 / NEON registers), and, even without vectorisation,
+// break each statistic's dependency chain into four interleaved chains.
+const int LANES = 4;
+
+}
+
+SampleSummary::SampleSummary() : validCount(0), sum(0.0), min(0.0), max(0.0)
+{
+
+}
+
+/**
+ * @brief Summarises \a count \a values, skipping those whose \a valid flag is 0.
+ *
+ * There are no per-sample branches (invalid samples are summed as 0.0, and
+ * compared as +/- infinity), so the main loop can be auto-vectorised by the
+ * compiler, without depending on any particular instruction set.
+ */
+SampleSummary::SampleSummary(const double * const values, const quint8 * const valid,
+                             const int count)
+    : validCount(0), sum(0.0), min(0.0), max(0.0)
+{
+    const double infinity = std::numeric_limits<double>::infinity();
+    double sums[LANES], mins[LANES], maxs[LANES];
+    int counts[LANES];
+    for (int lane = 0; lane < LANES; ++lane) {
+        sums[lane] = 0.0;
+        mins[lane] = infinity;
+        maxs[lane] = -infinity;
+        counts[lane] = 0;
+    }
+
+    const int blockedCount = count - (count % LANES);
+    for (int index = 0; index < blockedCount; index += LANES) {
+        for (int lane = 0; lane < LANES; ++lane) {
+            const bool isValid = (valid[index + lane] != 0);
+            const double value = values[index + lane];
+            sums[lane] += (isValid) ? value : 0.0;
+            mins[lane] = qMin(mins[lane], (isValid) ? value : infinity);
+            maxs[lane] = qMax(maxs[lane], (isValid) ? value : -infinity);
+            counts[lane] += (isValid) ? 1 : 0;
+        }
+    }
+    for (int index = blockedCount; index < count; ++index) {
+        if (valid[index] != 0) {
+            sums[0] += values[index];
+            mins[0] = qMin(mins[0], values[index]);
+            maxs[0] = qMax(maxs[0], values[index]);
+            ++counts[0];
+        }
+    }
+
+    // Combine the lanes.
+    double combinedMin = infinity, combinedMax = -infinity;
+    for (int lane = 0; lane < LANES; ++lane) {
+        sum += sums[lane];
+        combinedMin = qMin(combinedMin, mins[lane]);
+        combinedMax = qMax(combinedMax, maxs[lane]);
+        validCount += counts[lane];
+    }
+    if (validCount > 0) {
+        min = combinedMin;
+        max = combinedMax;
+    }
+}
+
+/// Returns the number of valid samples summarised.
+int SampleSummary::count() const
+{
+    return validCount;
+}
+
+/// Returns the average of the valid samples, or 0 if there were none.
+double SampleSummary::average() const
+{
+    return (validCount == 0) ? 0.0 : (sum / validCount);
+}
+
+/// Returns the minimum of the valid samples, or 0 if there were none.
+double SampleSummary::minimum() const
+{
+    return min;
+}
+
+/// Returns the maximum of the valid samples, or 0 if there were none.
+double SampleSummary::maximum() const
+{
+    return max;
+}
+
+}}
@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_SAMPLE_SUMMARY_H__
+#define __POLAR_V2_SAMPLE_SUMMARY_H__
+
+#include <QtGlobal>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief Minimum, average and maximum of a whole channel of samples.
+ *
+ * The samples are summarised in a single, branch-free pass over contiguous
+ * arrays of values and validity flags, so that whole exercises can be
+ * summarised at close to memory bandwidth.
+ */
+class SampleSummary {
+
+public:
+    SampleSummary();
+    SampleSummary(const double * const values, const quint8 * const valid, const int count);
+
+    int count() const;
+    double average() const;
+    double minimum() const;
+    double maximum() const;
+
+protected:
+    int validCount;
+    double sum;
+    double min;
+    double max;
+
+};
+
+}}
+
+#endif // __POLAR_V2_SAMPLE_SUMMARY_H__
@@ -0,0 +1,219 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "sampletable.h"
+
+#include <QDateTime>
+#include <QtEndian>
+
+#include <string.h>
+
+namespace polar {
+namespace v2 {
+
+SampleTable::Column::Column(const QString &name, const Type type)
+    : columnName(name), columnType(type), rowCount(0), nulls(0)
+{
+
+}
+
+QString SampleTable::Column::name() const
+{
+    return columnName;
+}
+
+SampleTable::Type SampleTable::Column::type() const
+{
+    return columnType;
+}
+
+int SampleTable::Column::size() const
+{
+    return rowCount;
+}
+
+int SampleTable::Column::nullCount() const
+{
+    return nulls;
+}
+
+/// Returns the column's little-endian values, with zeros in place of nulls.
+const QByteArray &SampleTable::Column::values() const
+{
+    return valueData;
+}
+
+/// Returns the column's validity bitmap, with one (LSB-first) bit per row.
+const QByteArray &SampleTable::Column::validity() const
+{
+    return validityData;
+}
+
+/// Appends \a value, converted to the column's type.
+void SampleTable::Column::append(const double value)
+{
+    switch (columnType) {
+    case Int32:
+        appendBytes(static_cast<quint32>(qRound(value)), true);
+        break;
+    case Float32: {
+        const float f = static_cast<float>(value);
+        quint32 bits;
+        memcpy(&bits, &f, sizeof(bits));
+        appendBytes(bits, true);
+    }   break;
+    case Float64: {
+        quint64 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        appendBytes(bits, true);
+    }   break;
+    case TimestampMSecs:
+        appendBytes(static_cast<quint64>(qRound64(value)), true);
+        break;
+    }
+}
+
+/// Appends \a value, converted to the column's type.
+void SampleTable::Column::append(const qint64 value)
+{
+    switch (columnType) {
+    case Int32:
+        appendBytes(static_cast<quint32>(value), true);
+        break;
+    case TimestampMSecs:
+        appendBytes(static_cast<quint64>(value), true);
+        break;
+    default:
+        append(static_cast<double>(value));
+    }
+}
+
+void SampleTable::Column::appendNull()
+{
+    appendBytes(0, false);
+}
+
+void SampleTable::Column::appendBytes(const quint64 bits, const bool valid)
+{
+    const int size = valueSize(columnType);
+    for (int index = 0; index < size; ++index) {
+        valueData.append(static_cast<char>((bits >> (index * 8)) & 0xFF));
+    }
+    if ((rowCount % 8) == 0) {
+        validityData.append('\0');
+    }
+    if (valid) {
+        validityData[rowCount / 8] = static_cast<char>(validityData.at(rowCount / 8) | (1 << (rowCount % 8)));
+    } else {
+        ++nulls;
+    }
+    ++rowCount;
+}
+
+bool SampleTable::Column::isValid(const int row) const
+{
+    return ((0 <= row) && (row < rowCount) &&
+            ((validityData.at(row / 8) & (1 << (row % 8))) != 0));
+}
+
+/**
+ * @brief Formats the value at \a row as text, such as for CSV output.
+ *
+ * Floating point values are formatted with enough digits to be exactly
+ * reproduced, and timestamps as ISO 8601 UTC times, with milliseconds.
+ *
+ * @return The formatted value, or an empty array if the value is null.
+ */
+QByteArray SampleTable::Column::toString(const int row) const
+{
+    if (!isValid(row)) {
+        return QByteArray();
+    }
+    const uchar * const data =
+        reinterpret_cast<const uchar *>(valueData.constData()) + (row * valueSize(columnType));
+    switch (columnType) {
+    case Int32:
+        return QByteArray::number(qFromLittleEndian<qint32>(data));
+    case Float32: {
+        const quint32 bits = qFromLittleEndian<quint32>(data);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return QByteArray::number(value, 'g', 9);
+    }
+    case Float64: {
+        const quint64 bits = qFromLittleEndian<quint64>(data);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return QByteArray::number(value, 'g', 17);
+    }
+    case TimestampMSecs:
+        return QDateTime::fromMSecsSinceEpoch(qFromLittleEndian<qint64>(data), Qt::UTC)
+            .toString(QLatin1String("yyyy-MM-dd'T'HH:mm:ss.zzz'Z'")).toLatin1();
+    }
+    return QByteArray();
+}
+
+/// Returns the size, in bytes, of each value of the given \a type.
+int SampleTable::Column::valueSize(const Type type)
+{
+    switch (type) {
+    case Int32:
+    case Float32:        return 4;
+    case Float64:
+    case TimestampMSecs: return 8;
+    }
+    return 0;
+}
+
+SampleTable::SampleTable()
+{
+
+}
+
+void SampleTable::addColumn(const Column &column)
+{
+    Q_ASSERT((tableColumns.isEmpty()) || (column.size() == rowCount()));
+    tableColumns.append(column);
+}
+
+const QList<SampleTable::Column> &SampleTable::columns() const
+{
+    return tableColumns;
+}
+
+int SampleTable::rowCount() const
+{
+    return (tableColumns.isEmpty()) ? 0 : tableColumns.first().size();
+}
+
+/// Returns a CSV header line, naming each of the table's columns.
+QByteArray SampleTable::toCsvHeader() const
+{
+    QByteArray header;
+    foreach (const Column &column, tableColumns) {
+        if (!header.isEmpty()) {
+            header.append(',');
+        }
+        header.append(column.name().toUtf8());
+    }
+    return header.append('\n');
+}
+
+/// Returns the table's rows as CSV lines, with empty fields for null values.
+QByteArray SampleTable::toCsv() const
+{
+    QByteArray csv;
+    const int rows = rowCount();
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < tableColumns.size(); ++column) {
+            if (column > 0) {
+                csv.append(',');
+            }
+            csv.append(tableColumns.at(column).toString(row));
+        }
+        csv.append('\n');
+    }
+    return csv;
+}
+
+}}
@@ -0,0 +1,82 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_SAMPLE_TABLE_H__
+#define __POLAR_V2_SAMPLE_TABLE_H__
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief A columnar table of one exercise's per-sample channels.
+ *
+ * Each column holds its values in a contiguous, little-endian buffer, along with
+ * a validity bitmap (least significant bit first, set for valid values), which
+ * is exactly the in-memory layout of an Apache Arrow primitive array. Missing
+ * samples, and samples recorded while their sensor was offline, are null.
+ *
+ * @see ArrowWriter
+ */
+class SampleTable {
+
+public:
+    enum Type {
+        Int32,
+        Float32,
+        Float64,
+        TimestampMSecs, ///< 64-bit milliseconds since the Unix epoch, UTC.
+    };
+
+    class Column {
+    public:
+        Column(const QString &name, const Type type);
+
+        QString name() const;
+        Type type() const;
+        int size() const;
+        int nullCount() const;
+
+        const QByteArray &values() const;
+        const QByteArray &validity() const;
+
+        void append(const double value);
+        void append(const qint64 value);
+        void appendNull();
+
+        bool isValid(const int row) const;
+        QByteArray toString(const int row) const;
+
+        static int valueSize(const Type type);
+
+    protected:
+        QString columnName;
+        Type columnType;
+        int rowCount;
+        int nulls;
+        QByteArray valueData;
+        QByteArray validityData;
+
+        void appendBytes(const quint64 bits, const bool valid);
+    };
+
+    SampleTable();
+
+    void addColumn(const Column &column);
+    const QList<Column> &columns() const;
+    int rowCount() const;
+
+    QByteArray toCsvHeader() const;
+    QByteArray toCsv() const;
+
+protected:
+    QList<Column> tableColumns;
+
+};
+
+}}
+
+#endif // __POLAR_V2_SAMPLE_TABLE_H__
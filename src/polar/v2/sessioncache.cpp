@@ -0,0 +1,172 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "sessioncache.h"
+
+#include "lazymessage.h"
+#include "samplechannels.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace polar {
+namespace v2 {
+
+namespace {
+
+const quint32 CACHE_MAGIC = 0x42505343; // "BPSC"
+const quint32 CACHE_FORMAT_VERSION = 1;
+const QDataStream::Version STREAM_VERSION = QDataStream::Qt_5_2;
+
+}
+
+const quint32 SessionCache::ParserVersion = 7;
+
+/**
+ * @brief Constructs a session cache in \a dirName.
+ *
+ * If \a dirName is empty, a "sessions" folder within the application's
+ * standard cache location is used.
+ */
+SessionCache::SessionCache(const QString &dirName) : cacheDirName(dirName)
+{
+    if (cacheDirName.isEmpty()) {
+        cacheDirName = QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+            + QLatin1String("/sessions");
+    }
+}
+
+QString SessionCache::dirName() const
+{
+    return cacheDirName;
+}
+
+/// Returns the name of the cache file for the session with \a baseName.
+QString SessionCache::fileName(const QString &baseName) const
+{
+    const QByteArray hash = QCryptographicHash::hash(
+        QFileInfo(baseName).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1);
+    return QString::fromLatin1("%1/%2.cache").arg(cacheDirName)
+        .arg(QString::fromLatin1(hash.toHex()));
+}
+
+/**
+ * @brief Builds an identity for a set of input files.
+ *
+ * The identity covers each file's name, size and modification time, so any
+ * change to the inputs (including files being added or removed) gives a new
+ * identity. File contents are not hashed, since that would require reading
+ * every input file, which is exactly what the cache exists to avoid.
+ *
+ * Any \a parseOptions that alter parsed sessions are included too, so sessions
+ * parsed with different options are not mistaken for each other.
+ */
+QByteArray SessionCache::inputIdentity(const QStringList &inputFileNames,
+                                       const QByteArray &parseOptions)
+{
+    QStringList fileNames(inputFileNames);
+    fileNames.sort();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    foreach (const QString &fileName, fileNames) {
+        const QFileInfo fileInfo(fileName);
+        QByteArray entry;
+        QDataStream stream(&entry, QIODevice::WriteOnly);
+        stream << fileName << (fileInfo.exists() ? fileInfo.size() : Q_INT64_C(-1))
+               << (fileInfo.exists() ? fileInfo.lastModified().toMSecsSinceEpoch() : Q_INT64_C(0));
+        hash.addData(entry);
+    }
+    hash.addData(parseOptions);
+    return hash.result();
+}
+
+/**
+ * @brief Loads the cached session for \a baseName.
+ *
+ * @return The cached session, or an invalid ParsedSession if there is no cache
+ *         entry matching both \a identity and the current ParserVersion.
+ */
+ParsedSession SessionCache::load(const QString &baseName, const QByteArray &identity) const
+{
+    QFile file(fileName(baseName));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return ParsedSession();
+    }
+
+    // Deserialise straight from the file; the values are copied out of the
+    // stream either way, so there is nothing to gain from mapping it first.
+    QDataStream stream(&file);
+    stream.setVersion(STREAM_VERSION);
+    quint32 magic = 0, formatVersion = 0, parserVersion = 0;
+    QByteArray storedIdentity;
+    stream >> magic >> formatVersion >> parserVersion >> storedIdentity;
+    if ((stream.status() != QDataStream::Ok) || (magic != CACHE_MAGIC) ||
+        (formatVersion != CACHE_FORMAT_VERSION) || (parserVersion != ParserVersion) ||
+        (storedIdentity != identity)) {
+        return ParsedSession(); // A stale (or foreign) cache entry.
+    }
+
+    // Parsed exercises hold their decoded sample channels, which can only be
+    // read from the stream once their type has been registered.
+    SampleChannels::registerMetaType();
+    QString storedBaseName;
+    QVariantMap exercises, physicalInformation, session;
+    stream >> storedBaseName >> exercises >> physicalInformation >> session;
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "Failed to read session cache" << file.fileName();
+        return ParsedSession();
+    }
+    return ParsedSession(baseName, exercises, physicalInformation, session);
+}
+
+/**
+ * @brief Serialises \a session for storing in a session cache.
+ *
+ * Any lazily-decoded messages are fully decoded first, so that loading the
+ * session later requires no decoding at all.
+ */
+QByteArray SessionCache::serialize(const ParsedSession &session, const QByteArray &identity)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(STREAM_VERSION);
+    stream << CACHE_MAGIC << CACHE_FORMAT_VERSION << ParserVersion << identity
+           << session.baseName()
+           << ProtoBuf::LazyMessage::expand(session.exercises()).toMap()
+           << ProtoBuf::LazyMessage::expand(session.physicalInformation()).toMap()
+           << ProtoBuf::LazyMessage::expand(session.session()).toMap();
+    return data;
+}
+
+/**
+ * @brief Stores \a serialized session data as the cache entry for \a baseName.
+ *
+ * The entry is replaced atomically, so concurrent readers never see a
+ * partially written entry.
+ *
+ * @see serialize
+ */
+bool SessionCache::store(const QString &baseName, const QByteArray &serialized) const
+{
+    if (!QDir().mkpath(cacheDirName)) {
+        qWarning() << "Failed to create session cache folder" << cacheDirName;
+        return false;
+    }
+
+    QSaveFile file(fileName(baseName));
+    if ((!file.open(QIODevice::WriteOnly)) ||
+        (file.write(serialized) != serialized.size()) || (!file.commit())) {
+        qWarning() << "Failed to write session cache" << file.fileName();
+        return false;
+    }
+    return true;
+}
+
+}}
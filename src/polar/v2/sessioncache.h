@@ -0,0 +1,55 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_SESSION_CACHE_H__
+#define __POLAR_V2_SESSION_CACHE_H__
+
+#include "parsedsession.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief A persistent, on-disk cache of parsed training sessions.
+ *
+ * Each cache entry holds one fully-decoded ParsedSession, serialised with
+ * QDataStream, along with the identity of the input files it was parsed from
+ * (see inputIdentity) and the ParserVersion that parsed them. Entries whose
+ * identity or parser version no longer match are ignored (and replaced on the
+ * next store), so changed inputs are re-parsed automatically.
+ *
+ * Loading an entry just deserialises its already-typed values, so re-exporting
+ * a session with different output options skips all gzip inflation and
+ * protobuf decoding.
+ */
+class SessionCache {
+
+public:
+    /// Increment this whenever a parsing change would alter parsed sessions.
+    static const quint32 ParserVersion;
+
+    explicit SessionCache(const QString &dirName = QString());
+
+    QString dirName() const;
+    QString fileName(const QString &baseName) const;
+
+    static QByteArray inputIdentity(const QStringList &inputFileNames,
+                                    const QByteArray &parseOptions = QByteArray());
+
+    ParsedSession load(const QString &baseName, const QByteArray &identity) const;
+
+    static QByteArray serialize(const ParsedSession &session, const QByteArray &identity);
+    bool store(const QString &baseName, const QByteArray &serialized) const;
+
+protected:
+    QString cacheDirName;
+
+};
+
+}}
+
+#endif // __POLAR_V2_SESSION_CACHE_H__
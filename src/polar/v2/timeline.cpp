@@ -0,0 +1,201 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "timeline.h"
+
+#include <QDebug>
+
+#include <limits>
+
+namespace polar {
+namespace v2 {
+
+namespace {
+
+struct AlignmentName {
+    const char * name;
+    Timeline::Alignment alignment;
+};
+
+const AlignmentName alignmentNames[] = {
+    { "index",    Timeline::IndexAlignment    },
+    { "nearest",  Timeline::NearestAlignment  },
+    { "previous", Timeline::PreviousAlignment },
+    { "linear",   Timeline::LinearAlignment   },
+};
+
+const qint64 NONE = std::numeric_limits<qint64>::max();
+
+/*
+ * Aligns time \a offset with a list, given the offsets of the list's entries
+ * immediately before (\a previousOffset, at \a next - 1) and after it (\a nextOffset,
+ * at \a next), either of which may be NONE.
+ */
+void align(const Timeline::Alignment alignment, const qint64 offset, const int next,
+           const qint64 previousOffset, const qint64 nextOffset, int &index, double &weight)
+{
+    index = -1;
+    weight = 0.0;
+    switch (alignment) {
+    case Timeline::NearestAlignment:
+        if ((previousOffset != NONE) &&
+            ((nextOffset == NONE) || ((offset - previousOffset) <= (nextOffset - offset)))) {
+            index = next - 1;
+        } else if (nextOffset != NONE) {
+            index = next;
+        }
+        break;
+    case Timeline::PreviousAlignment:
+        if (previousOffset != NONE) {
+            index = next - 1;
+        }
+        break;
+    case Timeline::LinearAlignment:
+        if ((previousOffset != NONE) && (nextOffset != NONE)) {
+            index = next - 1;
+            if (nextOffset > previousOffset) {
+                weight = static_cast<double>(offset - previousOffset)
+                       / static_cast<double>(nextOffset - previousOffset);
+            }
+        }
+        break;
+    default:
+        Q_ASSERT(false); // IndexAlignment does not align by time.
+    }
+}
+
+}
+
+/**
+ * @brief Builds the timeline for an exercise.
+ *
+ * @param routeOffsets   Offset of each route point, in milliseconds since the
+ *                       first sample.
+ * @param sampleCount    Number of samples.
+ * @param recordInterval Sample record interval, in milliseconds.
+ * @param alignment      How route points and samples are to be aligned.
+ */
+Timeline::Timeline(const QVector<qint64> &routeOffsets, const int sampleCount,
+                   const qint64 recordInterval, const Alignment alignment)
+    : pointAlignment(alignment)
+{
+    if (alignment != IndexAlignment) {
+        for (int index = 1; index < routeOffsets.size(); ++index) {
+            if (routeOffsets.at(index) < routeOffsets.at(index - 1)) {
+                qWarning() << "Route offsets are not in time order; aligning by index";
+                pointAlignment = IndexAlignment;
+                break;
+            }
+        }
+    }
+
+    if (pointAlignment == IndexAlignment) {
+        alignByIndex(routeOffsets.size(), sampleCount, recordInterval);
+    } else {
+        alignByTime(routeOffsets, sampleCount, recordInterval);
+    }
+}
+
+/**
+ * @brief Returns the alignment actually used.
+ *
+ * This is the alignment the timeline was built with, unless the route points
+ * were out of order, in which case they are aligned by index.
+ */
+Timeline::Alignment Timeline::alignment() const
+{
+    return pointAlignment;
+}
+
+/// Returns the timeline's points, in time order.
+const QVector<Timeline::Point> &Timeline::points() const
+{
+    return timelinePoints;
+}
+
+/**
+ * @brief Looks up an alignment by \a name, such as "nearest".
+ *
+ * @return The named alignment, or IndexAlignment if \a name is not recognised.
+ */
+Timeline::Alignment Timeline::alignment(const QString &name, bool * const ok)
+{
+    for (size_t index = 0; index < (sizeof(alignmentNames)/sizeof(alignmentNames[0])); ++index) {
+        if (name == QLatin1String(alignmentNames[index].name)) {
+            if (ok) *ok = true;
+            return alignmentNames[index].alignment;
+        }
+    }
+    if (ok) *ok = false;
+    return IndexAlignment;
+}
+
+QString Timeline::alignmentName(const Alignment alignment)
+{
+    for (size_t index = 0; index < (sizeof(alignmentNames)/sizeof(alignmentNames[0])); ++index) {
+        if (alignmentNames[index].alignment == alignment) {
+            return QLatin1String(alignmentNames[index].name);
+        }
+    }
+    return QString();
+}
+
+// The n-th point is the n-th route point, and the n-th sample, at n record intervals.
+void Timeline::alignByIndex(const int routeCount, const int sampleCount,
+                            const qint64 recordInterval)
+{
+    const int count = qMax(routeCount, sampleCount);
+    timelinePoints.resize(count);
+    for (int index = 0; index < count; ++index) {
+        Point &point = timelinePoints[index];
+        point.offset = index * recordInterval;
+        point.types = ((index < routeCount) ? RoutePoint : 0) |
+                      ((index < sampleCount) ? SamplePoint : 0);
+        point.routeIndex = (index < routeCount) ? index : -1;
+        point.sampleIndex = (index < sampleCount) ? index : -1;
+        point.routeWeight = 0.0;
+        point.sampleWeight = 0.0;
+    }
+}
+
+// Merges the (sorted) route offsets with the samples' offsets.
+void Timeline::alignByTime(const QVector<qint64> &routeOffsets, const int sampleCount,
+                           const qint64 recordInterval)
+{
+    const int routeCount = routeOffsets.size();
+    timelinePoints.reserve(routeCount + sampleCount);
+    int route = 0, sample = 0;
+    while ((route < routeCount) || (sample < sampleCount)) {
+        const qint64 routeOffset = (route < routeCount) ? routeOffsets.at(route) : NONE;
+        const qint64 sampleOffset = (sample < sampleCount) ? (sample * recordInterval) : NONE;
+
+        Point point;
+        point.routeIndex = -1;
+        point.sampleIndex = -1;
+        point.routeWeight = 0.0;
+        point.sampleWeight = 0.0;
+        if (routeOffset == sampleOffset) {
+            point.offset = routeOffset;
+            point.types = RoutePoint|SamplePoint;
+            point.routeIndex = route++;
+            point.sampleIndex = sample++;
+        } else if (sampleOffset < routeOffset) {
+            point.offset = sampleOffset;
+            point.types = SamplePoint;
+            point.sampleIndex = sample++;
+            align(pointAlignment, sampleOffset, route,
+                  (route > 0) ? routeOffsets.at(route - 1) : NONE, routeOffset,
+                  point.routeIndex, point.routeWeight);
+        } else {
+            point.offset = routeOffset;
+            point.types = RoutePoint;
+            point.routeIndex = route++;
+            align(pointAlignment, routeOffset, sample,
+                  (sample > 0) ? ((sample - 1) * recordInterval) : NONE, sampleOffset,
+                  point.sampleIndex, point.sampleWeight);
+        }
+        timelinePoints.append(point);
+    }
+}
+
+}}
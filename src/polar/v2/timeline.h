@@ -0,0 +1,73 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_TIMELINE_H__
+#define __POLAR_V2_TIMELINE_H__
+
+#include <QString>
+#include <QVector>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief Aligns an exercise's route points with its (regularly recorded) samples.
+ *
+ * Route points carry their own millisecond offsets, while samples are taken
+ * every record interval, so the two do not necessarily line up. The timeline
+ * merges both, in a single linear pass, into one time-ordered list of points.
+ * Each point is a route point, a sample, or both (when their offsets coincide),
+ * and carries the index of the other that it aligns with, according to the
+ * chosen Alignment.
+ *
+ * IndexAlignment simply pairs the n-th route point with the n-th sample, which
+ * is how Bipolar has always aligned the two.
+ */
+class Timeline {
+
+public:
+    /// How points align with the other list's entries.
+    enum Alignment {
+        IndexAlignment,    ///< The entry with the same index.
+        NearestAlignment,  ///< The entry nearest in time.
+        PreviousAlignment, ///< The latest entry at, or before, the same time.
+        LinearAlignment,   ///< Linear interpolation of the entries either side.
+    };
+
+    enum PointType {
+        RoutePoint  = 0x1,
+        SamplePoint = 0x2,
+    };
+
+    struct Point {
+        qint64 offset;       ///< Milliseconds since the first sample.
+        int types;           ///< PointType flags.
+        int routeIndex;      ///< -1 if no route point aligns with this point.
+        int sampleIndex;     ///< -1 if no sample aligns with this point.
+        double routeWeight;  ///< Weight of routeIndex + 1, for LinearAlignment.
+        double sampleWeight; ///< Weight of sampleIndex + 1, for LinearAlignment.
+    };
+
+    Timeline(const QVector<qint64> &routeOffsets, const int sampleCount,
+             const qint64 recordInterval, const Alignment alignment);
+
+    Alignment alignment() const;
+    const QVector<Point> &points() const;
+
+    static Alignment alignment(const QString &name, bool * const ok = NULL);
+    static QString alignmentName(const Alignment alignment);
+
+protected:
+    Alignment pointAlignment;
+    QVector<Point> timelinePoints;
+
+    void alignByIndex(const int routeCount, const int sampleCount,
+                      const qint64 recordInterval);
+    void alignByTime(const QVector<qint64> &routeOffsets, const int sampleCount,
+                     const qint64 recordInterval);
+
+};
+
+}}
+
+#endif // __POLAR_V2_TIMELINE_H__
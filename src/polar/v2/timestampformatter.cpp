@@ -0,0 +1,122 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "timestampformatter.h"
+
+#include <limits>
+
+namespace polar {
+namespace v2 {
+
+namespace {
+
+const qint64 MSECS_PER_SECOND = 1000;
+const qint64 SECONDS_PER_DAY = 86400;
+const qint64 INVALID = std::numeric_limits<qint64>::min();
+
+// Integer division, rounding towards negative infinity (for pre-1970 times).
+inline qint64 floorDiv(const qint64 numerator, const qint64 denominator)
+{
+    const qint64 quotient = numerator / denominator;
+    return ((numerator % denominator) < 0) ? (quotient - 1) : quotient;
+}
+
+inline void writeDigits(char * const dest, int value, const int digits)
+{
+    for (int index = digits - 1; index >= 0; --index) {
+        dest[index] = static_cast<char>('0' + (value % 10));
+        value /= 10;
+    }
+}
+
+}
+
+TimestampFormatter::TimestampFormatter(const QDateTime &startTime)
+    : startTime(startTime), useFallback(true), startMSecs(0), length(0),
+      currentDay(INVALID), currentSecond(INVALID)
+{
+    if (!startTime.isValid()) {
+        return; // The fallback will give the same (empty) result as QDateTime.
+    }
+
+    // Only fixed offsets from UTC can be formatted incrementally.
+    #if (QT_VERSION >= QT_VERSION_CHECK(5, 2, 0))
+    const int offsetSeconds = startTime.offsetFromUtc();
+    #else
+    const int offsetSeconds = startTime.utcOffset();
+    #endif
+    length = 19;
+    switch (startTime.timeSpec()) {
+    case Qt::UTC:
+        buffer[length++] = 'Z';
+        break;
+    case Qt::OffsetFromUTC:
+        buffer[length++] = (offsetSeconds >= 0) ? '+' : '-';
+        writeDigits(buffer + length, qAbs(offsetSeconds) / 3600, 2);
+        buffer[length + 2] = ':';
+        writeDigits(buffer + length + 3, (qAbs(offsetSeconds) / 60) % 60, 2);
+        length += 5;
+        break;
+    default:
+        return; // Qt::LocalTime and Qt::TimeZone may cross DST transitions.
+    }
+
+    buffer[4]  = '-';
+    buffer[7]  = '-';
+    buffer[10] = 'T';
+    buffer[13] = ':';
+    buffer[16] = ':';
+    startMSecs = startTime.toMSecsSinceEpoch() + (offsetSeconds * MSECS_PER_SECOND);
+    useFallback = false;
+}
+
+/**
+ * @brief Formats the time \a offset milliseconds after the start time.
+ *
+ * @return The same string as `startTime.addMSecs(offset).toString(Qt::ISODate)`.
+ */
+QString TimestampFormatter::format(const qint64 offset)
+{
+    if (useFallback) {
+        return startTime.addMSecs(offset).toString(Qt::ISODate);
+    }
+
+    // Note, Qt::ISODate truncates to whole seconds.
+    const qint64 second = floorDiv(startMSecs + offset, MSECS_PER_SECOND);
+    if (second == currentSecond) {
+        return currentString;
+    }
+
+    const qint64 day = floorDiv(second, SECONDS_PER_DAY);
+    if ((day != currentDay) && (!renderDate(day))) {
+        currentSecond = INVALID;
+        return startTime.addMSecs(offset).toString(Qt::ISODate);
+    }
+    renderTime(static_cast<int>(second - (day * SECONDS_PER_DAY)));
+    currentSecond = second;
+    currentString = QString::fromLatin1(buffer, length);
+    return currentString;
+}
+
+bool TimestampFormatter::renderDate(const qint64 day)
+{
+    const QDate date = QDate(1970, 1, 1).addDays(day);
+    if ((date.year() < 0) || (date.year() > 9999)) {
+        currentDay = INVALID;
+        return false; // Qt::ISODate only supports four-digit years.
+    }
+    writeDigits(buffer, date.year(), 4);
+    writeDigits(buffer + 5, date.month(), 2);
+    writeDigits(buffer + 8, date.day(), 2);
+    currentDay = day;
+    return true;
+}
+
+void TimestampFormatter::renderTime(const int secondOfDay)
+{
+    writeDigits(buffer + 11, secondOfDay / 3600, 2);
+    writeDigits(buffer + 14, (secondOfDay / 60) % 60, 2);
+    writeDigits(buffer + 17, secondOfDay % 60, 2);
+}
+
+}}
@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __POLAR_V2_TIMESTAMP_FORMATTER_H__
+#define __POLAR_V2_TIMESTAMP_FORMATTER_H__
+
+#include <QDateTime>
+#include <QString>
+
+namespace polar {
+namespace v2 {
+
+/**
+ * @brief Formats ISO 8601 timestamps at offsets from a fixed start time.
+ *
+ * This produces exactly the same strings as
+ * `startTime.addMSecs(offset).toString(Qt::ISODate)`, but is intended for the
+ * (typically monotonic, one-second-apart) timestamps of track points. Rather
+ * than building a new QDateTime per timestamp, the formatter keeps a fixed
+ * character buffer, and only re-renders the date portion when the day changes.
+ * Repeated requests for the same second return the previously formatted string.
+ *
+ * Start times with a Qt::LocalTime or Qt::TimeZone spec (which may cross DST
+ * transitions) fall back to QDateTime's own formatting.
+ */
+class TimestampFormatter {
+
+public:
+    explicit TimestampFormatter(const QDateTime &startTime);
+
+    QString format(const qint64 offset);
+
+protected:
+    QDateTime startTime;
+    bool useFallback;
+    qint64 startMSecs;   ///< Start time, in local (wall clock) msecs since epoch.
+
+    char buffer[32];     ///< "yyyy-MM-ddTHH:mm:ss" plus optional "Z" or "+hh:mm".
+    int length;
+    qint64 currentDay;   ///< Days since epoch currently rendered in buffer.
+    qint64 currentSecond;///< Seconds since epoch currently rendered in buffer.
+    QString currentString;
+
+    bool renderDate(const qint64 day);
+    void renderTime(const int secondOfDay);
+
+};
+
+}}
+
+#endif // __POLAR_V2_TIMESTAMP_FORMATTER_H__
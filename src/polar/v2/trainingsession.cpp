@@ -3,23 +3,35 @@
 
 #include "trainingsession.h"
 
+#include "arrowwriter.h"
+#include "chunkedformatter.h"
+#include "fitencoder.h"
+#include "gzipcompressor.h"
+#include "gzipdecompressor.h"
+#include "hrvmetrics.h"
+#include "lapaggregator.h"
 #include "message.h"
+#include "rrintervals.h"
+#include "samplechannels.h"
+#include "samplesummary.h"
+#include "timestampformatter.h"
 #include "types.h"
 
 #include "os/versioninfo.h"
 
 #include <QApplication>
+#include <QBitArray>
+#include <QBuffer>
 #include <QDebug>
 #include <QDir>
 #include <QDomElement>
 #include <QFileInfo>
-#include <QProcessEnvironment>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QVector>
 
-#ifdef Q_CC_MSVC
-#include <QtZlib/zlib.h>
-#else
-#include <zlib.h>
-#endif
+#include <algorithm>
+#include <limits>
 
 // Qt 5.5 increased the accuracy of QVariant::toString output for floats and
 // doubles (see qtproject/qtbase@8153386), resulting in slightly different
@@ -66,18 +78,100 @@
 #define STATISTICS QLatin1String("statistics")
 #define ZONES      QLatin1String("zones")
 
+// These keys are added to parsed exercises, to cache values derived from them.
+#define ROUTE_START_TIME  QLatin1String("route-start-time")
+#define RR_INTERVALS      QLatin1String("rr-intervals")
+#define SAMPLE_CHANNELS   QLatin1String("sample-channels")
+#define SAMPLE_STATISTICS QLatin1String("sample-statistics")
+#define START_TIME        QLatin1String("start-time")
+
 namespace polar {
 namespace v2 {
 
+using ProtoBuf::first;
+using ProtoBuf::firstMap;
+
+// Convenience functions, defined below.
+QDateTime getDateTime(const QVariantMap &map);
+QVariantMap getSampleStatistics(const SampleChannels &channels);
+
 TrainingSession::TrainingSession(const QString &baseName)
-    : baseName(baseName), hrmOptions(LapNames)
+    : baseName(baseName), haveExerciseFileNames(false), hrmOptions(LapNames),
+      sampleAlignment(Timeline::IndexAlignment), sampleCalibration(false)
+{
+
+}
+
+/**
+ * @brief Constructs a training session with a pre-built exercise file index.
+ *
+ * This allows callers that have already listed the input directory (such as
+ * the ConverterThread) to avoid each session re-scanning that directory.
+ */
+TrainingSession::TrainingSession(const QString &baseName,
+                                 const ExerciseFileNames &exerciseFileNames)
+    : baseName(baseName), exerciseFileNames(exerciseFileNames),
+      haveExerciseFileNames(true), hrmOptions(LapNames),
+      sampleAlignment(Timeline::IndexAlignment), sampleCalibration(false)
 {
 
 }
 
+/**
+ * @brief Adds an exercise sub-file to an exercise file index.
+ *
+ * @param exerciseFileNames Index to add the file to.
+ * @param fileName Name of the file, such as "v2-users-123-training-sessions-456-exercises-789-route".
+ * @param filePath Path to record for the file.
+ *
+ * @return \c true if \a fileName names an exercise sub-file, \c false otherwise.
+ */
+bool TrainingSession::addExerciseFileName(ExerciseFileNames &exerciseFileNames,
+                                          const QString &fileName, const QString &filePath)
+{
+    const QStringList nameParts = fileName.split(QLatin1Char('-'));
+    if ((nameParts.size() >= 3) && (nameParts.at(nameParts.size() - 3) == QLatin1String("exercises"))) {
+        exerciseFileNames[nameParts.at(nameParts.size() - 2)][nameParts.at(nameParts.size() - 1)] = filePath;
+        return true;
+    }
+    return false;
+}
+
 int TrainingSession::exerciseCount() const
 {
-    return (isValid()) ? parsedExercises.count() : -1;
+    return (isValid()) ? parsed.exercises().count() : -1;
+}
+
+/// Maps Polar sport values to FIT sport types; unmapped sports are "generic" (0).
+quint8 TrainingSession::getFitSport(const quint64 &polarSportValue)
+{
+    static QMap<quint64, quint8> map{
+        {  1,  1}, // Running -> running
+        {  2,  2}, // Cycling -> cycling
+        {  3, 11}, // Walking -> walking
+        {  4,  1}, // Jogging -> running
+        {  5,  2}, // Mountain biking -> cycling
+        {  7, 13}, // Downhill skiing -> alpine_skiing
+        {  8, 15}, // Rowing -> rowing
+        {  9, 11}, // Nordic walking -> walking
+        { 11, 17}, // Hiking -> hiking
+        { 12,  8}, // Tennis -> tennis
+        { 15, 10}, // Strength training -> training
+        { 17,  1}, // Treadmill running -> running
+        { 18,  2}, // Indoor cycling -> cycling
+        { 19,  1}, // Road running -> running
+        { 20, 10}, // Circuit training -> training
+        { 22, 14}, // Snowboarding -> snowboarding
+        { 23,  5}, // Swimming -> swimming
+        { 24, 12}, // Freestyle XC skiing -> cross_country_skiing
+        { 25, 12}, // Classic XC skiing -> cross_country_skiing
+        { 27,  1}, // Trail running -> running
+        { 36,  1}, // Track&field running -> running
+        { 38,  2}, // Road cycling -> cycling
+        { 39,  7}, // Soccer -> soccer
+        { 41,  6}, // Basketball -> basketball
+    };
+    return map.value(polarSportValue, 0);
 }
 
 QString TrainingSession::getPolarSportName(const quint64 &polarSportValue)
@@ -399,45 +493,138 @@ bool TrainingSession::isGzipped(QIODevice &data)
 
 bool TrainingSession::isValid() const
 {
-    return !parsedExercises.isEmpty();
+    return parsed.isValid();
 }
 
 bool TrainingSession::parse()
 {
-    parsedExercises.clear();
+    parsed = parseSession();
+    return isValid();
+}
+
+/**
+ * @brief Parses this training session from prefetched input file contents.
+ *
+ * Any input files not present in \a inputFiles are read from disk as usual.
+ *
+ * @see readInputFiles
+ */
+bool TrainingSession::parse(const InputFiles &inputFiles)
+{
+    parsed = parseSession(inputFiles);
+    return isValid();
+}
 
-    parsedPhysicalInformation = parsePhysicalInformation(
-        baseName + QLatin1String("-physical-information"));
+/**
+ * @brief Restores this training session from a previously parsed \a snapshot.
+ *
+ * This allows sessions to be loaded from a SessionCache, instead of parsed.
+ */
+bool TrainingSession::restore(const ParsedSession &snapshot)
+{
+    parsed = snapshot;
+    return isValid();
+}
 
-    parsedSession = parseCreateSession(baseName + QLatin1String("-create"));
+/// Returns the names of all input files this session would parse.
+QStringList TrainingSession::inputFileNames() const
+{
+    QStringList fileNames;
+    fileNames << (baseName + QLatin1String("-physical-information"))
+              << (baseName + QLatin1String("-create"));
+    foreach (const ExerciseFileNames::mapped_type &exerciseFiles, getExerciseFileNames()) {
+        for (ExerciseFileNames::mapped_type::const_iterator iter = exerciseFiles.constBegin();
+             iter != exerciseFiles.constEnd(); ++iter) {
+            // Only read the file types that parseExercise actually parses.
+            if ((iter.key() == AUTOLAPS) || (iter.key() == CREATE) ||
+                (iter.key() == LAPS) || (iter.key() == ROUTE) ||
+                (iter.key() == RRSAMPLES) || (iter.key() == SAMPLES) ||
+                (iter.key() == STATISTICS) || (iter.key() == ZONES)) {
+                fileNames << iter.value();
+            }
+        }
+    }
+    return fileNames;
+}
 
-    QMap<QString, QMap<QString, QString> > fileNames;
-    const QFileInfo fileInfo(this->baseName);
-    foreach (const QFileInfo &entryInfo, fileInfo.dir().entryInfoList(
-             QStringList(fileInfo.fileName() + QLatin1String("-*"))))
-    {
-        const QStringList nameParts = entryInfo.fileName().split(QLatin1Char('-'));
-        if ((nameParts.size() >= 3) && (nameParts.at(nameParts.size() - 3) == QLatin1String("exercises"))) {
-            fileNames[nameParts.at(nameParts.size() - 2)][nameParts.at(nameParts.size() - 1)] = entryInfo.filePath();
+/**
+ * @brief Reads the contents of all input files this session would parse.
+ *
+ * This allows the (I/O-bound) reading of a session's files to be separated
+ * from the (CPU-bound) parsing of them, such as by the ConverterThread.
+ *
+ * @see parse(const InputFiles &)
+ */
+TrainingSession::InputFiles TrainingSession::readInputFiles() const
+{
+    InputFiles inputFiles;
+    foreach (const QString &fileName, inputFileNames()) {
+        QFile file(fileName);
+        if (file.open(QIODevice::ReadOnly)) {
+            inputFiles.insert(fileName, file.readAll());
         }
     }
+    return inputFiles;
+}
+
+/**
+ * @brief Returns an immutable snapshot of the most recently parsed session.
+ *
+ * The snapshot may be handed to any number of threads, for example to write
+ * GPX, HRM and TCX outputs concurrently via the static to* and write* functions.
+ *
+ * @see parse
+ */
+ParsedSession TrainingSession::snapshot() const
+{
+    return parsed;
+}
+
+// Parses fileName via the parse##Func functions, preferring its prefetched contents.
+#define PARSE_INPUT(Func, fileName, result) { \
+    const InputFiles::const_iterator input = inputFiles.constFind(fileName); \
+    if (input == inputFiles.constEnd()) { \
+        result = parse##Func(fileName); \
+    } else { \
+        QBuffer buffer; \
+        buffer.setData(input.value()); \
+        buffer.open(QIODevice::ReadOnly); \
+        result = parse##Func(buffer); \
+    } \
+}
+
+ParsedSession TrainingSession::parseSession(const InputFiles &inputFiles) const
+{
+    QVariantMap physicalInformation;
+    PARSE_INPUT(PhysicalInformation, baseName + QLatin1String("-physical-information"),
+                physicalInformation);
+
+    QVariantMap session;
+    PARSE_INPUT(CreateSession, baseName + QLatin1String("-create"), session);
 
-    for (QMap<QString, QMap<QString, QString> >::const_iterator iter = fileNames.constBegin();
+    QVariantMap exercises;
+    const ExerciseFileNames fileNames = getExerciseFileNames();
+    for (ExerciseFileNames::const_iterator iter = fileNames.constBegin();
          iter != fileNames.constEnd(); ++iter)
     {
-        parse(iter.key(), iter.value());
+        const QVariantMap exercise = parseExercise(iter.value(), inputFiles);
+        if (!exercise.isEmpty()) {
+            exercises[iter.key()] = exercise;
+        }
     }
 
-    return isValid();
+    return ParsedSession(baseName, exercises, physicalInformation, session);
 }
 
-bool TrainingSession::parse(const QString &exerciseId, const QMap<QString, QString> &fileNames)
+QVariantMap TrainingSession::parseExercise(const QMap<QString, QString> &fileNames,
+                                           const InputFiles &inputFiles) const
 {
     QVariantMap exercise;
     QVariantList sources;
     #define PARSE_IF_CONTAINS(str, Func) \
         if (fileNames.contains(str)) { \
-            const QVariantMap map = parse##Func(fileNames.value(str)); \
+            QVariantMap map; \
+            PARSE_INPUT(Func, fileNames.value(str), map); \
             if (!map.empty()) { \
                 exercise[str] = map; \
                 sources << fileNames.value(str); \
@@ -448,21 +635,52 @@ bool TrainingSession::parse(const QString &exerciseId, const QMap<QString, QStri
     PARSE_IF_CONTAINS(LAPS,       Laps);
   //PARSE_IF_CONTAINS(PHASES,     Phases);
     PARSE_IF_CONTAINS(ROUTE,      Route);
-    PARSE_IF_CONTAINS(RRSAMPLES,  RRSamples);
+  //PARSE_IF_CONTAINS(RRSAMPLES,  RRSamples); // Decoded to RR_INTERVALS below.
     PARSE_IF_CONTAINS(SAMPLES,    Samples);
   //PARSE_IF_CONTAINS(SENSORS,    Sensors);
     PARSE_IF_CONTAINS(STATISTICS, Statistics);
     PARSE_IF_CONTAINS(ZONES,      Zones);
     #undef PARSE_IF_CONTAINS
 
+    // Decode any R-R intervals straight to a typed array, rather than a list of QVariants.
+    QByteArray rrIntervals;
+    if (fileNames.contains(RRSAMPLES)) {
+        PARSE_INPUT(RRIntervals, fileNames.value(RRSAMPLES), rrIntervals);
+        if (!rrIntervals.isEmpty()) {
+            sources << fileNames.value(RRSAMPLES);
+        }
+    }
+    if ((rrIntervals.isEmpty()) && (exercise.contains(SAMPLES))) {
+        rrIntervals = RRIntervals::fromSamples(exercise.value(SAMPLES).toMap()).toByteArray();
+    }
+    if (!rrIntervals.isEmpty()) {
+        exercise[RR_INTERVALS] = rrIntervals;
+    }
+
     if (!exercise.empty()) {
+        // Decode the exercise's timestamps once here, rather than in each writer.
+        exercise[START_TIME] = getDateTime(firstMap(
+            exercise.value(CREATE).toMap().value(QLatin1String("start"))));
+        if (exercise.contains(ROUTE)) {
+            exercise[ROUTE_START_TIME] = getDateTime(firstMap(
+                exercise.value(ROUTE).toMap().value(QLatin1String("timestamp"))));
+        }
         exercise[QLatin1String("sources")] = sources;
-        parsedExercises[exerciseId] = exercise;
-        return true;
+
+        // Decode the samples' channels once here, rather than in each writer (and
+        // apply their calibrations, if requested), then summarise them too, for
+        // when the "statistics" are incomplete.
+        if (exercise.contains(SAMPLES)) {
+            const SampleChannels channels(exercise.value(SAMPLES).toMap(), sampleCalibration);
+            exercise[SAMPLE_CHANNELS] = QVariant::fromValue(channels);
+            exercise[SAMPLE_STATISTICS] = getSampleStatistics(channels);
+        }
     }
-    return false;
+    return exercise;
 }
 
+#undef PARSE_INPUT
+
 #define ADD_FIELD_INFO(tag, name, type) \
     fieldInfo[QLatin1String(tag)] = ProtoBuf::Message::FieldInfo( \
         QLatin1String(name), ProtoBuf::Types::type \
@@ -797,6 +1015,8 @@ QVariantMap TrainingSession::parseLaps(QIODevice &data) const
     ADD_FIELD_INFO("2/2/3",    "seconds",          Uint32);
     ADD_FIELD_INFO("2/2/4",    "milliseconds",     Uint32);
     ProtoBuf::Message parser(fieldInfo);
+    parser.setLazy(QLatin1String("1/1")); // Lap headers.
+    parser.setLazy(QLatin1String("1/2")); // Lap stats.
 
     if (isGzipped(data)) {
         QByteArray array = unzip(data.readAll());
@@ -1080,6 +1300,14 @@ QVariantMap TrainingSession::parsePhysicalInformation(QIODevice &data) const
     ADD_FIELD_INFO("101/4",    "offset",              Int32);
     ProtoBuf::Message parser(fieldInfo);
 
+    // Only a handful of the physical information fields are ever used, so
+    // leave all top-level messages to be decoded on first access, if at all.
+    foreach (const QString &tagPath, fieldInfo.keys()) {
+        if (!tagPath.contains(QLatin1Char('/'))) {
+            parser.setLazy(tagPath);
+        }
+    }
+
     if (isGzipped(data)) {
         QByteArray array = unzip(data.readAll());
         return parser.parse(array);
@@ -1152,6 +1380,22 @@ QVariantMap TrainingSession::parseRoute(const QString &fileName) const
     return parseRoute(file);
 }
 
+QByteArray TrainingSession::parseRRIntervals(QIODevice &data) const
+{
+    const QByteArray array = isGzipped(data) ? unzip(data.readAll()) : data.readAll();
+    return RRIntervals::fromRRSamples(array).toByteArray();
+}
+
+QByteArray TrainingSession::parseRRIntervals(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open rrsamples file" << fileName;
+        return QByteArray();
+    }
+    return parseRRIntervals(file);
+}
+
 QVariantMap TrainingSession::parseRRSamples(QIODevice &data) const
 {
     ProtoBuf::Message::FieldInfoMap fieldInfo;
@@ -1368,6 +1612,8 @@ QVariantMap TrainingSession::parseSamples(QIODevice &data) const
     ADD_FIELD_INFO("30/2/4",      "milliseconds",              Uint32);
 
     ProtoBuf::Message parser(fieldInfo);
+    parser.setLazy(QLatin1String("28")); // Decoded directly by RRIntervals.
+    parser.setLazy(QLatin1String("29")); // Decoded directly by SampleChannels.
 
     if (isGzipped(data)) {
         QByteArray array = unzip(data.readAll());
@@ -1624,38 +1870,49 @@ void TrainingSession::setTcxOptions(const TcxOptions options)
 }
 
 /**
- * @brief Fetch the first item from a list contained within a QVariant.
- *
- * This is just a convenience function that prevents us from having to perform
- * the basic QList::isEmpty() check in many, many places.
+ * @brief Sets how route points are aligned with samples, for all outputs.
  *
- * @param variant QVariant (probably) containing a list.
- *
- * @return The first item in the list, or an invalid variant if there is no
- *         such list, or the list is empty.
+ * The default, Timeline::IndexAlignment, pairs route points and samples by index.
  */
-QVariant first(const QVariant &variant) {
-    const QVariantList list = variant.toList();
-    return (list.isEmpty()) ? QVariant() : list.first();
+void TrainingSession::setSampleAlignment(const Timeline::Alignment alignment)
+{
+    sampleAlignment = alignment;
 }
 
-QVariantMap firstMap(const QVariant &list) {
-    return first(list).toMap();
+/**
+ * @brief Sets whether the samples' calibration entries are applied when parsing.
+ *
+ * Polar devices appear to record samples with their calibrations already
+ * applied, so this is disabled by default.
+ */
+void TrainingSession::setSampleCalibration(const bool enabled)
+{
+    sampleCalibration = enabled;
 }
 
 QDateTime getDateTime(const QVariantMap &map)
 {
+    // Construct the date and time directly from their (typed) components. Any
+    // missing component yields an invalid date/time.
     const QVariantMap date = firstMap(map.value(QLatin1String("date")));
     const QVariantMap time = firstMap(map.value(QLatin1String("time")));
-    const QString string = QString::fromLatin1("%1-%2-%3 %4:%5:%6.%7")
-        .arg(first(date.value(QLatin1String("year"))).toString())
-        .arg(first(date.value(QLatin1String("month"))).toString())
-        .arg(first(date.value(QLatin1String("day"))).toString())
-        .arg(first(time.value(QLatin1String("hour"))).toString())
-        .arg(first(time.value(QLatin1String("minute"))).toString())
-        .arg(first(time.value(QLatin1String("seconds"))).toString())
-        .arg(first(time.value(QLatin1String("milliseconds"))).toString());
-    QDateTime dateTime = QDateTime::fromString(string, QLatin1String("yyyy-M-d H:m:s.z"));
+    const QVariant year         = first(date.value(QLatin1String("year")));
+    const QVariant month        = first(date.value(QLatin1String("month")));
+    const QVariant day          = first(date.value(QLatin1String("day")));
+    const QVariant hour         = first(time.value(QLatin1String("hour")));
+    const QVariant minute       = first(time.value(QLatin1String("minute")));
+    const QVariant seconds      = first(time.value(QLatin1String("seconds")));
+    const QVariant milliseconds = first(time.value(QLatin1String("milliseconds")));
+    if ((!year.isValid()) || (!month.isValid()) || (!day.isValid()) ||
+        (!hour.isValid()) || (!minute.isValid()) || (!seconds.isValid()) ||
+        (!milliseconds.isValid())) {
+        return QDateTime();
+    }
+    QDateTime dateTime(QDate(year.toInt(), month.toInt(), day.toInt()),
+                       QTime(hour.toInt(), minute.toInt(), seconds.toInt(), milliseconds.toInt()));
+    if (!dateTime.isValid()) {
+        return QDateTime();
+    }
 
     const QVariantMap::const_iterator offset = map.constFind(QLatin1String("offset"));
     if (offset == map.constEnd()) {
@@ -1711,161 +1968,463 @@ QString hrmTime(const QTime &time)
             .arg(qRound(time.msec()/100.0));
 }
 
-bool sensorOffline(const QVariantList &list, const int index)
+/**
+ * @brief Builds a mask of the samples recorded while a sensor was offline.
+ *
+ * @param list List of "offline" entries, each with a start and stop index.
+ * @param size Number of samples to build the mask for.
+ *
+ * @return A bit array of \a size bits, with bits set for offline samples.
+ */
+QBitArray offlineMask(const QVariantList &list, const int size)
 {
+    QBitArray mask(size);
     foreach (const QVariant &entry, list) {
         const QVariantMap map = entry.toMap();
         const QVariant startIndex = first(map.value(QLatin1String("start-index")));
-        const QVariant endIndex = first(map.value(QLatin1String("start-index")));
+        const QVariant stopIndex = first(map.value(QLatin1String("stop-index")));
         if ((!startIndex.canConvert(QMetaType::Int)) ||
-            (!endIndex.canConvert(QMetaType::Int))) {
+            (!stopIndex.canConvert(QMetaType::Int))) {
             qWarning() << "Ignoring invalid 'offline' entry" << entry;
             continue;
         }
-        if ((startIndex.toInt() <= index) && (index <= endIndex.toInt())) {
-            return true; // Sensor was offline.
+        const int stop = qMin(stopIndex.toInt(), size - 1);
+        for (int index = qMax(startIndex.toInt(), 0); index <= stop; ++index) {
+            mask.setBit(index);
         }
     }
-    return false; // Sensor was not offline.
+    return mask;
 }
 
-bool haveAnySamples(const QVariantMap &samples, const QString &type)
+// Checks if a channel's sensor was offline (see SampleChannels::isLegacyOffline) at a
+// timeline point, which if interpolated between two samples, is offline if either is.
+bool sensorOffline(const SampleChannels &channels, const SampleChannels::Channel channel,
+                   const int index, const double weight = 0.0)
 {
-    const int size = samples.value(type).toList().length();
-    for (int index = 0; index < size; ++index) {
-        if (!sensorOffline(samples.value(type + QLatin1String("-offline")).toList(), index)) {
-            return true;
+    return (channels.isLegacyOffline(channel, index)) ||
+           ((weight > 0.0) && (channels.isLegacyOffline(channel, index + 1)));
+}
+
+/**
+ * @brief Gets a (possibly interpolated) value from a list of samples.
+ *
+ * @param list   List of samples.
+ * @param index  Index of the sample to get.
+ * @param weight Weight of the next sample, for linear interpolation.
+ *
+ * @return The value at \a index, interpolated towards the value at \a index + 1
+ *         if \a weight is non-zero, or an invalid QVariant if \a index is out of
+ *         range.
+ */
+QVariant interpolate(const QVariantList &list, const int index, const double weight)
+{
+    if ((index < 0) || (index >= list.size())) {
+        return QVariant();
+    }
+    if ((weight <= 0.0) || (index + 1 >= list.size())) {
+        return list.at(index);
+    }
+    const double value = list.at(index).toDouble();
+    return value + ((list.at(index + 1).toDouble() - value) * weight);
+}
+
+/**
+ * @brief Gets a (possibly interpolated) value from a channel of an exercise's samples.
+ *
+ * @param channels    The exercise's sample channels.
+ * @param channel     Channel to get the value of.
+ * @param sampleIndex Index of the sample to get.
+ * @param weight      Weight of the next sample, for linear interpolation.
+ * @param value       Set to the value at \a sampleIndex, interpolated towards the
+ *                    value at \a sampleIndex + 1 if \a weight is non-zero.
+ *
+ * @return \c true if \a channel has a sample at \a sampleIndex, whether or not
+ *         its sensor was online.
+ */
+bool interpolate(const SampleChannels &channels, const SampleChannels::Channel channel,
+                 const int sampleIndex, const double weight, double &value)
+{
+    if (!channels.rawValue(channel, sampleIndex, value)) {
+        return false;
+    }
+    double next;
+    if ((weight > 0.0) && (channels.rawValue(channel, sampleIndex + 1, next))) {
+        value += (next - value) * weight;
+    }
+    return true;
+}
+
+// Gets a channel's value at sampleIndex, whether or not its sensor was online, or 0 if none.
+double rawValue(const SampleChannels &channels, const SampleChannels::Channel channel,
+                const int sampleIndex)
+{
+    double value = 0.0;
+    channels.rawValue(channel, sampleIndex, value);
+    return value;
+}
+
+// Formats a sample value exactly as VARIANT_TO_STRING formats its parsed QVariant.
+QString sampleToString(const SampleChannels::Channel channel, const double value)
+{
+    const QVariant variant =
+        (SampleChannels::valueType(channel) == QMetaType::UInt) ? QVariant(static_cast<uint>(qRound64(value)))
+      : (SampleChannels::valueType(channel) == QMetaType::Int)  ? QVariant(static_cast<int>(qRound64(value)))
+      : QVariant(static_cast<float>(value));
+    return VARIANT_TO_STRING(variant);
+}
+
+/**
+ * @brief Gets an exercise's sample channels.
+ *
+ * parseExercise decodes each exercise's sample channels just once, so this only
+ * decodes them for exercises parsed otherwise (such as in tests).
+ */
+SampleChannels getSampleChannels(const QVariantMap &exercise)
+{
+    const QVariant channels = exercise.value(SAMPLE_CHANNELS);
+    return (channels.userType() == qMetaTypeId<SampleChannels>())
+        ? channels.value<SampleChannels>() : SampleChannels(exercise.value(SAMPLES).toMap());
+}
+
+/**
+ * @brief Builds the timeline aligning an exercise's route points with its samples.
+ *
+ * @param exercise  Parsed exercise.
+ * @param channels  The exercise's sample channels.
+ * @param alignment How route points are to be aligned with samples.
+ */
+Timeline getTimeline(const QVariantMap &exercise, const SampleChannels &channels,
+                     const Timeline::Alignment alignment)
+{
+    // Route durations are relative to the route's own start time.
+    const QVariantList duration = exercise.value(ROUTE).toMap()
+        .value(QLatin1String("duration")).toList();
+    const QDateTime startTime = exercise.value(START_TIME).toDateTime();
+    const QDateTime routeStartTime = exercise.value(ROUTE_START_TIME).toDateTime();
+    const qint64 routeDelay = ((startTime.isValid()) && (routeStartTime.isValid()))
+        ? startTime.msecsTo(routeStartTime) : 0;
+    QVector<qint64> routeOffsets(duration.size());
+    for (int index = 0; index < duration.size(); ++index) {
+        routeOffsets[index] = duration.at(index).toLongLong() + routeDelay;
+    }
+
+    return Timeline(routeOffsets, channels.sampleCount(), channels.recordInterval(), alignment);
+}
+
+// As above, for writers that do not otherwise need the exercise's sample channels.
+Timeline getTimeline(const QVariantMap &exercise, const Timeline::Alignment alignment)
+{
+    return getTimeline(exercise, getSampleChannels(exercise), alignment);
+}
+
+// Builds a statistic's summary, in the same form as those parsed from protobuf data.
+QVariantList getStatsList(const double average, const double minimum, const double maximum)
+{
+    QVariantMap summary;
+    summary.insert(QLatin1String("average"), QVariantList() << average);
+    summary.insert(QLatin1String("maximum"), QVariantList() << maximum);
+    summary.insert(QLatin1String("minimum"), QVariantList() << minimum);
+    return QVariantList() << summary;
+}
+
+/**
+ * @brief Summarises each of an exercise's sample channels.
+ *
+ * Offline samples are excluded, as they are from each of the writers' outputs.
+ * Power is the total of both pedals, or double a single pedal's power, as per
+ * the TCX and FIT writers.
+ *
+ * @param sampleChannels The exercise's sample channels.
+ *
+ * @return Summaries in the same form as parsed "statistics" data.
+ */
+QVariantMap getSampleStatistics(const SampleChannels &sampleChannels)
+{
+    static const SampleChannels::Channel channels[] = {
+        SampleChannels::Altitude, SampleChannels::Cadence, SampleChannels::Heartrate,
+        SampleChannels::Speed, SampleChannels::Temperature
+    };
+    QVariantMap statistics;
+    for (size_t channel = 0; channel < (sizeof(channels)/sizeof(channels[0])); ++channel) {
+        const SampleChannels::Channel type = channels[channel];
+        const SampleSummary summary(sampleChannels.values(type), sampleChannels.valid(type),
+                                    sampleChannels.size(type));
+        if (summary.count() > 0) {
+            statistics.insert(SampleChannels::channelName(type),
+                getStatsList(summary.average(), summary.minimum(), summary.maximum()));
         }
     }
-    return false;
+
+    const int powerCount = sampleChannels.sampleCount();
+    QVector<double> values(powerCount);
+    QVector<quint8> valid(powerCount);
+    for (int index = 0; index < powerCount; ++index) {
+        double left, right;
+        const bool haveLeft  = sampleChannels.value(SampleChannels::LeftPedalPower, index, left);
+        const bool haveRight = sampleChannels.value(SampleChannels::RightPedalPower, index, right);
+        values[index] = (haveLeft && haveRight) ? qMax(int(left), 0) + qMax(int(right), 0)
+            : haveLeft  ? qMax(int(left) * 2, 0)
+            : haveRight ? qMax(int(right) * 2, 0) : 0;
+        valid[index] = (haveLeft || haveRight) ? 1 : 0;
+    }
+    const SampleSummary power(values.constData(), valid.constData(), powerCount);
+    if (power.count() > 0) {
+        statistics.insert(QLatin1String("power"),
+            getStatsList(power.average(), power.minimum(), power.maximum()));
+    }
+    return statistics;
 }
 
-QString TrainingSession::getOutputBaseFileName(const QString &format)
+/**
+ * @brief Gets an exercise's statistics, completed from its samples if need be.
+ *
+ * Exercises recorded by older firmware, or cut short, may have no "statistics"
+ * data, or statistics for only some channels. Any channels missing are filled
+ * in from the exercise's sample summaries (see getSampleStatistics).
+ */
+QVariantMap getStatistics(const QVariantMap &exercise)
 {
-    const QFileInfo inputBaseNameInfo(baseName);
-    if (format.isEmpty()) {
-        return inputBaseNameInfo.fileName();
+    QVariantMap statistics = exercise.value(STATISTICS).toMap();
+    const QVariantMap sampleStatistics = exercise.value(SAMPLE_STATISTICS).toMap();
+    for (QVariantMap::const_iterator iter = sampleStatistics.constBegin();
+         iter != sampleStatistics.constEnd(); ++iter) {
+        if (!statistics.contains(iter.key())) {
+            statistics.insert(iter.key(), iter.value());
+        }
     }
-    QRegExp inputFileNameParts(
-        QLatin1String("v2-users-([^-]+)-training-sessions-([^-]+)"));
-    if (format.contains(QLatin1String("$userId"   )) ||
-        format.contains(QLatin1String("$sessionId"))) {
-        if (!inputFileNameParts.exactMatch(inputBaseNameInfo.fileName())) {
-            qWarning() << "Base name does not match format" << baseName;
-            return QString();
+    return statistics;
+}
+
+// Builds a duration map, in the same form as those parsed from protobuf data.
+QVariantMap toDurationMap(const quint64 duration)
+{
+    QVariantMap map;
+    map.insert(QLatin1String("hours"),        QVariantList() << (duration / 3600000));
+    map.insert(QLatin1String("minutes"),      QVariantList() << ((duration / 60000) % 60));
+    map.insert(QLatin1String("seconds"),      QVariantList() << ((duration / 1000) % 60));
+    map.insert(QLatin1String("milliseconds"), QVariantList() << (duration % 1000));
+    return map;
+}
+
+// Lap statistics derived from an exercise's samples, for laps (and splits) that
+// the device recorded no statistics for. Each channel is aggregated just once,
+// so that each lap's statistics then take constant time.
+class SampleLapStats {
+
+public:
+    explicit SampleLapStats(const SampleChannels &channels)
+    {
+        static const SampleChannels::Channel statsChannels[] = {
+            SampleChannels::Cadence, SampleChannels::Heartrate,
+            SampleChannels::Speed, SampleChannels::Temperature
+        };
+        for (size_t index = 0; index < (sizeof(statsChannels)/sizeof(statsChannels[0])); ++index) {
+            const SampleChannels::Channel channel = statsChannels[index];
+            const Aggregate aggregate = {
+                static_cast<quint64>(qMax(channels.interval(channel), Q_INT64_C(0))),
+                LapAggregator(channels.values(channel), channels.valid(channel), channels.size(channel))
+            };
+            aggregates.insert(SampleChannels::channelName(channel), aggregate);
+        }
+    }
+
+    // Adds any channels missing from stats, summarising the samples recorded
+    // from startTime (inclusive) to endTime (exclusive) milliseconds.
+    QVariantMap fill(QVariantMap stats, const quint64 startTime, const quint64 endTime) const
+    {
+        for (QMap<QString, Aggregate>::const_iterator iter = aggregates.constBegin();
+             iter != aggregates.constEnd(); ++iter) {
+            if ((stats.contains(iter.key())) || (iter.value().interval == 0)) {
+                continue;
+            }
+            const LapAggregator::Stats channelStats = iter.value().aggregator.stats(
+                sampleIndex(startTime, iter.value().interval),
+                sampleIndex(endTime, iter.value().interval));
+            if (channelStats.count == 0) {
+                continue;
+            }
+            stats.insert(iter.key(), getStatsList(
+                channelStats.average, channelStats.minimum, channelStats.maximum));
         }
+        return stats;
+    }
+
+protected:
+    // Each channel is aggregated at its own interval, as intervalled channels may differ.
+    struct Aggregate {
+        quint64 interval;
+        LapAggregator aggregator;
+    };
+
+    // Index of the first sample recorded at, or after, time milliseconds.
+    static int sampleIndex(const quint64 time, const quint64 interval)
+    {
+        const quint64 index = (time / interval) + (((time % interval) == 0) ? 0 : 1);
+        return static_cast<int>(qMin(index, static_cast<quint64>(std::numeric_limits<int>::max())));
     }
 
-    QString fileName = format;
+    QMap<QString, Aggregate> aggregates;
+
+};
 
-    // If any of these placeholders are used, ensure we've parsed the base details.
-    if (format.contains(QLatin1String("$date"       )) ||
-        format.contains(QLatin1String("$dateUTC"    )) ||
-        format.contains(QLatin1String("$time"       )) ||
-        format.contains(QLatin1String("$timeUTC"    )) ||
-        format.contains(QLatin1String("$userId"     )) ||
-        format.contains(QLatin1String("$sessionId"  )) ||
-        format.contains(QLatin1String("$sessionName"))) {
-        if (parsedSession.isEmpty()) {
-            parsedSession = parseCreateSession(baseName + QLatin1String("-create"));
+bool haveAnySamples(const SampleChannels &channels, const SampleChannels::Channel channel)
+{
+    const int size = channels.sampleCount(channel);
+    for (int index = 0; index < size; ++index) {
+        if (!channels.isLegacyOffline(channel, index)) {
+            return true;
         }
     }
+    return false;
+}
 
-    fileName.replace(QLatin1String("$baseName"), inputBaseNameInfo.fileName());
+/**
+ * @brief Fetches this session's exercise file index.
+ *
+ * If an index was supplied at construction, it is returned as-is. Otherwise,
+ * the session's directory is scanned for this session's exercise files.
+ */
+TrainingSession::ExerciseFileNames TrainingSession::getExerciseFileNames() const
+{
+    if (haveExerciseFileNames) {
+        return exerciseFileNames;
+    }
 
-    if (format.contains(QLatin1String("$date"      )) ||
-        format.contains(QLatin1String("$dateUTC"   )) ||
-        format.contains(QLatin1String("$dateExt"   )) ||
-        format.contains(QLatin1String("$dateExtUTC")) ||
-        format.contains(QLatin1String("$time"      )) ||
-        format.contains(QLatin1String("$timeUTC"   )) ||
-        format.contains(QLatin1String("$timeExt"   )) ||
-        format.contains(QLatin1String("$timeExtUTC")))
+    ExerciseFileNames fileNames;
+    const QFileInfo fileInfo(this->baseName);
+    foreach (const QFileInfo &entryInfo, fileInfo.dir().entryInfoList(
+             QStringList(fileInfo.fileName() + QLatin1String("-*"))))
     {
-        const QDateTime startTime =
-            getDateTime(firstMap(parsedSession.value(QLatin1String("start"))));
-        fileName.replace(QLatin1String("$dateExtUTC"),
-             startTime.toUTC().toString(QLatin1String("yyyy-MM-dd")));
-        fileName.replace(QLatin1String("$dateExt"),
-             startTime.toString(QLatin1String("yyyy-MM-dd")));
-        fileName.replace(QLatin1String("$dateUTC"),
-             startTime.toUTC().toString(QLatin1String("yyyyMMdd")));
-        fileName.replace(QLatin1String("$date"),
-             startTime.toString(QLatin1String("yyyyMMdd")));
-        fileName.replace(QLatin1String("$timeExtUTC"),
-            startTime.toUTC().toString(QLatin1String("HH:mm:ss")));
-        fileName.replace(QLatin1String("$timeExt"),
-            startTime.toString(QLatin1String("HH:mm:ss")));
-        fileName.replace(QLatin1String("$timeUTC"),
-            startTime.toUTC().toString(QLatin1String("HHmmss")));
-        fileName.replace(QLatin1String("$time"),
-            startTime.toString(QLatin1String("HHmmss")));
-    }
-
-    if (format.contains(QLatin1String("$userId"))) {
-        fileName.replace(QLatin1String("$userId"), inputFileNameParts.cap(1));
-    }
-
-    if (format.contains(QLatin1String("$username"))) {
-        const QString user = QProcessEnvironment::systemEnvironment().value(
-            #ifdef Q_OS_WIN
-            QLatin1String("USERNAME"),
-            #else
-            QLatin1String("USER"),
-            #endif
-            QLatin1String("unknown")
-        );
-        fileName.replace(QLatin1String("$username"), user);
+        addExerciseFileName(fileNames, entryInfo.fileName(), entryInfo.filePath());
+    }
+    return fileNames;
+}
+
+/**
+ * @brief Returns the base name of this session's output files, for the given \a format.
+ *
+ * If the session has not been parsed yet, and \a format needs the exercises' sport
+ * names (ie there's no session name), then the session is parsed in full. In that
+ * case, that parsed session is returned via \a parsedSession (if not \c NULL), so
+ * that the caller can restore it instead of parsing the session again.
+ */
+QString TrainingSession::getOutputBaseFileName(const FileNameFormat &format,
+                                               ParsedSession * const parsedSession) const
+{
+    if (isValid()) {
+        return getOutputBaseFileName(parsed, format);
     }
 
-    if (format.contains(QLatin1String("$sessionId"))) {
-        fileName.replace(QLatin1String("$sessionId"), inputFileNameParts.cap(2));
+    // If not parsed yet (eg when checking for existing output files), then parse
+    // only as much as the format needs, without modifying this session.
+    QVariantMap session;
+    if (format.uses(FileNameFormat::AnyDateTime|FileNameFormat::SessionName)) {
+        session = parseCreateSession(baseName + QLatin1String("-create"));
+    }
+    if ((format.uses(FileNameFormat::SessionName)) &&
+        (first(firstMap(session.value(QLatin1String("session-name")))
+               .value(QLatin1String("text"))).toString().isEmpty())) {
+        // The session name will fallback to the exercises' sport names.
+        const ParsedSession snapshot = parseSession();
+        if (parsedSession != NULL) {
+            *parsedSession = snapshot;
+        }
+        return getOutputBaseFileName(snapshot, format);
     }
+    return getOutputBaseFileName(ParsedSession(baseName, QVariantMap(), QVariantMap(), session), format);
+}
 
-    // If there are any $sessionName references
-    if (fileName.contains(QStringLiteral("$sessionName"))) {
-        // Fetch the session name from the sesion.
-        QString sessionName = first(firstMap(parsedSession.value(QLatin1String("session-name")))
-                                    .value(QLatin1String("text"))).toString();
+QString TrainingSession::getOutputBaseFileName(const ParsedSession &session,
+                                               const FileNameFormat &format)
+{
+    const QFileInfo inputBaseNameInfo(session.baseName());
+    if (format.isEmpty()) {
+        return inputBaseNameInfo.fileName();
+    }
+    QRegExp inputFileNameParts(
+        QLatin1String("v2-users-([^-]+)-training-sessions-([^-]+)"));
+    if (format.uses(FileNameFormat::UserId|FileNameFormat::SessionId)) {
+        if (!inputFileNameParts.exactMatch(inputBaseNameInfo.fileName())) {
+            qWarning() << "Base name does not match format" << session.baseName();
+            return QString();
+        }
+    }
 
-        // If session name is empty (eg common for Vantage V), then fallback to the exercise name.
-        if (sessionName.isEmpty()) {
-            // If we haven't parsed the exercise data yet (really only happens in unit test), do so.
-            if (exerciseCount() < 1) {
-                parse();
-            }
+    // Placeholder values are only computed if the format actually uses them.
+    QDateTime startTime, startTimeUTC;
+    if (format.uses(FileNameFormat::AnyDateTime)) {
+        startTime = getDateTime(firstMap(session.session().value(QLatin1String("start"))));
+        startTimeUTC = startTime.toUTC();
+    }
+    const QString sessionName = (format.uses(FileNameFormat::SessionName))
+        ? getOutputSessionName(session) : QString();
+
+    QString fileName;
+    foreach (const FileNameFormat::Token &token, format.tokens()) {
+        switch (token.placeholder) {
+        case FileNameFormat::Literal:     fileName.append(token.text); break;
+        case FileNameFormat::BaseName:    fileName.append(inputBaseNameInfo.fileName()); break;
+        case FileNameFormat::Date:        fileName.append(startTime.toString(QLatin1String("yyyyMMdd"))); break;
+        case FileNameFormat::DateUTC:     fileName.append(startTimeUTC.toString(QLatin1String("yyyyMMdd"))); break;
+        case FileNameFormat::DateExt:     fileName.append(startTime.toString(QLatin1String("yyyy-MM-dd"))); break;
+        case FileNameFormat::DateExtUTC:  fileName.append(startTimeUTC.toString(QLatin1String("yyyy-MM-dd"))); break;
+        case FileNameFormat::Time:        fileName.append(startTime.toString(QLatin1String("HHmmss"))); break;
+        case FileNameFormat::TimeUTC:     fileName.append(startTimeUTC.toString(QLatin1String("HHmmss"))); break;
+        case FileNameFormat::TimeExt:     fileName.append(startTime.toString(QLatin1String("HH:mm:ss"))); break;
+        case FileNameFormat::TimeExtUTC:  fileName.append(startTimeUTC.toString(QLatin1String("HH:mm:ss"))); break;
+        case FileNameFormat::UserId:      fileName.append(inputFileNameParts.cap(1)); break;
+        case FileNameFormat::Username:    fileName.append(FileNameFormat::username()); break;
+        case FileNameFormat::SessionId:   fileName.append(inputFileNameParts.cap(2)); break;
+        case FileNameFormat::SessionName: fileName.append(sessionName); break;
+        case FileNameFormat::AnyDateTime: break; // Not a token type.
+        }
+    }
+    return fileName;
+}
 
-            // Build a unique set of sport names from the individual exercises in the session.
-            QSet<QString> sportNames;
-            foreach (const QVariant &exercise, parsedExercises) {
-                const QString sportName = getPolarSportName(first(firstMap(exercise.toMap()
-                    .value(CREATE).toMap().value(QStringLiteral("sport")))
-                    .value(QStringLiteral("value"))).toULongLong());
-                qDebug() << "No session name, found Polar sport name" << sportName;
-                if (!sportName.isNull()) {
-                    sportNames.insert(sportName);
-                }
+QString TrainingSession::getOutputSessionName(const ParsedSession &session)
+{
+    // Fetch the session name from the sesion.
+    QString sessionName = first(firstMap(session.session().value(QLatin1String("session-name")))
+                                .value(QLatin1String("text"))).toString();
+
+    // If session name is empty (eg common for Vantage V), then fallback to the exercise name.
+    if (sessionName.isEmpty()) {
+        // Build a unique set of sport names from the individual exercises in the session.
+        QSet<QString> sportNames;
+        foreach (const QVariant &exercise, session.exercises()) {
+            const QString sportName = getPolarSportName(first(firstMap(exercise.toMap()
+                .value(CREATE).toMap().value(QStringLiteral("sport")))
+                .value(QStringLiteral("value"))).toULongLong());
+            qDebug() << "No session name, found Polar sport name" << sportName;
+            if (!sportName.isNull()) {
+                sportNames.insert(sportName);
             }
+        }
 
-            // Pick an appropriate session name from the sport names.
-            if (sportNames.isEmpty()) {
-                qWarning() << "No session name, and no recognised sport names either";
-                sessionName = QStringLiteral("Unknown session");
-            } else if (sportNames.size() > 1) {
-                qWarning() << "No session name, and multiple unique sport names";
-                sessionName = QStringLiteral("Multisport");
-            } else {
-                sessionName = *sportNames.constBegin();
-            }
+        // Pick an appropriate session name from the sport names.
+        if (sportNames.isEmpty()) {
+            qWarning() << "No session name, and no recognised sport names either";
+            sessionName = QStringLiteral("Unknown session");
+        } else if (sportNames.size() > 1) {
+            qWarning() << "No session name, and multiple unique sport names";
+            sessionName = QStringLiteral("Multisport");
+        } else {
+            sessionName = *sportNames.constBegin();
         }
-        fileName.replace(QLatin1String("$sessionName"), sessionName);
     }
-    return fileName;
+    return sessionName;
 }
 
-QStringList TrainingSession::getOutputFileNames(const QString &fileNameFormat,
+/**
+ * @brief Returns the names of all output files this session would be written to.
+ *
+ * @see getOutputBaseFileName for the meaning of \a parsedSession.
+ */
+QStringList TrainingSession::getOutputFileNames(const FileNameFormat &fileNameFormat,
                                                 const OutputFormats outputFormats,
-                                                QString outputDirName)
+                                                QString outputDirName,
+                                                ParsedSession * const parsedSession) const
 {
     // Default the output directory match the input files, if not specified.
     if (outputDirName.isEmpty()) {
@@ -1873,29 +2432,40 @@ QStringList TrainingSession::getOutputFileNames(const QString &fileNameFormat,
     }
 
     const QString baseName = outputDirName + QLatin1Char('/') +
-        getOutputBaseFileName(fileNameFormat);
+        getOutputBaseFileName(fileNameFormat, parsedSession);
+    const QString gz = (outputFormats & GzipOutputs) ? QLatin1String(".gz") : QLatin1String("");
 
     QStringList fileNames;
 
     if (outputFormats & GpxOutput) {
-        fileNames.append(baseName + QLatin1String(".gpx"));
+        fileNames.append(baseName + QLatin1String(".gpx") + gz);
     }
 
     if (outputFormats & HrmOutput) {
-        const QFileInfo fileInfo(this->baseName);
-        const int exerciseCount = fileInfo.dir().entryInfoList(QStringList(
-            fileInfo.fileName() + QLatin1String("-exercises-*-create"))).count();
+        int exerciseCount = 0;
+        foreach (const ExerciseFileNames::mapped_type &exerciseFiles, getExerciseFileNames()) {
+            if (exerciseFiles.contains(CREATE)) {
+                ++exerciseCount;
+            }
+        }
         if (exerciseCount == 1) {
-            fileNames.append(baseName + QLatin1String(".hrm"));
+            fileNames.append(baseName + QLatin1String(".hrm") + gz);
             if (hrmOptions.testFlag(RrFiles)) {
-                fileNames.append(baseName + QLatin1String(".rr.hrm"));
+                fileNames.append(baseName + QLatin1String(".rr.hrm") + gz);
+            }
+            if (hrmOptions.testFlag(HrvAnalysis)) {
+                fileNames.append(baseName + QLatin1String(".hrv.json"));
             }
         } else {
             for (int index = 0; index < exerciseCount; ++index) {
-                fileNames.append(QString::fromLatin1("%1.%2.hrm")
-                    .arg(baseName).arg(index));
+                fileNames.append(QString::fromLatin1("%1.%2.hrm%3")
+                    .arg(baseName).arg(index).arg(gz));
                 if (hrmOptions.testFlag(RrFiles)) {
-                    fileNames.append(QString::fromLatin1("%1.%2.rr.hrm")
+                    fileNames.append(QString::fromLatin1("%1.%2.rr.hrm%3")
+                        .arg(baseName).arg(index).arg(gz));
+                }
+                if (hrmOptions.testFlag(HrvAnalysis)) {
+                    fileNames.append(QString::fromLatin1("%1.%2.hrv.json")
                         .arg(baseName).arg(index));
                 }
             }
@@ -1903,15 +2473,790 @@ QStringList TrainingSession::getOutputFileNames(const QString &fileNameFormat,
     }
 
     if (outputFormats & TcxOutput) {
-        fileNames.append(baseName + QLatin1String(".tcx"));
+        fileNames.append(baseName + QLatin1String(".tcx") + gz);
+    }
+
+    if (outputFormats & FitOutput) {
+        fileNames.append(baseName + QLatin1String(".fit"));
+    }
+
+    if (outputFormats & CsvOutput) {
+        fileNames.append(baseName + QLatin1String(".csv"));
+    }
+
+    if (outputFormats & ArrowOutput) {
+        fileNames.append(baseName + QLatin1String(".arrow"));
     }
 
     return fileNames;
 }
 
-/// @see http://www.topografix.com/GPX/1/1/gpx.xsd
+/**
+ * @brief Formats all of the requested output files, without writing them.
+ *
+ * This allows the (CPU-bound) formatting of output files to be separated from
+ * the (I/O-bound) writing of them, such as by the ConverterThread.
+ *
+ * If \a gpxDocument or \a tcxDocument are not \c NULL, they receive the GPX and
+ * TCX documents formatted (if requested), so callers can reuse them, such as for
+ * archives, without formatting the same session again.
+ *
+ * @return The output file contents, keyed by file name. Outputs that could not
+ *         be formatted are included with null contents.
+ */
+TrainingSession::OutputFiles TrainingSession::formatOutputs(const FileNameFormat &fileNameFormat,
+                                                            const OutputFormats outputFormats,
+                                                            QString outputDirName,
+                                                            QDomDocument * const gpxDocument,
+                                                            QDomDocument * const tcxDocument) const
+{
+    // Default the output directory match the input files, if not specified.
+    if (outputDirName.isEmpty()) {
+        outputDirName = QFileInfo(this->baseName).absoluteDir().absolutePath();
+    }
+
+    const QString baseName = outputDirName + QLatin1Char('/') +
+        getOutputBaseFileName(fileNameFormat);
+
+    OutputFiles outputFiles;
+
+    if (outputFormats & GpxOutput) {
+        const QDomDocument gpx = toGPX(parsed, gpxOptions, QDateTime::currentDateTimeUtc(),
+                                       sampleAlignment);
+        outputFiles.insert(baseName + QLatin1String(".gpx"),
+                           (gpx.isNull()) ? QByteArray() : gpx.toByteArray());
+        if (gpxDocument != NULL) {
+            *gpxDocument = gpx;
+        }
+    }
+
+    if (outputFormats & HrmOutput) {
+        const OutputFiles hrm = formatHRM(parsed, hrmOptions, baseName);
+        if (hrm.isEmpty()) {
+            outputFiles.insert(baseName + QLatin1String(".hrm"), QByteArray());
+        }
+        for (OutputFiles::const_iterator iter = hrm.constBegin(); iter != hrm.constEnd(); ++iter) {
+            outputFiles.insert(iter.key(), iter.value());
+        }
+    }
+
+    if (outputFormats & TcxOutput) {
+        const QDomDocument tcx = toTCX(parsed, tcxOptions, QString(), sampleAlignment);
+        outputFiles.insert(baseName + QLatin1String(".tcx"),
+                           (tcx.isNull()) ? QByteArray() : tcx.toByteArray());
+        if (tcxDocument != NULL) {
+            *tcxDocument = tcx;
+        }
+    }
+
+    if (outputFormats & FitOutput) {
+        outputFiles.insert(baseName + QLatin1String(".fit"), toFIT(parsed, sampleAlignment));
+    }
+
+    if (outputFormats & CsvOutput) {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        outputFiles.insert(baseName + QLatin1String(".csv"),
+                           (writeCSV(parsed, buffer, sampleAlignment)) ? buffer.data() : QByteArray());
+    }
+
+    if (outputFormats & ArrowOutput) {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        outputFiles.insert(baseName + QLatin1String(".arrow"),
+                           (writeArrow(parsed, buffer, sampleAlignment)) ? buffer.data() : QByteArray());
+    }
+
+    // Compress the (highly compressible) text outputs, if requested.
+    if (outputFormats & GzipOutputs) {
+        OutputFiles compressedFiles;
+        for (OutputFiles::const_iterator iter = outputFiles.constBegin(); iter != outputFiles.constEnd(); ++iter) {
+            if ((iter.key().endsWith(QLatin1String(".gpx"))) ||
+                (iter.key().endsWith(QLatin1String(".hrm"))) ||
+                (iter.key().endsWith(QLatin1String(".tcx")))) {
+                compressedFiles.insert(iter.key() + QLatin1String(".gz"), (iter.value().isNull())
+                    ? QByteArray() : GzipCompressor::compress(iter.value()));
+            } else {
+                compressedFiles.insert(iter.key(), iter.value());
+            }
+        }
+        return compressedFiles;
+    }
+
+    return outputFiles;
+}
+
+QByteArray TrainingSession::toFIT() const
+{
+    return toFIT(parsed, sampleAlignment);
+}
+
+/**
+ * @brief Converts a parsed training session to a FIT activity file.
+ *
+ * Each exercise becomes a FIT session, with one record message per sample
+ * (including the exercise's route, if any), followed by one lap message per
+ * lap, and the session message itself. A single activity message completes
+ * the file.
+ *
+ * @param session   Parsed training session to convert.
+ * @param alignment How route points are aligned with samples.
+ *
+ * @return The FIT file's contents, or an empty array if \a session contains no
+ *         exercises that could be converted.
+ *
+ * @see https://developer.garmin.com/fit/file-types/activity/
+ */
+QByteArray TrainingSession::toFIT(const ParsedSession &session,
+                                  const Timeline::Alignment alignment)
+{
+    const QVariantMap &parsedExercises = session.exercises();
+    const QVariantMap &parsedSession = session.session();
+
+    // Local message types.
+    enum { FileIdType = 0, RecordType = 1, LapType = 2, SessionType = 3, ActivityType = 4 };
+
+    // Global message and field numbers, and units, are per the FIT profile.
+    static const FitEncoder::Field fileIdFields[] = {
+        {   0, FitEncoder::Enum   }, // type
+        {   1, FitEncoder::Uint16 }, // manufacturer
+        {   2, FitEncoder::Uint16 }, // product
+        {   4, FitEncoder::Uint32 }, // time_created
+    };
+    static const FitEncoder::Field recordFields[] = {
+        { 253, FitEncoder::Uint32 }, // timestamp
+        {   0, FitEncoder::Sint32 }, // position_lat (semicircles)
+        {   1, FitEncoder::Sint32 }, // position_long (semicircles)
+        {   2, FitEncoder::Uint16 }, // altitude (5 * (m + 500))
+        {   3, FitEncoder::Uint8  }, // heart_rate (bpm)
+        {   4, FitEncoder::Uint8  }, // cadence (rpm)
+        {   5, FitEncoder::Uint32 }, // distance (cm)
+        {   6, FitEncoder::Uint16 }, // speed (mm/s)
+        {   7, FitEncoder::Uint16 }, // power (W)
+        {  13, FitEncoder::Sint8  }, // temperature (C)
+    };
+    static const FitEncoder::Field lapFields[] = {
+        { 254, FitEncoder::Uint16 }, // message_index
+        { 253, FitEncoder::Uint32 }, // timestamp
+        {   0, FitEncoder::Enum   }, // event
+        {   1, FitEncoder::Enum   }, // event_type
+        {   2, FitEncoder::Uint32 }, // start_time
+        {   7, FitEncoder::Uint32 }, // total_elapsed_time (ms)
+        {   8, FitEncoder::Uint32 }, // total_timer_time (ms)
+        {   9, FitEncoder::Uint32 }, // total_distance (cm)
+        {  15, FitEncoder::Uint8  }, // avg_heart_rate (bpm)
+        {  16, FitEncoder::Uint8  }, // max_heart_rate (bpm)
+        {  24, FitEncoder::Enum   }, // lap_trigger
+    };
+    static const FitEncoder::Field sessionFields[] = {
+        { 254, FitEncoder::Uint16 }, // message_index
+        { 253, FitEncoder::Uint32 }, // timestamp
+        {   0, FitEncoder::Enum   }, // event
+        {   1, FitEncoder::Enum   }, // event_type
+        {   2, FitEncoder::Uint32 }, // start_time
+        {   5, FitEncoder::Enum   }, // sport
+        {   7, FitEncoder::Uint32 }, // total_elapsed_time (ms)
+        {   8, FitEncoder::Uint32 }, // total_timer_time (ms)
+        {   9, FitEncoder::Uint32 }, // total_distance (cm)
+        {  11, FitEncoder::Uint16 }, // total_calories (kcal)
+        {  16, FitEncoder::Uint8  }, // avg_heart_rate (bpm)
+        {  17, FitEncoder::Uint8  }, // max_heart_rate (bpm)
+        {  25, FitEncoder::Uint16 }, // first_lap_index
+        {  26, FitEncoder::Uint16 }, // num_laps
+    };
+    static const FitEncoder::Field activityFields[] = {
+        { 253, FitEncoder::Uint32 }, // timestamp
+        {   0, FitEncoder::Uint32 }, // total_timer_time (ms)
+        {   1, FitEncoder::Uint16 }, // num_sessions
+        {   2, FitEncoder::Enum   }, // type
+        {   3, FitEncoder::Enum   }, // event
+        {   4, FitEncoder::Enum   }, // event_type
+        {   5, FitEncoder::Uint32 }, // local_timestamp
+    };
+
+    // The file's creation time is the session's start time, if known.
+    QDateTime createdTime = getDateTime(firstMap(parsedSession.value(QLatin1String("start"))));
+    foreach (const QVariant &exercise, parsedExercises) {
+        if (createdTime.isValid()) {
+            break;
+        }
+        createdTime = exercise.toMap().value(START_TIME).toDateTime();
+    }
+
+    FitEncoder fit;
+    fit.defineMessage(FileIdType, 0, fileIdFields);
+    const qint64 fileId[] = {
+        4,   // type: activity
+        255, // manufacturer: development
+        0,   // product
+        FitEncoder::timestamp(createdTime)
+    };
+    fit.writeMessage(FileIdType, fileId);
+    fit.defineMessage(RecordType,   20, recordFields);
+    fit.defineMessage(LapType,      19, lapFields);
+    fit.defineMessage(SessionType,  18, sessionFields);
+    fit.defineMessage(ActivityType, 34, activityFields);
+
+    qint64 lapIndex = 0, sessionIndex = 0, totalTimerTime = 0, endTimestamp = FitEncoder::Invalid;
+    int utcOffset = 0;
+    foreach (const QVariant &exercise, parsedExercises) {
+        const QVariantMap map = exercise.toMap();
+        if (!map.contains(CREATE)) {
+            qWarning() << "Skipping exercise with no 'create' request data";
+            continue;
+        }
+        const QDateTime startTime = map.value(START_TIME).toDateTime();
+        const qint64 start = FitEncoder::timestamp(startTime);
+        if (start == FitEncoder::Invalid) {
+            qWarning() << "Skipping exercise with no start time";
+            continue;
+        }
+        const QVariantMap create  = map.value(CREATE).toMap();
+        const QVariantMap route   = map.value(ROUTE).toMap();
+
+        // Get the "samples" samples, from legacy and / or intervalled channels.
+        const SampleChannels channels = getSampleChannels(map);
+
+        // Get the "route" samples.
+        const QVariantList latitude    = route.value(QLatin1String("latitude")).toList();
+        const QVariantList longitude   = route.value(QLatin1String("longitude")).toList();
+
+        // Add a record message for each sample, and any route point with no sample aligned.
+        const Timeline timeline = getTimeline(map, channels, alignment);
+        foreach (const Timeline::Point &point, timeline.points()) {
+            if ((!(point.types & Timeline::SamplePoint)) && (point.sampleIndex >= 0)) {
+                continue; // Route point between samples, so interpolated into them instead.
+            }
+            qint64 record[] = {
+                start + (point.offset / 1000),
+                FitEncoder::Invalid, FitEncoder::Invalid, FitEncoder::Invalid,
+                FitEncoder::Invalid, FitEncoder::Invalid, FitEncoder::Invalid,
+                FitEncoder::Invalid, FitEncoder::Invalid, FitEncoder::Invalid
+            };
+            const QVariant lat = interpolate(latitude, point.routeIndex, point.routeWeight);
+            const QVariant lon = interpolate(longitude, point.routeIndex, point.routeWeight);
+            if ((lat.isValid()) && (lon.isValid())) {
+                record[1] = FitEncoder::semicircles(lat.toDouble());
+                record[2] = FitEncoder::semicircles(lon.toDouble());
+            }
+            if (point.sampleIndex < 0) { // Route point with no samples aligned.
+                if (record[1] != FitEncoder::Invalid) {
+                    fit.writeMessage(RecordType, record);
+                }
+                continue;
+            }
+            const int index = point.sampleIndex;
+            double value;
+            if (channels.value(SampleChannels::Altitude, index, value)) {
+                record[3] = qRound64((value + 500.0) * 5.0);
+            }
+            if ((channels.value(SampleChannels::Heartrate, index, value)) && (int(value) > 0)) {
+                record[4] = int(value);
+            }
+            if ((channels.value(SampleChannels::Cadence, index, value)) && (int(value) >= 0)) {
+                record[5] = int(value);
+            }
+            if (channels.value(SampleChannels::Distance, index, value)) {
+                record[6] = qRound64(value * 100.0);
+            }
+            if ((channels.value(SampleChannels::Speed, index, value)) && (int(value) >= 0)) {
+                record[7] = qRound64(value / 3.6 * 1000.0);
+            }
+            double powerLeft, powerRight;
+            const bool havePowerLeft  = channels.value(SampleChannels::LeftPedalPower, index, powerLeft);
+            const bool havePowerRight = channels.value(SampleChannels::RightPedalPower, index, powerRight);
+            if (havePowerLeft && havePowerRight) {
+                record[8] = qMax(int(powerLeft), 0) + qMax(int(powerRight), 0);
+            } else if (havePowerLeft) {
+                record[8] = qMax(int(powerLeft) * 2, 0);
+            } else if (havePowerRight) {
+                record[8] = qMax(int(powerRight) * 2, 0);
+            }
+            if (channels.value(SampleChannels::Temperature, index, value)) {
+                record[9] = qRound64(value);
+            }
+
+            bool haveData = false;
+            for (size_t field = 1; field < (sizeof(record)/sizeof(record[0])); ++field) {
+                haveData |= (record[field] != FitEncoder::Invalid);
+            }
+            if (haveData) {
+                fit.writeMessage(RecordType, record);
+            }
+        }
+
+        // Build a map of lap split times to lap data.
+        QVariantList laps = map.value(LAPS).toMap().value(QLatin1String("laps")).toList();
+        if (laps.isEmpty()) {
+            laps = map.value(AUTOLAPS).toMap().value(QLatin1String("laps")).toList();
+        }
+        QMap<quint64, QVariantMap> splits;
+        foreach (const QVariant &lap, laps) {
+            const QVariantMap lapData = lap.toMap();
+            const quint64 splitTime = getDuration(firstMap(firstMap(
+                lapData.value(QLatin1String("header")))
+                .value(QLatin1String("split-time"))));
+            if (splitTime > 0) {
+                splits.insert(splitTime, lapData);
+            }
+        }
+
+        // Add a lap message for each lap, plus any time remaining after the last.
+        const quint64 exerciseDuration = getDuration(firstMap(create.value(QLatin1String("duration"))));
+        const double exerciseDistance = first(create.value(QLatin1String("distance"))).toDouble();
+        const qint64 firstLapIndex = lapIndex;
+        quint64 lapStartTime = 0;
+        double lapsDistance = 0.0;
+        for (QMap<quint64, QVariantMap>::const_iterator split = splits.constBegin();
+             split != splits.constEnd(); ++split) {
+            const QVariantMap header = firstMap(split.value().value(QLatin1String("header")));
+            const QVariantMap hrStats = firstMap(firstMap(split.value().value(QLatin1String("stats")))
+                .value(QLatin1String("heartrate")));
+            const double lapDistance = first(header.value(QLatin1String("distance"))).toDouble();
+            qint64 lapTrigger;
+            switch (first(header.value(QLatin1String("lap-type"))).toInt()) {
+            case 1:  lapTrigger = 2; break; // DISTANCE -> distance
+            case 2:  lapTrigger = 1; break; // DURATION -> time
+            case 3:  lapTrigger = 3; break; // LOCATION -> position_start
+            default: lapTrigger = 0;        // manual
+            }
+            const qint64 lap[] = {
+                lapIndex++,
+                start + static_cast<qint64>(split.key() / 1000),
+                9, // event: lap
+                1, // event_type: stop
+                start + static_cast<qint64>(lapStartTime / 1000),
+                static_cast<qint64>(split.key() - lapStartTime),
+                static_cast<qint64>(split.key() - lapStartTime),
+                qRound64(lapDistance * 100.0),
+                (hrStats.isEmpty()) ? FitEncoder::Invalid
+                    : first(hrStats.value(QLatin1String("average"))).toLongLong(),
+                (hrStats.isEmpty()) ? FitEncoder::Invalid
+                    : first(hrStats.value(QLatin1String("maximum"))).toLongLong(),
+                lapTrigger
+            };
+            fit.writeMessage(LapType, lap);
+            lapStartTime = split.key();
+            lapsDistance += lapDistance;
+        }
+        const QVariantMap hrStats = firstMap(getStatistics(map).value(QLatin1String("heartrate")));
+        if ((splits.isEmpty()) || (exerciseDuration > lapStartTime)) {
+            const quint64 remainingDuration = qMax(exerciseDuration, lapStartTime) - lapStartTime;
+            const qint64 lap[] = {
+                lapIndex++,
+                start + static_cast<qint64>((lapStartTime + remainingDuration) / 1000),
+                9, // event: lap
+                1, // event_type: stop
+                start + static_cast<qint64>(lapStartTime / 1000),
+                static_cast<qint64>(remainingDuration),
+                static_cast<qint64>(remainingDuration),
+                qRound64(qMax(exerciseDistance - lapsDistance, 0.0) * 100.0),
+                (hrStats.isEmpty() || !splits.isEmpty()) ? FitEncoder::Invalid
+                    : first(hrStats.value(QLatin1String("average"))).toLongLong(),
+                (hrStats.isEmpty() || !splits.isEmpty()) ? FitEncoder::Invalid
+                    : first(hrStats.value(QLatin1String("maximum"))).toLongLong(),
+                7 // lap_trigger: session_end
+            };
+            fit.writeMessage(LapType, lap);
+        }
+
+        // Add the session message, summarising the whole exercise.
+        const qint64 end = start + static_cast<qint64>(exerciseDuration / 1000);
+        const qint64 sessionMessage[] = {
+            sessionIndex++,
+            end,
+            8, // event: session
+            1, // event_type: stop
+            start,
+            getFitSport(first(firstMap(create.value(QLatin1String("sport")))
+                .value(QLatin1String("value"))).toULongLong()),
+            static_cast<qint64>(exerciseDuration),
+            static_cast<qint64>(exerciseDuration),
+            qRound64(exerciseDistance * 100.0),
+            first(create.value(QLatin1String("calories"))).isValid()
+                ? first(create.value(QLatin1String("calories"))).toLongLong() : FitEncoder::Invalid,
+            (hrStats.isEmpty()) ? FitEncoder::Invalid
+                : first(hrStats.value(QLatin1String("average"))).toLongLong(),
+            (hrStats.isEmpty()) ? FitEncoder::Invalid
+                : first(hrStats.value(QLatin1String("maximum"))).toLongLong(),
+            firstLapIndex,
+            lapIndex - firstLapIndex
+        };
+        fit.writeMessage(SessionType, sessionMessage);
+
+        totalTimerTime += static_cast<qint64>(exerciseDuration);
+        endTimestamp = qMax(endTimestamp, end); // Note, Invalid is less than any end.
+        #if (QT_VERSION >= QT_VERSION_CHECK(5, 2, 0))
+        utcOffset = startTime.offsetFromUtc();
+        #else
+        utcOffset = startTime.utcOffset();
+        #endif
+    }
+
+    if (sessionIndex == 0) {
+        return QByteArray();
+    }
+
+    // Add the activity message, summarising the whole training session.
+    const qint64 activity[] = {
+        endTimestamp,
+        totalTimerTime,
+        sessionIndex,
+        0,  // type: manual
+        26, // event: activity
+        1,  // event_type: stop
+        endTimestamp + utcOffset
+    };
+    fit.writeMessage(ActivityType, activity);
+    return fit.toByteArray();
+}
+
+/**
+ * @brief Splits an exercise into laps of a fixed distance, or duration.
+ *
+ * This allows for user-defined splits (such as every kilometre, or every five
+ * minutes) regardless of any laps recorded by the device. Each lap's statistics
+ * are derived from the exercise's samples, which are aggregated just once for
+ * all laps.
+ *
+ * @param exercise Parsed exercise to split.
+ * @param split    Whether to split by distance, or duration.
+ * @param interval Distance (in metres) or duration (in milliseconds) of each lap.
+ *
+ * @return Laps in the same form as those parsed from the exercise's "laps" data,
+ *         or an empty list if the exercise cannot be split as requested.
+ */
+QVariantList TrainingSession::splitLaps(const QVariantMap &exercise, const LapSplit split,
+                                        const double interval)
+{
+    const SampleChannels channels = getSampleChannels(exercise);
+    const quint64 recordInterval = static_cast<quint64>(qMax(channels.recordInterval(), Q_INT64_C(0)));
+    const int distanceCount = channels.sampleCount(SampleChannels::Distance);
+    if ((interval <= 0.0) || (recordInterval == 0) ||
+        ((split == DistanceSplits) && (distanceCount == 0))) {
+        return QVariantList();
+    }
+
+    // Cumulative distance at each sample, for finding where each split falls.
+    QVector<double> distances(distanceCount);
+    for (int index = 0; index < distanceCount; ++index) {
+        double distance = 0.0;
+        channels.rawValue(SampleChannels::Distance, index, distance);
+        distances[index] = ((index > 0) && (channels.isOffline(SampleChannels::Distance, index)))
+            ? distances.at(index - 1) : distance;
+        if ((index > 0) && (distances.at(index) < distances.at(index - 1))) {
+            distances[index] = distances.at(index - 1); // Keep the distances sorted.
+        }
+    }
+
+    const QVariantMap create = exercise.value(CREATE).toMap();
+    quint64 exerciseDuration = getDuration(firstMap(create.value(QLatin1String("duration"))));
+    if (exerciseDuration == 0) {
+        exerciseDuration = channels.sampleCount() * recordInterval;
+    }
+
+    const SampleLapStats sampleLapStats(channels);
+    QVariantList laps;
+    quint64 lapStartTime = 0;
+    for (int lapNumber = 1; lapStartTime < exerciseDuration; ++lapNumber) {
+        quint64 lapEndTime;
+        if (split == DurationSplits) {
+            lapEndTime = qMin(static_cast<quint64>(lapNumber * interval), exerciseDuration);
+        } else {
+            const QVector<double>::const_iterator next = std::lower_bound(
+                distances.constBegin(), distances.constEnd(), lapNumber * interval);
+            lapEndTime = (next == distances.constEnd()) ? exerciseDuration
+                : qMin((next - distances.constBegin()) * recordInterval, exerciseDuration);
+        }
+        if (lapEndTime <= lapStartTime) {
+            lapEndTime = qMin(lapStartTime + recordInterval, exerciseDuration);
+        }
+
+        const int startIndex = qMin(static_cast<int>(lapStartTime / recordInterval), distances.size() - 1);
+        const int endIndex = qMin(static_cast<int>(lapEndTime / recordInterval), distances.size() - 1);
+        QVariantMap header;
+        header.insert(QLatin1String("split-time"), QVariantList() << toDurationMap(lapEndTime));
+        header.insert(QLatin1String("duration"), QVariantList() << toDurationMap(lapEndTime - lapStartTime));
+        if (startIndex >= 0) {
+            header.insert(QLatin1String("distance"), QVariantList()
+                << (distances.at(endIndex) - distances.at(startIndex)));
+        }
+        header.insert(QLatin1String("lap-type"), QVariantList() << ((split == DistanceSplits) ? 1 : 2));
+
+        QVariantMap lap;
+        lap.insert(QLatin1String("header"), QVariantList() << header);
+        lap.insert(QLatin1String("stats"), QVariantList()
+            << sampleLapStats.fill(QVariantMap(), lapStartTime, lapEndTime));
+        laps.append(lap);
+        lapStartTime = lapEndTime;
+    }
+    return laps;
+}
+
+/**
+ * @brief Converts a parsed training session to columnar sample tables.
+ *
+ * Each exercise becomes one SampleTable, with one row per sample (plus any
+ * route points not aligned with a sample). The columns are the exercise's
+ * index, the row's time, and then each of the "samples" and "route" channels. Missing samples, and samples recorded while their
+ * sensor was offline, are null.
+ *
+ * @param session   Parsed training session to convert.
+ * @param alignment How route points are aligned with samples.
+ *
+ * @return A table for each exercise, in exercise order.
+ */
+QList<SampleTable> TrainingSession::toSampleTables(const ParsedSession &session,
+                                                   const Timeline::Alignment alignment)
+{
+    struct Channel {
+        const char * column;
+        bool isRoute;
+        SampleChannels::Channel sampleChannel; ///< Only if not isRoute.
+        const char * routeKey;                 ///< Only if isRoute.
+        SampleTable::Type type;
+    };
+    static const Channel channels[] = {
+        { "heartrate",         false, SampleChannels::Heartrate,           NULL,         SampleTable::Int32   },
+        { "cadence",           false, SampleChannels::Cadence,             NULL,         SampleTable::Int32   },
+        { "altitude",          false, SampleChannels::Altitude,            NULL,         SampleTable::Float32 },
+        { "temperature",       false, SampleChannels::Temperature,         NULL,         SampleTable::Float32 },
+        { "speed",             false, SampleChannels::Speed,               NULL,         SampleTable::Float32 },
+        { "distance",          false, SampleChannels::Distance,            NULL,         SampleTable::Float32 },
+        { "stride-length",     false, SampleChannels::StrideLength,        NULL,         SampleTable::Int32   },
+        { "fwd-acceleration",  false, SampleChannels::ForwardAcceleration, NULL,         SampleTable::Float32 },
+        { "left-pedal-power",  false, SampleChannels::LeftPedalPower,      NULL,         SampleTable::Int32   },
+        { "right-pedal-power", false, SampleChannels::RightPedalPower,     NULL,         SampleTable::Int32   },
+        { "latitude",          true,  SampleChannels::ChannelCount,        "latitude",   SampleTable::Float64 },
+        { "longitude",         true,  SampleChannels::ChannelCount,        "longitude",  SampleTable::Float64 },
+        { "gps-altitude",      true,  SampleChannels::ChannelCount,        "altitude",   SampleTable::Int32   },
+        { "satellites",        true,  SampleChannels::ChannelCount,        "satellites", SampleTable::Int32   },
+    };
+    const int channelCount = sizeof(channels)/sizeof(channels[0]);
+
+    QList<SampleTable> tables;
+    foreach (const QVariant &exercise, session.exercises()) {
+        const QVariantMap map = exercise.toMap();
+        if (!map.contains(CREATE)) {
+            qWarning() << "Skipping exercise with no 'create' request data";
+            continue;
+        }
+        const QVariantMap route   = map.value(ROUTE).toMap();
+        const QVariantList routeOffline = route.value(QLatin1String("gps-offline")).toList();
+        const SampleChannels samples = getSampleChannels(map);
+        const QDateTime startTime = map.value(START_TIME).toDateTime();
+
+        // The table has a row for each sample, and for each route point with no sample aligned.
+        const Timeline timeline = getTimeline(map, samples, alignment);
+        QVector<Timeline::Point> rows;
+        foreach (const Timeline::Point &point, timeline.points()) {
+            if ((point.types & Timeline::SamplePoint) || (point.sampleIndex < 0)) {
+                rows.append(point);
+            }
+        }
+
+        SampleTable table;
+        SampleTable::Column exerciseColumn(QLatin1String("exercise"), SampleTable::Int32);
+        SampleTable::Column timeColumn(QLatin1String("time"), SampleTable::TimestampMSecs);
+        foreach (const Timeline::Point &row, rows) {
+            exerciseColumn.append(static_cast<qint64>(tables.size()));
+            if (startTime.isValid()) {
+                timeColumn.append(startTime.toMSecsSinceEpoch() + row.offset);
+            } else {
+                timeColumn.appendNull();
+            }
+        }
+        table.addColumn(exerciseColumn);
+        table.addColumn(timeColumn);
+
+        for (int index = 0; index < channelCount; ++index) {
+            const Channel &channel = channels[index];
+            SampleTable::Column column(QLatin1String(channel.column), channel.type);
+            if (!channel.isRoute) {
+                foreach (const Timeline::Point &row, rows) {
+                    // Integer channels, such as heart rates, are never interpolated.
+                    const double weight = (channel.type == SampleTable::Int32) ? 0.0 : row.sampleWeight;
+                    double value;
+                    if ((samples.isOffline(channel.sampleChannel, row.sampleIndex)) ||
+                        ((weight > 0.0) && (samples.isOffline(channel.sampleChannel, row.sampleIndex + 1))) ||
+                        (!interpolate(samples, channel.sampleChannel, row.sampleIndex, weight, value))) {
+                        column.appendNull();
+                    } else if (channel.type == SampleTable::Int32) {
+                        column.append(qRound64(value));
+                    } else {
+                        column.append(value);
+                    }
+                }
+                table.addColumn(column);
+                continue;
+            }
+
+            const QVariantList values = route.value(QLatin1String(channel.routeKey)).toList();
+            const QBitArray offline = offlineMask(routeOffline, values.size());
+            foreach (const Timeline::Point &row, rows) {
+                const int valueIndex = row.routeIndex;
+                // Integer channels, such as satellite counts, are never interpolated.
+                const double weight = (channel.type == SampleTable::Int32) ? 0.0 : row.routeWeight;
+                if ((valueIndex < 0) || (valueIndex >= values.size()) ||
+                    (offline.testBit(valueIndex)) ||
+                    ((weight > 0.0) && (valueIndex + 1 < values.size()) &&
+                     (offline.testBit(valueIndex + 1)))) {
+                    column.appendNull();
+                    continue;
+                }
+                const QVariant value = interpolate(values, valueIndex, weight);
+                if (!value.isValid()) {
+                    column.appendNull();
+                } else if (channel.type == SampleTable::Int32) {
+                    column.append(value.toLongLong());
+                } else {
+                    column.append(value.toDouble());
+                }
+            }
+            table.addColumn(column);
+        }
+        tables.append(table);
+    }
+    return tables;
+}
+
+// Formats the text of each of a route's GPX trkpt elements. This is the bulk of
+// toGPX's per-trackpoint work, and unlike building the (non thread-safe) DOM, it
+// can be split across threads for long routes.
+class GpxTrackPointFormatter : public ChunkedFormatter {
+
+public:
+    struct TrackPoint {
+        quint32 timeOffset;
+        QString latitude;
+        QString longitude;
+        QString elevation;
+        QString time;
+        QString satellites;
+        QString acceleration; ///< Null if not available, as are the following.
+        QString cadence;
+        QString distance;
+        QString heartrate;
+        QString temperature;
+        uint cadenceValue;
+        uint heartrateValue;
+    };
+
+    GpxTrackPointFormatter(const QVariantMap &route, const SampleChannels &samples,
+                           const QDateTime &startTime,
+                           const TrainingSession::GpxOptions gpxOptions,
+                           const Timeline &timeline)
+        : gpxOptions(gpxOptions), startTime(startTime), samples(samples),
+          altitude(route.value(QLatin1String("altitude")).toList()),
+          duration(route.value(QLatin1String("duration")).toList()),
+          latitude(route.value(QLatin1String("latitude")).toList()),
+          longitude(route.value(QLatin1String("longitude")).toList()),
+          satellites(route.value(QLatin1String("satellites")).toList())
+    {
+        if ((duration.size() != altitude.size())  ||
+            (duration.size() != latitude.size())  ||
+            (duration.size() != longitude.size()) ||
+            (duration.size() != satellites.size())) {
+            qWarning() << "Sample lists not all equal sizes:" << duration.size()
+                       << altitude.size() << latitude.size()
+                       << longitude.size() << satellites.size();
+        }
+
+        // Each route point becomes a trkpt, with the sample (if any) aligned with it.
+        foreach (const Timeline::Point &point, timeline.points()) {
+            if (point.types & Timeline::RoutePoint) {
+                routePoints.append(point);
+            }
+        }
+        points.resize(routePoints.size());
+        pointData = points.data(); // Pre-fetched, so formatChunk never detaches points.
+    }
+
+    QVector<TrackPoint> points;
+
+protected:
+    virtual void formatChunk(const int begin, const int end)
+    {
+        const bool wantHeartrateAndCadence =
+            gpxOptions.testFlag(TrainingSession::CluetrustGpxDataExtension) ||
+            gpxOptions.testFlag(TrainingSession::GarminTrackPointExtension);
+        TimestampFormatter timestamps(startTime);
+        for (int index = begin; index < end; ++index) {
+            TrackPoint &point = pointData[index];
+            const int routeIndex = routePoints.at(index).routeIndex;
+            const int sampleIndex = routePoints.at(index).sampleIndex;
+            const double weight = routePoints.at(index).sampleWeight;
+            point.timeOffset = duration.at(routeIndex).toUInt();
+            point.latitude   = VARIANT_TO_STRING(latitude.at(routeIndex));
+            point.longitude  = VARIANT_TO_STRING(longitude.at(routeIndex));
+            point.elevation  = VARIANT_TO_STRING(altitude.at(routeIndex));
+            point.time       = timestamps.format(point.timeOffset);
+            point.satellites = VARIANT_TO_STRING(satellites.at(routeIndex));
+
+            double value;
+            if (wantHeartrateAndCadence) {
+                if ((interpolate(samples, SampleChannels::Heartrate, sampleIndex, weight, value)) &&
+                    (!sensorOffline(samples, SampleChannels::Heartrate, sampleIndex, weight))) {
+                    point.heartrateValue = static_cast<uint>(qRound64(value));
+                    point.heartrate = QString::fromLatin1("%1").arg(point.heartrateValue);
+                }
+                // Note, cadence is checked against the altitude sensor, as toGPX always has.
+                if ((interpolate(samples, SampleChannels::Cadence, sampleIndex, weight, value)) &&
+                    (!sensorOffline(samples, SampleChannels::Altitude, sampleIndex, weight))) {
+                    point.cadenceValue = static_cast<uint>(qRound64(value));
+                    point.cadence = QString::fromLatin1("%1").arg(point.cadenceValue);
+                }
+                if (interpolate(samples, SampleChannels::Temperature, sampleIndex, weight, value)) {
+                    point.temperature = QString::fromLatin1("%1").arg(static_cast<float>(value));
+                }
+            }
+
+            if ((gpxOptions.testFlag(TrainingSession::CluetrustGpxDataExtension)) &&
+                (interpolate(samples, SampleChannels::Distance, sampleIndex, weight, value)) &&
+                (!sensorOffline(samples, SampleChannels::Distance, sampleIndex, weight))) {
+                point.distance = QString::fromLatin1("%1").arg(static_cast<uint>(qRound64(value)));
+            }
+
+            if ((gpxOptions.testFlag(TrainingSession::GarminAccelerationExtension)) &&
+                (interpolate(samples, SampleChannels::ForwardAcceleration, sampleIndex, weight, value)) &&
+                (!sensorOffline(samples, SampleChannels::ForwardAcceleration, sampleIndex, weight))) {
+                point.acceleration = QString::fromLatin1("%1").arg(static_cast<float>(value));
+            }
+        }
+    }
+
+    const TrainingSession::GpxOptions gpxOptions;
+    const QDateTime startTime;
+
+    // The "samples" samples.
+    const SampleChannels samples;
+
+    // The "route" samples.
+    const QVariantList altitude;
+    const QVariantList duration;
+    const QVariantList latitude;
+    const QVariantList longitude;
+    const QVariantList satellites;
+
+    QVector<Timeline::Point> routePoints;
+    TrackPoint * pointData;
+
+};
+
 QDomDocument TrainingSession::toGPX(const QDateTime &creationTime) const
 {
+    return toGPX(parsed, gpxOptions, creationTime, sampleAlignment);
+}
+
+/// @see http://www.topografix.com/GPX/1/1/gpx.xsd
+QDomDocument TrainingSession::toGPX(const ParsedSession &session,
+                                    const GpxOptions gpxOptions,
+                                    const QDateTime &creationTime,
+                                    const Timeline::Alignment alignment)
+{
+    const QString baseName = session.baseName();
+    const QVariantMap &parsedExercises = session.exercises();
+
     QDomDocument doc;
     doc.appendChild(doc.createProcessingInstruction(QLatin1String("xml"),
         QLatin1String("version='1.0' encoding='utf-8'")));
@@ -1974,31 +3319,7 @@ QDomDocument TrainingSession::toGPX(const QDateTime &creationTime) const
         const QVariantMap route = map.value(ROUTE).toMap();
         if (!route.isEmpty()) {
             // Get the starting time.
-            const QDateTime startTime = getDateTime(firstMap(
-                route.value(QLatin1String("timestamp"))));
-
-            // Get the "samples" samples.
-            const QVariantMap samples = map.value(SAMPLES).toMap();
-            const QVariantList cadence             = samples.value(QLatin1String("cadence")).toList();
-            const QVariantList distance            = samples.value(QLatin1String("distance")).toList();
-            const QVariantList forwardAcceleration = samples.value(QLatin1String("fwd-acceleration")).toList();
-            const QVariantList heartrate           = samples.value(QLatin1String("heartrate")).toList();
-            const QVariantList temperature         = samples.value(QLatin1String("temperature")).toList();
-
-            // Get the "route" samples.
-            const QVariantList altitude   = route.value(QLatin1String("altitude")).toList();
-            const QVariantList duration   = route.value(QLatin1String("duration")).toList();
-            const QVariantList latitude   = route.value(QLatin1String("latitude")).toList();
-            const QVariantList longitude  = route.value(QLatin1String("longitude")).toList();
-            const QVariantList satellites = route.value(QLatin1String("satellites")).toList();
-            if ((duration.size() != altitude.size())  ||
-                (duration.size() != latitude.size())  ||
-                (duration.size() != longitude.size()) ||
-                (duration.size() != satellites.size())) {
-                qWarning() << "Sample lists not all equal sizes:" << duration.size()
-                           << altitude.size() << latitude.size()
-                           << longitude.size() << satellites.size();
-            }
+            const QDateTime startTime = map.value(ROUTE_START_TIME).toDateTime();
 
             // Build a list of lap split times.
             QVariantList laps = map.value(LAPS).toMap().value(QLatin1String("laps")).toList();
@@ -2020,27 +3341,31 @@ QDomDocument TrainingSession::toGPX(const QDateTime &creationTime) const
             std::sort(splits.begin(), splits.end());
             #endif
 
-            // Add trkseg elements containing the actual GPS data.
+            // Format the trackpoints (in parallel chunks, for long routes), then
+            // add trkseg elements containing the actual GPS data.
+            const SampleChannels samples = getSampleChannels(map);
+            GpxTrackPointFormatter formatter(route, samples, startTime, gpxOptions,
+                                             getTimeline(map, samples, alignment));
+            formatter.format(formatter.points.size());
             QDomElement trkseg = doc.createElement(QLatin1String("trkseg"));
             trk.appendChild(trkseg);
-            for (int index = 0; index < duration.size(); ++index) {
-                const quint32 timeOffset = duration.at(index).toUInt();
-                if ((!splits.isEmpty()) && (timeOffset > splits.first())) {
+            for (int index = 0; index < formatter.points.size(); ++index) {
+                const GpxTrackPointFormatter::TrackPoint &point = formatter.points.at(index);
+                if ((!splits.isEmpty()) && (point.timeOffset > splits.first())) {
                     trkseg = doc.createElement(QLatin1String("trkseg"));
                     trk.appendChild(trkseg);
                     splits.removeFirst();
                 }
 
                 QDomElement trkpt = doc.createElement(QLatin1String("trkpt"));
-                trkpt.setAttribute(QLatin1String("lat"), VARIANT_TO_STRING(latitude.at(index)));
-                trkpt.setAttribute(QLatin1String("lon"), VARIANT_TO_STRING(longitude.at(index)));
+                trkpt.setAttribute(QLatin1String("lat"), point.latitude);
+                trkpt.setAttribute(QLatin1String("lon"), point.longitude);
                 trkpt.appendChild(doc.createElement(QLatin1String("ele")))
-                    .appendChild(doc.createTextNode(VARIANT_TO_STRING(altitude.at(index))));
+                    .appendChild(doc.createTextNode(point.elevation));
                 trkpt.appendChild(doc.createElement(QLatin1String("time")))
-                    .appendChild(doc.createTextNode(startTime.addMSecs(
-                        timeOffset).toString(Qt::ISODate)));
+                    .appendChild(doc.createTextNode(point.time));
                 trkpt.appendChild(doc.createElement(QLatin1String("sat")))
-                    .appendChild(doc.createTextNode(VARIANT_TO_STRING(satellites.at(index))));
+                    .appendChild(doc.createTextNode(point.satellites));
 
                 if (gpxOptions.testFlag(CluetrustGpxDataExtension)   ||
                     gpxOptions.testFlag(GarminAccelerationExtension) ||
@@ -2049,32 +3374,25 @@ QDomDocument TrainingSession::toGPX(const QDateTime &creationTime) const
                     QDomElement extensions = doc.createElement(QLatin1String("extensions"));
 
                     if (gpxOptions.testFlag(CluetrustGpxDataExtension)) {
-                        if ((index < heartrate.length()) &&
-                            (!sensorOffline(samples.value(QLatin1String("heartrate-offline")).toList(), index))) {
+                        if (!point.heartrate.isNull()) {
                             extensions.appendChild(doc.createElement(QLatin1String("gpxdata:hr")))
-                                .appendChild(doc.createTextNode(QString::fromLatin1("%1")
-                                    .arg(heartrate.at(index).toUInt())));
+                                .appendChild(doc.createTextNode(point.heartrate));
                         }
 
-                        if ((index < cadence.length()) &&
-                            (!sensorOffline(samples.value(QLatin1String("altitude-offline")).toList(), index))) {
+                        if (!point.cadence.isNull()) {
                             extensions.appendChild(doc.createElement(QLatin1String("gpxdata:cadence")))
-                                .appendChild(doc.createTextNode(QString::fromLatin1("%1")
-                                    .arg(cadence.at(index).toUInt())));
+                                .appendChild(doc.createTextNode(point.cadence));
                         }
 
-                        if (index < temperature.length()) {
+                        if (!point.temperature.isNull()) {
                             extensions.appendChild(doc.createElement(QLatin1String("gpxdata:temp")))
-                                .appendChild(doc.createTextNode(QString::fromLatin1("%1")
-                                    .arg(temperature.at(index).toFloat())));
+                                .appendChild(doc.createTextNode(point.temperature));
                         }
 
-                        if ((index < distance.length()) &&
-                            (!sensorOffline(samples.value(QLatin1String("distance-offline")).toList(), index))) {
+                        if (!point.distance.isNull()) {
                             /// @todo  Include optional gpxdata:sensor="wheel|pedometer" attribute.
                             extensions.appendChild(doc.createElement(QLatin1String("gpxdata:distance")))
-                                .appendChild(doc.createTextNode(QString::fromLatin1("%1")
-                                    .arg(distance.at(index).toUInt())));
+                                .appendChild(doc.createTextNode(point.distance));
                         }
                     }
 
@@ -2082,11 +3400,9 @@ QDomDocument TrainingSession::toGPX(const QDateTime &creationTime) const
                         QDomElement accelerationExtension = doc.createElement(
                             QLatin1String("gpxax:AccelerationExtension"));
 
-                        if ((index < forwardAcceleration.length()) &&
-                            (!sensorOffline(samples.value(QLatin1String("fwd-acceleration-offline")).toList(), index))) {
+                        if (!point.acceleration.isNull()) {
                             QDomElement accel = doc.createElement(QLatin1String("gpxax:accel"));
-                            accel.setAttribute(QLatin1String("x"), QString::fromLatin1("%1")
-                                .arg(forwardAcceleration.at(index).toFloat()));
+                            accel.setAttribute(QLatin1String("x"), point.acceleration);
                             accel.setAttribute(QLatin1String("y"), QLatin1String("0"));
                             accel.setAttribute(QLatin1String("z"), QLatin1String("0"));
                             accelerationExtension.appendChild(accel);
@@ -2099,28 +3415,20 @@ QDomDocument TrainingSession::toGPX(const QDateTime &creationTime) const
                         QDomElement trackPointExtension = doc.createElement(
                             QLatin1String("gpxtpx:TrackPointExtension"));
 
-                        if (index < temperature.length()) {
+                        if (!point.temperature.isNull()) {
                             trackPointExtension.appendChild(doc.createElement(QLatin1String("gpxtpx:atemp")))
-                                .appendChild(doc.createTextNode(QString::fromLatin1("%1")
-                                    .arg(temperature.at(index).toFloat())));
+                                .appendChild(doc.createTextNode(point.temperature));
                         }
 
-                        if ((index < heartrate.length()) &&
-                            (!sensorOffline(samples.value(QLatin1String("heartrate-offline")).toList(), index))) {
-                            const uint hr = heartrate.at(index).toUInt();
-                            if ((hr >= 1) && (hr <= 255)) { // Schema enforced.
-                                trackPointExtension.appendChild(doc.createElement(QLatin1String("gpxtpx:hr")))
-                                    .appendChild(doc.createTextNode(QString::fromLatin1("%1").arg(hr)));
-                            }
+                        if ((!point.heartrate.isNull()) &&
+                            (point.heartrateValue >= 1) && (point.heartrateValue <= 255)) { // Schema enforced.
+                            trackPointExtension.appendChild(doc.createElement(QLatin1String("gpxtpx:hr")))
+                                .appendChild(doc.createTextNode(point.heartrate));
                         }
 
-                        if ((index < cadence.length()) &&
-                            (!sensorOffline(samples.value(QLatin1String("altitude-offline")).toList(), index))) {
-                            const uint cad = cadence.at(index).toUInt();
-                            if (cad <= 254) { // Schema enforced.
+                        if ((!point.cadence.isNull()) && (point.cadenceValue <= 254)) { // Schema enforced.
                             trackPointExtension.appendChild(doc.createElement(QLatin1String("gpxtpx:cad")))
-                                .appendChild(doc.createTextNode(QString::fromLatin1("%1").arg(cad)));
-                            }
+                                .appendChild(doc.createTextNode(point.cadence));
                         }
 
                         extensions.appendChild(trackPointExtension);
@@ -2135,50 +3443,132 @@ QDomDocument TrainingSession::toGPX(const QDateTime &creationTime) const
     return doc;
 }
 
-// Sometimes Polar devices generate a separate rrsamples data file which is just
-// a flat list of R-R intervals.  However, other times, Polar devices include HRV
-// data interspersed with other exercise sample data - which is a bit odd considering
-// that R-R intervals are, by there very nature, not sampled at regular intervals as
-// all of the other exercise sample data is.  Anyway, toHRM will use rrsamples if
-// available, and fallback to exercise sample HRM values if not. To assist in the
-// latter case, this funciton flattens the exercise sample HRV data into a list
-// of intervals the same as the rrsample data files would, making both sources look
-// the same throughout the toHRM function.
-QVariantList flattenHrvSamplesForHrm(const QVariantMap &samples)
+// Merges an exercise's auto and manual laps, keyed (and so ordered) by their HRM
+// split times, the same as the HRM [IntTimes] and [LapNames] sections number them.
+// With KilometreHrmLaps, kilometre splits (as auto laps) replace them, if possible.
+QMap<QString, QVariantMap> getHrmLaps(const QVariantMap &exercise,
+                                      const TrainingSession::HrmOptions hrmOptions)
 {
-    QVariantList rrsamples;
-    foreach (const QVariant &hrv, samples.value(QLatin1String("heartrate-variability")).toList()) {
-        rrsamples.append(hrv.toMap().value(QLatin1String("intervals")).toList());
-        // Note, ignorig hrv["offline"] values - no way to apply them to HRM.
+    QVariantMap autoLaps = exercise.value(AUTOLAPS).toMap();
+    QVariantMap manualLaps = exercise.value(LAPS).toMap();
+    if (hrmOptions.testFlag(TrainingSession::KilometreHrmLaps)) {
+        const QVariantList splits = TrainingSession::splitLaps(
+            exercise, TrainingSession::DistanceSplits, 1000.0);
+        if (!splits.isEmpty()) {
+            autoLaps.clear();
+            autoLaps.insert(QLatin1String("laps"), splits);
+            manualLaps.clear();
+        }
     }
-    return rrsamples;
+
+    QMap<QString, QVariantMap> laps;
+    foreach (const QVariant &lap, autoLaps.value(QLatin1String("laps")).toList()) {
+        QVariantMap lapMap = lap.toMap();
+        const QString splitTime = hrmTime(firstMap(firstMap(
+            lapMap.value(QLatin1String("header")))
+            .value(QLatin1String("split-time"))));
+        lapMap.insert(QLatin1String("_isAuto"), QVariant(true));
+        laps.insert(splitTime, lapMap);
+    }
+    foreach (const QVariant &lap, manualLaps.value(QLatin1String("laps")).toList()) {
+        QVariantMap lapMap = lap.toMap();
+        const QString splitTime = hrmTime(firstMap(firstMap(
+            lapMap.value(QLatin1String("header")))
+            .value(QLatin1String("split-time"))));
+        lapMap.insert(QLatin1String("_isAuto"), QVariant(false));
+        laps.insert(splitTime, lapMap);
+    }
+    return laps;
+}
+
+// Analyses the heart rate variability of an exercise's R-R intervals, over the
+// whole exercise, and over each of its HRM laps. R-R intervals carry no
+// timestamps of their own, so are placed on the exercise's timeline by their
+// cumulative sum, and each lap takes the intervals that ended within it.
+QVariantMap getHrvAnalysis(const QVariantMap &exercise,
+                           const TrainingSession::HrmOptions hrmOptions)
+{
+    const RRIntervals intervals(exercise.value(RR_INTERVALS).toByteArray());
+    QVariantMap analysis;
+    analysis.insert(QLatin1String("exercise"),
+                    HrvMetrics(intervals.constData(), intervals.size()).toMap());
+
+    QVector<quint64> endTimes(intervals.size());
+    quint64 endTime = 0;
+    for (int index = 0; index < intervals.size(); ++index) {
+        endTime += intervals.at(index);
+        endTimes[index] = endTime;
+    }
+
+    QVariantList lapAnalyses;
+    const QMap<QString, QVariantMap> laps = getHrmLaps(exercise, hrmOptions);
+    foreach (const QVariantMap &lap, laps) {
+        const QVariantMap header = firstMap(lap.value(QLatin1String("header")));
+        const quint64 lapEndTime = getDuration(firstMap(header.value(QLatin1String("split-time"))));
+        const quint64 lapDuration = getDuration(firstMap(header.value(QLatin1String("duration"))));
+        const quint64 lapStartTime = lapEndTime - qMin(lapDuration, lapEndTime);
+        const int begin = static_cast<int>(std::upper_bound(
+            endTimes.constBegin(), endTimes.constEnd(), lapStartTime) - endTimes.constBegin());
+        const int end = static_cast<int>(std::upper_bound(
+            endTimes.constBegin(), endTimes.constEnd(), lapEndTime) - endTimes.constBegin());
+        QVariantMap lapAnalysis = HrvMetrics(intervals.constData() + begin, end - begin).toMap();
+        lapAnalysis.insert(QLatin1String("lap"), lapAnalyses.size() + 1);
+        lapAnalysis.insert(QLatin1String("start-time"), lapStartTime);
+        lapAnalysis.insert(QLatin1String("end-time"), lapEndTime);
+        lapAnalyses.append(lapAnalysis);
+    }
+    analysis.insert(QLatin1String("laps"), lapAnalyses);
+    return analysis;
+}
+
+// Writes one row of the HRM [HRV] section; see toHRM.
+void writeHrmHrvRow(QTextStream &stream, const int index, const QVariantMap &metrics)
+{
+    stream << index << '\t' << metrics.value(QLatin1String("intervals")).toInt();
+    static const char * const columns[] = {
+        "mean-rr", "sdnn", "rmssd", "pnn50", "lf-power", "hf-power", "lf-hf-ratio"
+    };
+    for (size_t column = 0; column < (sizeof(columns)/sizeof(columns[0])); ++column) {
+        stream << '\t' << QString::number(metrics.value(QLatin1String(columns[column])).toDouble(), 'f', 2);
+    }
+    stream << "\r\n";
 }
 
-/// @see http://www.polar.com/files/Polar_HRM_file%20format.pdf
 QStringList TrainingSession::toHRM(const bool rrDataOnly) const
 {
+    return toHRM(parsed, hrmOptions, rrDataOnly);
+}
+
+/// @see http://www.polar.com/files/Polar_HRM_file%20format.pdf
+QStringList TrainingSession::toHRM(const ParsedSession &session,
+                                   const HrmOptions hrmOptions,
+                                   const bool rrDataOnly)
+{
+    const QVariantMap &parsedExercises = session.exercises();
+    const QVariantMap &parsedPhysicalInformation = session.physicalInformation();
+    const QVariantMap &parsedSession = session.session();
     QStringList hrmList;
 
     foreach (const QVariant &exercise, parsedExercises) {
         const QVariantMap map = exercise.toMap();
-        const QVariantMap autoLaps   = map.value(AUTOLAPS).toMap();
         const QVariantMap create     = map.value(CREATE).toMap();
-        const QVariantMap manualLaps = map.value(LAPS).toMap();
-        const QVariantMap samples    = map.value(SAMPLES).toMap();
+        const SampleChannels samples = getSampleChannels(map);
         const QVariantMap stats      = map.value(STATISTICS).toMap();
         const QVariantMap zones      = map.value(ZONES).toMap();
 
-        const QVariantList rrsamples = map.contains(RRSAMPLES)
-            ? map.value(RRSAMPLES).toMap().value(QLatin1String("value")).toList()
-            : flattenHrvSamplesForHrm(samples);
+        // Sometimes Polar devices generate a separate rrsamples data file which is just
+        // a flat list of R-R intervals.  However, other times, Polar devices include HRV
+        // data interspersed with other exercise sample data.  Either way, parseExercise
+        // has flattened them into the one typed array of intervals.
+        const RRIntervals rrIntervals(map.value(RR_INTERVALS).toByteArray());
 
-        const bool haveAltitude     = ((!rrDataOnly) && (haveAnySamples(samples, QLatin1String("altitude"))));
-        const bool haveCadence      = ((!rrDataOnly) && (haveAnySamples(samples, QLatin1String("cadence"))));
-        const bool havePowerLeft    = ((!rrDataOnly) && (haveAnySamples(samples, QLatin1String("left-pedal-power"))));
-        const bool havePowerRight   = ((!rrDataOnly) && (haveAnySamples(samples, QLatin1String("right-pedal-power"))));
+        const bool haveAltitude     = ((!rrDataOnly) && (haveAnySamples(samples, SampleChannels::Altitude)));
+        const bool haveCadence      = ((!rrDataOnly) && (haveAnySamples(samples, SampleChannels::Cadence)));
+        const bool havePowerLeft    = ((!rrDataOnly) && (haveAnySamples(samples, SampleChannels::LeftPedalPower)));
+        const bool havePowerRight   = ((!rrDataOnly) && (haveAnySamples(samples, SampleChannels::RightPedalPower)));
         const bool havePower        = (havePowerLeft || havePowerRight);
         const bool havePowerBalance = havePower;
-        const bool haveSpeed        = ((!rrDataOnly) && (haveAnySamples(samples, QLatin1String("speed"))));
+        const bool haveSpeed        = ((!rrDataOnly) && (haveAnySamples(samples, SampleChannels::Speed)));
 
         QString hrmData;
         QTextStream stream(&hrmData);
@@ -2204,8 +3594,8 @@ QStringList TrainingSession::toHRM(const bool rrDataOnly) const
             "0" // i) Air pressure (not available).
             "\r\n";
 
-        const QDateTime startTime = getDateTime(firstMap(create.value(QLatin1String("start"))));
-        const quint64 recordInterval = getDuration(firstMap(samples.value(QLatin1String("record-interval"))));
+        const QDateTime startTime = map.value(START_TIME).toDateTime();
+        const quint64 recordInterval = static_cast<quint64>(qMax(samples.recordInterval(), Q_INT64_C(0)));
         stream << "Date="      << startTime.toString(QLatin1String("yyyyMMdd")) << "\r\n";
         stream << "StartTime=" << hrmTime(startTime.time()) << "\r\n";
         stream << "Length="    << hrmTime(firstMap(create.value(QLatin1String("duration")))) << "\r\n";
@@ -2302,29 +3692,19 @@ QStringList TrainingSession::toHRM(const bool rrDataOnly) const
         // [HRCCModeCh] "HR/CC mode swaps are a available only with Polar XTrainer Plus."
 
         // [IntTimes]
-        QMap<QString, QVariantMap> laps;
-        foreach (const QVariant &lap, autoLaps.value(QLatin1String("laps")).toList()) {
-            QVariantMap lapMap = lap.toMap();
-            const QString splitTime = hrmTime(firstMap(firstMap(
-                lapMap.value(QLatin1String("header")))
-                .value(QLatin1String("split-time"))));
-            lapMap.insert(QLatin1String("_isAuto"), QVariant(true));
-            laps.insert(splitTime, lapMap);
-        }
-        foreach (const QVariant &lap, manualLaps.value(QLatin1String("laps")).toList()) {
-            QVariantMap lapMap = lap.toMap();
-            const QString splitTime = hrmTime(firstMap(firstMap(
-                lapMap.value(QLatin1String("header")))
-                .value(QLatin1String("split-time"))));
-            lapMap.insert(QLatin1String("_isAuto"), QVariant(false));
-            laps.insert(splitTime, lapMap);
-        }
+        const QMap<QString, QVariantMap> laps = getHrmLaps(map, hrmOptions);
         if (!laps.isEmpty()) {
             stream << "\r\n[IntTimes]\r\n";
+            const SampleLapStats sampleLapStats(samples);
             foreach (const QString &splitTime, laps.keys()) {
                 const QVariantMap &lap = laps.value(splitTime);
                 const QVariantMap header = firstMap(lap.value(QLatin1String("header")));
-                const QVariantMap stats = firstMap(lap.value(QLatin1String("stats")));
+                QVariantMap stats = firstMap(lap.value(QLatin1String("stats")));
+                if (hrmOptions.testFlag(FillHrmLapStats)) {
+                    const quint64 lapEndTime = getDuration(firstMap(header.value(QLatin1String("split-time"))));
+                    const quint64 lapDuration = getDuration(firstMap(header.value(QLatin1String("duration"))));
+                    stats = sampleLapStats.fill(stats, lapEndTime - qMin(lapDuration, lapEndTime), lapEndTime);
+                }
                 const QVariantMap hrStats = firstMap(stats.value(QLatin1String("heartrate")));
                 // Row 1
                 stream << hrmTime(firstMap(header.value(QLatin1String("split-time"))));
@@ -2423,11 +3803,24 @@ QStringList TrainingSession::toHRM(const bool rrDataOnly) const
             }
         }
 
+        // [HRV] Another non-standard section, with one row for the whole exercise
+        // (index 0), then one for each lap: the number of NN intervals, mean NN
+        // interval, SDNN, RMSSD, pNN50, LF power, HF power and LF/HF ratio.
+        if ((hrmOptions.testFlag(HrvAnalysis)) && (!rrDataOnly) && (map.contains(RR_INTERVALS))) {
+            stream << "\r\n[HRV]\r\n";
+            const QVariantMap analysis = getHrvAnalysis(map, hrmOptions);
+            writeHrmHrvRow(stream, 0, analysis.value(QLatin1String("exercise")).toMap());
+            foreach (const QVariant &lap, analysis.value(QLatin1String("laps")).toList()) {
+                const QVariantMap lapMap = lap.toMap();
+                writeHrmHrvRow(stream, lapMap.value(QLatin1String("lap")).toInt(), lapMap);
+            }
+        }
+
         // [Summary-123] This will need updating if/when phases data is available.
-        const QVariantList heartrate = samples.value(QLatin1String("heartrate")).toList();
+        const int heartrateCount = samples.sampleCount(SampleChannels::Heartrate);
         int summary123Row1[5] = { 0, 0, 0, 0, 0};
-        for (int index = 0; index < heartrate.length(); ++index) {
-            const quint32 hr = ((index < heartrate.length()) ? heartrate.at(index).toUInt() : (uint)0);
+        for (int index = 0; index < heartrateCount; ++index) {
+            const quint32 hr = static_cast<quint32>(qRound64(rawValue(samples, SampleChannels::Heartrate, index)));
             if (hr > hrMax)
                 summary123Row1[0]++;
             else if (hr > phase1LimitHigh)
@@ -2440,7 +3833,7 @@ QStringList TrainingSession::toHRM(const bool rrDataOnly) const
                 summary123Row1[4]++;
         }
         stream << "\r\n[Summary-123]\r\n";
-        stream << qRound(heartrate.length() * recordInterval / 1000.0);
+        stream << qRound(heartrateCount * recordInterval / 1000.0);
         for (size_t index = 0; index < (sizeof(summary123Row1)/sizeof(summary123Row1[0])); ++index) {
             stream << '\t' << qRound(summary123Row1[index] * recordInterval / 1000.0);
         }
@@ -2449,7 +3842,7 @@ QStringList TrainingSession::toHRM(const bool rrDataOnly) const
         stream << "0\t0\t0\t0\r\n";
         stream << "0\t0\t0\t0\t0\t0\r\n";
         stream << "0\t0\t0\t0\r\n";
-        stream << "0\t" << heartrate.length() << "\r\n";
+        stream << "0\t" << heartrateCount << "\r\n";
 
         // [Summary-TH]
         const quint32 anaerobicThreshold = first(firstMap(parsedPhysicalInformation.value(
@@ -2457,8 +3850,8 @@ QStringList TrainingSession::toHRM(const bool rrDataOnly) const
         const quint32 aerobicThreshold = first(firstMap(parsedPhysicalInformation.value(
             QLatin1String("aerobic-threshold"))).value(QLatin1String("value"))).toUInt();
         int summaryThRow1[5] = { 0, 0, 0, 0, 0};
-        for (int index = 0; index < heartrate.length(); ++index) {
-            const quint32 hr = ((index < heartrate.length()) ? heartrate.at(index).toUInt() : (uint)0);
+        for (int index = 0; index < heartrateCount; ++index) {
+            const quint32 hr = static_cast<quint32>(qRound64(rawValue(samples, SampleChannels::Heartrate, index)));
             if (hr > hrMax)
                 summaryThRow1[0]++;
             else if (hr > anaerobicThreshold)
@@ -2471,7 +3864,7 @@ QStringList TrainingSession::toHRM(const bool rrDataOnly) const
                 summaryThRow1[4]++;
         }
         stream << "\r\n[Summary-TH]\r\n"; // WebSync includes 0's when empty.
-        stream << qRound(heartrate.length() * recordInterval / 1000.0);
+        stream << qRound(heartrateCount * recordInterval / 1000.0);
         for (size_t index = 0; index < (sizeof(summaryThRow1)/sizeof(summaryThRow1[0])); ++index) {
             stream << '\t' << qRound(summaryThRow1[index] * recordInterval / 1000.0);
         }
@@ -2481,7 +3874,7 @@ QStringList TrainingSession::toHRM(const bool rrDataOnly) const
         stream << '\t' << aerobicThreshold;
         stream << '\t' << hrRest;
         stream << "\r\n";
-        stream << "0\t" << heartrate.length() << "\r\n";
+        stream << "0\t" << heartrateCount << "\r\n";
 
         // [Trip]
         stream << "\r\n[Trip]\r\n";
@@ -2497,39 +3890,27 @@ QStringList TrainingSession::toHRM(const bool rrDataOnly) const
         // [HRData]
         stream << "\r\n[HRData]\r\n";
         if (rrDataOnly) {
-            foreach (const QVariant &sample, rrsamples) {
-                stream << sample.toUInt() << "\r\n";
+            const quint32 * const intervals = rrIntervals.constData();
+            for (int index = 0; index < rrIntervals.size(); ++index) {
+                stream << intervals[index] << "\r\n";
             }
         } else {
-            const QVariantList altitude   = samples.value(QLatin1String("altitude")).toList();
-            const QVariantList cadence    = samples.value(QLatin1String("cadence")).toList();
-            const QVariantList speed      = samples.value(QLatin1String("speed")).toList();
-            const QVariantList powerLeft  = samples.value(QLatin1String("left-pedal-power")).toList();
-            const QVariantList powerRight = samples.value(QLatin1String("right-pedal-power")).toList();
-            for (int index = 0; index < heartrate.length(); ++index) {
-                stream << ((index < heartrate.length())
-                    ? heartrate.at(index).toUInt() : (uint)0);
+            for (int index = 0; index < heartrateCount; ++index) {
+                stream << static_cast<quint32>(qRound64(rawValue(samples, SampleChannels::Heartrate, index)));
                 if (haveSpeed) {
-                    stream << '\t' << ((index < speed.length())
-                        ? qRound(speed.at(index).toFloat() * 10.0) : (int)0);
+                    stream << '\t' << qRound(static_cast<float>(rawValue(samples, SampleChannels::Speed, index)) * 10.0);
                 }
                 if (haveCadence) {
-                    stream << '\t' << ((index < cadence.length())
-                        ? cadence.at(index).toUInt() : (uint)0);
+                    stream << '\t' << static_cast<quint32>(qRound64(rawValue(samples, SampleChannels::Cadence, index)));
                 }
                 if (haveAltitude) {
-                    stream << '\t' << ((index < altitude.length())
-                        ? qRound(altitude.at(index).toFloat()) : (int)0);
+                    stream << '\t' << qRound(static_cast<float>(rawValue(samples, SampleChannels::Altitude, index)));
                 }
                 if (havePower) {
-                    const int currentPowerLeft =
-                            ((index < powerLeft.length()) &&
-                             (!sensorOffline(samples.value(QLatin1String("left-pedal-power-offline")).toList(), index))) ?
-                        first(powerLeft.at(index).toMap().value(QLatin1String("current-power"))).toInt() : 0;
-                    const int currentPowerRight =
-                            ((index < powerRight.length()) &&
-                             (!sensorOffline(samples.value(QLatin1String("right-pedal-power-offline")).toList(), index))) ?
-                        first(powerRight.at(index).toMap().value(QLatin1String("current-power"))).toInt() : 0;
+                    const int currentPowerLeft = (!sensorOffline(samples, SampleChannels::LeftPedalPower, index))
+                        ? static_cast<int>(qRound64(rawValue(samples, SampleChannels::LeftPedalPower, index))) : 0;
+                    const int currentPowerRight = (!sensorOffline(samples, SampleChannels::RightPedalPower, index))
+                        ? static_cast<int>(qRound64(rawValue(samples, SampleChannels::RightPedalPower, index))) : 0;
                     if (currentPowerLeft < 0) {
                         qWarning() << "Negative left power sample at index" << index << ":" << currentPowerLeft;
                     }
@@ -2569,20 +3950,164 @@ QStringList TrainingSession::toHRM(const bool rrDataOnly) const
     return hrmList;
 }
 
+// Formats the text of each of an exercise's TCX Trackpoint elements, so that,
+// as for GPX, long exercises can be formatted in parallel chunks before toTCX
+// builds the DOM.
+class TcxTrackPointFormatter : public ChunkedFormatter {
+
+public:
+    struct TrackPoint {
+        quint64 timeOffset; ///< Milliseconds since the exercise's start time.
+        QString time; ///< Null if the trackpoint has no other data.
+        QString latitude; ///< Null if not available, as are the following.
+        QString longitude;
+        QString altitude;
+        QString distance;
+        QString heartrate;
+        QString cadence;
+        QString speed;
+        QString watts;
+    };
+
+    TcxTrackPointFormatter(const QVariantMap &route, const SampleChannels &samples,
+                           const QDateTime &startTime,
+                           const TrainingSession::TcxOptions tcxOptions,
+                           const Timeline &timeline)
+        : tcxOptions(tcxOptions), startTime(startTime), samples(samples),
+          latitude(route.value(QLatin1String("latitude")).toList()),
+          longitude(route.value(QLatin1String("longitude")).toList())
+    {
+        // Each sample becomes a Trackpoint, as does any route point with no sample aligned.
+        foreach (const Timeline::Point &point, timeline.points()) {
+            if ((point.types & Timeline::SamplePoint) || (point.sampleIndex < 0)) {
+                timelinePoints.append(point);
+            }
+        }
+        points.resize(timelinePoints.size());
+        pointData = points.data(); // Pre-fetched, so formatChunk never detaches points.
+    }
+
+    QVector<TrackPoint> points;
+
+protected:
+    virtual void formatChunk(const int begin, const int end)
+    {
+        const bool garminActivityExtension =
+            tcxOptions.testFlag(TrainingSession::GarminActivityExtension);
+        TimestampFormatter timestamps(startTime);
+        for (int index = begin; index < end; ++index) {
+            TrackPoint &point = pointData[index];
+            const Timeline::Point &timelinePoint = timelinePoints.at(index);
+            const int routeIndex = timelinePoint.routeIndex;
+            const int sampleIndex = timelinePoint.sampleIndex;
+            point.timeOffset = static_cast<quint64>(qMax(timelinePoint.offset, Q_INT64_C(0)));
+
+            const QVariant lat = interpolate(latitude, routeIndex, timelinePoint.routeWeight);
+            const QVariant lon = interpolate(longitude, routeIndex, timelinePoint.routeWeight);
+            if ((lat.isValid()) && (lon.isValid())) {
+                point.latitude  = VARIANT_TO_STRING(lat);
+                point.longitude = VARIANT_TO_STRING(lon);
+            }
+            double value;
+            if ((samples.rawValue(SampleChannels::Altitude, sampleIndex, value)) &&
+                (!sensorOffline(samples, SampleChannels::Altitude, sampleIndex))) {
+                point.altitude = sampleToString(SampleChannels::Altitude, value);
+            }
+            if ((samples.rawValue(SampleChannels::Distance, sampleIndex, value)) &&
+                (!sensorOffline(samples, SampleChannels::Distance, sampleIndex))) {
+                point.distance = sampleToString(SampleChannels::Distance, value);
+            }
+            if ((samples.rawValue(SampleChannels::Heartrate, sampleIndex, value)) &&
+                (qRound64(value) > 0) &&
+                (!sensorOffline(samples, SampleChannels::Heartrate, sampleIndex))) {
+                point.heartrate = sampleToString(SampleChannels::Heartrate, value);
+            }
+            if ((samples.rawValue(SampleChannels::Cadence, sampleIndex, value)) &&
+                (qRound64(value) >= 0) &&
+                (!sensorOffline(samples, SampleChannels::Cadence, sampleIndex))) {
+                point.cadence = sampleToString(SampleChannels::Cadence, value);
+            }
+
+            if ((garminActivityExtension) && (sampleIndex >= 0)) {
+                if ((samples.rawValue(SampleChannels::Speed, sampleIndex, value)) &&
+                    (qRound64(value) >= 0) &&
+                    (!sensorOffline(samples, SampleChannels::Speed, sampleIndex))) {
+                    point.speed = QString::fromLatin1("%1").arg(value / 3.6);
+                }
+
+                double powerLeft, powerRight;
+                const bool haveLeft  = samples.rawValue(SampleChannels::LeftPedalPower, sampleIndex, powerLeft);
+                const bool haveRight = samples.rawValue(SampleChannels::RightPedalPower, sampleIndex, powerRight);
+                const int currentPowerLeft  = (haveLeft)  ? static_cast<int>(qRound64(powerLeft))  : 0;
+                const int currentPowerRight = (haveRight) ? static_cast<int>(qRound64(powerRight)) : 0;
+                if ((haveLeft) && (currentPowerLeft < 0)) {
+                    qWarning() << "Negative left power sample at index" << sampleIndex << ":" << currentPowerLeft;
+                }
+                if ((haveRight) && (currentPowerRight < 0)) {
+                    qWarning() << "Negative right power sample at index" << sampleIndex << ":" << currentPowerRight;
+                }
+
+                if ((haveLeft) || (haveRight)) {
+                    const int currentPower = (haveLeft && haveRight)
+                        ? qMax(currentPowerLeft, 0) + qMax(currentPowerRight, 0)
+                        : qMax(((haveLeft) ? currentPowerLeft : currentPowerRight) * 2, 0);
+                    Q_ASSERT(currentPower >= 0);
+                    point.watts = QString::fromLatin1("%1").arg(currentPower);
+                }
+            }
+
+            // Trackpoints with no data are omitted, so need no time.
+            if ((garminActivityExtension) || (!point.latitude.isNull()) ||
+                (!point.altitude.isNull()) || (!point.distance.isNull()) ||
+                (!point.heartrate.isNull()) || (!point.cadence.isNull())) {
+                point.time = timestamps.format(point.timeOffset);
+            }
+        }
+    }
+
+    const TrainingSession::TcxOptions tcxOptions;
+    const QDateTime startTime;
+
+    // The "samples" samples.
+    const SampleChannels samples;
+
+    // The "route" samples.
+    const QVariantList latitude;
+    const QVariantList longitude;
+
+    QVector<Timeline::Point> timelinePoints;
+    TrackPoint * pointData;
+
+};
+
+QDomDocument TrainingSession::toTCX(const QString &buildTime) const
+{
+    return toTCX(parsed, tcxOptions, buildTime, sampleAlignment);
+}
+
 /**
  * @brief TrainingSession::toTCX
  *
- * @param buildTime If set, will override the internally detected build time.
- *                  Note, this is really only here to allow for deterministic
- *                  testing - not to be used by the final application.
+ * @param session    Parsed training session to convert.
+ * @param tcxOptions TCX options to apply.
+ * @param buildTime  If set, will override the internally detected build time.
+ *                   Note, this is really only here to allow for deterministic
+ *                   testing - not to be used by the final application.
+ * @param alignment  How route points are aligned with samples.
  *
- * @return A TCX document representing the parsed Polar data.
+ * @return A TCX document representing the \a session data.
  *
  * @see http://developer.garmin.com/schemas/tcx/v2/
  * @see http://www8.garmin.com/xmlschemas/TrainingCenterDatabasev2.xsd
  */
-QDomDocument TrainingSession::toTCX(const QString &buildTime) const
+QDomDocument TrainingSession::toTCX(const ParsedSession &session,
+                                    const TcxOptions tcxOptions,
+                                    const QString &buildTime,
+                                    const Timeline::Alignment alignment)
 {
+    const QVariantMap &parsedExercises = session.exercises();
+    const QVariantMap &parsedSession = session.session();
+
     QDomDocument doc;
     doc.appendChild(doc.createProcessingInstruction(QLatin1String("xml"),
         QLatin1String("version='1.0' encoding='utf-8'")));
@@ -2627,39 +4152,7 @@ QDomDocument TrainingSession::toTCX(const QString &buildTime) const
         }
         const QVariantMap create  = map.value(CREATE).toMap();
         const QVariantMap route   = map.value(ROUTE).toMap();
-        const QVariantMap samples = map.value(SAMPLES).toMap();
-        const quint64 recordInterval = getDuration(
-            firstMap(samples.value(QLatin1String("record-interval"))));
-
-        // Get the "samples" samples.
-        const QVariantList altitude    = samples.value(QLatin1String("altitude")).toList();
-        const QVariantList cadence     = samples.value(QLatin1String("cadence")).toList();
-        const QVariantList powerLeft   = samples.value(QLatin1String("left-pedal-power")).toList();
-        const QVariantList powerRight  = samples.value(QLatin1String("right-pedal-power")).toList();
-        const QVariantList distance    = samples.value(QLatin1String("distance")).toList();
-        const QVariantList heartrate   = samples.value(QLatin1String("heartrate")).toList();
-        const QVariantList speed       = samples.value(QLatin1String("speed")).toList();
-        const QVariantList temperature = samples.value(QLatin1String("temperature")).toList();
-
-        // Get the "route" samples.
-        const QVariantList duration    = route.value(QLatin1String("duration")).toList();
-        const QVariantList gpsAltitude = route.value(QLatin1String("altitude")).toList();
-        const QVariantList latitude    = route.value(QLatin1String("latitude")).toList();
-        const QVariantList longitude   = route.value(QLatin1String("longitude")).toList();
-        const QVariantList satellites  = route.value(QLatin1String("satellites")).toList();
-
-        const int maxIndex =
-            qMax(altitude.length(),
-            qMax(cadence.length(),
-            qMax(distance.length(),
-            qMax(heartrate.length(),
-            qMax(speed.length(),
-          //qMax(temperature.length(), // We don't use temperature in TCX yet.
-            qMax(duration.length(),
-            qMax(gpsAltitude.length(),
-            qMax(latitude.length(),
-            qMax(longitude.length(),
-            qMax(satellites.length(), 0))))))))));
+        const SampleChannels samples = getSampleChannels(map);
 
         QDomElement activity = doc.createElement(QLatin1String("Activity"));
         if (multiSportSession.isNull()) {
@@ -2681,15 +4174,22 @@ QDomDocument TrainingSession::toTCX(const QString &buildTime) const
                 .value(QLatin1String("value"))).toULongLong()));
 
         // Get the starting time.
-        QDateTime startTime = getDateTime(firstMap(create.value(QLatin1String("start"))));
+        QDateTime startTime = map.value(START_TIME).toDateTime();
         if (tcxOptions.testFlag(ForceTcxUTC)) {
             startTime = startTime.toUTC();
         }
         activity.appendChild(doc.createElement(QLatin1String("Id")))
             .appendChild(doc.createTextNode(startTime.toString(Qt::ISODate)));
+        TimestampFormatter timestamps(startTime); // Already UTC, if ForceTcxUTC.
 
         // Build a map of lap split times to lap data.
-        QVariantList laps = map.value(LAPS).toMap().value(QLatin1String("laps")).toList();
+        QVariantList laps;
+        if (tcxOptions.testFlag(KilometreTcxLaps)) {
+            laps = splitLaps(map, DistanceSplits, 1000.0);
+        }
+        if (laps.isEmpty()) {
+            laps = map.value(LAPS).toMap().value(QLatin1String("laps")).toList();
+        }
         if (laps.isEmpty()) {
             laps = map.value(AUTOLAPS).toMap().value(QLatin1String("laps")).toList();
         }
@@ -2707,15 +4207,29 @@ QDomDocument TrainingSession::toTCX(const QString &buildTime) const
         // Add each of the laps to the Activity element.
         QDomElement lap;
         QVariantMap base = create; // The base data for this lap.
-        QVariantMap stats = map.value(STATISTICS).toMap();
+        QVariantMap stats = (tcxOptions.testFlag(FillTcxLapStats))
+            ? getStatistics(map) : map.value(STATISTICS).toMap();
         QDomElement track = doc.createElement(QLatin1String("Track"));
         quint64 durationRemaining = getDuration(firstMap(create.value(QLatin1String("duration"))));
         double distanceRemaining = first(create.value(QLatin1String("distance"))).toDouble();
-        for (int index = 0; index < maxIndex; ++index) {
+        const SampleLapStats sampleLapStats(samples);
+        quint64 lapStartTime = 0;
+
+        // Format the trackpoints (in parallel chunks, for long exercises).
+        TcxTrackPointFormatter formatter(route, samples, startTime, tcxOptions,
+                                         getTimeline(map, samples, alignment));
+        const int pointCount = formatter.points.size();
+        formatter.format(pointCount);
+        const QString cadenceSensor = getTcxCadenceSensor(
+            first(firstMap(create.value(QLatin1String("sport")))
+                            .value(QLatin1String("value"))).toULongLong());
+
+        for (int index = 0; index < pointCount; ++index) {
+            const TcxTrackPointFormatter::TrackPoint &point = formatter.points.at(index);
             #if (QT_VERSION >= QT_VERSION_CHECK(5, 2, 0))
-            if ((lap.isNull()) || ((!splits.isEmpty()) && (index * recordInterval > splits.firstKey()))) {
+            if ((lap.isNull()) || ((!splits.isEmpty()) && (point.timeOffset > splits.firstKey()))) {
             #else
-            if ((lap.isNull()) || ((!splits.isEmpty()) && (index * recordInterval > splits.constBegin().key()))) {
+            if ((lap.isNull()) || ((!splits.isEmpty()) && (point.timeOffset > splits.constBegin().key()))) {
             #endif
                 quint64 trailingDuration = 0;
                 double trailingDistance = 0.0;
@@ -2743,20 +4257,23 @@ QDomDocument TrainingSession::toTCX(const QString &buildTime) const
                     stats = QVariantMap();
                 }
 
-                // Create the Lap element, and set its StartTime attribute.
+                // Fill in any statistics the device did not record for this lap.
                 #if (QT_VERSION >= QT_VERSION_CHECK(5, 2, 0))
-                QDateTime lapStartTime = startTime.addMSecs(index * recordInterval);
-                #else /// @todo Remove this hack when Qt 5.2+ is available on Travis CI.
-                QDateTime lapStartTime = startTime.toUTC()
-                    .addMSecs(index * recordInterval).addSecs(startTime.utcOffset());
-                lapStartTime.setUtcOffset(startTime.utcOffset());
+                const quint64 lapEndTime = (splits.isEmpty())
+                    ? std::numeric_limits<quint64>::max() : splits.firstKey();
+                #else
+                const quint64 lapEndTime = (splits.isEmpty())
+                    ? std::numeric_limits<quint64>::max() : splits.constBegin().key();
                 #endif
-                if (tcxOptions.testFlag(ForceTcxUTC)) {
-                    lapStartTime = lapStartTime.toUTC();
+                if (tcxOptions.testFlag(FillTcxLapStats)) {
+                    stats = sampleLapStats.fill(stats, lapStartTime, lapEndTime);
                 }
+                lapStartTime = lapEndTime;
+
+                // Create the Lap element, and set its StartTime attribute.
                 lap = doc.createElement(QLatin1String("Lap"));
                 lap.setAttribute(QLatin1String("StartTime"),
-                    lapStartTime.toString(Qt::ISODate));
+                    timestamps.format(point.timeOffset));
                 activity.appendChild(lap);
 
                 // Add the per-lap (or per-exercise) statistics.
@@ -2847,35 +4364,31 @@ QDomDocument TrainingSession::toTCX(const QString &buildTime) const
 
             QDomElement trackPoint = doc.createElement(QLatin1String("Trackpoint"));
 
-            if ((index < latitude.length()) && (index < longitude.length())) {
+            if (!point.latitude.isNull()) {
                 QDomElement position = doc.createElement(QLatin1String("Position"));
                 position.appendChild(doc.createElement(QLatin1String("LatitudeDegrees")))
-                    .appendChild(doc.createTextNode(VARIANT_TO_STRING(latitude.at(index))));
+                    .appendChild(doc.createTextNode(point.latitude));
                 position.appendChild(doc.createElement(QLatin1String("LongitudeDegrees")))
-                    .appendChild(doc.createTextNode(VARIANT_TO_STRING(longitude.at(index))));
+                    .appendChild(doc.createTextNode(point.longitude));
                 trackPoint.appendChild(position);
             }
 
-            if ((index < altitude.length()) &&
-                (!sensorOffline(samples.value(QLatin1String("altitude-offline")).toList(), index))) {
+            if (!point.altitude.isNull()) {
                 trackPoint.appendChild(doc.createElement(QLatin1String("AltitudeMeters")))
-                    .appendChild(doc.createTextNode(VARIANT_TO_STRING(altitude.at(index))));
+                    .appendChild(doc.createTextNode(point.altitude));
             }
-            if ((index < distance.length()) &&
-                (!sensorOffline(samples.value(QLatin1String("distance-offline")).toList(), index))) {
+            if (!point.distance.isNull()) {
                 trackPoint.appendChild(doc.createElement(QLatin1String("DistanceMeters")))
-                    .appendChild(doc.createTextNode(VARIANT_TO_STRING(distance.at(index))));
+                    .appendChild(doc.createTextNode(point.distance));
             }
-            if ((index < heartrate.length()) && (heartrate.at(index).toInt() > 0) &&
-                (!sensorOffline(samples.value(QLatin1String("heartrate-offline")).toList(), index))) {
+            if (!point.heartrate.isNull()) {
                 trackPoint.appendChild(doc.createElement(QLatin1String("HeartRateBpm")))
                     .appendChild(doc.createElement(QLatin1String("Value")))
-                    .appendChild(doc.createTextNode(VARIANT_TO_STRING(heartrate.at(index))));
+                    .appendChild(doc.createTextNode(point.heartrate));
             }
-            if ((index < cadence.length()) && (cadence.at(index).toInt() >= 0) &&
-                (!sensorOffline(samples.value(QLatin1String("cadence-offline")).toList(), index))) {
+            if (!point.cadence.isNull()) {
                 trackPoint.appendChild(doc.createElement(QLatin1String("Cadence")))
-                    .appendChild(doc.createTextNode(VARIANT_TO_STRING(cadence.at(index))));
+                    .appendChild(doc.createTextNode(point.cadence));
             }
 
             if (tcxOptions.testFlag(GarminActivityExtension)) {
@@ -2885,67 +4398,31 @@ QDomDocument TrainingSession::toTCX(const QString &buildTime) const
                 trackPoint.appendChild(doc.createElement(QLatin1String("Extensions")))
                     .appendChild(tpx);
 
-                if ((index < speed.length()) && (speed.at(index).toInt() >= 0) &&
-                    (!sensorOffline(samples.value(QLatin1String("speed-offline")).toList(), index))) {
+                if (!point.speed.isNull()) {
                     tpx.appendChild(doc.createElement(QLatin1String("Speed")))
-                        .appendChild(doc.createTextNode(QString::fromLatin1("%1")
-                            .arg(speed.at(index).toDouble() / 3.6)));
+                        .appendChild(doc.createTextNode(point.speed));
                 }
 
-                if ((index < cadence.length()) && (cadence.at(index).toInt() >= 0) &&
-                    (!sensorOffline(samples.value(QLatin1String("cadence-offline")).toList(), index))) {
-                    const QString sensor = getTcxCadenceSensor(
-                        first(firstMap(create.value(QLatin1String("sport")))
-                                        .value(QLatin1String("value"))).toULongLong());
-                    if (!sensor.isEmpty()) {
-                        tpx.setAttribute(QLatin1String("CadenceSensor"), sensor);
+                if (!point.cadence.isNull()) {
+                    if (!cadenceSensor.isEmpty()) {
+                        tpx.setAttribute(QLatin1String("CadenceSensor"), cadenceSensor);
                     }
-                    if (sensor == QLatin1String("Footpod")) {
+                    if (cadenceSensor == QLatin1String("Footpod")) {
                         tpx.appendChild(doc.createElement(QLatin1String("RunCadence")))
-                            .appendChild(doc.createTextNode(VARIANT_TO_STRING(cadence.at(index))));
+                            .appendChild(doc.createTextNode(point.cadence));
                     }
                 }
 
-                const QVariant currentPowerLeft = (index < powerLeft.length()) ?
-                    first(powerLeft.at(index).toMap().value(QLatin1String("current-power"))) : QVariant();
-                const QVariant currentPowerRight = (index < powerRight.length()) ?
-                    first(powerRight.at(index).toMap().value(QLatin1String("current-power"))) : QVariant();
-                if ((currentPowerLeft.isValid()) && (currentPowerLeft.toInt() < 0)) {
-                    qWarning() << "Negative left power sample at index" << index << ":" << currentPowerLeft.toInt();
-                }
-                if ((currentPowerRight.isValid()) && (currentPowerRight.toInt() < 0)) {
-                    qWarning() << "Negative right power sample at index" << index << ":" << currentPowerRight.toInt();
-                }
-
-                const QVariant currentPower =
-                    (currentPowerLeft.isValid() && currentPowerRight.isValid())
-                        ? qMax(currentPowerLeft.toInt(), 0) + qMax(currentPowerRight.toInt(), 0)
-                        : currentPowerLeft.isValid() ? qMax(currentPowerLeft.toInt() * 2, 0)
-                        : currentPowerRight.isValid() ? qMax(currentPowerRight.toInt() * 2, 0)
-                        : QVariant();
-                Q_ASSERT(currentPower.toInt() >= 0);
-
-                if (currentPower.isValid()) {
+                if (!point.watts.isNull()) {
                     tpx.appendChild(doc.createElement(QLatin1String("Watts")))
-                        .appendChild(doc.createTextNode(QString::fromLatin1("%1")
-                            .arg(qMax(currentPower.toInt(), 0))));
+                        .appendChild(doc.createTextNode(point.watts));
                 }
 
             }
 
             if (trackPoint.hasChildNodes()) {
-                #if (QT_VERSION >= QT_VERSION_CHECK(5, 2, 0))
-                QDateTime trackPointTime = startTime.addMSecs(index * recordInterval);
-                #else /// @todo Remove this hack when Qt 5.2+ is available on Travis CI.
-                QDateTime trackPointTime = startTime.toUTC()
-                    .addMSecs(index * recordInterval).addSecs(startTime.utcOffset());
-                trackPointTime.setUtcOffset(startTime.utcOffset());
-                #endif
-                if (tcxOptions.testFlag(ForceTcxUTC)) {
-                    trackPointTime = trackPointTime.toUTC();
-                }
                 trackPoint.insertBefore(doc.createElement(QLatin1String("Time")), QDomNode())
-                    .appendChild(doc.createTextNode(trackPointTime.toString(Qt::ISODate)));
+                    .appendChild(doc.createTextNode(point.time));
                 track.appendChild(trackPoint);
             }
         }
@@ -3015,7 +4492,7 @@ void TrainingSession::addLapStats(QDomDocument &doc, QDomElement &lap,
                                   const QVariantMap &base,
                                   const QVariantMap &stats,
                                   const quint64 duration,
-                                  const double distance) const
+                                  const double distance)
 {
     // Note, we're using an explicit precision argument to QString::arg here
     // because QString::arg defaults to the precision to -1, which in turn
@@ -3083,50 +4560,11 @@ void TrainingSession::addLapStats(QDomDocument &doc, QDomElement &lap,
 QByteArray TrainingSession::unzip(const QByteArray &data,
                                   const int initialBufferSize) const
 {
-    Q_ASSERT(initialBufferSize > 0);
-    QByteArray result;
-    result.resize(initialBufferSize);
-
-    // Prepare a zlib stream structure.
-    z_stream stream;
-    memset(&stream, 0, sizeof(stream));
-    stream.next_in = (Bytef *) data.data();
-    stream.avail_in = data.length();
-    stream.next_out = (Bytef *) result.data();
-    stream.avail_out = result.size();
-    stream.zalloc = Z_NULL;
-    stream.zfree = Z_NULL;
-    stream.opaque = Z_NULL;
-
-    // Decompress the data.
-    int z_result;
-    for (z_result = inflateInit2(&stream, 15 + 32); z_result == Z_OK;) {
-        if ((z_result = inflate(&stream, Z_SYNC_FLUSH)) == Z_OK) {
-            const int oldSize = result.size();
-            result.resize(result.size() * 2);
-            stream.next_out = (Bytef *)(result.data() + oldSize);
-            stream.avail_out = oldSize;
-        }
-    }
-
-    // Check for errors.
-    if (z_result != Z_STREAM_END) {
-        qWarning() << "zlib error" << z_result << stream.msg;
-        return QByteArray();
-    }
-
-    // Free any allocated resources.
-    if ((z_result = inflateEnd(&stream)) != Z_OK) {
-        qWarning() << "inflateEnd returned" << z_result << stream.msg;
-    }
-
-    // Return the decompressed data.
-    result.chop(stream.avail_out);
-    return result;
+    return GzipDecompressor::decompress(data, initialBufferSize);
 }
 
-QString TrainingSession::writeGPX(const QString &fileNameFormat,
-                                  QString outputDirName)
+QString TrainingSession::writeGPX(const FileNameFormat &fileNameFormat,
+                                  QString outputDirName) const
 {
     if (outputDirName.isEmpty()) {
         outputDirName = QFileInfo(baseName).dir().absolutePath();
@@ -3149,17 +4587,24 @@ bool TrainingSession::writeGPX(const QString &fileName) const
 
 bool TrainingSession::writeGPX(QIODevice &device) const
 {
-    QDomDocument gpx = toGPX();
+    return writeGPX(parsed, gpxOptions, device, sampleAlignment);
+}
+
+bool TrainingSession::writeGPX(const ParsedSession &session,
+                               const GpxOptions gpxOptions, QIODevice &device,
+                               const Timeline::Alignment alignment)
+{
+    QDomDocument gpx = toGPX(session, gpxOptions, QDateTime::currentDateTimeUtc(), alignment);
     if (gpx.isNull()) {
-        qWarning() << "Failed to convert to GPX" << baseName;
+        qWarning() << "Failed to convert to GPX" << session.baseName();
         return false;
     }
     device.write(gpx.toByteArray());
     return true;
 }
 
-QStringList TrainingSession::writeHRM(const QString &fileNameFormat,
-                                      QString outputDirName)
+QStringList TrainingSession::writeHRM(const FileNameFormat &fileNameFormat,
+                                      QString outputDirName) const
 {
     if (outputDirName.isEmpty()) {
         outputDirName = QFileInfo(baseName).dir().absolutePath();
@@ -3169,13 +4614,44 @@ QStringList TrainingSession::writeHRM(const QString &fileNameFormat,
 }
 
 QStringList TrainingSession::writeHRM(const QString &baseName) const
+{
+    return writeHRM(parsed, hrmOptions, baseName);
+}
+
+QStringList TrainingSession::writeHRM(const ParsedSession &session,
+                                      const HrmOptions hrmOptions,
+                                      const QString &baseName)
 {
     QStringList fileNames;
+    const OutputFiles outputFiles = formatHRM(session, hrmOptions, baseName);
+    for (OutputFiles::const_iterator iter = outputFiles.constBegin();
+         iter != outputFiles.constEnd(); ++iter) {
+        QFile file(iter.key());
+        if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
+            qWarning() << "Failed to open" << QDir::toNativeSeparators(iter.key());
+        } else if (file.write(iter.value())) {
+            fileNames.append(iter.key());
+        }
+    }
+    return fileNames;
+}
+
+/**
+ * @brief Formats the HRM output file(s) for \a session, without writing them.
+ *
+ * @return The HRM file contents, keyed by file name, or an empty map if the
+ *         session could not be converted to HRM.
+ */
+TrainingSession::OutputFiles TrainingSession::formatHRM(const ParsedSession &session,
+                                                        const HrmOptions hrmOptions,
+                                                        const QString &baseName)
+{
+    OutputFiles outputFiles;
     for (int rrDataOnly = 0; rrDataOnly <= (hrmOptions.testFlag(RrFiles) ? 1 : 0); ++rrDataOnly) {
-        QStringList hrm = toHRM(rrDataOnly);
+        QStringList hrm = toHRM(session, hrmOptions, rrDataOnly);
         if (hrm.isEmpty()) {
             qWarning() << "Failed to convert to HRM" << baseName;
-            return QStringList();
+            return OutputFiles();
         }
 
         for (int index = 0; index < hrm.length(); ++index) {
@@ -3183,19 +4659,29 @@ QStringList TrainingSession::writeHRM(const QString &baseName) const
             const QString fileName = (hrm.length() == 1)
                 ? QString::fromLatin1("%1.%2").arg(baseName).arg(extension)
                 : QString::fromLatin1("%1.%2.%3").arg(baseName).arg(index).arg(extension);
-            QFile file(fileName);
-            if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
-                qWarning() << "Failed to open" << QDir::toNativeSeparators(fileName);
-            } else if (file.write(hrm.at(index).toLatin1())) {
-                fileNames.append(fileName);
+            outputFiles.insert(fileName, hrm.at(index).toLatin1());
+        }
+
+        // Add a JSON sidecar of each exercise's HRV analysis, if requested, named
+        // (like the HRM files) in the same order that toHRM() visits the exercises.
+        // Every exercise gets one, even if empty, as getOutputFileNames() expects.
+        if ((!rrDataOnly) && (hrmOptions.testFlag(HrvAnalysis))) {
+            int index = 0;
+            foreach (const QVariant &exercise, session.exercises()) {
+                const QString fileName = (hrm.length() == 1)
+                    ? QString::fromLatin1("%1.hrv.json").arg(baseName)
+                    : QString::fromLatin1("%1.%2.hrv.json").arg(baseName).arg(index);
+                outputFiles.insert(fileName, QJsonDocument(QJsonObject::fromVariantMap(
+                    getHrvAnalysis(exercise.toMap(), hrmOptions))).toJson());
+                ++index;
             }
         }
     }
-    return fileNames;
+    return outputFiles;
 }
 
-QString TrainingSession::writeTCX(const QString &fileNameFormat,
-                                  QString outputDirName)
+QString TrainingSession::writeTCX(const FileNameFormat &fileNameFormat,
+                                  QString outputDirName) const
 {
     if (outputDirName.isEmpty()) {
         outputDirName = QFileInfo(baseName).dir().absolutePath();
@@ -3218,13 +4704,157 @@ bool TrainingSession::writeTCX(const QString &fileName) const
 
 bool TrainingSession::writeTCX(QIODevice &device) const
 {
-    QDomDocument tcx = toTCX();
+    return writeTCX(parsed, tcxOptions, device, sampleAlignment);
+}
+
+bool TrainingSession::writeTCX(const ParsedSession &session,
+                               const TcxOptions tcxOptions, QIODevice &device,
+                               const Timeline::Alignment alignment)
+{
+    QDomDocument tcx = toTCX(session, tcxOptions, QString(), alignment);
     if (tcx.isNull()) {
-        qWarning() << "Failed to convert to TCX" << baseName;
+        qWarning() << "Failed to convert to TCX" << session.baseName();
         return false;
     }
     device.write(tcx.toByteArray());
     return true;
 }
 
+QString TrainingSession::writeFIT(const FileNameFormat &fileNameFormat,
+                                  QString outputDirName) const
+{
+    if (outputDirName.isEmpty()) {
+        outputDirName = QFileInfo(baseName).dir().absolutePath();
+    }
+    const QString fileName = QString::fromLatin1("%1/%2.fit")
+        .arg(outputDirName).arg(getOutputBaseFileName(fileNameFormat));
+    writeFIT(fileName);
+    return fileName;
+}
+
+bool TrainingSession::writeFIT(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
+        qWarning() << "Failed to open" << QDir::toNativeSeparators(fileName);
+        return false;
+    }
+    return writeFIT(file);
+}
+
+bool TrainingSession::writeFIT(QIODevice &device) const
+{
+    return writeFIT(parsed, device, sampleAlignment);
+}
+
+bool TrainingSession::writeFIT(const ParsedSession &session, QIODevice &device,
+                               const Timeline::Alignment alignment)
+{
+    const QByteArray fit = toFIT(session, alignment);
+    if (fit.isEmpty()) {
+        qWarning() << "Failed to convert to FIT" << session.baseName();
+        return false;
+    }
+    device.write(fit);
+    return true;
+}
+
+QString TrainingSession::writeCSV(const FileNameFormat &fileNameFormat,
+                                  QString outputDirName) const
+{
+    if (outputDirName.isEmpty()) {
+        outputDirName = QFileInfo(baseName).dir().absolutePath();
+    }
+    const QString fileName = QString::fromLatin1("%1/%2.csv")
+        .arg(outputDirName).arg(getOutputBaseFileName(fileNameFormat));
+    writeCSV(fileName);
+    return fileName;
+}
+
+bool TrainingSession::writeCSV(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
+        qWarning() << "Failed to open" << QDir::toNativeSeparators(fileName);
+        return false;
+    }
+    return writeCSV(file);
+}
+
+bool TrainingSession::writeCSV(QIODevice &device) const
+{
+    return writeCSV(parsed, device, sampleAlignment);
+}
+
+/**
+ * @brief Writes a parsed training session's samples as comma-separated values.
+ *
+ * All exercises share the one header row (see toSampleTables), and each
+ * exercise's rows are written as soon as that exercise has been converted.
+ */
+bool TrainingSession::writeCSV(const ParsedSession &session, QIODevice &device,
+                               const Timeline::Alignment alignment)
+{
+    const QList<SampleTable> tables = toSampleTables(session, alignment);
+    if (tables.isEmpty()) {
+        qWarning() << "Failed to convert to CSV" << session.baseName();
+        return false;
+    }
+    device.write(tables.first().toCsvHeader());
+    foreach (const SampleTable &table, tables) {
+        device.write(table.toCsv());
+    }
+    return true;
+}
+
+QString TrainingSession::writeArrow(const FileNameFormat &fileNameFormat,
+                                    QString outputDirName) const
+{
+    if (outputDirName.isEmpty()) {
+        outputDirName = QFileInfo(baseName).dir().absolutePath();
+    }
+    const QString fileName = QString::fromLatin1("%1/%2.arrow")
+        .arg(outputDirName).arg(getOutputBaseFileName(fileNameFormat));
+    writeArrow(fileName);
+    return fileName;
+}
+
+bool TrainingSession::writeArrow(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
+        qWarning() << "Failed to open" << QDir::toNativeSeparators(fileName);
+        return false;
+    }
+    return writeArrow(file);
+}
+
+bool TrainingSession::writeArrow(QIODevice &device) const
+{
+    return writeArrow(parsed, device, sampleAlignment);
+}
+
+/**
+ * @brief Writes a parsed training session's samples as an Apache Arrow IPC file.
+ *
+ * Each exercise's SampleTable (see toSampleTables) is written as one record
+ * batch, with offline and missing samples marked null.
+ */
+bool TrainingSession::writeArrow(const ParsedSession &session, QIODevice &device,
+                                 const Timeline::Alignment alignment)
+{
+    const QList<SampleTable> tables = toSampleTables(session, alignment);
+    if (tables.isEmpty()) {
+        qWarning() << "Failed to convert to Arrow" << session.baseName();
+        return false;
+    }
+    ArrowWriter writer(device);
+    foreach (const SampleTable &table, tables) {
+        if (!writer.write(table)) {
+            return false;
+        }
+    }
+    return writer.close();
+}
+
 }}
@@ -4,8 +4,14 @@
 #ifndef __POLAR_V2_TRAINING_SESSION_H__
 #define __POLAR_V2_TRAINING_SESSION_H__
 
+#include "filenameformat.h"
+#include "parsedsession.h"
+#include "sampletable.h"
+#include "timeline.h"
+
 #include <QDateTime>
 #include <QDomDocument>
+#include <QHash>
 #include <QIODevice>
 #include <QMap>
 #include <QStringList>
@@ -19,6 +25,9 @@ namespace v2 {
 /**
  * @brief The TrainingSession class
  *
+ * Parsing produces an immutable ParsedSession snapshot (see snapshot), which the
+ * static to* and write* functions convert without touching any shared state.
+ *
  * @note This class does not yet make any use of *-phases, *-rrsamples,
  *       *-sensors, nor *-statistics file, if present.
  */
@@ -31,7 +40,11 @@ public:
         GpxOutput = 0x0001,
         HrmOutput = 0x0002,
         TcxOutput = 0x0004,
-        AllOutputs = GpxOutput|HrmOutput|TcxOutput
+        FitOutput = 0x0008,
+        CsvOutput = 0x0010,
+        ArrowOutput = 0x0020,
+        AllOutputs = GpxOutput|HrmOutput|TcxOutput|FitOutput|CsvOutput|ArrowOutput,
+        GzipOutputs = 0x0100, ///< Gzip-compress the GPX, HRM and TCX outputs.
     };
     Q_DECLARE_FLAGS(OutputFormats, OutputFormat)
 
@@ -45,27 +58,63 @@ public:
     enum HrmOption {
         RrFiles  = 0x0001,
         LapNames = 0x0002,
+        FillHrmLapStats = 0x0004, ///< Derive missing lap statistics from samples.
+        HrvAnalysis = 0x0008, ///< Add HRV metrics, and a JSON sidecar of them.
+        KilometreHrmLaps = 0x0010, ///< Replace recorded laps with kilometre splits.
     };
     Q_DECLARE_FLAGS(HrmOptions, HrmOption)
 
     enum TcxOption {
         ForceTcxUTC = 0x0001,
+        FillTcxLapStats = 0x0002, ///< Derive missing lap statistics from samples.
+        KilometreTcxLaps = 0x0004, ///< Replace recorded laps with kilometre splits.
         GarminActivityExtension = 0x0100,
         GarminCourseExtension   = 0x0200,
     };
     Q_DECLARE_FLAGS(TcxOptions, TcxOption)
 
+    enum LapSplit {
+        DistanceSplits, ///< Split every \a interval metres.
+        DurationSplits, ///< Split every \a interval milliseconds.
+    };
+
+    /// Exercise sub-file paths, keyed by exercise ID, then by file type (eg
+    /// "create", "route" or "samples").
+    typedef QMap<QString, QMap<QString, QString> > ExerciseFileNames;
+
+    /// Input file contents, keyed by file path.
+    typedef QHash<QString, QByteArray> InputFiles;
+
+    /// Output file contents, keyed by file path.
+    typedef QMap<QString, QByteArray> OutputFiles;
+
     TrainingSession(const QString &baseName);
+    TrainingSession(const QString &baseName, const ExerciseFileNames &exerciseFileNames);
+
+    static bool addExerciseFileName(ExerciseFileNames &exerciseFileNames,
+                                    const QString &fileName, const QString &filePath);
 
     int exerciseCount() const;
 
-    QStringList getOutputFileNames(const QString &fileNameFormat,
+    QStringList getOutputFileNames(const FileNameFormat &fileNameFormat,
                                    const OutputFormats outputFormats,
-                                   QString outputDirName = QString());
+                                   QString outputDirName = QString(),
+                                   ParsedSession * const parsedSession = NULL) const;
+
+    OutputFiles formatOutputs(const FileNameFormat &fileNameFormat,
+                              const OutputFormats outputFormats,
+                              QString outputDirName = QString(),
+                              QDomDocument * const gpxDocument = NULL,
+                              QDomDocument * const tcxDocument = NULL) const;
 
     bool isValid() const;
 
     bool parse();
+    bool parse(const InputFiles &inputFiles);
+    bool restore(const ParsedSession &snapshot);
+    QStringList inputFileNames() const;
+    InputFiles readInputFiles() const;
+    ParsedSession snapshot() const;
 
     void setGpxOption(const GpxOption option, const bool enabled = true);
     void setHrmOption(const HrmOption option, const bool enabled = true);
@@ -73,37 +122,96 @@ public:
     void setGpxOptions(const GpxOptions options);
     void setHrmOptions(const HrmOptions options);
     void setTcxOptions(const TcxOptions options);
+    void setSampleAlignment(const Timeline::Alignment alignment);
+    void setSampleCalibration(const bool enabled);
 
-    QString writeGPX(const QString &fileNameFormat, QString outputDirName);
+    QString writeGPX(const FileNameFormat &fileNameFormat, QString outputDirName) const;
     bool writeGPX(const QString &fileName) const;
     bool writeGPX(QIODevice &device) const;
 
-    QStringList writeHRM(const QString &fileNameFormat, QString outputDirName);
+    QStringList writeHRM(const FileNameFormat &fileNameFormat, QString outputDirName) const;
     QStringList writeHRM(const QString &baseName) const;
 
-    QString writeTCX(const QString &fileNameFormat, QString outputDirName);
+    QString writeTCX(const FileNameFormat &fileNameFormat, QString outputDirName) const;
     bool writeTCX(const QString &fileName) const;
     bool writeTCX(QIODevice &device) const;
 
+    QString writeFIT(const FileNameFormat &fileNameFormat, QString outputDirName) const;
+    bool writeFIT(const QString &fileName) const;
+    bool writeFIT(QIODevice &device) const;
+
+    QString writeCSV(const FileNameFormat &fileNameFormat, QString outputDirName) const;
+    bool writeCSV(const QString &fileName) const;
+    bool writeCSV(QIODevice &device) const;
+
+    QString writeArrow(const FileNameFormat &fileNameFormat, QString outputDirName) const;
+    bool writeArrow(const QString &fileName) const;
+    bool writeArrow(QIODevice &device) const;
+
+    static QString getOutputBaseFileName(const ParsedSession &session,
+                                         const FileNameFormat &format);
+
+    static QDomDocument toGPX(const ParsedSession &session, const GpxOptions gpxOptions,
+        const QDateTime &creationTime = QDateTime::currentDateTimeUtc(),
+        const Timeline::Alignment alignment = Timeline::IndexAlignment);
+    static bool writeGPX(const ParsedSession &session, const GpxOptions gpxOptions,
+                         QIODevice &device, const Timeline::Alignment alignment = Timeline::IndexAlignment);
+
+    static QStringList toHRM(const ParsedSession &session, const HrmOptions hrmOptions,
+                             const bool rrDataOnly = false);
+    static QStringList writeHRM(const ParsedSession &session, const HrmOptions hrmOptions,
+                                const QString &baseName);
+    static OutputFiles formatHRM(const ParsedSession &session, const HrmOptions hrmOptions,
+                                 const QString &baseName);
+
+    static QDomDocument toTCX(const ParsedSession &session, const TcxOptions tcxOptions,
+                              const QString &buildTime = QString(),
+                              const Timeline::Alignment alignment = Timeline::IndexAlignment);
+    static bool writeTCX(const ParsedSession &session, const TcxOptions tcxOptions,
+                         QIODevice &device, const Timeline::Alignment alignment = Timeline::IndexAlignment);
+
+    static QByteArray toFIT(const ParsedSession &session,
+                            const Timeline::Alignment alignment = Timeline::IndexAlignment);
+    static bool writeFIT(const ParsedSession &session, QIODevice &device,
+                         const Timeline::Alignment alignment = Timeline::IndexAlignment);
+
+    static QVariantList splitLaps(const QVariantMap &exercise, const LapSplit split,
+                                  const double interval);
+
+    static QList<SampleTable> toSampleTables(const ParsedSession &session,
+                                             const Timeline::Alignment alignment = Timeline::IndexAlignment);
+    static bool writeCSV(const ParsedSession &session, QIODevice &device,
+                         const Timeline::Alignment alignment = Timeline::IndexAlignment);
+    static bool writeArrow(const ParsedSession &session, QIODevice &device,
+                           const Timeline::Alignment alignment = Timeline::IndexAlignment);
+
 protected:
     QString baseName;
-    QVariantMap parsedExercises;
-    QVariantMap parsedPhysicalInformation;
-    QVariantMap parsedSession;
+    ExerciseFileNames exerciseFileNames;
+    bool haveExerciseFileNames;
+    ParsedSession parsed;
 
     GpxOptions gpxOptions;
     HrmOptions hrmOptions;
     TcxOptions tcxOptions;
+    Timeline::Alignment sampleAlignment;
+    bool sampleCalibration;
 
+    static quint8 getFitSport(const quint64 &polarSportValue);
     static QString getPolarSportName(const quint64 &polarSportValue);
     static QString getTcxCadenceSensor(const quint64 &polarSportValue);
     static QString getTcxSport(const quint64 &polarSportValue);
-    QString getOutputBaseFileName(const QString &format);
+    ExerciseFileNames getExerciseFileNames() const;
+    QString getOutputBaseFileName(const FileNameFormat &format,
+                                  ParsedSession * const parsedSession = NULL) const;
+    static QString getOutputSessionName(const ParsedSession &session);
 
     static bool isGzipped(const QByteArray &data);
     static bool isGzipped(QIODevice &data);
 
-    bool parse(const QString &exerciseId, const QMap<QString, QString> &fileNames);
+    QVariantMap parseExercise(const QMap<QString, QString> &fileNames,
+                              const InputFiles &inputFiles = InputFiles()) const;
+    ParsedSession parseSession(const InputFiles &inputFiles = InputFiles()) const;
     QVariantMap parseCreateExercise(QIODevice &data) const;
     QVariantMap parseCreateExercise(const QString &fileName) const;
     QVariantMap parseCreateSession(QIODevice &data) const;
@@ -114,6 +222,8 @@ protected:
     QVariantMap parsePhysicalInformation(const QString &fileName) const;
     QVariantMap parseRoute(QIODevice &data) const;
     QVariantMap parseRoute(const QString &fileName) const;
+    QByteArray parseRRIntervals(QIODevice &data) const;
+    QByteArray parseRRIntervals(const QString &fileName) const;
     QVariantMap parseRRSamples(QIODevice &data) const;
     QVariantMap parseRRSamples(const QString &fileName) const;
     QVariantMap parseSamples(QIODevice &data) const;
@@ -129,15 +239,17 @@ protected:
 
     QDomDocument toTCX(const QString &buildTime = QString()) const;
 
+    QByteArray toFIT() const;
+
     QByteArray unzip(const QByteArray &data,
                      const int initialBufferSize = 10240) const;
 
 private:
     friend class ::TestTrainingSession;
 
-    void addLapStats(QDomDocument &doc, QDomElement &lap,
-                     const QVariantMap &base, const QVariantMap &stats,
-                     const quint64 duration = 0, const double distance = 0) const;
+    static void addLapStats(QDomDocument &doc, QDomElement &lap,
+                            const QVariantMap &base, const QVariantMap &stats,
+                            const quint64 duration = 0, const double distance = 0);
 
 };
 
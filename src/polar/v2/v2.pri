@@ -3,8 +3,8 @@
 
 INCLUDEPATH += $$PWD
 VPATH += $$PWD
-HEADERS += trainingsession.h
-SOURCES += trainingsession.cpp
+HEADERS += archivewriter.h   arrowwriter.h   chunkedformatter.h   filenameformat.h   fitencoder.h   gzipcompressor.h   gzipdecompressor.h   hrvmetrics.h   lapaggregator.h   parallelmap.h   parsedsession.h   rrintervals.h   samplecalibration.h   samplechannels.h   samplesummary.h   sampletable.h   sessioncache.h   timeline.h   timestampformatter.h   trainingsession.h
+SOURCES += archivewriter.cpp arrowwriter.cpp chunkedformatter.cpp filenameformat.cpp fitencoder.cpp gzipcompressor.cpp gzipdecompressor.cpp hrvmetrics.cpp lapaggregator.cpp parallelmap.cpp parsedsession.cpp rrintervals.cpp samplecalibration.cpp samplechannels.cpp samplesummary.cpp sampletable.cpp sessioncache.cpp timeline.cpp timestampformatter.cpp trainingsession.cpp
 
 unix:LIBS += -lz
 win32-g++:LIBS += -lz
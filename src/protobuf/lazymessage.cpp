@@ -0,0 +1,147 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "lazymessage.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+
+namespace ProtoBuf {
+
+class LazyMessage::Data : public QSharedData {
+
+public:
+    QByteArray data;
+    Message::FieldInfoMap fieldInfo;
+    QString pathSeparator;
+    QString tagPathPrefix;
+    QSet<QString> lazyTagPaths;
+
+    QMutex mutex;
+    bool decoded;
+    QVariantMap decodedMap;
+
+    Data() : decoded(true)
+    {
+
+    }
+
+};
+
+namespace {
+
+int registerLazyMessageMetaType()
+{
+    const int typeId = qRegisterMetaType<LazyMessage>();
+    QMetaType::registerConverter<LazyMessage, QVariantMap>(&LazyMessage::toMap);
+    #if (QT_VERSION >= QT_VERSION_CHECK(5, 5, 0))
+    QMetaType::registerEqualsComparator<LazyMessage>();
+    #endif
+    return typeId;
+}
+
+}
+
+LazyMessage::LazyMessage() : d(new Data)
+{
+    static const int typeId = registerLazyMessageMetaType();
+    Q_UNUSED(typeId);
+}
+
+LazyMessage::LazyMessage(const QByteArray &data, const Message::FieldInfoMap &fieldInfo,
+                         const QString &pathSeparator, const QString &tagPathPrefix,
+                         const QSet<QString> &lazyTagPaths)
+    : d(new Data)
+{
+    static const int typeId = registerLazyMessageMetaType();
+    Q_UNUSED(typeId);
+
+    d->data = data;
+    d->fieldInfo = fieldInfo;
+    d->pathSeparator = pathSeparator;
+    d->tagPathPrefix = tagPathPrefix;
+    d->lazyTagPaths = lazyTagPaths;
+    d->decoded = false;
+}
+
+LazyMessage::LazyMessage(const LazyMessage &other) : d(other.d)
+{
+
+}
+
+LazyMessage::~LazyMessage()
+{
+
+}
+
+LazyMessage &LazyMessage::operator=(const LazyMessage &other)
+{
+    d = other.d;
+    return *this;
+}
+
+bool LazyMessage::isDecoded() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->decoded;
+}
+
+QByteArray LazyMessage::rawData() const
+{
+    return d->data;
+}
+
+QVariantMap LazyMessage::toMap() const
+{
+    QMutexLocker locker(&d->mutex);
+    if (!d->decoded) {
+        Message parser(d->fieldInfo, d->pathSeparator);
+        foreach (const QString &tagPath, d->lazyTagPaths) {
+            parser.setLazy(tagPath);
+        }
+        QByteArray array(d->data);
+        d->decodedMap = parser.parse(array, d->tagPathPrefix);
+        d->decoded = true;
+    }
+    return d->decodedMap;
+}
+
+QVariant LazyMessage::value(const QString &fieldName) const
+{
+    return toMap().value(fieldName);
+}
+
+bool LazyMessage::operator==(const LazyMessage &other) const
+{
+    return (d == other.d) || (toMap() == other.toMap());
+}
+
+/// Returns a copy of \a variant with all LazyMessage values (recursively)
+/// replaced by their decoded QVariantMap equivalents.
+QVariant LazyMessage::expand(const QVariant &variant)
+{
+    if (variant.userType() == qMetaTypeId<LazyMessage>()) {
+        return expand(variant.value<LazyMessage>().toMap());
+    }
+
+    switch (static_cast<QMetaType::Type>(variant.type())) {
+    case QMetaType::QVariantList: {
+            QVariantList list;
+            foreach (const QVariant &item, variant.toList()) {
+                list << expand(item);
+            }
+            return list;
+        }
+    case QMetaType::QVariantMap: {
+            QVariantMap map(variant.toMap());
+            for (QVariantMap::iterator iter = map.begin(); iter != map.end(); ++iter) {
+                iter.value() = expand(iter.value());
+            }
+            return map;
+        }
+    default:
+        return variant;
+    }
+}
+
+}
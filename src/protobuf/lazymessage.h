@@ -0,0 +1,55 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __PROTOBUF_LAZY_MESSAGE_H__
+#define __PROTOBUF_LAZY_MESSAGE_H__
+
+#include "message.h"
+
+#include <QExplicitlySharedDataPointer>
+#include <QMetaType>
+#include <QSet>
+#include <QVariantMap>
+
+namespace ProtoBuf {
+
+/// An embedded message whose decoding is deferred until its fields are first
+/// accessed.
+///
+/// A LazyMessage holds the raw (still encoded) bytes of an embedded message,
+/// along with the schema node (field info and tag path) needed to decode it.
+/// The message is decoded at most once; the decoded map is memoized and shared
+/// by all copies. LazyMessage values are registered as convertible to
+/// QVariantMap, so existing QVariant::toMap() calls decode them transparently.
+class LazyMessage {
+
+public:
+    LazyMessage();
+    LazyMessage(const QByteArray &data, const Message::FieldInfoMap &fieldInfo,
+                const QString &pathSeparator, const QString &tagPathPrefix,
+                const QSet<QString> &lazyTagPaths = QSet<QString>());
+    LazyMessage(const LazyMessage &other);
+    ~LazyMessage();
+
+    LazyMessage &operator=(const LazyMessage &other);
+
+    bool isDecoded() const;
+    QByteArray rawData() const;
+    QVariantMap toMap() const;
+    QVariant value(const QString &fieldName) const;
+
+    bool operator==(const LazyMessage &other) const;
+
+    static QVariant expand(const QVariant &variant);
+
+private:
+    class Data;
+    QExplicitlySharedDataPointer<Data> d;
+
+};
+
+}
+
+Q_DECLARE_METATYPE(ProtoBuf::LazyMessage)
+
+#endif // __PROTOBUF_LAZY_MESSAGE_H__
@@ -4,6 +4,7 @@
 #include "message.h"
 
 #include "fixnum.h"
+#include "lazymessage.h"
 #include "varint.h"
 
 #include <QBuffer>
@@ -65,6 +66,17 @@ QVariantMap Message::parse(QIODevice &data, const QString &tagPathPrefix) const
     return parsedFields;
 }
 
+/// Marks embedded messages at \a tagPath to be decoded lazily, on first access,
+/// rather than eagerly as part of the enclosing message.
+void Message::setLazy(const QString &tagPath, const bool lazy)
+{
+    if (lazy) {
+        lazyTagPaths.insert(tagPath);
+    } else {
+        lazyTagPaths.remove(tagPath);
+    }
+}
+
 QPair<quint32, quint8> Message::parseTagAndType(QIODevice &data) const
 {
     QVariant tagAndType = parseUnsignedVarint(data);
@@ -150,9 +162,13 @@ QVariant Message::parseLengthDelimitedValue(QIODevice &data,
         return QString::fromUtf8(value.toByteArray());
     }
 
-    // Parse embedded messages recursively.
+    // Parse embedded messages recursively, or defer parsing if lazy.
     if (scalarType == Types::EmbeddedMessage) {
         QByteArray array = value.toByteArray();
+        if (lazyTagPaths.contains(tagPath)) {
+            return QVariant::fromValue(LazyMessage(array, fieldInfo, pathSeparator,
+                                                   tagPath + pathSeparator, lazyTagPaths));
+        }
         return parse(array, tagPath + pathSeparator);
     }
 
@@ -184,4 +200,25 @@ QVariant Message::readLengthDelimitedValue(QIODevice &data) const
     return (value.length() == length.toInt()) ? value : QVariant();
 }
 
+/**
+ * @brief Fetches the first value of a parsed (and so, list-valued) field.
+ *
+ * @param field QVariant (probably) containing a list, such as parse() returns
+ *              for each field.
+ *
+ * @return The first item in the list, or an invalid variant if there is no
+ *         such list, or the list is empty.
+ */
+QVariant first(const QVariant &field)
+{
+    const QVariantList list = field.toList();
+    return (list.isEmpty()) ? QVariant() : list.first();
+}
+
+/// Fetches the first value of a parsed field, as an embedded message's map.
+QVariantMap firstMap(const QVariant &field)
+{
+    return first(field).toMap();
+}
+
 }
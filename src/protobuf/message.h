@@ -9,6 +9,7 @@
 #include <QByteArray>
 #include <QIODevice>
 #include <QPair>
+#include <QSet>
 #include <QVariantList>
 
 namespace ProtoBuf {
@@ -43,8 +44,11 @@ public:
     QVariantMap parse(QByteArray &data, const QString &tagPathPrefix = QString()) const;
     QVariantMap parse(QIODevice &data, const QString &tagPathPrefix = QString()) const;
 
+    void setLazy(const QString &tagPath, const bool lazy = true);
+
 protected:
     FieldInfoMap fieldInfo;
+    QSet<QString> lazyTagPaths;
     QString pathSeparator;
 
     QPair<quint32, quint8> parseTagAndType(QIODevice &data) const;
@@ -61,6 +65,9 @@ protected:
 
 };
 
+QVariant first(const QVariant &field);
+QVariantMap firstMap(const QVariant &field);
+
 }
 
 #endif // __PROTOBUF_MESSAGE_H__
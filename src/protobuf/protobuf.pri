@@ -3,5 +3,5 @@
 
 INCLUDEPATH += $$PWD
 VPATH += $$PWD
-HEADERS += fixnum.h   message.h   types.h   varint.h
-SOURCES += fixnum.cpp message.cpp types.cpp varint.cpp
+HEADERS += fixnum.h   lazymessage.h   message.h   types.h   varint.h
+SOURCES += fixnum.cpp lazymessage.cpp message.cpp types.cpp varint.cpp
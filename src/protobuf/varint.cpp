@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "varint.h"
+#include "types.h"
 
 #include <QBuffer>
 #include <QDebug>
@@ -123,4 +124,77 @@ QVariantList parseUnsignedVarints(QIODevice &data, int maxItems)
     return list;
 }
 
+/**
+ * @brief Reads one unsigned varint directly from raw memory.
+ *
+ * Unlike the QIODevice-based parse* functions above, this does no buffering or
+ * QVariant conversion, for decoders (such as of packed samples) that walk large
+ * amounts of raw protobuf data.
+ *
+ * @param pos   Position to read from; advanced past the varint.
+ * @param end   End of the readable data.
+ * @param value Set to the decoded value.
+ *
+ * @return \c false if the varint is truncated, or longer than 64 bits.
+ */
+bool readVarint(const char * &pos, const char * const end, quint64 &value)
+{
+    value = 0;
+    for (int shift = 0; (pos < end) && (shift < 64); shift += 7) {
+        const quint8 byte = static_cast<quint8>(*pos++);
+        value |= static_cast<quint64>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Reads the length prefix of a length-delimited value from raw memory.
+ *
+ * @param pos      Position to read from; advanced to the start of the value.
+ * @param end      End of the readable data.
+ * @param fieldEnd Set to the end of the value.
+ *
+ * @return \c false if the length is truncated, or overruns \a end.
+ */
+bool readLengthDelimited(const char * &pos, const char * const end, const char * &fieldEnd)
+{
+    quint64 length;
+    if ((!readVarint(pos, end, length)) || (length > static_cast<quint64>(end - pos))) {
+        return false;
+    }
+    fieldEnd = pos + length;
+    return true;
+}
+
+/**
+ * @brief Skips over one field's value, of type \a wireType, in raw memory.
+ *
+ * @return \c false if the value is truncated, or is a (deprecated) group.
+ */
+bool skipField(const char * &pos, const char * const end, const quint8 wireType)
+{
+    quint64 value;
+    const char * fieldEnd = NULL;
+    switch (wireType) {
+    case Types::Varint:
+        return readVarint(pos, end, value);
+    case Types::SixtyFourBit:
+        if ((end - pos) < 8) return false;
+        pos += 8;
+        return true;
+    case Types::LengthDelimeted:
+        if (!readLengthDelimited(pos, end, fieldEnd)) return false;
+        pos = fieldEnd;
+        return true;
+    case Types::ThirtyTwoBit:
+        if ((end - pos) < 4) return false;
+        pos += 4;
+        return true;
+    }
+    return false; // Groups are deprecated, and not used by Polar.
+}
+
 }
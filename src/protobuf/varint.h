@@ -25,6 +25,10 @@ QVariant parseUnsignedVarint(QIODevice &data);
 QVariantList parseUnsignedVarints(QByteArray data, int maxItems = -1);
 QVariantList parseUnsignedVarints(QIODevice &data, int maxItems = -1);
 
+bool readVarint(const char * &pos, const char * const end, quint64 &value);
+bool readLengthDelimited(const char * &pos, const char * const end, const char * &fieldEnd);
+bool skipField(const char * &pos, const char * const end, const quint8 wireType);
+
 }
 
 #endif // __PROTOBUF_VARINT_H__
@@ -7,7 +7,7 @@ include(../common.pri)
 TARGET = Bipolar
 TEMPLATE = app
 CONFIG += warn_on
-QT += widgets xml
+QT += concurrent widgets xml
 
 # Define the build user (for TCX).
 win32:DEFINES += BUILD_USER=$$shell_quote($$(USERNAME))
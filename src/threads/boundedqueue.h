@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __BOUNDED_QUEUE__
+#define __BOUNDED_QUEUE__
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QWaitCondition>
+
+/**
+ * @brief A thread-safe, fixed-capacity, FIFO queue.
+ *
+ * Producers block while the queue is full, and consumers block while the queue
+ * is empty, so a BoundedQueue between two pipeline stages caps the amount of
+ * work (and memory) in flight between them. Once closed, producers can no
+ * longer add items, and consumers receive any remaining items before dequeue
+ * returns \c false.
+ */
+template <typename T>
+class BoundedQueue {
+
+public:
+    explicit BoundedQueue(const int capacity) : capacity(qMax(capacity, 1)), closed(false)
+    {
+
+    }
+
+    /// Closes the queue, waking all blocked producers and consumers.
+    void close()
+    {
+        QMutexLocker locker(&mutex);
+        closed = true;
+        notEmpty.wakeAll();
+        notFull.wakeAll();
+    }
+
+    /// Removes the next \a item, blocking until one is available.
+    /// @return \c false if the queue is both closed and empty.
+    bool dequeue(T &item)
+    {
+        QMutexLocker locker(&mutex);
+        while ((queue.isEmpty()) && (!closed)) {
+            notEmpty.wait(&mutex);
+        }
+        if (queue.isEmpty()) {
+            return false;
+        }
+        item = queue.dequeue();
+        notFull.wakeOne();
+        return true;
+    }
+
+    /// Appends \a item, blocking until there is room for it.
+    /// @return \c false if the queue has been closed.
+    bool enqueue(const T &item)
+    {
+        QMutexLocker locker(&mutex);
+        while ((queue.size() >= capacity) && (!closed)) {
+            notFull.wait(&mutex);
+        }
+        if (closed) {
+            return false;
+        }
+        queue.enqueue(item);
+        notEmpty.wakeOne();
+        return true;
+    }
+
+protected:
+    const int capacity;
+    bool closed;
+    QMutex mutex;
+    QQueue<T> queue;
+    QWaitCondition notEmpty;
+    QWaitCondition notFull;
+
+};
+
+#endif // __BOUNDED_QUEUE__
@@ -3,6 +3,8 @@
 
 #include "converterthread.h"
 
+#include "archivewriter.h"
+#include "sessioncache.h"
 #include "gpx/gpxextensionstab.h"
 #include "hrm/hrmextensionstab.h"
 #include "hrm/generalhrmoptionstab.h"
@@ -10,9 +12,67 @@
 #include "tcx/tcxextensionstab.h"
 #include "trainingsession.h"
 
+#include <QAtomicInt>
+#include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QSet>
 #include <QSettings>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+bool caseInsensitiveLessThan(const QString &a, const QString &b)
+{
+    return a.compare(b, Qt::CaseInsensitive) < 0;
+}
+
+struct SchedulingPolicyName {
+    const char * name;
+    ConverterThread::SchedulingPolicy policy;
+};
+
+const SchedulingPolicyName schedulingPolicyNames[] = {
+    { "directory",      ConverterThread::DirectoryOrder },
+    { "largest-first",  ConverterThread::LargestFirst   },
+    { "smallest-first", ConverterThread::SmallestFirst  },
+    { "newest-first",   ConverterThread::NewestFirst    },
+};
+
+struct ScheduledSession {
+    QString baseName;
+    qint64 size;         ///< Total size of the session's input files, in bytes.
+    qint64 lastModified; ///< Latest modification time of the session's input files.
+};
+
+// Runs one stage of the conversion pipeline on a QThreadPool thread.
+class PipelineStage : public QRunnable {
+
+public:
+    explicit PipelineStage(const std::function<void()> &stage) : stage(stage)
+    {
+
+    }
+
+    virtual void run()
+    {
+        stage();
+    }
+
+protected:
+    std::function<void()> stage;
+
+};
+
+}
 
 ConverterThread::ConverterThread(QObject * const parent)
     : QThread(parent), cancelled(false)
@@ -31,6 +91,41 @@ const QStringList &ConverterThread::sessionBaseNames() const
     return baseNames;
 }
 
+/**
+ * @brief Gets the scheduling policy with the given \a name.
+ *
+ * @param name Policy name, such as "largest-first".
+ * @param ok   If not \c NULL, set to \c false if \a name is not recognised.
+ *
+ * @return The named policy, or DirectoryOrder if \a name is not recognised.
+ */
+ConverterThread::SchedulingPolicy ConverterThread::schedulingPolicy(const QString &name,
+                                                                    bool * const ok)
+{
+    for (size_t index = 0;
+         index < (sizeof(schedulingPolicyNames)/sizeof(schedulingPolicyNames[0]));
+         ++index) {
+        if (name == QLatin1String(schedulingPolicyNames[index].name)) {
+            if (ok) *ok = true;
+            return schedulingPolicyNames[index].policy;
+        }
+    }
+    if (ok) *ok = false;
+    return DirectoryOrder;
+}
+
+QString ConverterThread::schedulingPolicyName(const SchedulingPolicy policy)
+{
+    for (size_t index = 0;
+         index < (sizeof(schedulingPolicyNames)/sizeof(schedulingPolicyNames[0]));
+         ++index) {
+        if (schedulingPolicyNames[index].policy == policy) {
+            return QLatin1String(schedulingPolicyNames[index].name);
+        }
+    }
+    return QString();
+}
+
 // Public slots.
 
 void ConverterThread::cancel()
@@ -40,20 +135,71 @@ void ConverterThread::cancel()
 
 // Protected methods.
 
-void ConverterThread::findSessionBaseNames()
+/**
+ * @brief Completes an archive opened by openArchive, if any.
+ *
+ * The archive (and its index) only replace any previous archive if every session
+ * was written successfully; if the run was cancelled, or any session failed to be
+ * written, then any previous archive is left untouched.
+ */
+void ConverterThread::closeArchive(Archive &archive)
 {
-    QSettings settings;
+    if (archive.writer.isNull()) {
+        return;
+    }
 
-    QRegExp regex(QLatin1String("(v2-users-[^-]+-training-sessions-[^-]+)-.*"));
-    foreach (const QString &folder,
-             settings.value(QLatin1String("inputFolders")).toStringList()) {
-        QDir dir(folder);
-        foreach (const QFileInfo &info, dir.entryInfoList()) {
-            if (regex.exactMatch(info.fileName())) {
-                const QString baseName = dir.absoluteFilePath(regex.cap(1));
-                if (!baseNames.contains(baseName)) {
-                    baseNames.append(baseName);
-                }
+    if (cancelled) {
+        // Don't replace any previous archive with a partial one.
+        archive.pending.clear();
+        archive.file.cancelWriting();
+        archive.indexFile.cancelWriting();
+        archive.writer.reset();
+        return;
+    }
+
+    // Write any sessions still waiting on earlier (missing) ones.
+    for (QMap<int, QPair<QString, QByteArray> >::const_iterator iter = archive.pending.constBegin();
+         iter != archive.pending.constEnd(); ++iter) {
+        if (!archive.writer->write(iter.value().first, iter.value().second)) {
+            archive.failed = true;
+        }
+    }
+    archive.pending.clear();
+
+    if ((archive.writer->close()) && (!archive.failed) &&
+        (archive.file.commit()) && (archive.indexFile.commit())) {
+        qDebug() << "Wrote" << QDir::toNativeSeparators(archive.file.fileName());
+        files.written += 2;
+    } else {
+        qWarning() << "Failed to write" << QDir::toNativeSeparators(archive.file.fileName());
+        files.failed++;
+        archive.file.cancelWriting();
+        archive.indexFile.cancelWriting();
+    }
+    archive.writer.reset();
+}
+
+void ConverterThread::findSessionBaseNames(const QStringList &folders)
+{
+    // Each folder is listed just once; the resulting per-session exercise file
+    // indexes are then handed to each TrainingSession, to save every session
+    // from re-scanning the same folder. Folders are independent of each other,
+    // so scan them in parallel when there's more than one.
+    const QList<FolderScan> scans = (folders.size() > 1)
+        ? QtConcurrent::blockingMapped<QList<FolderScan> >(folders, &ConverterThread::scanFolder)
+        : QList<FolderScan>() << scanFolder(folders.value(0));
+
+    // Merge the scans in folder order, so the session order is deterministic.
+    QSet<QString> knownBaseNames;
+    foreach (const QString &baseName, baseNames) {
+        knownBaseNames.insert(baseName);
+    }
+    foreach (const FolderScan &scan, scans) {
+        foreach (const QString &baseName, scan.baseNames) {
+            if (!knownBaseNames.contains(baseName)) {
+                knownBaseNames.insert(baseName);
+                baseNames.append(baseName);
+                exerciseFileNames.insert(baseName, scan.exerciseFileNames.value(baseName));
             }
         }
     }
@@ -61,96 +207,495 @@ void ConverterThread::findSessionBaseNames()
     emit sessionBaseNamesChanged(baseNames.size());
 }
 
-void ConverterThread::proccessSession(const QString &baseName)
+/**
+ * @brief Loads \a job's session from the session cache, if its inputs are unchanged.
+ *
+ * On a cache hit, \a session is restored from the cached data too, so that it
+ * can name its output files without parsing any input files.
+ */
+void ConverterThread::loadCachedSession(SessionJob &job, polar::v2::TrainingSession &session,
+                                        const ConversionOptions &options)
+{
+    job.cacheIdentity = polar::v2::SessionCache::inputIdentity(session.inputFileNames(),
+        (options.sampleCalibration) ? QByteArray("calibrated") : QByteArray());
+    job.cached = polar::v2::SessionCache().load(job.baseName, job.cacheIdentity);
+    job.cacheHit = job.cached.isValid();
+    if (job.cacheHit) {
+        session.restore(job.cached);
+    }
+}
+
+/**
+ * @brief Loads all conversion options from QSettings.
+ *
+ * This is called just once per run, so that the pipeline stages (and their
+ * worker threads) never need to access QSettings themselves.
+ *
+ * A "-scheduling-policy=<name>" command line argument takes precedence over the
+ * "schedulingPolicy" setting.
+ */
+ConverterThread::ConversionOptions ConverterThread::loadConversionOptions()
 {
-    if (cancelled) return;
-    qDebug() << QDir::toNativeSeparators(baseName);
+    QSettings settings;
+    ConversionOptions options;
+    options.inputFolders = settings.value(QLatin1String("inputFolders")).toStringList();
+
+    // Compile the output file name format once, for all sessions.
+    options.outputFileNameFormat = polar::v2::FileNameFormat(
+        settings.value(QLatin1String("outputFileNameFormat")).toString());
 
     // Build the set of file formats to be exported.
-    QSettings settings;
-    polar::v2::TrainingSession::OutputFormats outputDataFormats;
     if (settings.value(QLatin1String("gpxEnabled")).toBool()) {
-        outputDataFormats |= polar::v2::TrainingSession::GpxOutput;
+        options.outputFormats |= polar::v2::TrainingSession::GpxOutput;
     }
     if (settings.value(QLatin1String("hrmEnabled")).toBool()) {
-        outputDataFormats |= polar::v2::TrainingSession::HrmOutput;
+        options.outputFormats |= polar::v2::TrainingSession::HrmOutput;
     }
     if (settings.value(QLatin1String("tcxEnabled")).toBool()) {
-        outputDataFormats |= polar::v2::TrainingSession::TcxOutput;
+        options.outputFormats |= polar::v2::TrainingSession::TcxOutput;
+    }
+    if (settings.value(QLatin1String("fitEnabled")).toBool()) {
+        options.outputFormats |= polar::v2::TrainingSession::FitOutput;
+    }
+    if (settings.value(QLatin1String("csvEnabled")).toBool()) {
+        options.outputFormats |= polar::v2::TrainingSession::CsvOutput;
+    }
+    if (settings.value(QLatin1String("arrowEnabled")).toBool()) {
+        options.outputFormats |= polar::v2::TrainingSession::ArrowOutput;
+    }
+    if (settings.value(QLatin1String("gzipEnabled")).toBool()) {
+        options.outputFormats |= polar::v2::TrainingSession::GzipOutputs;
     }
 
     // Load the output directory setting (empty == auto).
-    const QString outputDir =
-        (settings.value(QLatin1String("outputFolderIndex")).toInt() == 0) ?
-            QString() : settings.value(QLatin1String("outputFolder")).toString();
-
-    // Check for pre-existing output files.
-    const QString outputFileNameFormat =
-        settings.value(QLatin1String("outputFileNameFormat")).toString();
-    polar::v2::TrainingSession session(baseName);
-    setTrainingSessionOptions(&session);
-    {
-        QStringList outputFileNames = session.getOutputFileNames(
-            outputFileNameFormat, outputDataFormats, outputDir);
+    if (settings.value(QLatin1String("outputFolderIndex")).toInt() != 0) {
+        options.outputDir = settings.value(QLatin1String("outputFolder")).toString();
+    }
+    options.statOutputFiles = settings.value(QLatin1String("statOutputFiles"), false).toBool();
+
+    // Stream all GPX and TCX outputs into one archive per format, if requested.
+    if (settings.value(QLatin1String("archiveEnabled"), false).toBool()) {
+        const int archivable = polar::v2::TrainingSession::GpxOutput|polar::v2::TrainingSession::TcxOutput;
+        options.archiveFormats = options.outputFormats & archivable;
+        options.outputFormats &= ~archivable;
+        options.archiveBaseName = QDir((options.outputDir.isEmpty()) ? options.inputFolders.value(0)
+            : options.outputDir).absoluteFilePath(QLatin1String("bipolar-archive"));
+    }
+    options.cacheSessions = settings.value(QLatin1String("cacheSessions"), false).toBool();
+
+    // Load the scheduling policy, preferring any command line override.
+    const QString argumentPrefix = QLatin1String("-scheduling-policy=");
+    QString policyName = settings.value(QLatin1String("schedulingPolicy")).toString();
+    foreach (const QString &argument, QCoreApplication::arguments()) {
+        if (argument.startsWith(argumentPrefix)) {
+            policyName = argument.mid(argumentPrefix.size());
+        }
+    }
+    bool ok;
+    options.schedulingPolicy = schedulingPolicy(policyName, &ok);
+    if ((!ok) && (!policyName.isEmpty())) {
+        qWarning() << "Unknown scheduling policy" << policyName;
+    }
+
+    // Load the alignment of route points with samples.
+    const QString alignmentName = settings.value(QLatin1String("sampleAlignment")).toString();
+    options.sampleAlignment = polar::v2::Timeline::alignment(alignmentName, &ok);
+    if ((!ok) && (!alignmentName.isEmpty())) {
+        qWarning() << "Unknown sample alignment" << alignmentName;
+    }
+    options.sampleCalibration = settings.value(QLatin1String("sampleCalibration"), false).toBool();
+
+    // The src/widgets/*/*Tabs widgets load/save options from/to QSettings.
+    // Here we load from QSettings, for applying to each TrainingSession instance.
+    #define LOAD_OPTION(flags, option, Tab, Name) \
+        if (settings.value(Tab::Name##SettingsKey, Tab::Name##DefaultSetting).toBool()) { \
+            flags |= polar::v2::TrainingSession::option; \
+        }
+
+    settings.beginGroup(QLatin1String("gpx"));
+    LOAD_OPTION(options.gpxOptions, CluetrustGpxDataExtension,   GpxExtensionsTab, CluetrustGpxExt);
+    LOAD_OPTION(options.gpxOptions, GarminAccelerationExtension, GpxExtensionsTab, GarminAccelerationExt);
+    LOAD_OPTION(options.gpxOptions, GarminTrackPointExtension,   GpxExtensionsTab, GarminTrackPointExt);
+    settings.endGroup();
+
+    settings.beginGroup(QLatin1String("hrm"));
+    LOAD_OPTION(options.hrmOptions, RrFiles,          GeneralHrmOptions, ExportRrFiles);
+    LOAD_OPTION(options.hrmOptions, FillHrmLapStats,  GeneralHrmOptions, LapStats);
+    LOAD_OPTION(options.hrmOptions, HrvAnalysis,      GeneralHrmOptions, HrvAnalysis);
+    LOAD_OPTION(options.hrmOptions, KilometreHrmLaps, GeneralHrmOptions, KilometreLaps);
+    LOAD_OPTION(options.hrmOptions, LapNames,         HrmExtensionsTab,  LapNamesExt);
+    settings.endGroup();
+
+    settings.beginGroup(QLatin1String("tcx"));
+    LOAD_OPTION(options.tcxOptions, ForceTcxUTC,             GeneralTcxOptions, UtcOnly);
+    LOAD_OPTION(options.tcxOptions, FillTcxLapStats,         GeneralTcxOptions, LapStats);
+    LOAD_OPTION(options.tcxOptions, KilometreTcxLaps,        GeneralTcxOptions, KilometreLaps);
+    LOAD_OPTION(options.tcxOptions, GarminActivityExtension, TcxExtensionsTab,  GarminActivityExt);
+    LOAD_OPTION(options.tcxOptions, GarminCourseExtension,   TcxExtensionsTab,  GarminCourseExt);
+    settings.endGroup();
+
+    #undef LOAD_OPTION
+    return options;
+}
+
+/**
+ * @brief Opens the archive, and archive index, for the given output \a format.
+ *
+ * @return \c true if \a format is not being archived, or its archive was opened
+ *         successfully, otherwise \c false.
+ */
+bool ConverterThread::openArchive(Archive &archive,
+                                  const polar::v2::TrainingSession::OutputFormat format,
+                                  const ConversionOptions &options)
+{
+    if (!options.archiveFormats.testFlag(format)) {
+        return true;
+    }
+    archive.file.setFileName(options.archiveBaseName + QLatin1String(
+        (format == polar::v2::TrainingSession::GpxOutput) ? ".gpx" : ".tcx"));
+    archive.indexFile.setFileName(archive.file.fileName() + QLatin1String(".idx"));
+    foreach (QSaveFile * const file, QList<QSaveFile *>() << &archive.file << &archive.indexFile) {
+        if (!file->open(QIODevice::WriteOnly)) {
+            qWarning() << "Failed to open" << QDir::toNativeSeparators(file->fileName());
+            files.failed++;
+            return false;
+        }
+    }
+    if (format == polar::v2::TrainingSession::GpxOutput) {
+        archive.writer.reset(new polar::v2::ArchiveWriter(
+            archive.file, options.gpxOptions, &archive.indexFile, options.sampleAlignment));
+    } else {
+        archive.writer.reset(new polar::v2::ArchiveWriter(
+            archive.file, options.tcxOptions, &archive.indexFile, options.sampleAlignment));
+    }
+    return true;
+}
+
+/**
+ * @brief Re-orders the found training sessions according to \a policy.
+ *
+ * Input file sizes and modification times are only fetched (which requires a
+ * stat of every input file) for policies that need them. Sessions that compare
+ * equal keep their directory order.
+ */
+void ConverterThread::scheduleSessions(const SchedulingPolicy policy)
+{
+    if (policy == DirectoryOrder) {
+        return;
+    }
+
+    QList<ScheduledSession> scheduledSessions;
+    foreach (const QString &baseName, baseNames) {
+        QStringList fileNames;
+        fileNames << (baseName + QLatin1String("-create"))
+                  << (baseName + QLatin1String("-physical-information"));
+        foreach (const polar::v2::TrainingSession::ExerciseFileNames::mapped_type &exerciseFiles,
+                 exerciseFileNames.value(baseName)) {
+            fileNames << exerciseFiles.values();
+        }
+
+        ScheduledSession session = { baseName, 0, 0 };
+        foreach (const QString &fileName, fileNames) {
+            const QFileInfo fileInfo(fileName);
+            if (fileInfo.exists()) {
+                session.size += fileInfo.size();
+                session.lastModified = qMax(session.lastModified,
+                                            fileInfo.lastModified().toMSecsSinceEpoch());
+            }
+        }
+        scheduledSessions.append(session);
+    }
+
+    std::stable_sort(scheduledSessions.begin(), scheduledSessions.end(),
+        [policy](const ScheduledSession &a, const ScheduledSession &b) {
+            switch (policy) {
+            case LargestFirst:  return a.size > b.size;
+            case SmallestFirst: return a.size < b.size;
+            case NewestFirst:   return a.lastModified > b.lastModified;
+            default:            return false;
+            }
+        });
+
+    baseNames.clear();
+    foreach (const ScheduledSession &session, scheduledSessions) {
+        baseNames.append(session.baseName);
+    }
+}
+
+ConverterThread::FolderScan ConverterThread::scanFolder(const QString &folder)
+{
+    FolderScan scan;
+    if (folder.isEmpty()) {
+        return scan;
+    }
+
+    QString dirPrefix = QDir(folder).absolutePath();
+    if (!dirPrefix.endsWith(QLatin1Char('/'))) {
+        dirPrefix.append(QLatin1Char('/'));
+    }
+
+    // Only entry names are inspected here, so the iterator never needs to stat
+    // (or build a QFileInfo for) any of the, potentially many, entries.
+    QSet<QString> knownBaseNames;
+    QDirIterator iter(folder, QDir::Files);
+    while (iter.hasNext()) {
+        iter.next();
+        const QString fileName = iter.fileName();
+        const int baseNameLength = sessionBaseNameLength(fileName);
+        if (baseNameLength < 0) {
+            continue;
+        }
+        QString baseName(dirPrefix);
+        baseName.append(fileName.leftRef(baseNameLength));
+        if (!knownBaseNames.contains(baseName)) {
+            knownBaseNames.insert(baseName);
+            scan.baseNames.append(baseName);
+        }
+        polar::v2::TrainingSession::addExerciseFileName(
+            scan.exerciseFileNames[baseName], fileName, iter.filePath());
+    }
+
+    // Directory iteration order is filesystem-dependent, so sort by name (as
+    // QDir::entryInfoList would have) for a consistent processing order.
+    std::sort(scan.baseNames.begin(), scan.baseNames.end(), caseInsensitiveLessThan);
+    return scan;
+}
+
+/**
+ * @brief Gets the length of the session base name prefix of \a fileName.
+ *
+ * This is equivalent to matching \a fileName against the regular expression
+ * "(v2-users-[^-]+-training-sessions-[^-]+)-.*", and returning the length of
+ * the captured group, but without the overhead of a regular expression.
+ *
+ * @return The length of the base name, or -1 if \a fileName does not belong to
+ *         a training session.
+ */
+int ConverterThread::sessionBaseNameLength(const QString &fileName)
+{
+    const QLatin1String usersPrefix("v2-users-");
+    const QLatin1String sessionsInfix("-training-sessions-");
+
+    if (!fileName.startsWith(usersPrefix)) {
+        return -1;
+    }
+
+    const int userIdEnd = fileName.indexOf(QLatin1Char('-'), usersPrefix.size());
+    if ((userIdEnd <= usersPrefix.size()) ||
+        (!fileName.midRef(userIdEnd).startsWith(sessionsInfix))) {
+        return -1;
+    }
+
+    const int sessionIdStart = userIdEnd + sessionsInfix.size();
+    const int sessionIdEnd = fileName.indexOf(QLatin1Char('-'), sessionIdStart);
+    return (sessionIdEnd > sessionIdStart) ? sessionIdEnd : -1;
+}
+
+/**
+ * @brief Pipeline stage 1: reads each training session's input files.
+ *
+ * Sessions whose output files all exist already are passed straight to the
+ * write stage (to be counted as skipped); all others are passed, along with
+ * their input file contents, to the parse stage.
+ */
+void ConverterThread::readSessions(const ConversionOptions &options,
+                                   OutputFileIndex &outputFiles,
+                                   SessionQueue &parseQueue, SessionQueue &writeQueue)
+{
+    for (int index = 0; (index < baseNames.size()) && (!cancelled); ++index) {
+        emit progress(index);
+        SessionJob job;
+        job.status = SessionJob::Pending;
+        job.baseName = baseNames.at(index);
+        // Archives list sessions in processing order, so that the write stage need
+        // only hold back sessions overtaking others still being parsed.
+        job.archiveOrder = index;
+        job.cacheHit = false;
+        qDebug() << QDir::toNativeSeparators(job.baseName);
+
+        polar::v2::TrainingSession session(job.baseName, exerciseFileNames.value(job.baseName));
+        setTrainingSessionOptions(&session, options);
+
+        // Look the session up in the cache before naming its outputs, if the names
+        // need the session's data, so that a cache hit never parses input files.
+        bool cacheChecked = false;
+        if ((options.cacheSessions) && (options.outputFileNameFormat.uses(
+                polar::v2::FileNameFormat::AnyDateTime|polar::v2::FileNameFormat::SessionName))) {
+            loadCachedSession(job, session, options);
+            cacheChecked = true;
+        }
+
+        // Check for pre-existing output files. Naming the outputs may need to parse
+        // the session, in which case keep the result for the parse stage to restore.
+        polar::v2::ParsedSession parsedSession;
+        const QStringList outputFileNames = session.getOutputFileNames(
+            options.outputFileNameFormat, options.outputFormats, options.outputDir,
+            (job.cached.isValid()) ? NULL : &parsedSession);
         bool foundNonExistentOutputFileName = false;
-        for (int index = 0;
-             (index < outputFileNames.count()) && (!foundNonExistentOutputFileName);
-             ++index)
+        for (int fileIndex = 0;
+             (fileIndex < outputFileNames.count()) && (!foundNonExistentOutputFileName);
+             ++fileIndex)
         {
-            if (!QFile::exists(outputFileNames.at(index))) {
+            if (!outputFiles.exists(outputFileNames.at(fileIndex))) {
                 foundNonExistentOutputFileName = true;
             }
         }
-        if ((!outputFileNames.isEmpty()) && (!foundNonExistentOutputFileName)) {
-            sessions.skipped++;
-            return; // No need to process this training session.
+        // Note, archives must include every session, so are never skipped.
+        if ((!options.archiveFormats) && (!outputFileNames.isEmpty()) &&
+            (!foundNonExistentOutputFileName)) {
+            job.status = SessionJob::Skipped;
+            job.cached = polar::v2::ParsedSession();
+            writeQueue.enqueue(job);
+            continue; // No need to process this training session.
         }
-    }
 
-    // Parse the training session.
-    if (!session.parse()) {
-        sessions.failed++;
-        return;
+        // Load the session from the cache if its inputs are unchanged, else read them
+        // (unless already parsed while naming its outputs).
+        if (parsedSession.isValid()) {
+            job.cached = parsedSession;
+        } else if ((options.cacheSessions) && (!cacheChecked)) {
+            loadCachedSession(job, session, options);
+        }
+        if (!job.cached.isValid()) {
+            job.inputFiles = session.readInputFiles();
+        }
+        parseQueue.enqueue(job);
     }
+    parseQueue.close();
+}
 
-    // Write the relevant output files.
-    bool anyFailed = false;
-    if (settings.value(QLatin1String("gpxEnabled")).toBool()) {
-        const QString fileName = session.writeGPX(outputFileNameFormat, outputDir);
-        if (!fileName.isEmpty()) {
-            qDebug() << "Wrote" << QDir::toNativeSeparators(fileName);
-            files.written++;
+/**
+ * @brief Pipeline stage 2: parses training sessions, and formats their outputs.
+ *
+ * Any number of threads may run this stage concurrently.
+ */
+void ConverterThread::parseSessions(const ConversionOptions &options,
+                                    SessionQueue &parseQueue, SessionQueue &writeQueue)
+{
+    SessionJob job;
+    while (parseQueue.dequeue(job)) {
+        if (cancelled) {
+            continue; // Drain the queue, so the read stage is never left blocked.
+        }
+
+        polar::v2::TrainingSession session(job.baseName, exerciseFileNames.value(job.baseName));
+        setTrainingSessionOptions(&session, options);
+        if ((job.cached.isValid()) ? session.restore(job.cached) : session.parse(job.inputFiles)) {
+            if ((options.cacheSessions) && (!job.cacheHit)) {
+                job.cacheData = polar::v2::SessionCache::serialize(
+                    session.snapshot(), job.cacheIdentity);
+            }
+            // Archive fragments reuse the per-session GPX and TCX documents, if any.
+            QDomDocument gpx, tcx;
+            job.outputFiles = session.formatOutputs(
+                options.outputFileNameFormat, options.outputFormats, options.outputDir, &gpx, &tcx);
+            if (options.archiveFormats.testFlag(polar::v2::TrainingSession::GpxOutput)) {
+                if (!options.outputFormats.testFlag(polar::v2::TrainingSession::GpxOutput)) {
+                    gpx = polar::v2::TrainingSession::toGPX(session.snapshot(), options.gpxOptions,
+                        QDateTime::currentDateTimeUtc(), options.sampleAlignment);
+                }
+                job.gpxFragment = polar::v2::ArchiveWriter::toFragment(
+                    gpx, polar::v2::ArchiveWriter::GpxArchive);
+            }
+            if (options.archiveFormats.testFlag(polar::v2::TrainingSession::TcxOutput)) {
+                if (!options.outputFormats.testFlag(polar::v2::TrainingSession::TcxOutput)) {
+                    tcx = polar::v2::TrainingSession::toTCX(session.snapshot(), options.tcxOptions,
+                        QString(), options.sampleAlignment);
+                }
+                job.tcxFragment = polar::v2::ArchiveWriter::toFragment(
+                    tcx, polar::v2::ArchiveWriter::TcxArchive);
+            }
+            job.status = SessionJob::Parsed;
         } else {
-            anyFailed = true;
-            files.failed++;
+            job.status = SessionJob::ParseFailed;
         }
+        job.inputFiles.clear(); // Release the input data as early as possible.
+        job.cached = polar::v2::ParsedSession();
+        writeQueue.enqueue(job);
     }
-    if (settings.value(QLatin1String("hrmEnabled")).toBool()) {
-        const QStringList fileNames = session.writeHRM(outputFileNameFormat, outputDir);
-        foreach (const QString &fileName, fileNames) {
-            qDebug() << "Wrote" << QDir::toNativeSeparators(fileName);
-            files.written++;
+}
+
+/**
+ * @brief Pipeline stage 3: writes formatted output files, and archives, to disk.
+ *
+ * This is the only stage that updates the files and sessions counters, and the
+ * only stage that writes to the archives (if any).
+ */
+void ConverterThread::writeSessions(OutputFileIndex &outputFiles, SessionQueue &writeQueue,
+                                    Archive &gpxArchive, Archive &tcxArchive)
+{
+    SessionJob job;
+    while (writeQueue.dequeue(job)) {
+        // Stream the session into the archives (if any) in archive order, even
+        // if it failed to parse, so that it no longer holds up later sessions.
+        if ((job.status != SessionJob::Skipped) && (!cancelled)) {
+            const QString name = QFileInfo(job.baseName).fileName();
+            writeArchive(gpxArchive, job.archiveOrder, name, job.gpxFragment);
+            writeArchive(tcxArchive, job.archiveOrder, name, job.tcxFragment);
         }
-        const int failedFilesCount = (fileNames.size() - (2 * session.exerciseCount()));
-        if (failedFilesCount > 0) {
-            anyFailed = true;
-            files.failed += failedFilesCount;
+
+        if (job.status == SessionJob::Skipped) {
+            sessions.skipped++;
+            continue;
+        } else if (job.status == SessionJob::ParseFailed) {
+            sessions.failed++;
+            continue;
+        } else if (cancelled) {
+            continue;
         }
-    }
-    if (settings.value(QLatin1String("tcxEnabled")).toBool()) {
-        const QString fileName = session.writeTCX(outputFileNameFormat, outputDir);
-        if (!fileName.isEmpty()) {
-            qDebug() << "Wrote" << QDir::toNativeSeparators(fileName);
-            files.written++;
-        } else {
+
+        if (!job.cacheData.isEmpty()) {
+            polar::v2::SessionCache().store(job.baseName, job.cacheData);
+        }
+
+        bool anyFailed = false;
+        for (polar::v2::TrainingSession::OutputFiles::const_iterator iter = job.outputFiles.constBegin();
+             iter != job.outputFiles.constEnd(); ++iter)
+        {
+            QFile file(iter.key());
+            if (iter.value().isNull()) {
+                qWarning() << "Failed to convert" << QDir::toNativeSeparators(iter.key());
+            } else if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
+                qWarning() << "Failed to open" << QDir::toNativeSeparators(iter.key());
+            } else if (file.write(iter.value()) != iter.value().size()) {
+                qWarning() << "Failed to write" << QDir::toNativeSeparators(iter.key());
+            } else {
+                qDebug() << "Wrote" << QDir::toNativeSeparators(iter.key());
+                outputFiles.insert(iter.key());
+                files.written++;
+                continue;
+            }
             anyFailed = true;
             files.failed++;
         }
+
+        if (anyFailed) {
+            sessions.failed++;
+        } else {
+            sessions.processed++;
+        }
     }
-    if (anyFailed) {
-        sessions.failed++;
-    } else {
-        sessions.processed++;
+}
+
+/**
+ * @brief Queues a session's \a fragment for \a archive, at position \a order.
+ *
+ * Sessions arrive from the parse stage in whatever order they finish, so each
+ * fragment is held until all those before it have been written. Any archive
+ * write failure is recorded, and reported (once) by closeArchive.
+ */
+void ConverterThread::writeArchive(Archive &archive, const int order,
+                                   const QString &name, const QByteArray &fragment)
+{
+    if (archive.writer.isNull()) {
+        return;
+    }
+    archive.pending.insert(order, qMakePair(name, fragment));
+    while ((!archive.pending.isEmpty()) && (archive.pending.firstKey() == archive.nextOrder)) {
+        const QPair<QString, QByteArray> entry = archive.pending.take(archive.nextOrder++);
+        if (!archive.writer->write(entry.first, entry.second)) {
+            archive.failed = true;
+        }
     }
 }
 
@@ -160,54 +705,54 @@ void ConverterThread::run()
     memset(&files,    0, sizeof(files));
     memset(&sessions, 0, sizeof(sessions));
 
+    // Snapshot all options once; the pipeline stages must not access QSettings.
+    const ConversionOptions options = loadConversionOptions();
+
     // Find the base name of training sessions to consider for processing.
-    findSessionBaseNames();
+    findSessionBaseNames(options.inputFolders);
+    scheduleSessions(options.schedulingPolicy);
 
-    // Process all found training sessions.
-    for (int index = 0; (index < baseNames.size()) && (!cancelled); ++index) {
-        emit progress(index);
-        proccessSession(baseNames.at(index));
+    // Open the archives (if any) that the write stage streams sessions into.
+    Archive gpxArchive, tcxArchive;
+    if ((!openArchive(gpxArchive, polar::v2::TrainingSession::GpxOutput, options)) ||
+        (!openArchive(tcxArchive, polar::v2::TrainingSession::TcxOutput, options))) {
+        return;
+    }
+
+    // Process all found training sessions via a three-stage pipeline: one thread
+    // reads input files, a pool of threads parses sessions and formats their
+    // outputs, and this thread writes the outputs to disk. The bounded queues
+    // between the stages cap the number of sessions held in memory at once.
+    const int parserCount = qMax(QThread::idealThreadCount() - 1, 1);
+    SessionQueue parseQueue(parserCount * 2), writeQueue(parserCount * 2);
+    OutputFileIndex outputFiles(options.statOutputFiles);
+    QAtomicInt activeParsers(parserCount);
+    QThreadPool pool;
+    pool.setMaxThreadCount(parserCount + 1);
+    pool.start(new PipelineStage([&]() {
+        readSessions(options, outputFiles, parseQueue, writeQueue);
+    }));
+    for (int index = 0; index < parserCount; ++index) {
+        pool.start(new PipelineStage([&]() {
+            parseSessions(options, parseQueue, writeQueue);
+            if (!activeParsers.deref()) {
+                writeQueue.close(); // This was the last parser to finish.
+            }
+        }));
     }
+    writeSessions(outputFiles, writeQueue, gpxArchive, tcxArchive);
+    pool.waitForDone();
+    closeArchive(gpxArchive);
+    closeArchive(tcxArchive);
 }
 
-void ConverterThread::setTrainingSessionOptions(polar::v2::TrainingSession * const session)
+void ConverterThread::setTrainingSessionOptions(polar::v2::TrainingSession * const session,
+                                                const ConversionOptions &options)
 {
     Q_CHECK_PTR(session);
-
-    // The src/widgets/*/*Tabs widgets load/save options from/to QSettings.
-    // Here we load from QSettings, and apply to our TrainingSession instance.
-    QSettings settings;
-
-    settings.beginGroup(QLatin1String("gpx"));
-    session->setGpxOption(polar::v2::TrainingSession::CluetrustGpxDataExtension,
-        settings.value(GpxExtensionsTab::CluetrustGpxExtSettingsKey,
-                       GpxExtensionsTab::CluetrustGpxExtDefaultSetting).toBool());
-    session->setGpxOption(polar::v2::TrainingSession::GarminAccelerationExtension,
-        settings.value(GpxExtensionsTab::GarminAccelerationExtSettingsKey,
-                       GpxExtensionsTab::GarminAccelerationExtDefaultSetting).toBool());
-    session->setGpxOption(polar::v2::TrainingSession::GarminTrackPointExtension,
-        settings.value(GpxExtensionsTab::GarminTrackPointExtSettingsKey,
-                       GpxExtensionsTab::GarminTrackPointExtDefaultSetting).toBool());
-    settings.endGroup();
-
-    settings.beginGroup(QLatin1String("hrm"));
-    session->setHrmOption(polar::v2::TrainingSession::RrFiles,
-        settings.value(GeneralHrmOptions::ExportRrFilesSettingsKey,
-                       GeneralHrmOptions::ExportRrFilesDefaultSetting).toBool());
-    session->setHrmOption(polar::v2::TrainingSession::LapNames,
-        settings.value(HrmExtensionsTab::LapNamesExtSettingsKey,
-                       HrmExtensionsTab::LapNamesExtDefaultSetting).toBool());
-    settings.endGroup();
-
-    settings.beginGroup(QLatin1String("tcx"));
-    session->setTcxOption(polar::v2::TrainingSession::ForceTcxUTC,
-        settings.value(GeneralTcxOptions::UtcOnlySettingsKey,
-                       GeneralTcxOptions::UtcOnlyDefaultSetting).toBool());
-    session->setTcxOption(polar::v2::TrainingSession::GarminActivityExtension,
-        settings.value(TcxExtensionsTab::GarminActivityExtSettingsKey,
-                       TcxExtensionsTab::GarminActivityExtDefaultSetting).toBool());
-    session->setTcxOption(polar::v2::TrainingSession::GarminCourseExtension,
-        settings.value(TcxExtensionsTab::GarminCourseExtSettingsKey,
-                       TcxExtensionsTab::GarminCourseExtDefaultSetting).toBool());
-    settings.endGroup();
+    session->setGpxOptions(options.gpxOptions);
+    session->setHrmOptions(options.hrmOptions);
+    session->setTcxOptions(options.tcxOptions);
+    session->setSampleAlignment(options.sampleAlignment);
+    session->setSampleCalibration(options.sampleCalibration);
 }
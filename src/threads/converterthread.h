@@ -4,17 +4,33 @@
 #ifndef __CONVERTER_THREAD__
 #define __CONVERTER_THREAD__
 
+#include "archivewriter.h"
+#include "boundedqueue.h"
+#include "outputfileindex.h"
+#include "trainingsession.h"
+
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QSaveFile>
+#include <QScopedPointer>
 #include <QStringList>
 #include <QThread>
 
-namespace polar { namespace v2 { class TrainingSession; } }
-
 class ConverterThread : public QThread {
     Q_OBJECT
     Q_PROPERTY(bool cancelled READ isCancelled)
     Q_PROPERTY(QStringList baseNames READ sessionBaseNames NOTIFY sessionBaseNamesChanged)
 
 public:
+    /// The order in which training sessions are converted.
+    enum SchedulingPolicy {
+        DirectoryOrder, ///< Input folder order, then by base name.
+        LargestFirst,   ///< Largest total input size first, to minimise the overall time.
+        SmallestFirst,  ///< Smallest total input size first, to get early outputs sooner.
+        NewestFirst,    ///< Most recently modified input files first.
+    };
+
     struct { int failed, written; } files;
     struct { int failed, processed, skipped; } sessions;
 
@@ -22,17 +38,93 @@ public:
     bool isCancelled() const;
     const QStringList &sessionBaseNames() const;
 
+    static SchedulingPolicy schedulingPolicy(const QString &name, bool * const ok = NULL);
+    static QString schedulingPolicyName(const SchedulingPolicy policy);
+
 public slots:
     void cancel();
 
 protected:
+    struct FolderScan {
+        QStringList baseNames;
+        QHash<QString, polar::v2::TrainingSession::ExerciseFileNames> exerciseFileNames;
+    };
+
+    /// Conversion options, captured from QSettings once at the start of each run.
+    struct ConversionOptions {
+        QStringList inputFolders;
+        polar::v2::FileNameFormat outputFileNameFormat;
+        polar::v2::TrainingSession::OutputFormats outputFormats;
+        polar::v2::TrainingSession::OutputFormats archiveFormats; ///< Formats written to one archive each.
+        QString archiveBaseName; ///< Archive file path, without extension.
+        QString outputDir; ///< Empty to use each session's input folder.
+        bool statOutputFiles; ///< Check for existing outputs via per-file stats.
+        bool cacheSessions;   ///< Load and store parsed sessions via a SessionCache.
+        SchedulingPolicy schedulingPolicy;
+        polar::v2::Timeline::Alignment sampleAlignment;
+        bool sampleCalibration; ///< Apply the samples' calibration entries when parsing.
+        polar::v2::TrainingSession::GpxOptions gpxOptions;
+        polar::v2::TrainingSession::HrmOptions hrmOptions;
+        polar::v2::TrainingSession::TcxOptions tcxOptions;
+    };
+
+    /// A training session passing through the read, parse and write stages.
+    struct SessionJob {
+        enum Status { Pending, Skipped, ParseFailed, Parsed };
+        Status status;
+        QString baseName;
+        int archiveOrder;                ///< Session's position within the archives, if any.
+        polar::v2::TrainingSession::InputFiles inputFiles;
+        polar::v2::TrainingSession::OutputFiles outputFiles;
+        QByteArray cacheIdentity;        ///< Input identity, if caching sessions.
+        polar::v2::ParsedSession cached; ///< Session already parsed, or loaded from the cache, if any.
+        bool cacheHit;                   ///< Whether \a cached was loaded from the cache.
+        QByteArray cacheData;            ///< Serialised session to store in the cache.
+        QByteArray gpxFragment;          ///< Session's GPX archive elements, if any.
+        QByteArray tcxFragment;          ///< Session's TCX archive elements, if any.
+    };
+    typedef BoundedQueue<SessionJob> SessionQueue;
+
+    /**
+     * @brief An archive output, and its index, that the write stage streams sessions into.
+     *
+     * Both files are only replaced, on closing, if every session was written successfully.
+     */
+    struct Archive {
+        QSaveFile file;
+        QSaveFile indexFile;
+        QScopedPointer<polar::v2::ArchiveWriter> writer;
+        QMap<int, QPair<QString, QByteArray> > pending; ///< Fragments awaiting earlier sessions.
+        int nextOrder; ///< Archive order of the next session to write.
+        bool failed;   ///< Whether any session failed to be written.
+        Archive() : nextOrder(0), failed(false) { }
+    };
+
     bool cancelled;
     QStringList baseNames;
+    QHash<QString, polar::v2::TrainingSession::ExerciseFileNames> exerciseFileNames;
 
-    void findSessionBaseNames();
-    void proccessSession(const QString &baseName);
+    void closeArchive(Archive &archive);
+    void findSessionBaseNames(const QStringList &folders);
+    static void loadCachedSession(SessionJob &job, polar::v2::TrainingSession &session,
+                                  const ConversionOptions &options);
+    static ConversionOptions loadConversionOptions();
+    bool openArchive(Archive &archive, const polar::v2::TrainingSession::OutputFormat format,
+                     const ConversionOptions &options);
+    void scheduleSessions(const SchedulingPolicy policy);
+    static FolderScan scanFolder(const QString &folder);
+    static int sessionBaseNameLength(const QString &fileName);
+    void readSessions(const ConversionOptions &options, OutputFileIndex &outputFiles,
+                      SessionQueue &parseQueue, SessionQueue &writeQueue);
+    void parseSessions(const ConversionOptions &options,
+                       SessionQueue &parseQueue, SessionQueue &writeQueue);
+    void writeSessions(OutputFileIndex &outputFiles, SessionQueue &writeQueue,
+                       Archive &gpxArchive, Archive &tcxArchive);
+    static void writeArchive(Archive &archive, const int order,
+                             const QString &name, const QByteArray &fragment);
     virtual void run();
-    virtual void setTrainingSessionOptions(polar::v2::TrainingSession * const session);
+    virtual void setTrainingSessionOptions(polar::v2::TrainingSession * const session,
+                                           const ConversionOptions &options);
 
 signals:
     void progress(const int index);
@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "outputfileindex.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+OutputFileIndex::OutputFileIndex(const bool statFiles, const Qt::CaseSensitivity caseSensitivity)
+    : statFiles(statFiles), caseSensitivity(caseSensitivity)
+{
+
+}
+
+/// Returns \c true if \a fileName exists, or has been inserted into this index.
+bool OutputFileIndex::exists(const QString &fileName)
+{
+    if (statFiles) {
+        return QFile::exists(fileName);
+    }
+
+    QString name;
+    const QString directory = directoryKey(fileName, &name);
+    QMutexLocker locker(&mutex);
+    return listDirectory(directory).contains(name);
+}
+
+/// Records that \a fileName has been written.
+void OutputFileIndex::insert(const QString &fileName)
+{
+    if (statFiles) {
+        return;
+    }
+
+    QString name;
+    const QString directory = directoryKey(fileName, &name);
+    QMutexLocker locker(&mutex);
+    listDirectory(directory).insert(name);
+}
+
+/// Returns the usual case sensitivity of file names on this platform's filesystems.
+Qt::CaseSensitivity OutputFileIndex::filesystemCaseSensitivity()
+{
+#if defined(Q_OS_WIN) || defined(Q_OS_MAC)
+    return Qt::CaseInsensitive;
+#else
+    return Qt::CaseSensitive;
+#endif
+}
+
+// Splits fileName into its (absolute, clean) directory and its file name,
+// without touching the filesystem.
+QString OutputFileIndex::directoryKey(const QString &fileName, QString * const name) const
+{
+    const QFileInfo fileInfo(fileName);
+    *name = nameKey(fileInfo.fileName());
+    return QDir::cleanPath(fileInfo.absolutePath());
+}
+
+// Note, the caller must hold the mutex.
+QSet<QString> &OutputFileIndex::listDirectory(const QString &directory)
+{
+    const QString key = nameKey(directory);
+    QHash<QString, QSet<QString> >::iterator iter = directories.find(key);
+    if (iter == directories.end()) {
+        iter = directories.insert(key, QSet<QString>());
+        QDirIterator dirIter(directory, QDir::Files|QDir::Hidden);
+        while (dirIter.hasNext()) {
+            dirIter.next();
+            iter.value().insert(nameKey(dirIter.fileName()));
+        }
+    }
+    return iter.value();
+}
+
+// Returns name as indexed: case-folded if lookups are case-insensitive.
+QString OutputFileIndex::nameKey(const QString &name) const
+{
+    return (caseSensitivity == Qt::CaseInsensitive) ? name.toCaseFolded() : name;
+}
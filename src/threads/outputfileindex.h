@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef __OUTPUT_FILE_INDEX__
+#define __OUTPUT_FILE_INDEX__
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+
+/**
+ * @brief A thread-safe index of existing output files.
+ *
+ * Rather than stat'ing every candidate output file (which is slow on network
+ * mounts), each output directory is listed just once, on first use, and all
+ * subsequent existence checks are in-memory lookups. Files written during the
+ * run should be added via insert, to keep the index current.
+ *
+ * For directories that other writers may also be modifying, the index can be
+ * constructed to fallback to per-file stats instead.
+ *
+ * Lookups are case-insensitive where the filesystem usually is too (Windows and
+ * macOS), so that, for example, an existing "Session.GPX" is found for a
+ * candidate "Session.gpx", just as a per-file stat would find it.
+ */
+class OutputFileIndex {
+
+public:
+    explicit OutputFileIndex(const bool statFiles = false,
+        const Qt::CaseSensitivity caseSensitivity = filesystemCaseSensitivity());
+
+    bool exists(const QString &fileName);
+    void insert(const QString &fileName);
+
+    static Qt::CaseSensitivity filesystemCaseSensitivity();
+
+protected:
+    const bool statFiles;
+    const Qt::CaseSensitivity caseSensitivity;
+    QMutex mutex;
+    QHash<QString, QSet<QString> > directories; ///< File names, keyed by directory.
+
+    QString directoryKey(const QString &fileName, QString * const name) const;
+    QSet<QString> &listDirectory(const QString &directory);
+    QString nameKey(const QString &name) const;
+
+};
+
+#endif // __OUTPUT_FILE_INDEX__
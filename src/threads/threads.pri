@@ -3,5 +3,5 @@
 
 INCLUDEPATH += $$PWD
 VPATH += $$PWD
-HEADERS += converterthread.h
-SOURCES += converterthread.cpp
+HEADERS += boundedqueue.h converterthread.h   outputfileindex.h
+SOURCES +=                converterthread.cpp outputfileindex.cpp
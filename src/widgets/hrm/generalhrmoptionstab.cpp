@@ -8,8 +8,14 @@
 #include <QVBoxLayout>
 
 const QString GeneralHrmOptions::ExportRrFilesSettingsKey = QLatin1String("rrFiles");
+const QString GeneralHrmOptions::LapStatsSettingsKey = QLatin1String("lapStatsFromSamples");
+const QString GeneralHrmOptions::HrvAnalysisSettingsKey = QLatin1String("hrvAnalysis");
+const QString GeneralHrmOptions::KilometreLapsSettingsKey = QLatin1String("kilometreLaps");
 
 const bool GeneralHrmOptions::ExportRrFilesDefaultSetting = true;
+const bool GeneralHrmOptions::LapStatsDefaultSetting = true;
+const bool GeneralHrmOptions::HrvAnalysisDefaultSetting = false;
+const bool GeneralHrmOptions::KilometreLapsDefaultSetting = false;
 
 GeneralHrmOptions::GeneralHrmOptions(QWidget *parent, Qt::WindowFlags flags)
     : QWidget(parent, flags)
@@ -18,10 +24,30 @@ GeneralHrmOptions::GeneralHrmOptions(QWidget *parent, Qt::WindowFlags flags)
     rrFiles->setToolTip(tr("Generate spearate HRM files containing R-R data"));
     rrFiles->setWhatsThis(tr("Check this box to generate matching HRM files containing "
                              "heart rate variablility data whenever exporting to HRM."));
+    lapStats = new QCheckBox(tr("Calculate missing lap statistics"));
+    lapStats->setToolTip(tr("Calculate missing lap statistics from samples"));
+    lapStats->setWhatsThis(tr("Check this box to have any lap heart rate, speed, cadence "
+                              "and temperature statistics not recorded by the device "
+                              "calculated from the exercise's samples."));
+    hrvAnalysis = new QCheckBox(tr("Include HRV analysis"));
+    hrvAnalysis->setToolTip(tr("Analyse heart rate variability from R-R data"));
+    hrvAnalysis->setWhatsThis(tr("Check this box to add an [HRV] section, with RMSSD, SDNN, "
+                                 "pNN50 and LF/HF metrics for the whole exercise and each "
+                                 "lap, to HRM files, along with a matching JSON file."));
+    kilometreLaps = new QCheckBox(tr("Split laps every kilometre"));
+    kilometreLaps->setToolTip(tr("Replace recorded laps with kilometre splits"));
+    kilometreLaps->setWhatsThis(tr("Check this box to have the exercise split into one "
+                                   "lap per kilometre, with statistics calculated from the "
+                                   "exercise's samples, instead of the laps recorded by the "
+                                   "device. Exercises without distance samples keep their "
+                                   "recorded laps."));
     load();
 
     QVBoxLayout * const vBox = new QVBoxLayout();
     vBox->addWidget(rrFiles);
+    vBox->addWidget(lapStats);
+    vBox->addWidget(hrvAnalysis);
+    vBox->addWidget(kilometreLaps);
     setLayout(vBox);
 }
 
@@ -30,6 +56,9 @@ void GeneralHrmOptions::load()
     QSettings settings;
     settings.beginGroup(QLatin1String("hrm"));
     rrFiles->setChecked(settings.value(ExportRrFilesSettingsKey, ExportRrFilesDefaultSetting).toBool());
+    lapStats->setChecked(settings.value(LapStatsSettingsKey, LapStatsDefaultSetting).toBool());
+    hrvAnalysis->setChecked(settings.value(HrvAnalysisSettingsKey, HrvAnalysisDefaultSetting).toBool());
+    kilometreLaps->setChecked(settings.value(KilometreLapsSettingsKey, KilometreLapsDefaultSetting).toBool());
 }
 
 void GeneralHrmOptions::save()
@@ -37,4 +66,7 @@ void GeneralHrmOptions::save()
     QSettings settings;
     settings.beginGroup(QLatin1String("hrm"));
     settings.setValue(ExportRrFilesSettingsKey, rrFiles->isChecked());
+    settings.setValue(LapStatsSettingsKey, lapStats->isChecked());
+    settings.setValue(HrvAnalysisSettingsKey, hrvAnalysis->isChecked());
+    settings.setValue(KilometreLapsSettingsKey, kilometreLaps->isChecked());
 }
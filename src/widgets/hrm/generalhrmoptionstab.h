@@ -13,8 +13,14 @@ class GeneralHrmOptions : public QWidget {
 
 public:
     static const QString ExportRrFilesSettingsKey;
+    static const QString HrvAnalysisSettingsKey;
+    static const QString KilometreLapsSettingsKey;
+    static const QString LapStatsSettingsKey;
 
     static const bool ExportRrFilesDefaultSetting;
+    static const bool HrvAnalysisDefaultSetting;
+    static const bool KilometreLapsDefaultSetting;
+    static const bool LapStatsDefaultSetting;
 
     GeneralHrmOptions(QWidget *parent=0, Qt::WindowFlags flags=Qt::WindowFlags());
 
@@ -24,6 +30,9 @@ public slots:
 
 protected:
     QCheckBox * rrFiles;
+    QCheckBox * lapStats;
+    QCheckBox * hrvAnalysis;
+    QCheckBox * kilometreLaps;
 
 };
 
@@ -3,6 +3,7 @@
 
 #include "outputspage.h"
 
+#include "converterthread.h"
 #include "gpx/gpxoptionsdialog.h"
 #include "hrm/hrmoptionsdialog.h"
 #include "tcx/tcxoptionsdialog.h"
@@ -74,12 +75,23 @@ OutputsPage::OutputsPage(QWidget *parent) : QWizardPage(parent)
         QCheckBox * const gpxCheckBox = new QCheckBox(tr("GPX"));
         QCheckBox * const hrmCheckBox = new QCheckBox(tr("HRM"));
         QCheckBox * const tcxCheckBox = new QCheckBox(tr("TCX"));
+        QCheckBox * const fitCheckBox = new QCheckBox(tr("FIT"));
+        QCheckBox * const csvCheckBox = new QCheckBox(tr("CSV"));
+        QCheckBox * const arrowCheckBox = new QCheckBox(tr("Arrow"));
         gpxCheckBox->setToolTip(tr("Enable GPX output"));
         hrmCheckBox->setToolTip(tr("Enable HRM output"));
         tcxCheckBox->setToolTip(tr("Enable TCX output"));
+        fitCheckBox->setToolTip(tr("Enable FIT output"));
+        csvCheckBox->setToolTip(tr("Enable CSV (per-sample) output"));
+        arrowCheckBox->setToolTip(tr("Enable Apache Arrow (per-sample) output"));
         gpxCheckBox->setWhatsThis(tr("Check this box to enable GPX output."));
         hrmCheckBox->setWhatsThis(tr("Check this box to enable HRM output."));
         tcxCheckBox->setWhatsThis(tr("Check this box to enable TCX output."));
+        fitCheckBox->setWhatsThis(tr("Check this box to enable (binary) FIT output."));
+        csvCheckBox->setWhatsThis(tr("Check this box to enable CSV output of each sample, "
+                                     "for use with spreadsheets and analytics tools."));
+        arrowCheckBox->setWhatsThis(tr("Check this box to enable (binary) Apache Arrow output "
+                                       "of each sample, for use with analytics tools."));
 
         QLabel * const advancedGpxLabel = new QLabel(QString::fromLatin1("<a href='gpx'>%1</a>").arg(tr("advanced...")));
         QLabel * const advancedHrmLabel = new QLabel(QString::fromLatin1("<a href='hrm'>%1</a>").arg(tr("advanced...")));
@@ -98,6 +110,9 @@ OutputsPage::OutputsPage(QWidget *parent) : QWizardPage(parent)
         grid->addWidget(gpxCheckBox, 0, 0);
         grid->addWidget(hrmCheckBox, 1, 0);
         grid->addWidget(tcxCheckBox, 2, 0);
+        grid->addWidget(fitCheckBox, 3, 0);
+        grid->addWidget(csvCheckBox, 4, 0);
+        grid->addWidget(arrowCheckBox, 5, 0);
         grid->addWidget(advancedGpxLabel, 0, 1);
         grid->addWidget(advancedHrmLabel, 1, 1);
         grid->addWidget(advancedTcxLabel, 2, 1);
@@ -109,16 +124,101 @@ OutputsPage::OutputsPage(QWidget *parent) : QWizardPage(parent)
         registerField(QLatin1String("gpxEnabled"), gpxCheckBox);
         registerField(QLatin1String("hrmEnabled"), hrmCheckBox);
         registerField(QLatin1String("tcxEnabled"), tcxCheckBox);
+        registerField(QLatin1String("fitEnabled"), fitCheckBox);
+        registerField(QLatin1String("csvEnabled"), csvCheckBox);
+        registerField(QLatin1String("arrowEnabled"), arrowCheckBox);
 
         connect(gpxCheckBox, SIGNAL(clicked()), this, SLOT(checkBoxClicked()));
         connect(hrmCheckBox, SIGNAL(clicked()), this, SLOT(checkBoxClicked()));
         connect(tcxCheckBox, SIGNAL(clicked()), this, SLOT(checkBoxClicked()));
+        connect(fitCheckBox, SIGNAL(clicked()), this, SLOT(checkBoxClicked()));
+        connect(csvCheckBox, SIGNAL(clicked()), this, SLOT(checkBoxClicked()));
+        connect(arrowCheckBox, SIGNAL(clicked()), this, SLOT(checkBoxClicked()));
 
         connect(advancedGpxLabel, SIGNAL(linkActivated(QString)), this, SLOT(showAdvancedOptions(QString)));
         connect(advancedHrmLabel, SIGNAL(linkActivated(QString)), this, SLOT(showAdvancedOptions(QString)));
         connect(advancedTcxLabel, SIGNAL(linkActivated(QString)), this, SLOT(showAdvancedOptions(QString)));
     }
 
+    {
+        schedulingPolicy = new QComboBox();
+        schedulingPolicy->addItem(tr("Folder order"),
+            ConverterThread::schedulingPolicyName(ConverterThread::DirectoryOrder));
+        schedulingPolicy->addItem(tr("Largest sessions first (fastest overall)"),
+            ConverterThread::schedulingPolicyName(ConverterThread::LargestFirst));
+        schedulingPolicy->addItem(tr("Smallest sessions first (first outputs sooner)"),
+            ConverterThread::schedulingPolicyName(ConverterThread::SmallestFirst));
+        schedulingPolicy->addItem(tr("Newest sessions first"),
+            ConverterThread::schedulingPolicyName(ConverterThread::NewestFirst));
+        schedulingPolicy->setWhatsThis(tr("Use this box to choose the order in which "
+                                          "training sessions are converted."));
+        form->addRow(tr("Processing Order:"), schedulingPolicy);
+    }
+
+    {
+        sampleAlignment = new QComboBox();
+        sampleAlignment->addItem(tr("By index (as recorded)"),
+            polar::v2::Timeline::alignmentName(polar::v2::Timeline::IndexAlignment));
+        sampleAlignment->addItem(tr("By time, nearest sample"),
+            polar::v2::Timeline::alignmentName(polar::v2::Timeline::NearestAlignment));
+        sampleAlignment->addItem(tr("By time, previous sample"),
+            polar::v2::Timeline::alignmentName(polar::v2::Timeline::PreviousAlignment));
+        sampleAlignment->addItem(tr("By time, interpolated"),
+            polar::v2::Timeline::alignmentName(polar::v2::Timeline::LinearAlignment));
+        sampleAlignment->setWhatsThis(tr("Use this box to choose how GPS route points "
+                                         "are matched up with heart rate (and other) "
+                                         "samples."));
+        form->addRow(tr("Sample Alignment:"), sampleAlignment);
+
+        QCheckBox * const calibrationCheckBox = new QCheckBox(tr("Apply sample calibrations"));
+        calibrationCheckBox->setToolTip(tr("Re-apply recorded altitude, stride and power calibrations"));
+        calibrationCheckBox->setWhatsThis(tr("Check this box to apply the altitude, stride length "
+                                             "and pedal power calibrations recorded with each "
+                                             "exercise to its samples. Polar devices normally "
+                                             "record samples already calibrated, so leave this "
+                                             "box unchecked unless your device does not."));
+        form->addRow(QString(), calibrationCheckBox);
+        registerField(QLatin1String("sampleCalibration"), calibrationCheckBox);
+    }
+
+    {
+        QCheckBox * const statCheckBox = new QCheckBox(tr("Shared output folder"));
+        statCheckBox->setToolTip(tr("Check for existing output files one at a time"));
+        statCheckBox->setWhatsThis(tr("Check this box if other programs may be writing to "
+                                      "the output folder at the same time. Existing output "
+                                      "files will then be checked for individually, instead "
+                                      "of listing each output folder once."));
+        form->addRow(QString(), statCheckBox);
+        registerField(QLatin1String("statOutputFiles"), statCheckBox);
+
+        QCheckBox * const cacheCheckBox = new QCheckBox(tr("Cache parsed sessions"));
+        cacheCheckBox->setToolTip(tr("Speed up repeated conversions of the same sessions"));
+        cacheCheckBox->setWhatsThis(tr("Check this box to keep a cache of parsed training "
+                                       "sessions, so that converting the same sessions again "
+                                       "(such as with different output options) is faster."));
+        form->addRow(QString(), cacheCheckBox);
+        registerField(QLatin1String("cacheSessions"), cacheCheckBox);
+
+        QCheckBox * const archiveCheckBox = new QCheckBox(tr("Archive GPX and TCX outputs"));
+        archiveCheckBox->setToolTip(tr("Write all sessions to a single GPX and/or TCX file"));
+        archiveCheckBox->setWhatsThis(tr("Check this box to write all training sessions to "
+                                         "a single GPX and/or TCX archive file (for bulk "
+                                         "imports), instead of one file per session. Each "
+                                         "archive is accompanied by an index of the sessions "
+                                         "it contains."));
+        form->addRow(QString(), archiveCheckBox);
+        registerField(QLatin1String("archiveEnabled"), archiveCheckBox);
+
+        QCheckBox * const gzipCheckBox = new QCheckBox(tr("Compress GPX, HRM and TCX outputs"));
+        gzipCheckBox->setToolTip(tr("Write gzip-compressed .gpx.gz, .hrm.gz and .tcx.gz files"));
+        gzipCheckBox->setWhatsThis(tr("Check this box to gzip-compress GPX, HRM and TCX output "
+                                      "files as they are written. This greatly reduces the size "
+                                      "of the output files, which is especially useful for "
+                                      "output folders on network storage."));
+        form->addRow(QString(), gzipCheckBox);
+        registerField(QLatin1String("gzipEnabled"), gzipCheckBox);
+    }
+
     setLayout(form);
 }
 
@@ -146,6 +246,23 @@ void OutputsPage::initializePage()
     setField(QLatin1String("gpxEnabled"), settings.value(QLatin1String("gpxEnabled"), true));
     setField(QLatin1String("hrmEnabled"), settings.value(QLatin1String("hrmEnabled"), true));
     setField(QLatin1String("tcxEnabled"), settings.value(QLatin1String("tcxEnabled"), true));
+    setField(QLatin1String("fitEnabled"), settings.value(QLatin1String("fitEnabled"), false));
+    setField(QLatin1String("csvEnabled"), settings.value(QLatin1String("csvEnabled"), false));
+    setField(QLatin1String("arrowEnabled"), settings.value(QLatin1String("arrowEnabled"), false));
+
+    setField(QLatin1String("statOutputFiles"), settings.value(QLatin1String("statOutputFiles"), false));
+    setField(QLatin1String("cacheSessions"), settings.value(QLatin1String("cacheSessions"), false));
+    setField(QLatin1String("archiveEnabled"), settings.value(QLatin1String("archiveEnabled"), false));
+    setField(QLatin1String("gzipEnabled"), settings.value(QLatin1String("gzipEnabled"), false));
+    setField(QLatin1String("sampleCalibration"), settings.value(QLatin1String("sampleCalibration"), false));
+
+    const int schedulingPolicyIndex = schedulingPolicy->findData(
+        settings.value(QLatin1String("schedulingPolicy")).toString());
+    schedulingPolicy->setCurrentIndex(qMax(schedulingPolicyIndex, 0));
+
+    const int sampleAlignmentIndex = sampleAlignment->findData(
+        settings.value(QLatin1String("sampleAlignment")).toString());
+    sampleAlignment->setCurrentIndex(qMax(sampleAlignmentIndex, 0));
 }
 
 bool OutputsPage::isComplete() const
@@ -163,7 +280,10 @@ bool OutputsPage::isComplete() const
     // Return true, as long as at least one ouput format is enabled.
     return ((field(QLatin1String("gpxEnabled")).toBool()) ||
             (field(QLatin1String("hrmEnabled")).toBool()) ||
-            (field(QLatin1String("tcxEnabled")).toBool()));
+            (field(QLatin1String("tcxEnabled")).toBool()) ||
+            (field(QLatin1String("fitEnabled")).toBool()) ||
+            (field(QLatin1String("csvEnabled")).toBool()) ||
+            (field(QLatin1String("arrowEnabled")).toBool()));
 }
 
 bool OutputsPage::validatePage()
@@ -176,6 +296,18 @@ bool OutputsPage::validatePage()
     settings.setValue(QLatin1String("gpxEnabled"), field(QLatin1String("gpxEnabled")));
     settings.setValue(QLatin1String("hrmEnabled"), field(QLatin1String("hrmEnabled")));
     settings.setValue(QLatin1String("tcxEnabled"), field(QLatin1String("tcxEnabled")));
+    settings.setValue(QLatin1String("fitEnabled"), field(QLatin1String("fitEnabled")));
+    settings.setValue(QLatin1String("csvEnabled"), field(QLatin1String("csvEnabled")));
+    settings.setValue(QLatin1String("arrowEnabled"), field(QLatin1String("arrowEnabled")));
+    settings.setValue(QLatin1String("statOutputFiles"), field(QLatin1String("statOutputFiles")));
+    settings.setValue(QLatin1String("cacheSessions"), field(QLatin1String("cacheSessions")));
+    settings.setValue(QLatin1String("archiveEnabled"), field(QLatin1String("archiveEnabled")));
+    settings.setValue(QLatin1String("gzipEnabled"), field(QLatin1String("gzipEnabled")));
+    settings.setValue(QLatin1String("sampleCalibration"), field(QLatin1String("sampleCalibration")));
+    settings.setValue(QLatin1String("schedulingPolicy"),
+                      schedulingPolicy->itemData(schedulingPolicy->currentIndex()));
+    settings.setValue(QLatin1String("sampleAlignment"),
+                      sampleAlignment->itemData(sampleAlignment->currentIndex()));
     return true;
 }
 
@@ -18,6 +18,8 @@ public:
 
 protected:
     QComboBox * outputFolder;
+    QComboBox * sampleAlignment;
+    QComboBox * schedulingPolicy;
 
 protected slots:
     void browseForFolder();
@@ -8,8 +8,12 @@
 #include <QVBoxLayout>
 
 const QString GeneralTcxOptions::UtcOnlySettingsKey = QLatin1String("garminActivityExt");
+const QString GeneralTcxOptions::LapStatsSettingsKey = QLatin1String("lapStatsFromSamples");
+const QString GeneralTcxOptions::KilometreLapsSettingsKey = QLatin1String("kilometreLaps");
 
 const bool GeneralTcxOptions::UtcOnlyDefaultSetting = true;
+const bool GeneralTcxOptions::LapStatsDefaultSetting = true;
+const bool GeneralTcxOptions::KilometreLapsDefaultSetting = false;
 
 GeneralTcxOptions::GeneralTcxOptions(QWidget *parent, Qt::WindowFlags flags)
     : QWidget(parent, flags)
@@ -17,10 +21,24 @@ GeneralTcxOptions::GeneralTcxOptions(QWidget *parent, Qt::WindowFlags flags)
     utcOnly = new QCheckBox(tr("Convert timestamps to UTC"));
     utcOnly->setToolTip(tr("Convert all local timestamps to UTC"));
     utcOnly->setWhatsThis(tr("Check this box to have all TCX timestamps converted to UTC."));
+    lapStats = new QCheckBox(tr("Calculate missing lap statistics"));
+    lapStats->setToolTip(tr("Calculate missing lap statistics from samples"));
+    lapStats->setWhatsThis(tr("Check this box to have any lap heart rate, speed and cadence "
+                              "statistics not recorded by the device calculated from the "
+                              "exercise's samples."));
+    kilometreLaps = new QCheckBox(tr("Split laps every kilometre"));
+    kilometreLaps->setToolTip(tr("Replace recorded laps with kilometre splits"));
+    kilometreLaps->setWhatsThis(tr("Check this box to have the exercise split into one "
+                                   "lap per kilometre, with statistics calculated from the "
+                                   "exercise's samples, instead of the laps recorded by the "
+                                   "device. Exercises without distance samples keep their "
+                                   "recorded laps."));
     load();
 
     QVBoxLayout * const vBox = new QVBoxLayout();
     vBox->addWidget(utcOnly);
+    vBox->addWidget(lapStats);
+    vBox->addWidget(kilometreLaps);
     setLayout(vBox);
 }
 
@@ -29,6 +47,8 @@ void GeneralTcxOptions::load()
     QSettings settings;
     settings.beginGroup(QLatin1String("tcx"));
     utcOnly->setChecked(settings.value(UtcOnlySettingsKey, UtcOnlyDefaultSetting).toBool());
+    lapStats->setChecked(settings.value(LapStatsSettingsKey, LapStatsDefaultSetting).toBool());
+    kilometreLaps->setChecked(settings.value(KilometreLapsSettingsKey, KilometreLapsDefaultSetting).toBool());
 }
 
 void GeneralTcxOptions::save()
@@ -36,4 +56,6 @@ void GeneralTcxOptions::save()
     QSettings settings;
     settings.beginGroup(QLatin1String("tcx"));
     settings.setValue(UtcOnlySettingsKey, utcOnly->isChecked());
+    settings.setValue(LapStatsSettingsKey, lapStats->isChecked());
+    settings.setValue(KilometreLapsSettingsKey, kilometreLaps->isChecked());
 }
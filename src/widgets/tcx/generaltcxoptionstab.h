@@ -13,8 +13,12 @@ class GeneralTcxOptions : public QWidget {
 
 public:
     static const QString UtcOnlySettingsKey;
+    static const QString LapStatsSettingsKey;
+    static const QString KilometreLapsSettingsKey;
 
     static const bool UtcOnlyDefaultSetting;
+    static const bool LapStatsDefaultSetting;
+    static const bool KilometreLapsDefaultSetting;
 
     GeneralTcxOptions(QWidget *parent=0, Qt::WindowFlags flags=Qt::WindowFlags());
 
@@ -24,6 +28,8 @@ public slots:
 
 protected:
     QCheckBox * utcOnly;
+    QCheckBox * lapStats;
+    QCheckBox * kilometreLaps;
 
 };
 
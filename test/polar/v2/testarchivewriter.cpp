@@ -0,0 +1,164 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testarchivewriter.h"
+
+#include "../../src/polar/v2/archivewriter.h"
+
+#include <QBuffer>
+#include <QDomDocument>
+#include <QFile>
+#include <QScopedPointer>
+#include <QTest>
+#include <QXmlSchema>
+#include <QXmlSchemaValidator>
+
+using polar::v2::ArchiveWriter;
+using polar::v2::TrainingSession;
+
+namespace {
+
+ArchiveWriter * createWriter(const ArchiveWriter::Format format, QIODevice &device,
+                             QIODevice * const indexDevice = NULL,
+                             const polar::v2::Timeline::Alignment alignment
+                                 = polar::v2::Timeline::IndexAlignment)
+{
+    return (format == ArchiveWriter::GpxArchive)
+        ? new ArchiveWriter(device, TrainingSession::GpxOptions(), indexDevice, alignment)
+        : new ArchiveWriter(device, TrainingSession::TcxOptions(), indexDevice, alignment);
+}
+
+bool validate(const ArchiveWriter::Format format, const QByteArray &data)
+{
+    QDomDocument doc;
+    if (!doc.setContent(data)) {
+        return false;
+    }
+    doc.documentElement().removeAttribute(QLatin1String("xsi:schemaLocation"));
+    QFile xsd(QFINDTESTDATA((format == ArchiveWriter::GpxArchive)
+        ? "schemata/gpx.xsd" : "schemata/TrainingCenterDatabasev2.xsd"));
+    if (!xsd.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QXmlSchema schema;
+    schema.load(&xsd, QUrl::fromLocalFile(xsd.fileName()));
+    QXmlSchemaValidator validator(schema);
+    return validator.validate(doc.toByteArray());
+}
+
+}
+
+void TestArchiveWriter::alignment_data()
+{
+    close_data();
+}
+
+void TestArchiveWriter::alignment()
+{
+    QFETCH(int, format);
+
+    QString baseName = QFINDTESTDATA("testdata/training-sessions-19401412.gpx");
+    QVERIFY2(!baseName.isEmpty(), "failed to find testdata");
+    baseName.chop(4);
+    TrainingSession session(baseName);
+    QVERIFY(session.parse());
+
+    // Sessions must be written with the archive's sample alignment.
+    const polar::v2::Timeline::Alignment alignment = polar::v2::Timeline::LinearAlignment;
+    QBuffer archive;
+    archive.open(QIODevice::WriteOnly);
+    QScopedPointer<ArchiveWriter> writer(createWriter(
+        static_cast<ArchiveWriter::Format>(format), archive, NULL, alignment));
+    QVERIFY(writer->write(session.snapshot()));
+    QVERIFY(writer->close());
+    const QByteArray expected = ArchiveWriter::toFragment((format == ArchiveWriter::GpxArchive)
+        ? TrainingSession::toGPX(session.snapshot(), TrainingSession::GpxOptions(),
+                                 QDateTime::currentDateTimeUtc(), alignment)
+        : TrainingSession::toTCX(session.snapshot(), TrainingSession::TcxOptions(),
+                                 QString(), alignment),
+        static_cast<ArchiveWriter::Format>(format));
+    QVERIFY(!expected.isEmpty());
+    QVERIFY(archive.data().contains(expected));
+}
+
+void TestArchiveWriter::close_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::newRow("gpx") << static_cast<int>(ArchiveWriter::GpxArchive);
+    QTest::newRow("tcx") << static_cast<int>(ArchiveWriter::TcxArchive);
+}
+
+void TestArchiveWriter::close()
+{
+    QFETCH(int, format);
+
+    // An archive with no sessions must still be a valid document.
+    QBuffer archive, index;
+    archive.open(QIODevice::WriteOnly);
+    index.open(QIODevice::WriteOnly);
+    QScopedPointer<ArchiveWriter> writer(createWriter(
+        static_cast<ArchiveWriter::Format>(format), archive, &index));
+    QVERIFY(writer->close());
+    QVERIFY(validate(static_cast<ArchiveWriter::Format>(format), archive.data()));
+    QVERIFY(index.data().isEmpty());
+
+    // Nothing more may be written once closed.
+    const QByteArray data = archive.data();
+    QVERIFY(!writer->close());
+    QVERIFY(!writer->write(QLatin1String("name"), QByteArray("<trk/>")));
+    QCOMPARE(archive.data(), data);
+}
+
+void TestArchiveWriter::write_data()
+{
+    close_data();
+}
+
+void TestArchiveWriter::write()
+{
+    QFETCH(int, format);
+
+    QBuffer archive, index;
+    archive.open(QIODevice::WriteOnly);
+    index.open(QIODevice::WriteOnly);
+    QScopedPointer<ArchiveWriter> writer(createWriter(
+        static_cast<ArchiveWriter::Format>(format), archive, &index));
+
+    // Write two sessions, each of which has one track, and one activity.
+    QStringList names;
+    names << QLatin1String("training-sessions-19401412")
+          << QLatin1String("training-sessions-22165267");
+    foreach (const QString &name, names) {
+        QString baseName = QFINDTESTDATA(QString::fromLatin1("testdata/%1.gpx").arg(name));
+        QVERIFY2(!baseName.isEmpty(), "failed to find testdata");
+        baseName.chop(4);
+        TrainingSession session(baseName);
+        QVERIFY(session.parse());
+        QVERIFY(writer->write(session.snapshot()));
+    }
+    QVERIFY(writer->close());
+    QVERIFY(validate(static_cast<ArchiveWriter::Format>(format), archive.data()));
+
+    // Each session must be indexed, in order, by its elements' byte range.
+    const QByteArray element = (format == ArchiveWriter::GpxArchive) ? "trk" : "Activity";
+    const QList<QByteArray> entries = index.data().split('\n');
+    QCOMPARE(entries.size(), names.size() + 1); // Plus an empty string after the last newline.
+    QVERIFY(entries.last().isEmpty());
+    qint64 previousEnd = 0;
+    for (int entryIndex = 0; entryIndex < names.size(); ++entryIndex) {
+        const QList<QByteArray> fields = entries.at(entryIndex).split('\t');
+        QCOMPARE(fields.size(), 3);
+        const qint64 offset = fields.at(0).toLongLong();
+        const qint64 length = fields.at(1).toLongLong();
+        QCOMPARE(QString::fromUtf8(fields.at(2)), names.at(entryIndex));
+        QVERIFY(offset >= previousEnd);
+        QVERIFY(offset + length < archive.data().size());
+        const QByteArray fragment = archive.data().mid(offset, length);
+        QVERIFY(fragment.startsWith('<' + element));
+        QVERIFY(fragment.endsWith("</" + element + ">\n"));
+        QCOMPARE(fragment.count('<' + element + ' ') + fragment.count('<' + element + '>'), 1);
+        QDomDocument doc;
+        QVERIFY(doc.setContent(fragment));
+        previousEnd = offset + length;
+    }
+}
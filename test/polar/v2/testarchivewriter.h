@@ -0,0 +1,19 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QObject>
+
+class TestArchiveWriter : public QObject {
+    Q_OBJECT
+
+private slots:
+    void alignment_data();
+    void alignment();
+
+    void close_data();
+    void close();
+
+    void write_data();
+    void write();
+
+};
@@ -0,0 +1,137 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testarrowwriter.h"
+
+#include "../../src/polar/v2/arrowwriter.h"
+
+#include <QBuffer>
+#include <QFile>
+#include <QTest>
+
+using polar::v2::ArrowWriter;
+using polar::v2::SampleTable;
+
+namespace {
+
+// Builds a table of \a rows rows; the first exercise has a mix of null and valid
+// values, while the second has entirely null "time" and "altitude" columns.
+SampleTable createTable(const qint64 exercise, const int rows)
+{
+    SampleTable::Column exerciseColumn(QLatin1String("exercise"), SampleTable::Int32);
+    SampleTable::Column time(QLatin1String("time"), SampleTable::TimestampMSecs);
+    SampleTable::Column heartrate(QLatin1String("heartrate"), SampleTable::Int32);
+    SampleTable::Column altitude(QLatin1String("altitude"), SampleTable::Float32);
+    SampleTable::Column latitude(QLatin1String("latitude"), SampleTable::Float64);
+    for (int row = 0; row < rows; ++row) {
+        exerciseColumn.append(exercise);
+        if (exercise == 0) {
+            time.append(Q_INT64_C(1405600000000) + (row * 1000));
+            if ((row % 3) == 0) {
+                heartrate.appendNull();
+            } else {
+                heartrate.append(static_cast<qint64>(100 + row));
+            }
+            altitude.append(12.5 + row);
+            if (row > 8) {
+                latitude.appendNull();
+            } else {
+                latitude.append(-33.8688 + (row * 0.001));
+            }
+        } else {
+            time.appendNull();
+            heartrate.append(Q_INT64_C(60));
+            altitude.appendNull();
+            latitude.append(1.5);
+        }
+    }
+
+    SampleTable table;
+    table.addColumn(exerciseColumn);
+    table.addColumn(time);
+    table.addColumn(heartrate);
+    table.addColumn(altitude);
+    table.addColumn(latitude);
+    return table;
+}
+
+}
+
+void TestArrowWriter::close()
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    ArrowWriter writer(buffer);
+    QVERIFY(!writer.close()); // No schema, so nothing to close.
+    QVERIFY(buffer.data().isEmpty());
+
+    QVERIFY(writer.write(createTable(0, 1)));
+    QVERIFY(writer.close());
+    const QByteArray data = buffer.data();
+    QVERIFY(data.startsWith(QByteArray("ARROW1\0\0", 8)));
+    QVERIFY(data.endsWith("ARROW1"));
+
+    // Nothing more may be written once closed.
+    QVERIFY(!writer.write(createTable(0, 1)));
+    QVERIFY(!writer.close());
+    QCOMPARE(buffer.data(), data);
+}
+
+void TestArrowWriter::toCsv()
+{
+    const SampleTable first = createTable(0, 11);
+    QCOMPARE(first.rowCount(), 11);
+    QCOMPARE(first.toCsvHeader(), QByteArray("exercise,time,heartrate,altitude,latitude\n"));
+    const QList<QByteArray> rows = first.toCsv().split('\n');
+    QCOMPARE(rows.size(), 12); // Including the empty string after the final newline.
+    QCOMPARE(rows.at(0),  QByteArray("0,2014-07-17T12:26:40.000Z,,12.5,-33.8688"));
+    QCOMPARE(rows.at(1),  QByteArray("0,2014-07-17T12:26:41.000Z,101,13.5,-33.867800000000003"));
+    QCOMPARE(rows.at(10), QByteArray("0,2014-07-17T12:26:50.000Z,110,22.5,"));
+    QVERIFY(rows.at(11).isEmpty());
+
+    const SampleTable second = createTable(1, 3);
+    QCOMPARE(second.columns().at(1).nullCount(), 3);
+    QCOMPARE(second.toCsv(), QByteArray("1,,60,,1.5\n1,,60,,1.5\n1,,60,,1.5\n"));
+}
+
+void TestArrowWriter::write()
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    ArrowWriter writer(buffer);
+    QVERIFY(writer.write(createTable(0, 11)));
+    QVERIFY(writer.write(createTable(1, 3)));
+    QVERIFY(writer.close());
+
+    // The expected file was verified independently with pyarrow.
+    QFile expected(QFINDTESTDATA("testdata/sample-tables.arrow"));
+    QVERIFY(expected.open(QIODevice::ReadOnly));
+    QCOMPARE(buffer.data(), expected.readAll());
+}
+
+void TestArrowWriter::writeSchemaMismatch()
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    ArrowWriter writer(buffer);
+    QVERIFY(writer.write(createTable(0, 2)));
+    const qint64 size = buffer.size();
+
+    // Different column names.
+    SampleTable renamed;
+    renamed.addColumn(SampleTable::Column(QLatin1String("exercise"), SampleTable::Int32));
+    QVERIFY(!writer.write(renamed));
+
+    // Same column names, but a different column type.
+    SampleTable retyped;
+    foreach (const SampleTable::Column &column, createTable(0, 0).columns()) {
+        retyped.addColumn(SampleTable::Column(column.name(),
+            (column.type() == SampleTable::Float32) ? SampleTable::Float64 : column.type()));
+    }
+    QVERIFY(!writer.write(retyped));
+
+    // Rejected tables must not have been written at all.
+    QCOMPARE(buffer.size(), size);
+    QVERIFY(writer.write(createTable(1, 2)));
+    QVERIFY(writer.close());
+}
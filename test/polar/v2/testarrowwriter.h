@@ -0,0 +1,18 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QObject>
+
+class TestArrowWriter : public QObject {
+    Q_OBJECT
+
+private slots:
+    void close();
+
+    void toCsv();
+
+    void write();
+
+    void writeSchemaMismatch();
+
+};
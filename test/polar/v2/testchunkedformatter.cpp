@@ -0,0 +1,75 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testchunkedformatter.h"
+
+#include "../../src/polar/v2/chunkedformatter.h"
+
+#include <QStringList>
+#include <QTest>
+#include <QVector>
+
+namespace {
+
+// Formats each index as a string, counting how many times each was formatted.
+class IndexFormatter : public polar::v2::ChunkedFormatter {
+
+public:
+    IndexFormatter(const int count, const int chunkSize)
+        : polar::v2::ChunkedFormatter(chunkSize), strings(count), counts(count, 0)
+    {
+        stringData = strings.data();
+        countData = counts.data();
+    }
+
+    QVector<QString> strings;
+    QVector<int> counts;
+
+protected:
+    virtual void formatChunk(const int begin, const int end)
+    {
+        for (int index = begin; index < end; ++index) {
+            stringData[index] = QString::number(index * 1.5, 'f', 1);
+            ++countData[index];
+        }
+    }
+
+    QString * stringData;
+    int * countData;
+
+};
+
+}
+
+void TestChunkedFormatter::format_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("chunkSize");
+
+    QTest::newRow("empty") << 0 << polar::v2::ChunkedFormatter::DefaultChunkSize;
+    QTest::newRow("one-chunk") << 1000 << polar::v2::ChunkedFormatter::DefaultChunkSize;
+    QTest::newRow("exact-chunks") << 4096 << polar::v2::ChunkedFormatter::DefaultChunkSize;
+    QTest::newRow("partial-chunk") << 86400 << polar::v2::ChunkedFormatter::DefaultChunkSize;
+    QTest::newRow("tiny-chunks") << 1001 << 1;
+    QTest::newRow("odd-chunks") << 5239 << 7;
+    QTest::newRow("invalid-chunk-size") << 10 << 0;
+}
+
+void TestChunkedFormatter::format()
+{
+    QFETCH(int, count);
+    QFETCH(int, chunkSize);
+
+    IndexFormatter formatter(count, chunkSize);
+    formatter.format(count);
+
+    // Each index must be formatted exactly once.
+    QCOMPARE(formatter.counts, QVector<int>(count, 1));
+
+    // The results must match those of sequential formatting.
+    QStringList expected;
+    for (int index = 0; index < count; ++index) {
+        expected.append(QString::number(index * 1.5, 'f', 1));
+    }
+    QCOMPARE(QStringList(formatter.strings.toList()), expected);
+}
@@ -0,0 +1,140 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testfitencoder.h"
+
+#include "../../src/polar/v2/fitencoder.h"
+
+#include <QTest>
+
+void TestFitEncoder::crc_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<quint16>("expected");
+
+    QTest::newRow("empty") << QByteArray() << quint16(0);
+    QTest::newRow("check") << QByteArray("123456789") << quint16(0xBB3D);
+    QTest::newRow("header") << QByteArray::fromHex("0e10d9070000000000002e464954")
+                            << quint16(0x1A2B);
+}
+
+void TestFitEncoder::crc()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(quint16, expected);
+
+    QCOMPARE(polar::v2::FitEncoder::crc(data), expected);
+
+    // The CRC of data followed by its (little-endian) CRC is always zero.
+    QByteArray withCrc(data);
+    withCrc.append(static_cast<char>(expected & 0xFF));
+    withCrc.append(static_cast<char>(expected >> 8));
+    QCOMPARE(polar::v2::FitEncoder::crc(withCrc), quint16(0));
+
+    // Calculating incrementally must give the same result.
+    const int split = data.size() / 2;
+    QCOMPARE(polar::v2::FitEncoder::crc(data.mid(split),
+             polar::v2::FitEncoder::crc(data.left(split))), expected);
+}
+
+void TestFitEncoder::semicircles_data()
+{
+    QTest::addColumn<double>("degrees");
+    QTest::addColumn<qint64>("expected");
+
+    QTest::newRow("zero")       <<    0.0    << Q_INT64_C(0);
+    QTest::newRow("north-pole") <<   90.0    << Q_INT64_C(1073741824);
+    QTest::newRow("south-pole") <<  -90.0    << Q_INT64_C(-1073741824);
+    QTest::newRow("date-line")  << -180.0    << Q_INT64_C(-2147483648);
+    QTest::newRow("sydney")     <<  -33.8688 << Q_INT64_C(-404070523);
+}
+
+void TestFitEncoder::semicircles()
+{
+    QFETCH(double, degrees);
+    QFETCH(qint64, expected);
+    QCOMPARE(polar::v2::FitEncoder::semicircles(degrees), expected);
+}
+
+void TestFitEncoder::timestamp_data()
+{
+    QTest::addColumn<QDateTime>("dateTime");
+    QTest::addColumn<qint64>("expected");
+
+    QTest::newRow("invalid") << QDateTime() << polar::v2::FitEncoder::Invalid;
+    QTest::newRow("epoch") << QDateTime(QDate(1989, 12, 31), QTime(0, 0), Qt::UTC) << Q_INT64_C(0);
+    QTest::newRow("utc") << QDateTime(QDate(2014, 7, 17), QTime(23, 58, 30, 250), Qt::UTC)
+                         << Q_INT64_C(774575910);
+    #if (QT_VERSION >= QT_VERSION_CHECK(5, 2, 0))
+    QTest::newRow("offset") << QDateTime(QDate(2014, 7, 18), QTime(9, 58, 30), Qt::OffsetFromUTC, 10 * 3600)
+                            << Q_INT64_C(774575910);
+    #endif
+}
+
+void TestFitEncoder::timestamp()
+{
+    QFETCH(QDateTime, dateTime);
+    QFETCH(qint64, expected);
+    QCOMPARE(polar::v2::FitEncoder::timestamp(dateTime), expected);
+}
+
+void TestFitEncoder::toByteArray()
+{
+    // An empty file is just the 14-byte header, and the 2-byte file CRC.
+    polar::v2::FitEncoder fit;
+    QCOMPARE(fit.dataSize(), 0);
+    QByteArray file = fit.toByteArray();
+    QCOMPARE(file.size(), 16);
+    QCOMPARE(file.at(0), '\x0e');
+    QCOMPARE(file.mid(4, 4), QByteArray(4, '\0'));
+    QCOMPARE(file.mid(8, 4), QByteArray(".FIT"));
+    QCOMPARE(polar::v2::FitEncoder::crc(file.left(14)), quint16(0));
+    QCOMPARE(polar::v2::FitEncoder::crc(file), quint16(0));
+
+    // The header's data size must include all messages written.
+    static const polar::v2::FitEncoder::Field fields[] = {
+        { 253, polar::v2::FitEncoder::Uint32 },
+    };
+    const qint64 values[] = { 1 };
+    fit.defineMessage(0, 20, fields);
+    QVERIFY(fit.writeMessage(0, values));
+    QCOMPARE(fit.dataSize(), 9 + 5);
+    file = fit.toByteArray();
+    QCOMPARE(file.size(), 14 + 9 + 5 + 2);
+    QCOMPARE(file.mid(4, 4), QByteArray::fromHex("0e000000"));
+    QCOMPARE(polar::v2::FitEncoder::crc(file.left(14)), quint16(0));
+    QCOMPARE(polar::v2::FitEncoder::crc(file), quint16(0));
+}
+
+void TestFitEncoder::writeMessage()
+{
+    using polar::v2::FitEncoder;
+    static const FitEncoder::Field fields[] = {
+        { 253, FitEncoder::Uint32  },
+        {   3, FitEncoder::Uint8   },
+        {   0, FitEncoder::Sint32  },
+        {  13, FitEncoder::Sint8   },
+        {   3, FitEncoder::Uint32z },
+    };
+
+    FitEncoder fit;
+    fit.defineMessage(3, 20, fields);
+    QCOMPARE(fit.toByteArray().mid(14, fit.dataSize()),
+             QByteArray::fromHex("4300001400" "05" "fd0486" "030102" "000485" "0d0101" "03048c"));
+
+    // Values are little-endian, with invalid and out-of-range values replaced
+    // by each base type's invalid value.
+    const qint64 values[] = { 0x01020304, FitEncoder::Invalid, -2, -129, 0 };
+    QVERIFY(fit.writeMessage(3, values));
+    const qint64 moreValues[] = { 0xFFFFFFFFLL, 255, -0x80000000LL, -128, 0xFFFFFFFFLL };
+    QVERIFY(fit.writeMessage(3, moreValues));
+    QCOMPARE(fit.toByteArray().mid(14 + 21, fit.dataSize() - 21),
+             QByteArray::fromHex("03" "04030201" "ff" "feffffff" "7f" "00000000"
+                                 "03" "ffffffff" "ff" "00000080" "80" "ffffffff"));
+
+    // Messages must match their definitions.
+    const qint64 tooFew[] = { 1, 2 };
+    QVERIFY(!fit.writeMessage(3, tooFew));
+    QVERIFY(!fit.writeMessage(4, values));
+    QCOMPARE(fit.dataSize(), 21 + 15 + 15);
+}
@@ -0,0 +1,23 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QObject>
+
+class TestFitEncoder : public QObject {
+    Q_OBJECT
+
+private slots:
+    void crc_data();
+    void crc();
+
+    void semicircles_data();
+    void semicircles();
+
+    void timestamp_data();
+    void timestamp();
+
+    void toByteArray();
+
+    void writeMessage();
+
+};
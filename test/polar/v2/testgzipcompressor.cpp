@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testgzipcompressor.h"
+
+#include "../../src/polar/v2/gzipcompressor.h"
+
+#include <QFile>
+#include <QTest>
+#include <QtEndian>
+
+#ifdef Q_CC_MSVC
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+namespace {
+
+QByteArray gunzip(const QByteArray &data, const int expectedSize)
+{
+    QByteArray result(expectedSize + 1, '\0'); // One spare byte, to detect overruns.
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.next_in = (Bytef *) data.data();
+    stream.avail_in = data.size();
+    stream.next_out = (Bytef *) result.data();
+    stream.avail_out = result.size();
+    if ((inflateInit2(&stream, 15 + 16) != Z_OK) || (inflate(&stream, Z_FINISH) != Z_STREAM_END)) {
+        inflateEnd(&stream);
+        return QByteArray();
+    }
+    result.chop(stream.avail_out);
+    inflateEnd(&stream);
+    return result;
+}
+
+}
+
+void TestGzipCompressor::compress_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("blockSize");
+
+    QTest::newRow("empty") << QByteArray("") << polar::v2::GzipCompressor::DefaultBlockSize;
+    QTest::newRow("tiny-blocks") << QByteArray("hello, hello, hello") << 1;
+
+    #define LOAD_TEST_DATA(name) { \
+        QFile file(QFINDTESTDATA("testdata/" name)); \
+        file.open(QIODevice::ReadOnly); \
+        const QByteArray data = file.readAll(); \
+        QTest::newRow(name) << data << polar::v2::GzipCompressor::DefaultBlockSize; \
+        QTest::newRow(name "-4k-blocks") << data << 4096; \
+        QTest::newRow(name "-odd-blocks") << data << 1001; \
+    }
+
+    LOAD_TEST_DATA("lorem-ipsum.txt");
+    LOAD_TEST_DATA("random-bytes");
+
+    #undef LOAD_TEST_DATA
+}
+
+void TestGzipCompressor::compress()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, blockSize);
+
+    const QByteArray gzip = polar::v2::GzipCompressor::compress(data, -1, blockSize);
+    QVERIFY(gzip.size() >= 18);
+    QCOMPARE(gzip.left(4), QByteArray("\x1f\x8b\x08\x00", 4));
+    QCOMPARE(gunzip(gzip, data.size()), data);
+
+    // Verify the trailer's CRC and (modulo 2^32) size.
+    const uchar * const trailer = reinterpret_cast<const uchar *>(gzip.constData() + gzip.size() - 8);
+    QCOMPARE(qFromLittleEndian<quint32>(trailer),
+             static_cast<quint32>(crc32(0L, (const Bytef *) data.constData(), data.size())));
+    QCOMPARE(qFromLittleEndian<quint32>(trailer + 4), static_cast<quint32>(data.size()));
+
+    // The output must not depend on how the blocks were scheduled.
+    QCOMPARE(polar::v2::GzipCompressor::compress(data, -1, blockSize), gzip);
+}
@@ -0,0 +1,64 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testgzipdecompressor.h"
+
+#include "../../src/polar/v2/gzipcompressor.h"
+#include "../../src/polar/v2/gzipdecompressor.h"
+
+#include <QFile>
+#include <QTest>
+
+void TestGzipDecompressor::decompress_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<QByteArray>("expected");
+
+    #define LOAD_TEST_DATA(name) { \
+        QFile dataFile(QFINDTESTDATA("testdata/" name ".gz")); \
+        dataFile.open(QIODevice::ReadOnly); \
+        QFile expectedFile(QFINDTESTDATA("testdata/" name)); \
+        expectedFile.open(QIODevice::ReadOnly); \
+        const QByteArray expected = expectedFile.readAll(); \
+        QTest::newRow(name) << dataFile.readAll() << expected; \
+        QTest::newRow(name "-blocks") \
+            << polar::v2::GzipCompressor::compress(expected, -1, 1000) << expected; \
+        QTest::newRow(name "-zlib") << qCompress(expected).mid(4) << expected; \
+    }
+
+    LOAD_TEST_DATA("lorem-ipsum.txt");
+    LOAD_TEST_DATA("random-bytes");
+
+    #undef LOAD_TEST_DATA
+
+    QTest::newRow("empty") << polar::v2::GzipCompressor::compress(QByteArray()) << QByteArray();
+}
+
+void TestGzipDecompressor::decompress()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(QByteArray, expected);
+
+    QCOMPARE(polar::v2::GzipDecompressor::decompress(data), expected);
+    QCOMPARE(polar::v2::GzipDecompressor::decompress(data, 1), expected);
+}
+
+void TestGzipDecompressor::decompressCorrupt_data()
+{
+    QTest::addColumn<int>("offset"); // From the end of the data.
+
+    QTest::newRow("crc")   << 8;
+    QTest::newRow("isize") << 4;
+    QTest::newRow("isize-high-byte") << 1;
+}
+
+void TestGzipDecompressor::decompressCorrupt()
+{
+    QFETCH(int, offset);
+
+    QFile file(QFINDTESTDATA("testdata/lorem-ipsum.txt.gz"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QByteArray data = file.readAll();
+    data[data.size() - offset] = static_cast<char>(data.at(data.size() - offset) ^ 0x01);
+    QVERIFY(polar::v2::GzipDecompressor::decompress(data).isEmpty());
+}
@@ -0,0 +1,16 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QObject>
+
+class TestGzipDecompressor : public QObject {
+    Q_OBJECT
+
+private slots:
+    void decompress_data();
+    void decompress();
+
+    void decompressCorrupt_data();
+    void decompressCorrupt();
+
+};
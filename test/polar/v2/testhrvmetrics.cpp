@@ -0,0 +1,127 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testhrvmetrics.h"
+
+#include "../../src/polar/v2/hrvmetrics.h"
+
+#include <QTest>
+#include <QVector>
+
+#include <cmath>
+
+using polar::v2::HrvMetrics;
+
+namespace {
+
+// Intervals of about 1s, modulated at frequency Hz, for the given number of seconds.
+QVector<quint32> modulatedIntervals(const double frequency, const double seconds)
+{
+    QVector<quint32> intervals;
+    for (double time = 0.0; time < seconds * 1000.0; time += intervals.last()) {
+        intervals.append(static_cast<quint32>(qRound(
+            1000.0 + 50.0 * std::sin(2.0 * 3.14159265358979323846 * frequency * time / 1000.0))));
+    }
+    return intervals;
+}
+
+}
+
+void TestHrvMetrics::empty()
+{
+    const HrvMetrics metrics;
+    QCOMPARE(metrics.count(), 0);
+    QCOMPARE(metrics.artifactCount(), 0);
+    QCOMPARE(metrics.meanHeartrate(), 0.0);
+    QCOMPARE(metrics.sdnn(), 0.0);
+    QCOMPARE(metrics.rmssd(), 0.0);
+    QCOMPARE(metrics.pnn50(), 0.0);
+    QVERIFY(!metrics.haveFrequencyDomain());
+
+    const HrvMetrics none(NULL, 0);
+    QCOMPARE(none.count(), 0);
+    QVERIFY(!none.haveFrequencyDomain());
+}
+
+void TestHrvMetrics::timeDomain()
+{
+    const quint32 intervals[] = { 800, 810, 790, 860, 800 };
+    const HrvMetrics metrics(intervals, 5);
+    QCOMPARE(metrics.count(), 5);
+    QCOMPARE(metrics.artifactCount(), 0);
+    QCOMPARE(metrics.meanInterval(), 812.0);
+    QCOMPARE(metrics.meanHeartrate(), 60000.0 / 812.0);
+    QCOMPARE(metrics.sdnn(), std::sqrt(3080.0 / 4.0));
+    QCOMPARE(metrics.rmssd(), std::sqrt(9000.0 / 4.0)); // Differences of 10, 20, 70 and 60ms.
+    QCOMPARE(metrics.pnn50(), 50.0);
+    QVERIFY(!metrics.haveFrequencyDomain()); // Far too short.
+}
+
+void TestHrvMetrics::artifacts()
+{
+    // Only the 800 to 810ms difference is between two adjacent NN intervals.
+    const quint32 intervals[] = { 800, 100, 800, 810, 3000 };
+    const HrvMetrics metrics(intervals, 5);
+    QCOMPARE(metrics.count(), 3);
+    QCOMPARE(metrics.artifactCount(), 2);
+    QCOMPARE(metrics.rmssd(), 10.0);
+    QCOMPARE(metrics.pnn50(), 0.0);
+}
+
+void TestHrvMetrics::frequencyDomain_data()
+{
+    QTest::addColumn<double>("frequency");
+    QTest::addColumn<double>("seconds");
+    QTest::addColumn<bool>("lowFrequency");
+
+    QTest::newRow("LF 5 minutes")   << 0.1  << 300.0   << true;
+    QTest::newRow("HF 5 minutes")   << 0.25 << 300.0   << false;
+    QTest::newRow("LF 90 seconds")  << 0.1  << 90.0    << true;
+    QTest::newRow("HF 8 hours")     << 0.25 << 28800.0 << false;
+}
+
+void TestHrvMetrics::frequencyDomain()
+{
+    QFETCH(double, frequency);
+    QFETCH(double, seconds);
+    QFETCH(bool, lowFrequency);
+
+    const QVector<quint32> intervals = modulatedIntervals(frequency, seconds);
+    const HrvMetrics metrics(intervals.constData(), intervals.size());
+    QVERIFY(metrics.haveFrequencyDomain());
+    if (lowFrequency) {
+        QVERIFY(metrics.lfPower() > 100.0 * metrics.hfPower());
+        QVERIFY(metrics.lfHfRatio() > 100.0);
+    } else {
+        QVERIFY(metrics.hfPower() > 100.0 * metrics.lfPower());
+        QVERIFY(metrics.lfHfRatio() < 0.01);
+    }
+
+    // The total power can be no more than the intervals' variance (of ~1250ms^2).
+    const double variance = metrics.sdnn() * metrics.sdnn();
+    QVERIFY(metrics.lfPower() + metrics.hfPower() > variance / 2.0);
+    QVERIFY(metrics.lfPower() + metrics.hfPower() < variance * 1.1);
+
+    // Shorter than 64 seconds is too short for the frequency domain.
+    const QVector<quint32> tooShort = modulatedIntervals(frequency, 60.0);
+    QVERIFY(!HrvMetrics(tooShort.constData(), tooShort.size()).haveFrequencyDomain());
+}
+
+void TestHrvMetrics::toMap()
+{
+    const quint32 intervals[] = { 1000 };
+    const QVariantMap single = HrvMetrics(intervals, 1).toMap();
+    QCOMPARE(single.value(QLatin1String("intervals")).toInt(), 1);
+    QCOMPARE(single.value(QLatin1String("mean-rr")).toDouble(), 1000.0);
+    QCOMPARE(single.value(QLatin1String("mean-heartrate")).toDouble(), 60.0);
+    QVERIFY(!single.contains(QLatin1String("rmssd"))); // No successive differences.
+    QVERIFY(!single.contains(QLatin1String("lf-power")));
+
+    const QVector<quint32> modulated = modulatedIntervals(0.1, 300.0);
+    const QVariantMap map = HrvMetrics(modulated.constData(), modulated.size()).toMap();
+    foreach (const char * const key, QList<const char *>() << "intervals" << "artifacts"
+             << "mean-rr" << "mean-heartrate" << "sdnn" << "rmssd" << "pnn50"
+             << "lf-power" << "hf-power" << "lf-hf-ratio") {
+        QVERIFY2(map.contains(QLatin1String(key)), key);
+    }
+}
@@ -0,0 +1,21 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QObject>
+
+class TestHrvMetrics : public QObject {
+    Q_OBJECT
+
+private slots:
+    void empty();
+
+    void timeDomain();
+
+    void artifacts();
+
+    void frequencyDomain_data();
+    void frequencyDomain();
+
+    void toMap();
+
+};
@@ -0,0 +1,114 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testlapaggregator.h"
+
+#include "../../src/polar/v2/lapaggregator.h"
+
+#include <QTest>
+
+void TestLapAggregator::empty()
+{
+    const polar::v2::LapAggregator aggregator;
+    QCOMPARE(aggregator.size(), 0);
+    QCOMPARE(aggregator.stats(0, 10).count, 0);
+
+    // A window of only invalid samples has no statistics either.
+    QVariantList samples;
+    samples << QVariant() << QVariantMap() << 123;
+    QBitArray offline(3);
+    offline.setBit(2);
+    const polar::v2::LapAggregator invalid(samples, offline);
+    QCOMPARE(invalid.size(), 3);
+    QCOMPARE(invalid.stats(0, 3).count, 0);
+}
+
+void TestLapAggregator::stats_data()
+{
+    QTest::addColumn<QVariantList>("samples");
+    QTest::addColumn<QBitArray>("offline");
+
+    QVariantList samples;
+    QTest::newRow("one") << (samples << 72) << QBitArray();
+
+    samples.clear();
+    for (int index = 0; index < 100; ++index) {
+        samples << ((index * 37) % 101) + 0.5;
+    }
+    QTest::newRow("hundred") << samples << QBitArray();
+
+    QBitArray offline(samples.size());
+    for (int index = 10; index < 30; ++index) {
+        offline.setBit(index);
+    }
+    QTest::newRow("hundred-offline") << samples << offline;
+
+    // Invalid samples, and an offline mask shorter than the samples.
+    samples[5] = QVariant();
+    samples[64] = QVariant();
+    offline.resize(50);
+    QTest::newRow("hundred-invalid") << samples << offline;
+}
+
+void TestLapAggregator::stats()
+{
+    QFETCH(QVariantList, samples);
+    QFETCH(QBitArray, offline);
+
+    const polar::v2::LapAggregator aggregator(samples, offline);
+    QCOMPARE(aggregator.size(), samples.size());
+
+    // Compare every window with a brute-force scan of the same samples.
+    for (int begin = 0; begin < samples.size(); ++begin) {
+        for (int end = begin + 1; end <= samples.size(); ++end) {
+            int count = 0;
+            double sum = 0.0, minimum = 0.0, maximum = 0.0;
+            for (int index = begin; index < end; ++index) {
+                if ((!samples.at(index).isValid()) ||
+                    ((index < offline.size()) && (offline.testBit(index)))) {
+                    continue;
+                }
+                const double value = samples.at(index).toDouble();
+                minimum = (count == 0) ? value : qMin(minimum, value);
+                maximum = (count == 0) ? value : qMax(maximum, value);
+                sum += value;
+                ++count;
+            }
+            const polar::v2::LapAggregator::Stats stats = aggregator.stats(begin, end);
+            QCOMPARE(stats.count, count);
+            if (count > 0) {
+                QCOMPARE(stats.average, sum / count);
+                QCOMPARE(stats.minimum, minimum);
+                QCOMPARE(stats.maximum, maximum);
+            }
+        }
+    }
+
+    // The same samples, already decoded (as by SampleChannels), aggregate the same.
+    QVector<double> values(samples.size());
+    QVector<quint8> valid(samples.size());
+    for (int index = 0; index < samples.size(); ++index) {
+        values[index] = samples.at(index).toDouble();
+        valid[index] = ((samples.at(index).isValid()) &&
+                        ((index >= offline.size()) || (!offline.testBit(index)))) ? 1 : 0;
+    }
+    const polar::v2::LapAggregator typed(values.constData(), valid.constData(), values.size());
+    QCOMPARE(typed.size(), aggregator.size());
+    for (int begin = 0; begin < samples.size(); ++begin) {
+        for (int end = begin + 1; end <= samples.size(); ++end) {
+            const polar::v2::LapAggregator::Stats expected = aggregator.stats(begin, end);
+            const polar::v2::LapAggregator::Stats stats = typed.stats(begin, end);
+            QCOMPARE(stats.count, expected.count);
+            if (expected.count > 0) {
+                QCOMPARE(stats.average, expected.average);
+                QCOMPARE(stats.minimum, expected.minimum);
+                QCOMPARE(stats.maximum, expected.maximum);
+            }
+        }
+    }
+
+    // Windows are clipped to the available samples.
+    QCOMPARE(aggregator.stats(-10, samples.size() + 10).count, aggregator.stats(0, samples.size()).count);
+    QCOMPARE(aggregator.stats(samples.size(), samples.size() + 1).count, 0);
+    QCOMPARE(aggregator.stats(1, 1).count, 0);
+}
@@ -0,0 +1,15 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QObject>
+
+class TestLapAggregator : public QObject {
+    Q_OBJECT
+
+private slots:
+    void empty();
+
+    void stats_data();
+    void stats();
+
+};
@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testoutputfileindex.h"
+
+#include "../../src/threads/outputfileindex.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+namespace {
+
+bool createFile(const QString &fileName)
+{
+    QFile file(fileName);
+    return file.open(QIODevice::WriteOnly);
+}
+
+}
+
+void TestOutputFileIndex::caseSensitivity_data()
+{
+    QTest::addColumn<int>("caseSensitivity");
+    QTest::newRow("sensitive")   << static_cast<int>(Qt::CaseSensitive);
+    QTest::newRow("insensitive") << static_cast<int>(Qt::CaseInsensitive);
+}
+
+void TestOutputFileIndex::caseSensitivity()
+{
+    QFETCH(int, caseSensitivity);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(createFile(dir.path() + QLatin1String("/Session.GPX")));
+
+    // Lookups of differently-cased names match only if case-insensitive.
+    OutputFileIndex index(false, static_cast<Qt::CaseSensitivity>(caseSensitivity));
+    QVERIFY(index.exists(dir.path() + QLatin1String("/Session.GPX")));
+    QCOMPARE(index.exists(dir.path() + QLatin1String("/session.gpx")),
+             caseSensitivity == Qt::CaseInsensitive);
+
+    // As do inserted names.
+    index.insert(dir.path() + QLatin1String("/session.tcx"));
+    QVERIFY(index.exists(dir.path() + QLatin1String("/session.tcx")));
+    QCOMPARE(index.exists(dir.path() + QLatin1String("/SESSION.TCX")),
+             caseSensitivity == Qt::CaseInsensitive);
+}
+
+void TestOutputFileIndex::exists_data()
+{
+    QTest::addColumn<bool>("statFiles");
+    QTest::newRow("index") << false;
+    QTest::newRow("stat")  << true;
+}
+
+void TestOutputFileIndex::exists()
+{
+    QFETCH(bool, statFiles);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(createFile(dir.path() + QLatin1String("/a.gpx")));
+    QVERIFY(createFile(dir.path() + QLatin1String("/.hidden.hrm")));
+
+    OutputFileIndex index(statFiles);
+    QVERIFY(index.exists(dir.path() + QLatin1String("/a.gpx")));
+    QVERIFY(index.exists(dir.path() + QLatin1String("/./a.gpx")));
+    QVERIFY(index.exists(dir.path() + QLatin1String("/.hidden.hrm")));
+    QVERIFY(!index.exists(dir.path() + QLatin1String("/b.gpx")));
+    QVERIFY(!index.exists(dir.path() + QLatin1String("/missing/a.gpx")));
+
+    // Each directory is listed only once, so only per-file stats see later changes.
+    QVERIFY(createFile(dir.path() + QLatin1String("/b.gpx")));
+    QCOMPARE(index.exists(dir.path() + QLatin1String("/b.gpx")), statFiles);
+}
+
+void TestOutputFileIndex::insert_data()
+{
+    exists_data();
+}
+
+void TestOutputFileIndex::insert()
+{
+    QFETCH(bool, statFiles);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // Inserted names are found in the index, but not by per-file stats.
+    OutputFileIndex index(statFiles);
+    QVERIFY(!index.exists(dir.path() + QLatin1String("/a.gpx")));
+    index.insert(dir.path() + QLatin1String("/a.gpx"));
+    QCOMPARE(index.exists(dir.path() + QLatin1String("/a.gpx")), !statFiles);
+    index.insert(dir.path() + QLatin1String("/missing/b.gpx"));
+    QCOMPARE(index.exists(dir.path() + QLatin1String("/missing/b.gpx")), !statFiles);
+}
@@ -0,0 +1,19 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QObject>
+
+class TestOutputFileIndex : public QObject {
+    Q_OBJECT
+
+private slots:
+    void caseSensitivity_data();
+    void caseSensitivity();
+
+    void exists_data();
+    void exists();
+
+    void insert_data();
+    void insert();
+
+};
@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testparallelmap.h"
+
+#include "../../src/polar/v2/parallelmap.h"
+
+#include <QAtomicInt>
+#include <QTest>
+#include <QVector>
+
+void TestParallelMap::map_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("chunkSize");
+
+    QTest::newRow("empty") << 0 << 16;
+    QTest::newRow("one-chunk") << 10 << 16;
+    QTest::newRow("exact-chunks") << 64 << 16;
+    QTest::newRow("partial-chunk") << 1000 << 16;
+    QTest::newRow("one-per-chunk") << 257 << 1;
+    QTest::newRow("invalid-chunk-size") << 10 << 0;
+}
+
+void TestParallelMap::map()
+{
+    QFETCH(int, count);
+    QFETCH(int, chunkSize);
+
+    QVector<int> counts(count, 0);
+    int * const countData = counts.data();
+    QAtomicInt chunks(0), misaligned(0);
+    polar::v2::ParallelMap::map(count, chunkSize, [&](const int begin, const int end) {
+        // Chunks must be whole, in-range, and aligned to the chunk size.
+        const int size = qMax(chunkSize, 1);
+        if ((begin % size != 0) || (end <= begin) || (end > count) ||
+            ((end - begin != size) && (end != count))) {
+            misaligned.ref();
+        }
+        for (int index = begin; index < end; ++index) {
+            ++countData[index];
+        }
+        chunks.ref();
+    });
+
+    // Each index must be mapped exactly once, before map returns.
+    QCOMPARE(counts, QVector<int>(count, 1));
+    QCOMPARE(misaligned.loadAcquire(), 0);
+    QCOMPARE(chunks.loadAcquire(), (count + qMax(chunkSize, 1) - 1) / qMax(chunkSize, 1));
+}
@@ -0,0 +1,13 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QObject>
+
+class TestParallelMap : public QObject {
+    Q_OBJECT
+
+private slots:
+    void map_data();
+    void map();
+
+};
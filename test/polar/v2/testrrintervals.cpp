@@ -0,0 +1,150 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testrrintervals.h"
+
+#include "../../src/polar/v2/rrintervals.h"
+#include "../../src/protobuf/lazymessage.h"
+
+#include <QTest>
+
+using polar::v2::RRIntervals;
+
+namespace {
+
+QByteArray varint(quint64 value)
+{
+    QByteArray bytes;
+    for (; value >= 0x80; value >>= 7) {
+        bytes.append(static_cast<char>((value & 0x7F) | 0x80));
+    }
+    bytes.append(static_cast<char>(value));
+    return bytes;
+}
+
+QByteArray field(const quint32 tag, const QByteArray &payload)
+{
+    return varint((tag << 3) | 2) + varint(payload.size()) + payload;
+}
+
+QList<quint32> toList(const RRIntervals &intervals)
+{
+    QList<quint32> list;
+    for (int index = 0; index < intervals.size(); ++index) {
+        list << intervals.at(index);
+    }
+    return list;
+}
+
+// Intervals of 800 and 1200ms, with an offline range (that is skipped) between them.
+QByteArray hrvBlock()
+{
+    return field(1, varint(800)) + field(2, field(1, varint(1)))
+         + varint((1 << 3) | 0) + varint(1200);
+}
+
+}
+
+void TestRRIntervals::empty()
+{
+    const RRIntervals intervals;
+    QVERIFY(intervals.isEmpty());
+    QCOMPARE(intervals.size(), 0);
+    QVERIFY(intervals.toByteArray().isEmpty());
+
+    QVERIFY(RRIntervals::fromRRSamples(QByteArray()).isEmpty());
+    QVERIFY(RRIntervals::fromSamples(QVariantMap()).isEmpty());
+}
+
+void TestRRIntervals::rrSamples_data()
+{
+    QTest::addColumn<QByteArray>("message");
+    QTest::addColumn<QList<quint32> >("expected");
+
+    QTest::newRow("packed")
+        << field(1, varint(1000) + varint(990) + varint(1010))
+        << (QList<quint32>() << 1000 << 990 << 1010);
+
+    QTest::newRow("unpacked")
+        << (varint((1 << 3) | 0) + varint(1000) + varint((1 << 3) | 0) + varint(990))
+        << (QList<quint32>() << 1000 << 990);
+
+    QTest::newRow("mixed")
+        << (field(1, varint(1000) + varint(990)) + varint((1 << 3) | 0) + varint(1010)
+          + field(1, varint(1020)))
+        << (QList<quint32>() << 1000 << 990 << 1010 << 1020);
+
+    QTest::newRow("other fields")
+        << (varint((2 << 3) | 0) + varint(5) + field(1, varint(1000))
+          + varint((3 << 3) | 5) + QByteArray(4, '\0') + field(4, varint(990)))
+        << (QList<quint32>() << 1000);
+
+    QTest::newRow("truncated packed value")
+        << field(1, varint(1000) + QByteArray(1, '\x80'))
+        << (QList<quint32>() << 1000);
+}
+
+void TestRRIntervals::rrSamples()
+{
+    QFETCH(QByteArray, message);
+    QFETCH(QList<quint32>, expected);
+
+    const RRIntervals intervals = RRIntervals::fromRRSamples(message);
+    QCOMPARE(toList(intervals), expected);
+
+    // The intervals should survive a round trip via a QVariant unchanged, and uncopied.
+    const RRIntervals restored(QVariant(intervals.toByteArray()).toByteArray());
+    QCOMPARE(toList(restored), expected);
+    QCOMPARE(restored.constData(), intervals.constData());
+}
+
+void TestRRIntervals::samples_data()
+{
+    QTest::addColumn<bool>("lazy");
+    QTest::newRow("raw") << true;
+    QTest::newRow("decoded") << false; // eg restored from the session cache.
+}
+
+void TestRRIntervals::samples()
+{
+    QFETCH(bool, lazy);
+
+    // The same names as TrainingSession::parseSamples, relative to the block.
+    ProtoBuf::Message::FieldInfoMap fieldInfo;
+    fieldInfo[QLatin1String("1")] = ProtoBuf::Message::FieldInfo(
+        QLatin1String("intervals"), ProtoBuf::Types::Uint32);
+    fieldInfo[QLatin1String("2")] = ProtoBuf::Message::FieldInfo(
+        QLatin1String("offline"), ProtoBuf::Types::EmbeddedMessage);
+    const ProtoBuf::Message parser(fieldInfo);
+
+    QVariantList blocks;
+    foreach (QByteArray block, QList<QByteArray>() << hrvBlock() << field(1, varint(900))) {
+        blocks << ((lazy) ? QVariant::fromValue(ProtoBuf::LazyMessage(
+                                block, fieldInfo, QLatin1String("/"), QString()))
+                          : QVariant(parser.parse(block)));
+    }
+    QVariantMap samples;
+    samples.insert(QLatin1String("heartrate-variability"), blocks);
+
+    const RRIntervals intervals = RRIntervals::fromSamples(samples);
+    QCOMPARE(toList(intervals), QList<quint32>() << 800 << 1200 << 900);
+}
+
+void TestRRIntervals::malformed()
+{
+    QByteArray truncated = field(1, varint(1000) + varint(990));
+    truncated.chop(1);
+
+    QTest::ignoreMessage(QtWarningMsg, "Ignoring malformed rrsamples data");
+    QVERIFY(RRIntervals::fromRRSamples(truncated).isEmpty());
+
+    // Only the malformed block is ignored.
+    QVariantMap samples;
+    samples.insert(QLatin1String("heartrate-variability"), QVariantList()
+        << QVariant::fromValue(ProtoBuf::LazyMessage(hrvBlock(), ProtoBuf::Message::FieldInfoMap(),
+                                                     QLatin1String("/"), QString()))
+        << QVariant::fromValue(ProtoBuf::LazyMessage(truncated, ProtoBuf::Message::FieldInfoMap(),
+                                                     QLatin1String("/"), QString())));
+    QTest::ignoreMessage(QtWarningMsg, "Ignoring malformed heartrate-variability block");
+    QCOMPARE(toList(RRIntervals::fromSamples(samples)), QList<quint32>() << 800 << 1200);
+}
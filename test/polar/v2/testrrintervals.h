@@ -0,0 +1,20 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QObject>
+
+class TestRRIntervals : public QObject {
+    Q_OBJECT
+
+private slots:
+    void empty();
+
+    void rrSamples_data();
+    void rrSamples();
+
+    void samples_data();
+    void samples();
+
+    void malformed();
+
+};
@@ -0,0 +1,87 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testsamplecalibration.h"
+
+#include "../../src/polar/v2/samplecalibration.h"
+
+#include <QTest>
+#include <QVariantMap>
+
+namespace {
+
+QVariantMap entry(const int startIndex, const double value, const int operation)
+{
+    QVariantMap map;
+    map.insert(QLatin1String("start-index"), QVariantList() << startIndex);
+    map.insert(QLatin1String("value"), QVariantList() << value);
+    map.insert(QLatin1String("operation"), QVariantList() << operation);
+    return map;
+}
+
+}
+
+void TestSampleCalibration::empty()
+{
+    const polar::v2::SampleCalibration calibration;
+    QVERIFY(calibration.isEmpty());
+
+    // Applying no calibration leaves the samples unchanged.
+    double values[] = { 1.0, 2.0, 3.0 };
+    calibration.apply(values, 3);
+    QCOMPARE(values[0], 1.0);
+    QCOMPARE(values[1], 2.0);
+    QCOMPARE(values[2], 3.0);
+}
+
+void TestSampleCalibration::segments()
+{
+    // Invalid entries are skipped, and the rest sorted by start index.
+    const polar::v2::SampleCalibration calibration(QVariantList()
+        << entry(10, 2.0, 1) << entry(0, 5.0, 2) << entry(5, 1.0, 3) << QVariantMap());
+    QCOMPARE(calibration.segments().size(), 2);
+    QCOMPARE(calibration.segments().at(0).startIndex, 0);
+    QCOMPARE(calibration.segments().at(0).operation, polar::v2::SampleCalibration::Sum);
+    QCOMPARE(calibration.segments().at(1).startIndex, 10);
+    QCOMPARE(calibration.segments().at(1).operation, polar::v2::SampleCalibration::Multiply);
+}
+
+void TestSampleCalibration::apply_data()
+{
+    QTest::addColumn<QVariantList>("entries");
+    QTest::addColumn<QVector<double> >("values");
+    QTest::addColumn<QVector<double> >("expected");
+
+    const QVector<double> values = QVector<double>() << 1.0 << 2.0 << 3.0 << 4.0 << 5.0;
+
+    QTest::newRow("sum")
+        << (QVariantList() << entry(0, 10.0, 2)) << values
+        << (QVector<double>() << 11.0 << 12.0 << 13.0 << 14.0 << 15.0);
+
+    QTest::newRow("multiply")
+        << (QVariantList() << entry(0, 0.5, 1)) << values
+        << (QVector<double>() << 0.5 << 1.0 << 1.5 << 2.0 << 2.5);
+
+    QTest::newRow("late-start")
+        << (QVariantList() << entry(3, -1.0, 2)) << values
+        << (QVector<double>() << 1.0 << 2.0 << 3.0 << 3.0 << 4.0);
+
+    QTest::newRow("segments")
+        << (QVariantList() << entry(2, 2.0, 1) << entry(0, 100.0, 2) << entry(4, 0.0, 2)) << values
+        << (QVector<double>() << 101.0 << 102.0 << 6.0 << 8.0 << 5.0);
+
+    QTest::newRow("beyond-end")
+        << (QVariantList() << entry(0, 1.0, 2) << entry(50, 10.0, 1)) << values
+        << (QVector<double>() << 2.0 << 3.0 << 4.0 << 5.0 << 6.0);
+}
+
+void TestSampleCalibration::apply()
+{
+    QFETCH(QVariantList, entries);
+    QFETCH(QVector<double>, values);
+    QFETCH(QVector<double>, expected);
+
+    const polar::v2::SampleCalibration calibration(entries);
+    calibration.apply(values.data(), values.size());
+    QCOMPARE(values, expected);
+}
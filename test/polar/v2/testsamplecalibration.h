@@ -0,0 +1,17 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QObject>
+
+class TestSampleCalibration : public QObject {
+    Q_OBJECT
+
+private slots:
+    void empty();
+
+    void segments();
+
+    void apply_data();
+    void apply();
+
+};
@@ -0,0 +1,332 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testsamplechannels.h"
+
+#include "../../src/polar/v2/samplechannels.h"
+#include "../../src/protobuf/lazymessage.h"
+
+#include <QTest>
+#include <QtEndian>
+
+#include <string.h>
+
+using polar::v2::SampleChannels;
+
+namespace {
+
+QByteArray varint(quint64 value)
+{
+    QByteArray bytes;
+    for (; value >= 0x80; value >>= 7) {
+        bytes.append(static_cast<char>((value & 0x7F) | 0x80));
+    }
+    bytes.append(static_cast<char>(value));
+    return bytes;
+}
+
+QByteArray field(const quint32 tag, const QByteArray &payload)
+{
+    return varint((tag << 3) | 2) + varint(payload.size()) + payload;
+}
+
+QByteArray floats(const QList<float> &values)
+{
+    QByteArray bytes;
+    foreach (const float value, values) {
+        uchar buffer[4];
+        quint32 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        qToLittleEndian<quint32>(bits, buffer);
+        bytes.append(reinterpret_cast<const char *>(buffer), 4);
+    }
+    return bytes;
+}
+
+// Heart rate every 500ms, with the first two samples from an offline sensor.
+QByteArray heartrateBlock()
+{
+    return varint((1 << 3) | 0) + varint(1)   // sample-type
+         + varint((2 << 3) | 0) + varint(500) // rec-interval-ms
+         + field(3, varint((1 << 3) | 0) + varint(1) + varint((2 << 3) | 0) + varint(0)
+                  + varint((3 << 3) | 0) + varint(1)) // sample-source (offline).
+         + field(4, varint(60) + varint(61) + varint(62) + varint(63) + varint(64) + varint(300));
+}
+
+// Altitude every 2s, plus an (unpacked) left pedal power sample.
+QByteArray altitudeBlock()
+{
+    return varint((2 << 3) | 0) + varint(2000)
+         + field(10, floats(QList<float>() << 10.5f << 11.5f))
+         + field(15, varint((1 << 3) | 0) + varint(quint64(-5))); // current-power = -5.
+}
+
+}
+
+void TestSampleChannels::empty()
+{
+    const SampleChannels channels;
+    QCOMPARE(channels.recordInterval(), Q_INT64_C(0));
+    QCOMPARE(channels.sampleCount(), 0);
+    double value;
+    for (int channel = 0; channel < SampleChannels::ChannelCount; ++channel) {
+        const SampleChannels::Channel type = static_cast<SampleChannels::Channel>(channel);
+        QCOMPARE(channels.size(type), 0);
+        QCOMPARE(channels.channelIndex(type, 0), -1);
+        QVERIFY(!channels.value(type, 0, value));
+        QVERIFY(!SampleChannels::channelName(type).isEmpty());
+        QVERIFY(SampleChannels::offlineName(type).endsWith(QLatin1String("-offline")));
+    }
+
+    const SampleChannels noSamples = SampleChannels(QVariantMap());
+    QCOMPARE(noSamples.sampleCount(), 0);
+}
+
+void TestSampleChannels::legacy()
+{
+    QVariantMap recordInterval, offline, power;
+    recordInterval.insert(QLatin1String("seconds"), QVariantList() << 1);
+    offline.insert(QLatin1String("start-index"), QVariantList() << 1);
+    offline.insert(QLatin1String("stop-index"), QVariantList() << 2);
+    power.insert(QLatin1String("current-power"), QVariantList() << 150);
+
+    QVariantMap samples;
+    samples.insert(QLatin1String("record-interval"), QVariantList() << recordInterval);
+    samples.insert(QLatin1String("heartrate"), QVariantList() << 100 << 101 << 102 << 103);
+    samples.insert(QLatin1String("heartrate-offline"), QVariantList() << offline);
+    samples.insert(QLatin1String("left-pedal-power"), QVariantList() << power << QVariantMap());
+    samples.insert(QLatin1String("altitude"), QVariantList() << 12.5f);
+    samples.insert(QLatin1String("stride-length"), QVariantList() << 80 << 81 << 82);
+    samples.insert(QLatin1String("stride-offline"), QVariantList() << offline); // Not "stride-length-offline".
+
+    // Legacy channels take precedence over intervalled ones.
+    samples.insert(QLatin1String("intervalled-samples"), QVariantList() << QVariant::fromValue(
+        ProtoBuf::LazyMessage(heartrateBlock(), ProtoBuf::Message::FieldInfoMap(),
+                              QLatin1String("/"), QLatin1String("29/"))));
+
+    const SampleChannels channels(samples);
+    QCOMPARE(channels.recordInterval(), Q_INT64_C(1000));
+    QCOMPARE(channels.sampleCount(), 4);
+    QCOMPARE(channels.size(SampleChannels::Heartrate), 4);
+    QCOMPARE(channels.interval(SampleChannels::Heartrate), Q_INT64_C(1000));
+    QVERIFY(!channels.isIntervalled(SampleChannels::Heartrate));
+
+    double value = 0.0;
+    QVERIFY(channels.value(SampleChannels::Heartrate, 0, value));
+    QCOMPARE(value, 100.0);
+    QVERIFY(!channels.value(SampleChannels::Heartrate, 1, value));
+    QVERIFY(!channels.value(SampleChannels::Heartrate, 2, value));
+    QVERIFY(channels.value(SampleChannels::Heartrate, 3, value));
+    QCOMPARE(value, 103.0);
+    QVERIFY(!channels.value(SampleChannels::Heartrate, 4, value));
+
+    QVERIFY(channels.value(SampleChannels::LeftPedalPower, 0, value));
+    QCOMPARE(value, 150.0);
+    QVERIFY(!channels.value(SampleChannels::LeftPedalPower, 1, value));
+    QVERIFY(channels.value(SampleChannels::Altitude, 0, value));
+    QCOMPARE(value, 12.5);
+    QCOMPARE(channels.channelIndex(SampleChannels::Altitude, 1), -1);
+
+    QVERIFY(channels.value(SampleChannels::StrideLength, 0, value));
+    QCOMPARE(value, 80.0);
+    QVERIFY(!channels.value(SampleChannels::StrideLength, 1, value));
+    QVERIFY(!channels.value(SampleChannels::StrideLength, 2, value));
+
+    // Raw values are kept for offline samples, but only the start of each
+    // legacy offline range is offline as the writers have always checked.
+    QVERIFY(channels.rawValue(SampleChannels::Heartrate, 2, value));
+    QCOMPARE(value, 102.0);
+    QVERIFY(!channels.rawValue(SampleChannels::LeftPedalPower, 1, value));
+    QVERIFY(channels.isOffline(SampleChannels::Heartrate, 2));
+    QVERIFY(channels.isLegacyOffline(SampleChannels::Heartrate, 1));
+    QVERIFY(!channels.isLegacyOffline(SampleChannels::Heartrate, 2));
+    QVERIFY(!channels.isLegacyOffline(SampleChannels::Heartrate, 3));
+}
+
+void TestSampleChannels::intervalled_data()
+{
+    QTest::addColumn<bool>("lazy");
+    QTest::newRow("raw") << true;
+    QTest::newRow("decoded") << false; // eg restored from the session cache.
+}
+
+void TestSampleChannels::intervalled()
+{
+    QFETCH(bool, lazy);
+
+    // The same names as TrainingSession::parseSamples, relative to the block.
+    ProtoBuf::Message::FieldInfoMap fieldInfo;
+    #define ADD_FIELD_INFO(tag, name, type) \
+        fieldInfo[QLatin1String(tag)] = ProtoBuf::Message::FieldInfo( \
+            QLatin1String(name), ProtoBuf::Types::type)
+    ADD_FIELD_INFO("1",    "sample-type",              Enumerator);
+    ADD_FIELD_INFO("2",    "rec-interval-ms",          Uint32);
+    ADD_FIELD_INFO("3",    "sample-source",            EmbeddedMessage);
+    ADD_FIELD_INFO("3/1",  "sample-source-type",       Enumerator);
+    ADD_FIELD_INFO("3/2",  "start-index",              Uint32);
+    ADD_FIELD_INFO("3/3",  "stop-index",               Uint32);
+    ADD_FIELD_INFO("4",    "hr-samples",               Uint32);
+    ADD_FIELD_INFO("10",   "altitude-samples",         Float);
+    ADD_FIELD_INFO("15",   "left-pedal-power-samples", EmbeddedMessage);
+    ADD_FIELD_INFO("15/1", "current-power",            Int32);
+    #undef ADD_FIELD_INFO
+    const ProtoBuf::Message parser(fieldInfo);
+
+    QVariantList blocks;
+    foreach (QByteArray block, QList<QByteArray>() << heartrateBlock() << altitudeBlock()) {
+        blocks << ((lazy) ? QVariant::fromValue(ProtoBuf::LazyMessage(
+                                block, fieldInfo, QLatin1String("/"), QString()))
+                          : QVariant(parser.parse(block)));
+    }
+    QVariantMap samples;
+    samples.insert(QLatin1String("intervalled-samples"), blocks);
+
+    // With no legacy samples, the finest intervalled channel sets the timeline.
+    const SampleChannels channels(samples);
+    QCOMPARE(channels.recordInterval(), Q_INT64_C(500));
+    QCOMPARE(channels.sampleCount(), 8); // 2 altitude samples, 2s apart.
+    QVERIFY(channels.isIntervalled(SampleChannels::Heartrate));
+    QCOMPARE(channels.size(SampleChannels::Heartrate), 6);
+    QCOMPARE(channels.interval(SampleChannels::Altitude), Q_INT64_C(2000));
+    QCOMPARE(channels.size(SampleChannels::Altitude), 2);
+
+    double value = 0.0;
+    QVERIFY(!channels.value(SampleChannels::Heartrate, 0, value));
+    QVERIFY(!channels.value(SampleChannels::Heartrate, 1, value));
+    QVERIFY(channels.value(SampleChannels::Heartrate, 2, value));
+    QCOMPARE(value, 62.0);
+    QVERIFY(channels.value(SampleChannels::Heartrate, 5, value));
+    QCOMPARE(value, 300.0);
+    QVERIFY(!channels.value(SampleChannels::Heartrate, 6, value));
+
+    QCOMPARE(channels.channelIndex(SampleChannels::Altitude, 3), 0);
+    QCOMPARE(channels.channelIndex(SampleChannels::Altitude, 4), 1);
+    QVERIFY(channels.value(SampleChannels::Altitude, 7, value));
+    QCOMPARE(value, 11.5);
+    QCOMPARE(channels.channelIndex(SampleChannels::Altitude, 8), -1);
+
+    QVERIFY(channels.value(SampleChannels::LeftPedalPower, 0, value));
+    QCOMPARE(value, -5.0);
+    QCOMPARE(channels.size(SampleChannels::RightPedalPower), 0);
+
+    // Intervalled channels have no legacy offline quirk.
+    QVERIFY(channels.isLegacyOffline(SampleChannels::Heartrate, 0));
+    QVERIFY(channels.isLegacyOffline(SampleChannels::Heartrate, 1));
+    QVERIFY(!channels.isLegacyOffline(SampleChannels::Heartrate, 2));
+}
+
+void TestSampleChannels::serialise()
+{
+    QVariantMap offline;
+    offline.insert(QLatin1String("start-index"), QVariantList() << 0);
+    offline.insert(QLatin1String("stop-index"), QVariantList() << 1);
+    QVariantMap samples;
+    samples.insert(QLatin1String("heartrate"), QVariantList() << 100 << 101 << 102);
+    samples.insert(QLatin1String("heartrate-offline"), QVariantList() << offline);
+    samples.insert(QLatin1String("intervalled-samples"), QVariantList() << QVariant::fromValue(
+        ProtoBuf::LazyMessage(altitudeBlock(), ProtoBuf::Message::FieldInfoMap(),
+                              QLatin1String("/"), QString())));
+    const SampleChannels channels(samples);
+
+    // Round-trip the channels via a QVariant, as the session cache does.
+    QByteArray bytes;
+    {
+        QDataStream stream(&bytes, QIODevice::WriteOnly);
+        stream << QVariant::fromValue(channels);
+    }
+    QVariant variant;
+    QDataStream stream(bytes);
+    stream >> variant;
+    QCOMPARE(stream.status(), QDataStream::Ok);
+    QCOMPARE(variant.userType(), qMetaTypeId<SampleChannels>());
+    const SampleChannels restored = variant.value<SampleChannels>();
+    QVERIFY(restored == channels);
+    QVERIFY(restored.isLegacyOffline(SampleChannels::Heartrate, 0));
+    QVERIFY(!restored.isLegacyOffline(SampleChannels::Heartrate, 1));
+    QCOMPARE(restored.size(SampleChannels::Altitude), 2);
+    QVERIFY(!(restored == SampleChannels()));
+}
+
+void TestSampleChannels::calibrated()
+{
+    QVariantMap sum, multiply;
+    sum.insert(QLatin1String("start-index"), QVariantList() << 0u);
+    sum.insert(QLatin1String("value"), QVariantList() << 5.0f);
+    sum.insert(QLatin1String("operation"), QVariantList() << 2); // Sum.
+    multiply.insert(QLatin1String("start-index"), QVariantList() << 1u);
+    multiply.insert(QLatin1String("value"), QVariantList() << 2.0f);
+    multiply.insert(QLatin1String("operation"), QVariantList() << 1); // Multiply.
+
+    // Legacy channels are calibrated by their top-level calibration entries.
+    QVariantMap legacy;
+    legacy.insert(QLatin1String("altitude"), QVariantList() << 10.0f << 20.0f);
+    legacy.insert(QLatin1String("altitude-calibration"), QVariantList() << sum);
+    legacy.insert(QLatin1String("stride-length"), QVariantList() << 80u << 90u);
+    legacy.insert(QLatin1String("stride-calibration"), QVariantList() << multiply);
+    legacy.insert(QLatin1String("heartrate"), QVariantList() << 100u << 101u);
+    legacy.insert(QLatin1String("heartrate-calibration"), QVariantList() << multiply); // Not a thing.
+
+    double value = 0.0;
+    const SampleChannels uncalibrated(legacy);
+    QVERIFY(uncalibrated.value(SampleChannels::Altitude, 1, value));
+    QCOMPARE(value, 20.0);
+
+    const SampleChannels channels(legacy, true);
+    QVERIFY(channels.value(SampleChannels::Altitude, 0, value));
+    QCOMPARE(value, 15.0);
+    QVERIFY(channels.value(SampleChannels::Altitude, 1, value));
+    QCOMPARE(value, 25.0);
+    QVERIFY(channels.value(SampleChannels::StrideLength, 0, value));
+    QCOMPARE(value, 80.0);
+    QVERIFY(channels.value(SampleChannels::StrideLength, 1, value));
+    QCOMPARE(value, 180.0);
+    QVERIFY(channels.value(SampleChannels::Heartrate, 1, value));
+    QCOMPARE(value, 101.0);
+
+    // Intervalled blocks are calibrated by their own entries, whether still
+    // encoded, or already decoded (eg restored from the session cache).
+    const QByteArray calibration = varint((1 << 3) | 0) + varint(1)           // start-index
+                                 + varint((2 << 3) | 5) + floats(QList<float>() << 100.0f)
+                                 + varint((3 << 3) | 0) + varint(2);          // operation: Sum
+    QVariantMap raw;
+    raw.insert(QLatin1String("intervalled-samples"), QVariantList() << QVariant::fromValue(
+        ProtoBuf::LazyMessage(altitudeBlock() + field(11, calibration),
+                              ProtoBuf::Message::FieldInfoMap(), QLatin1String("/"), QString())));
+    QVariantMap block;
+    block.insert(QLatin1String("rec-interval-ms"), QVariantList() << 2000u);
+    block.insert(QLatin1String("altitude-samples"), QVariantList() << 10.5f << 11.5f);
+    block.insert(QLatin1String("altitude-calibration"), QVariantList() << multiply);
+    QVariantMap decoded;
+    decoded.insert(QLatin1String("intervalled-samples"), QVariantList() << block);
+
+    const SampleChannels rawChannels(raw, true);
+    QVERIFY(rawChannels.value(SampleChannels::Altitude, 0, value));
+    QCOMPARE(value, 10.5);
+    QVERIFY(rawChannels.value(SampleChannels::Altitude, 1, value));
+    QCOMPARE(value, 111.5);
+    QVERIFY(rawChannels.value(SampleChannels::LeftPedalPower, 0, value));
+    QCOMPARE(value, -5.0);
+    QVERIFY(SampleChannels(raw).value(SampleChannels::Altitude, 1, value));
+    QCOMPARE(value, 11.5);
+
+    const SampleChannels decodedChannels(decoded, true);
+    QVERIFY(decodedChannels.value(SampleChannels::Altitude, 0, value));
+    QCOMPARE(value, 10.5);
+    QVERIFY(decodedChannels.value(SampleChannels::Altitude, 1, value));
+    QCOMPARE(value, 23.0);
+}
+
+void TestSampleChannels::malformed()
+{
+    QByteArray truncated = heartrateBlock();
+    truncated.chop(1);
+
+    QVariantMap samples;
+    samples.insert(QLatin1String("intervalled-samples"), QVariantList() << QVariant::fromValue(
+        ProtoBuf::LazyMessage(truncated, ProtoBuf::Message::FieldInfoMap(),
+                              QLatin1String("/"), QString())));
+    QTest::ignoreMessage(QtWarningMsg, "Ignoring malformed intervalled samples block");
+    const SampleChannels channels(samples);
+    QCOMPARE(channels.size(SampleChannels::Heartrate), 0);
+    QCOMPARE(channels.sampleCount(), 0);
+}
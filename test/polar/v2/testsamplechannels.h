@@ -0,0 +1,23 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QObject>
+
+class TestSampleChannels : public QObject {
+    Q_OBJECT
+
+private slots:
+    void empty();
+
+    void legacy();
+
+    void intervalled_data();
+    void intervalled();
+
+    void calibrated();
+
+    void malformed();
+
+    void serialise();
+
+};
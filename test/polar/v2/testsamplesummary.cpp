@@ -0,0 +1,67 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testsamplesummary.h"
+
+#include "../../src/polar/v2/samplesummary.h"
+
+#include <QTest>
+#include <QVector>
+
+void TestSampleSummary::empty()
+{
+    const polar::v2::SampleSummary summary;
+    QCOMPARE(summary.count(), 0);
+    QCOMPARE(summary.average(), 0.0);
+
+    // Invalid samples are ignored entirely.
+    const double values[] = { 1.0, 2.0, 3.0, 4.0, 5.0 };
+    const quint8 valid[] = { 0, 0, 0, 0, 0 };
+    const polar::v2::SampleSummary invalid(values, valid, 5);
+    QCOMPARE(invalid.count(), 0);
+    QCOMPARE(invalid.average(), 0.0);
+    QCOMPARE(invalid.minimum(), 0.0);
+    QCOMPARE(invalid.maximum(), 0.0);
+}
+
+void TestSampleSummary::summary_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("invalidEvery");
+
+    // Counts either side of multiples of the kernel's lane count.
+    const int counts[] = { 1, 2, 3, 4, 5, 7, 8, 9, 63, 64, 65, 1000 };
+    for (size_t index = 0; index < (sizeof(counts)/sizeof(counts[0])); ++index) {
+        QTest::newRow(qPrintable(QString::fromLatin1("%1").arg(counts[index])))
+            << counts[index] << 0;
+        QTest::newRow(qPrintable(QString::fromLatin1("%1-invalid-every-3").arg(counts[index])))
+            << counts[index] << 3;
+    }
+}
+
+void TestSampleSummary::summary()
+{
+    QFETCH(int, count);
+    QFETCH(int, invalidEvery);
+
+    QVector<double> values(count);
+    QVector<quint8> valid(count);
+    int expectedCount = 0;
+    double expectedSum = 0.0, expectedMin = 0.0, expectedMax = 0.0;
+    for (int index = 0; index < count; ++index) {
+        values[index] = ((index * 37) % 101) - 20.5; // Includes negative values.
+        valid[index] = ((invalidEvery > 0) && ((index % invalidEvery) == 1)) ? 0 : 1;
+        if (valid.at(index)) {
+            expectedMin = (expectedCount == 0) ? values.at(index) : qMin(expectedMin, values.at(index));
+            expectedMax = (expectedCount == 0) ? values.at(index) : qMax(expectedMax, values.at(index));
+            expectedSum += values.at(index);
+            ++expectedCount;
+        }
+    }
+
+    const polar::v2::SampleSummary summary(values.constData(), valid.constData(), count);
+    QCOMPARE(summary.count(), expectedCount);
+    QCOMPARE(summary.average(), expectedSum / expectedCount);
+    QCOMPARE(summary.minimum(), expectedMin);
+    QCOMPARE(summary.maximum(), expectedMax);
+}
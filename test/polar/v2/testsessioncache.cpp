@@ -0,0 +1,94 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testsessioncache.h"
+
+#include "../../src/polar/v2/sessioncache.h"
+#include "../../src/polar/v2/trainingsession.h"
+#include "../../src/protobuf/lazymessage.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+void TestSessionCache::inputIdentity()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.path() + QLatin1String("/input");
+    const QStringList fileNames(fileName);
+
+    // A missing file has a stable identity.
+    const QByteArray missing = polar::v2::SessionCache::inputIdentity(fileNames);
+    QCOMPARE(polar::v2::SessionCache::inputIdentity(fileNames), missing);
+
+    // Creating the file changes the identity.
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write("abc"), Q_INT64_C(3));
+    file.close();
+    const QByteArray created = polar::v2::SessionCache::inputIdentity(fileNames);
+    QVERIFY(created != missing);
+
+    // Changing the file's size changes the identity.
+    QVERIFY(file.open(QIODevice::Append));
+    QCOMPARE(file.write("def"), Q_INT64_C(3));
+    file.close();
+    const QByteArray changed = polar::v2::SessionCache::inputIdentity(fileNames);
+    QVERIFY(changed != created);
+
+    // Parse options are part of the identity too.
+    QVERIFY(polar::v2::SessionCache::inputIdentity(fileNames, QByteArray("calibrated")) != changed);
+    QCOMPARE(polar::v2::SessionCache::inputIdentity(fileNames, QByteArray()), changed);
+}
+
+void TestSessionCache::storeAndLoad_data()
+{
+    QTest::addColumn<QString>("baseName");
+
+    #define LOAD_TEST_DATA(name) { \
+        QFile expectedFile(QFINDTESTDATA("testdata/" name ".gpx")); \
+        QString baseName(expectedFile.fileName()); \
+        baseName.chop(4); \
+        QTest::newRow(name) << baseName; \
+    }
+
+    LOAD_TEST_DATA("training-sessions-1");
+    LOAD_TEST_DATA("training-sessions-19401412");
+    LOAD_TEST_DATA("training-sessions-1942173160");
+
+    #undef LOAD_TEST_DATA
+}
+
+void TestSessionCache::storeAndLoad()
+{
+    QFETCH(QString, baseName);
+
+    QVERIFY2(!baseName.isEmpty(), "failed to find testdata");
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const polar::v2::SessionCache cache(dir.path());
+
+    // Parse the session, and store it in the cache.
+    polar::v2::TrainingSession session(baseName);
+    QVERIFY(session.parse());
+    const QByteArray identity =
+        polar::v2::SessionCache::inputIdentity(session.inputFileNames());
+    QVERIFY(!cache.load(baseName, identity).isValid());
+    QVERIFY(cache.store(baseName, polar::v2::SessionCache::serialize(session.snapshot(), identity)));
+
+    // Load the session back, and compare to the original.
+    const polar::v2::ParsedSession cached = cache.load(baseName, identity);
+    QVERIFY(cached.isValid());
+    QCOMPARE(cached.baseName(), baseName);
+    QCOMPARE(cached.exercises(),
+             ProtoBuf::LazyMessage::expand(session.snapshot().exercises()).toMap());
+    QCOMPARE(cached.physicalInformation(),
+             ProtoBuf::LazyMessage::expand(session.snapshot().physicalInformation()).toMap());
+    QCOMPARE(cached.session(),
+             ProtoBuf::LazyMessage::expand(session.snapshot().session()).toMap());
+
+    // Entries for different inputs must not be loaded.
+    QVERIFY(!cache.load(baseName, identity + "x").isValid());
+}
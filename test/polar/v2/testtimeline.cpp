@@ -0,0 +1,128 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testtimeline.h"
+
+#include "../../src/polar/v2/timeline.h"
+
+#include <QStringList>
+#include <QTest>
+#include <QVector>
+
+Q_DECLARE_METATYPE(polar::v2::Timeline::Alignment)
+
+namespace {
+
+// Describes each point as "offset:types:routeIndex:sampleIndex:weight", where
+// types is some combination of "R" and "S", for easily-read test failures.
+QString describe(const polar::v2::Timeline &timeline)
+{
+    QStringList points;
+    foreach (const polar::v2::Timeline::Point &point, timeline.points()) {
+        points.append(QString::fromLatin1("%1:%2%3:%4:%5:%6").arg(point.offset)
+            .arg((point.types & polar::v2::Timeline::RoutePoint) ? QLatin1String("R") : QLatin1String(""))
+            .arg((point.types & polar::v2::Timeline::SamplePoint) ? QLatin1String("S") : QLatin1String(""))
+            .arg(point.routeIndex).arg(point.sampleIndex)
+            .arg(qMax(point.routeWeight, point.sampleWeight)));
+    }
+    return points.join(QLatin1Char(' '));
+}
+
+}
+
+void TestTimeline::alignmentName_data()
+{
+    QTest::addColumn<polar::v2::Timeline::Alignment>("alignment");
+    QTest::addColumn<QString>("name");
+
+    QTest::newRow("index")    << polar::v2::Timeline::IndexAlignment    << QString::fromLatin1("index");
+    QTest::newRow("nearest")  << polar::v2::Timeline::NearestAlignment  << QString::fromLatin1("nearest");
+    QTest::newRow("previous") << polar::v2::Timeline::PreviousAlignment << QString::fromLatin1("previous");
+    QTest::newRow("linear")   << polar::v2::Timeline::LinearAlignment   << QString::fromLatin1("linear");
+}
+
+void TestTimeline::alignmentName()
+{
+    QFETCH(polar::v2::Timeline::Alignment, alignment);
+    QFETCH(QString, name);
+
+    QCOMPARE(polar::v2::Timeline::alignmentName(alignment), name);
+    bool ok = false;
+    QCOMPARE(polar::v2::Timeline::alignment(name, &ok), alignment);
+    QVERIFY(ok);
+
+    // Unknown names fall back to index alignment.
+    QCOMPARE(polar::v2::Timeline::alignment(name.toUpper(), &ok),
+             polar::v2::Timeline::IndexAlignment);
+    QVERIFY(!ok);
+}
+
+void TestTimeline::points_data()
+{
+    QTest::addColumn<QVector<qint64> >("routeOffsets");
+    QTest::addColumn<int>("sampleCount");
+    QTest::addColumn<polar::v2::Timeline::Alignment>("alignment");
+    QTest::addColumn<QString>("expected");
+
+    // Route points at 0s and 2.5s, and samples every second from 0s to 3s.
+    QVector<qint64> routeOffsets;
+    routeOffsets << 0 << 2500;
+
+    QTest::newRow("index")
+        << routeOffsets << 4 << polar::v2::Timeline::IndexAlignment
+        << QString::fromLatin1("0:RS:0:0:0 1000:RS:1:1:0 2000:S:-1:2:0 3000:S:-1:3:0");
+
+    QTest::newRow("nearest")
+        << routeOffsets << 4 << polar::v2::Timeline::NearestAlignment
+        << QString::fromLatin1("0:RS:0:0:0 1000:S:0:1:0 2000:S:1:2:0 2500:R:1:2:0 3000:S:1:3:0");
+
+    QTest::newRow("previous")
+        << routeOffsets << 4 << polar::v2::Timeline::PreviousAlignment
+        << QString::fromLatin1("0:RS:0:0:0 1000:S:0:1:0 2000:S:0:2:0 2500:R:1:2:0 3000:S:1:3:0");
+
+    QTest::newRow("linear")
+        << routeOffsets << 4 << polar::v2::Timeline::LinearAlignment
+        << QString::fromLatin1("0:RS:0:0:0 1000:S:0:1:0.4 2000:S:0:2:0.8 2500:R:1:2:0.5 3000:S:-1:3:0");
+
+    // A route point before the first sample, as when GPS starts before the exercise.
+    routeOffsets.clear();
+    routeOffsets << -500 << 1000;
+
+    QTest::newRow("early-route-nearest")
+        << routeOffsets << 2 << polar::v2::Timeline::NearestAlignment
+        << QString::fromLatin1("-500:R:0:0:0 0:S:0:0:0 1000:RS:1:1:0");
+
+    QTest::newRow("early-route-previous")
+        << routeOffsets << 2 << polar::v2::Timeline::PreviousAlignment
+        << QString::fromLatin1("-500:R:0:-1:0 0:S:0:0:0 1000:RS:1:1:0");
+
+    QTest::newRow("no-route")
+        << QVector<qint64>() << 2 << polar::v2::Timeline::LinearAlignment
+        << QString::fromLatin1("0:S:-1:0:0 1000:S:-1:1:0");
+
+    QTest::newRow("no-samples")
+        << routeOffsets << 0 << polar::v2::Timeline::NearestAlignment
+        << QString::fromLatin1("-500:R:0:-1:0 1000:R:1:-1:0");
+}
+
+void TestTimeline::points()
+{
+    QFETCH(QVector<qint64>, routeOffsets);
+    QFETCH(int, sampleCount);
+    QFETCH(polar::v2::Timeline::Alignment, alignment);
+    QFETCH(QString, expected);
+
+    const polar::v2::Timeline timeline(routeOffsets, sampleCount, 1000, alignment);
+    QCOMPARE(timeline.alignment(), alignment);
+    QCOMPARE(describe(timeline), expected);
+}
+
+void TestTimeline::unsortedRoute()
+{
+    QVector<qint64> routeOffsets;
+    routeOffsets << 1000 << 0;
+    QTest::ignoreMessage(QtWarningMsg, "Route offsets are not in time order; aligning by index");
+    const polar::v2::Timeline timeline(routeOffsets, 1, 1000, polar::v2::Timeline::NearestAlignment);
+    QCOMPARE(timeline.alignment(), polar::v2::Timeline::IndexAlignment);
+    QCOMPARE(describe(timeline), QString::fromLatin1("0:RS:0:0:0 1000:R:1:-1:0"));
+}
@@ -0,0 +1,18 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QObject>
+
+class TestTimeline : public QObject {
+    Q_OBJECT
+
+private slots:
+    void alignmentName_data();
+    void alignmentName();
+
+    void points_data();
+    void points();
+
+    void unsortedRoute();
+
+};
@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testtimestampformatter.h"
+
+#include "../../src/polar/v2/timestampformatter.h"
+
+#include <QTest>
+
+void TestTimestampFormatter::format_data()
+{
+    QTest::addColumn<QDateTime>("startTime");
+
+    const QDate date(2014, 7, 17);
+    const QTime time(23, 58, 30, 250);
+
+    QTest::newRow("invalid") << QDateTime();
+    QTest::newRow("utc") << QDateTime(date, time, Qt::UTC);
+    QTest::newRow("utc-1969") << QDateTime(QDate(1969, 12, 31), time, Qt::UTC);
+    QTest::newRow("utc-leap-year") << QDateTime(QDate(2016, 2, 28), time, Qt::UTC);
+    QTest::newRow("utc-new-year") << QDateTime(QDate(2014, 12, 31), time, Qt::UTC);
+    #if (QT_VERSION >= QT_VERSION_CHECK(5, 2, 0))
+    QTest::newRow("offset-east") << QDateTime(date, time, Qt::OffsetFromUTC, 10 * 3600);
+    QTest::newRow("offset-west") << QDateTime(date, time, Qt::OffsetFromUTC, -(9 * 3600 + 30 * 60));
+    QTest::newRow("offset-to-utc") << QDateTime(date, time, Qt::OffsetFromUTC, 3600).toUTC();
+    #endif
+    QTest::newRow("local") << QDateTime(date, time, Qt::LocalTime);
+}
+
+void TestTimestampFormatter::format()
+{
+    QFETCH(QDateTime, startTime);
+
+    // Step through a few days, in a mix of sub-second, one second, and larger
+    // increments, as well as backwards, comparing against QDateTime each time.
+    polar::v2::TimestampFormatter formatter(startTime);
+    const qint64 offsets[] = { 0, 250, 500, 749, 750, 1000, 1750, 60000, 90000,
+                               -1000, -86400000, 3600000, 86400000, 172800000 };
+    for (size_t index = 0; index < (sizeof(offsets)/sizeof(offsets[0])); ++index) {
+        QCOMPARE(formatter.format(offsets[index]),
+                 startTime.addMSecs(offsets[index]).toString(Qt::ISODate));
+    }
+    for (qint64 offset = 0; offset < 2 * 86400000LL; offset += 997) {
+        QCOMPARE(formatter.format(offset), startTime.addMSecs(offset).toString(Qt::ISODate));
+    }
+}
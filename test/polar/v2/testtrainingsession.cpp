@@ -3,14 +3,21 @@
 
 #include "testtrainingsession.h"
 
+#include "../../src/polar/v2/fitencoder.h"
+#include "../../src/polar/v2/rrintervals.h"
+#include "../../src/polar/v2/sampletable.h"
 #include "../../src/polar/v2/trainingsession.h"
+#include "../../src/protobuf/lazymessage.h"
 #include "../../tools/variant.h"
 
+#include <QBuffer>
 #include <QDebug>
 #include <QDir>
 #include <QDomDocument>
 #include <QFile>
+#include <QJsonDocument>
 #include <QTest>
+#include <QtEndian>
 #include <QXmlSchema>
 #include <QXmlSchemaValidator>
 
@@ -378,6 +385,9 @@ void TestTrainingSession::getOutputFileNames_data()
         list.append(QLatin1String("test-dir/training-sessions-19946380.hrm"));
         list.append(QLatin1String("test-dir/training-sessions-19946380.rr.hrm"));
         list.append(QLatin1String("test-dir/training-sessions-19946380.tcx"));
+        list.append(QLatin1String("test-dir/training-sessions-19946380.fit"));
+        list.append(QLatin1String("test-dir/training-sessions-19946380.csv"));
+        list.append(QLatin1String("test-dir/training-sessions-19946380.arrow"));
         QTest::newRow("all")
             << QFINDTESTDATA("testdata/training-sessions-19946380-create")
             << QString()
@@ -386,12 +396,32 @@ void TestTrainingSession::getOutputFileNames_data()
             << list;
     }
 
+    {   // Compressed outputs; only GPX, HRM and TCX are compressed.
+        QStringList list;
+        list.append(QLatin1String("test-dir/training-sessions-19946380.gpx.gz"));
+        list.append(QLatin1String("test-dir/training-sessions-19946380.hrm.gz"));
+        list.append(QLatin1String("test-dir/training-sessions-19946380.rr.hrm.gz"));
+        list.append(QLatin1String("test-dir/training-sessions-19946380.tcx.gz"));
+        list.append(QLatin1String("test-dir/training-sessions-19946380.fit"));
+        list.append(QLatin1String("test-dir/training-sessions-19946380.csv"));
+        list.append(QLatin1String("test-dir/training-sessions-19946380.arrow"));
+        QTest::newRow("gzip")
+            << QFINDTESTDATA("testdata/training-sessions-19946380-create")
+            << QString()
+            << QString::fromLatin1("test-dir")
+            << TrainingSession::OutputFormats(TrainingSession::AllOutputs|TrainingSession::GzipOutputs)
+            << list;
+    }
+
     {   // Non-default output base file name.
         QStringList list;
         list.append(QLatin1String("test-dir/20140718 074856 Other outdoor.gpx"));
         list.append(QLatin1String("test-dir/20140718 074856 Other outdoor.hrm"));
         list.append(QLatin1String("test-dir/20140718 074856 Other outdoor.rr.hrm"));
         list.append(QLatin1String("test-dir/20140718 074856 Other outdoor.tcx"));
+        list.append(QLatin1String("test-dir/20140718 074856 Other outdoor.fit"));
+        list.append(QLatin1String("test-dir/20140718 074856 Other outdoor.csv"));
+        list.append(QLatin1String("test-dir/20140718 074856 Other outdoor.arrow"));
         QTest::newRow("format")
             << QFINDTESTDATA("testdata/training-sessions-19946380-create")
             << QString::fromLatin1("$date $time $sessionName")
@@ -419,6 +449,19 @@ void TestTrainingSession::getOutputFileNames()
     session.setHrmOption(polar::v2::TrainingSession::RrFiles);
     QCOMPARE(session.getOutputFileNames(outputFileNameFormat, outputFileFormats,
              outputDirName), outputFileNames);
+
+    // Sessions given a pre-built exercise file index should give the same names.
+    polar::v2::TrainingSession::ExerciseFileNames exerciseFileNames;
+    const QFileInfo baseNameInfo(inputBaseName);
+    foreach (const QFileInfo &info, baseNameInfo.dir().entryInfoList(
+             QStringList(baseNameInfo.fileName() + QLatin1String("-*")))) {
+        polar::v2::TrainingSession::addExerciseFileName(
+            exerciseFileNames, info.fileName(), info.filePath());
+    }
+    polar::v2::TrainingSession indexedSession(inputBaseName, exerciseFileNames);
+    indexedSession.setHrmOption(polar::v2::TrainingSession::RrFiles);
+    QCOMPARE(indexedSession.getOutputFileNames(outputFileNameFormat, outputFileFormats,
+             outputDirName), outputFileNames);
 }
 
 void TestTrainingSession::isGzipped_data()
@@ -550,6 +593,32 @@ void TestTrainingSession::parseCreateSession()
     QCOMPARE(result, expected);
 }
 
+void TestTrainingSession::parseInputFiles_data()
+{
+    toGPX_data();
+}
+
+void TestTrainingSession::parseInputFiles()
+{
+    QFETCH(QString, baseName);
+    QFETCH(QByteArray, expected);
+
+    QVERIFY2(!baseName.isEmpty(), "failed to find testdata");
+
+    // Parse the session from prefetched file contents.
+    polar::v2::TrainingSession session(baseName);
+    const polar::v2::TrainingSession::InputFiles inputFiles = session.readInputFiles();
+    QVERIFY(!inputFiles.isEmpty());
+    QVERIFY(session.parse(inputFiles));
+    QDomDocument gpx = session.toGPX(QDateTime::fromString(
+        QLatin1String("2014-07-15T12:34:56Z"), Qt::ISODate));
+
+    // Compare the generated document against the expected result.
+    QDomDocument expectedDoc;
+    expectedDoc.setContent(expected);
+    compare(gpx, expectedDoc);
+}
+
 void TestTrainingSession::parseLaps_data()
 {
     QTest::addColumn<QString>("fileName");
@@ -587,7 +656,18 @@ void TestTrainingSession::parseLaps()
 
     // Parse the route (protobuf) message.
     const polar::v2::TrainingSession session(QLatin1String("ignored"));
-    const QVariantMap result = session.parseLaps(fileName);
+    const QVariantMap lazyResult = session.parseLaps(fileName);
+
+    // Lap headers and stats should not be decoded until first accessed.
+    foreach (const QVariant &lap, lazyResult.value(QLatin1String("laps")).toList()) {
+        foreach (const QString &key, QStringList() << QLatin1String("header") << QLatin1String("stats")) {
+            foreach (const QVariant &value, lap.toMap().value(key).toList()) {
+                QCOMPARE(value.userType(), qMetaTypeId<ProtoBuf::LazyMessage>());
+                QVERIFY(!value.value<ProtoBuf::LazyMessage>().isDecoded());
+            }
+        }
+    }
+    const QVariantMap result = ProtoBuf::LazyMessage::expand(lazyResult).toMap();
 
     // Write the result to files for optional post-mortem investigations.
     if (!outputDirPath.isNull()) {
@@ -637,7 +717,8 @@ void TestTrainingSession::parsePhysicalInformation()
 
     // Parse the route (protobuf) message.
     const polar::v2::TrainingSession session(QLatin1String("ignored"));
-    const QVariantMap result = session.parsePhysicalInformation(fileName);
+    const QVariantMap result = ProtoBuf::LazyMessage::expand(
+        session.parsePhysicalInformation(fileName)).toMap();
 
     // Write the result to files for optional post-mortem investigations.
     if (!outputDirPath.isNull()) {
@@ -700,6 +781,28 @@ void TestTrainingSession::parseRoute()
     QCOMPARE(result, expected);
 }
 
+void TestTrainingSession::parseRRIntervals_data()
+{
+    parseRRSamples_data();
+}
+
+void TestTrainingSession::parseRRIntervals()
+{
+    QFETCH(QString, fileName);
+    QFETCH(QVariantMap, expected);
+
+    QVERIFY2(!fileName.isEmpty(), "failed to find testdata");
+
+    // Bulk-decode the intervals, which should match those parsed as QVariants.
+    const polar::v2::TrainingSession session(QLatin1String("ignored"));
+    const polar::v2::RRIntervals result(session.parseRRIntervals(fileName));
+    const QVariantList values = expected.value(QLatin1String("value")).toList();
+    QCOMPARE(result.size(), values.size());
+    for (int index = 0; index < values.size(); ++index) {
+        QCOMPARE(result.at(index), values.at(index).toUInt());
+    }
+}
+
 void TestTrainingSession::parseRRSamples_data()
 {
     QTest::addColumn<QString>("fileName");
@@ -895,6 +998,180 @@ void TestTrainingSession::parseZones()
     QCOMPARE(result, expected);
 }
 
+void TestTrainingSession::snapshot_data()
+{
+    toGPX_data();
+}
+
+void TestTrainingSession::snapshot()
+{
+    QFETCH(QString, baseName);
+    QFETCH(QByteArray, expected);
+
+    QVERIFY2(!baseName.isEmpty(), "failed to find testdata");
+
+    // Take a snapshot of the parsed session.
+    polar::v2::TrainingSession * const session = getTrainingSession(baseName);
+    QVERIFY(session->isValid() || session->parse());
+    const polar::v2::ParsedSession snapshot = session->snapshot();
+    QVERIFY(snapshot.isValid());
+    QCOMPARE(snapshot.baseName(), baseName);
+    QCOMPARE(snapshot.exercises().size(), session->exerciseCount());
+
+    // Output from the snapshot must not depend on the session's own options.
+    session->setGpxOption(polar::v2::TrainingSession::GarminTrackPointExtension);
+    QDomDocument gpx = polar::v2::TrainingSession::toGPX(snapshot,
+        polar::v2::TrainingSession::GpxOptions(), QDateTime::fromString(
+        QLatin1String("2014-07-15T12:34:56Z"), Qt::ISODate));
+    session->setGpxOptions(polar::v2::TrainingSession::GpxOptions());
+
+    // Compare the generated document against the expected result.
+    QDomDocument expectedDoc;
+    expectedDoc.setContent(expected);
+    compare(gpx, expectedDoc);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+
+    // The other snapshot writers should match the session's own.
+    QCOMPARE(polar::v2::TrainingSession::toHRM(snapshot,
+             polar::v2::TrainingSession::HrmOptions(), false), session->toHRM(false));
+    compare(polar::v2::TrainingSession::toTCX(snapshot,
+            polar::v2::TrainingSession::TcxOptions(), QLatin1String("Jul 17 2014 21:02:38")),
+            session->toTCX(QLatin1String("Jul 17 2014 21:02:38")));
+}
+
+void TestTrainingSession::splitLaps_data()
+{
+    toTCX_data();
+}
+
+void TestTrainingSession::splitLaps()
+{
+    QFETCH(QString, baseName);
+
+    QVERIFY2(!baseName.isEmpty(), "failed to find testdata");
+
+    polar::v2::TrainingSession * const session = getTrainingSession(baseName);
+    QVERIFY(session->isValid() || session->parse());
+
+    #define MSECS(map) \
+        ((((map.value(QLatin1String("hours")).toList().value(0).toULongLong() * 60) \
+          + map.value(QLatin1String("minutes")).toList().value(0).toULongLong()) * 60 \
+          + map.value(QLatin1String("seconds")).toList().value(0).toULongLong()) * 1000 \
+          + map.value(QLatin1String("milliseconds")).toList().value(0).toULongLong())
+
+    foreach (const QVariant &exercise, session->snapshot().exercises()) {
+        const QVariantList durationLaps = polar::v2::TrainingSession::splitLaps(
+            exercise.toMap(), polar::v2::TrainingSession::DurationSplits, 60000);
+        const QVariantList distanceLaps = polar::v2::TrainingSession::splitLaps(
+            exercise.toMap(), polar::v2::TrainingSession::DistanceSplits, 1000);
+        QVERIFY(polar::v2::TrainingSession::splitLaps(exercise.toMap(),
+            polar::v2::TrainingSession::DurationSplits, 0).isEmpty());
+
+        // Laps must be contiguous, with every duration-split lap (but the last) one minute long.
+        for (int split = 0; split < 2; ++split) {
+            const QVariantList &laps = (split == 0) ? durationLaps : distanceLaps;
+            quint64 lapStartTime = 0;
+            for (int index = 0; index < laps.size(); ++index) {
+                const QVariantMap header = laps.at(index).toMap()
+                    .value(QLatin1String("header")).toList().value(0).toMap();
+                const quint64 splitTime = MSECS(header.value(QLatin1String("split-time")).toList().value(0).toMap());
+                const quint64 duration = MSECS(header.value(QLatin1String("duration")).toList().value(0).toMap());
+                QVERIFY(splitTime > lapStartTime);
+                QCOMPARE(splitTime - duration, lapStartTime);
+                QCOMPARE(header.value(QLatin1String("lap-type")).toList().value(0).toInt(), (split == 0) ? 2 : 1);
+                if ((split == 0) && (index + 1 < laps.size())) {
+                    QCOMPARE(duration, Q_UINT64_C(60000));
+                }
+                lapStartTime = splitTime;
+            }
+        }
+    }
+
+    #undef MSECS
+}
+
+void TestTrainingSession::toFIT_data()
+{
+    toTCX_data();
+}
+
+void TestTrainingSession::toFIT()
+{
+    QFETCH(QString, baseName);
+    QFETCH(QByteArray, expected);
+
+    QVERIFY2(!baseName.isEmpty(), "failed to find testdata");
+
+    // Parse the route (protobuf) message.
+    polar::v2::TrainingSession * const session = getTrainingSession(baseName);
+    QVERIFY(session->isValid() || session->parse());
+    const QByteArray fit = session->toFIT();
+
+    // Write the result to a FIT file for optional post-mortem investigations.
+    if (!outputDirPath.isNull()) {
+        QFile file(QString::fromLatin1("%1/%2.fit")
+            .arg(outputDirPath).arg(QString::fromLatin1(QTest::currentDataTag())));
+        if (file.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
+            file.write(fit);
+        }
+    }
+
+    // Sessions with no activities in the expected TCX have no FIT output.
+    const int activityCount = expected.count("<Activity ");
+    if (activityCount == 0) {
+        QVERIFY(fit.isEmpty());
+        return;
+    }
+
+    // Verify the file header, and CRCs.
+    QVERIFY(fit.size() > 16);
+    QVERIFY(fit.size() < expected.size());
+    QCOMPARE(fit.at(0), '\x0e');
+    QCOMPARE(fit.mid(8, 4), QByteArray(".FIT"));
+    QCOMPARE(polar::v2::FitEncoder::crc(fit.left(14)), quint16(0));
+    QCOMPARE(polar::v2::FitEncoder::crc(fit), quint16(0));
+    const int dataEnd = 14 + qFromLittleEndian<quint32>(
+        reinterpret_cast<const uchar *>(fit.constData() + 4));
+    QCOMPARE(dataEnd, fit.size() - 2);
+
+    // Walk the messages, counting data messages by global message number.
+    QMap<int, QPair<int,int> > definitions; // Local type -> global number, size.
+    QMap<int, int> messageCounts;
+    int pos = 14;
+    while (pos < dataEnd) {
+        const quint8 header = static_cast<quint8>(fit.at(pos++));
+        QVERIFY((header & 0x80) == 0); // No compressed timestamp headers.
+        const int localType = header & 0x0F;
+        if (header & 0x40) {
+            QVERIFY(pos + 5 <= dataEnd);
+            const int globalNumber = qFromLittleEndian<quint16>(
+                reinterpret_cast<const uchar *>(fit.constData() + pos + 2));
+            const int fieldCount = static_cast<quint8>(fit.at(pos + 4));
+            pos += 5;
+            int size = 0;
+            for (int field = 0; field < fieldCount; ++field, pos += 3) {
+                QVERIFY(pos + 3 <= dataEnd);
+                size += static_cast<quint8>(fit.at(pos + 1));
+            }
+            definitions.insert(localType, qMakePair(globalNumber, size));
+        } else {
+            QVERIFY(definitions.contains(localType));
+            ++messageCounts[definitions.value(localType).first];
+            pos += definitions.value(localType).second;
+        }
+    }
+    QCOMPARE(pos, dataEnd);
+
+    // Verify the messages against the TCX equivalent.
+    QCOMPARE(messageCounts.value(0),  1);             // file_id
+    QCOMPARE(messageCounts.value(18), activityCount); // session
+    QCOMPARE(messageCounts.value(34), 1);             // activity
+    QVERIFY(messageCounts.value(19) >= activityCount); // lap
+    QVERIFY(messageCounts.value(20) >= expected.count("<Trackpoint")); // record
+}
+
 void TestTrainingSession::toGPX_data()
 {
     QTest::addColumn<QString>("baseName");
@@ -1398,6 +1675,52 @@ void TestTrainingSession::toHRM()
     QCOMPARE(hrm, expected);
 }
 
+void TestTrainingSession::toHRM_HrvAnalysis_data()
+{
+    toHRM_RR_data();
+}
+
+void TestTrainingSession::toHRM_HrvAnalysis()
+{
+    QFETCH(QString, baseName);
+    QFETCH(QStringList, expected);
+
+    QVERIFY2(!baseName.isEmpty(), "failed to find testdata");
+
+    polar::v2::TrainingSession * const session = getTrainingSession(baseName);
+    QVERIFY(session->isValid() || session->parse());
+    session->setHrmOption(polar::v2::TrainingSession::HrvAnalysis);
+
+    // The R-R data itself is unaffected by the HRV analysis.
+    QCOMPARE(session->toHRM(true), expected);
+
+    const polar::v2::TrainingSession::OutputFiles outputFiles =
+        polar::v2::TrainingSession::formatHRM(session->snapshot(),
+            polar::v2::TrainingSession::HrvAnalysis, QLatin1String("hrv"));
+    for (int index = 0; index < expected.size(); ++index) {
+        const QString fileName = (expected.size() == 1) ? QString::fromLatin1("hrv")
+            : QString::fromLatin1("hrv.%1").arg(index);
+        QVERIFY(outputFiles.contains(fileName + QLatin1String(".hrm")));
+
+        // Every HRM file has a JSON sidecar, but only gains an [HRV] section
+        // if there are R-R intervals to analyse.
+        const int rrDataIndex = expected.at(index).indexOf(QLatin1String("[HRData]\r\n"));
+        QVERIFY(rrDataIndex >= 0);
+        const int intervalCount = expected.at(index).mid(rrDataIndex).count(QLatin1String("\r\n")) - 1;
+        const QByteArray hrm = outputFiles.value(fileName + QLatin1String(".hrm"));
+        QCOMPARE(hrm.contains("\r\n[HRV]\r\n0\t"), (intervalCount > 0));
+        QVERIFY(outputFiles.contains(fileName + QLatin1String(".hrv.json")));
+
+        // Every R-R interval should have been analysed, either as an NN interval, or an artifact.
+        const QVariantMap analysis = QJsonDocument::fromJson(
+            outputFiles.value(fileName + QLatin1String(".hrv.json"))).toVariant().toMap();
+        const QVariantMap exercise = analysis.value(QLatin1String("exercise")).toMap();
+        QCOMPARE(exercise.value(QLatin1String("intervals")).toInt() +
+                 exercise.value(QLatin1String("artifacts")).toInt(), intervalCount);
+    }
+    QCOMPARE(outputFiles.size(), expected.size() * 2);
+}
+
 void TestTrainingSession::toHRM_LapNames_data()
 {
     QTest::addColumn<QString>("baseName");
@@ -1608,6 +1931,95 @@ void TestTrainingSession::toHRM_RR()
     QCOMPARE(hrm, expected);
 }
 
+void TestTrainingSession::toSampleTables_data()
+{
+    toTCX_data();
+}
+
+void TestTrainingSession::toSampleTables()
+{
+    QFETCH(QString, baseName);
+    QFETCH(QByteArray, expected);
+
+    QVERIFY2(!baseName.isEmpty(), "failed to find testdata");
+
+    polar::v2::TrainingSession * const session = getTrainingSession(baseName);
+    QVERIFY(session->isValid() || session->parse());
+    const QList<polar::v2::SampleTable> tables =
+        polar::v2::TrainingSession::toSampleTables(session->snapshot());
+
+    // Each table must be rectangular, with the same columns as the first.
+    int rowCount = 0;
+    foreach (const polar::v2::SampleTable &table, tables) {
+        QCOMPARE(table.toCsvHeader(), tables.first().toCsvHeader());
+        foreach (const polar::v2::SampleTable::Column &column, table.columns()) {
+            QCOMPARE(column.size(), table.rowCount());
+            QVERIFY(column.nullCount() <= column.size());
+        }
+        rowCount += table.rowCount();
+    }
+
+    // The CSV and Arrow outputs are both written from the same tables.
+    QBuffer csv, arrow;
+    csv.open(QIODevice::WriteOnly);
+    arrow.open(QIODevice::WriteOnly);
+    QCOMPARE(session->writeCSV(csv), !tables.isEmpty());
+    QCOMPARE(session->writeArrow(arrow), !tables.isEmpty());
+    if (tables.isEmpty()) {
+        QVERIFY(csv.data().isEmpty());
+        QVERIFY(arrow.data().isEmpty());
+        return;
+    }
+    QCOMPARE(csv.data().count('\n'), rowCount + 1);
+    QVERIFY(csv.data().startsWith("exercise,time,heartrate,"));
+    QVERIFY(arrow.data().startsWith(QByteArray("ARROW1\0\0", 8)));
+    QVERIFY(arrow.data().endsWith("ARROW1"));
+
+    // Every activity in the expected TCX has a table (as may other exercises).
+    QVERIFY(tables.size() >= expected.count("<Activity "));
+}
+
+void TestTrainingSession::toSampleTables_Intervalled()
+{
+    // An exercise with only intervalled samples, as newer devices record, with
+    // the sensor offline for the middle sample.
+    QVariantMap source;
+    source.insert(QLatin1String("sample-source-type"), QVariantList() << 1);
+    source.insert(QLatin1String("start-index"), QVariantList() << 1);
+    source.insert(QLatin1String("stop-index"), QVariantList() << 1);
+    QVariantMap block;
+    block.insert(QLatin1String("rec-interval-ms"), QVariantList() << 1000);
+    block.insert(QLatin1String("sample-source"), QVariantList() << source);
+    block.insert(QLatin1String("hr-samples"), QVariantList() << 60 << 61 << 62);
+    block.insert(QLatin1String("altitude-samples"), QVariantList() << 10.5 << 11.0 << 11.5);
+    QVariantMap samples;
+    samples.insert(QLatin1String("intervalled-samples"), QVariantList() << block);
+    QVariantMap exercise;
+    exercise.insert(QLatin1String("create"), QVariantMap());
+    exercise.insert(QLatin1String("samples"), samples);
+    QVariantMap exercises;
+    exercises.insert(QLatin1String("0"), exercise);
+    const polar::v2::ParsedSession session(QLatin1String("intervalled"), exercises,
+                                           QVariantMap(), QVariantMap());
+
+    const QList<polar::v2::SampleTable> tables =
+        polar::v2::TrainingSession::toSampleTables(session);
+    QCOMPARE(tables.size(), 1);
+    QCOMPARE(tables.first().rowCount(), 3);
+    QStringList heartrate, altitude;
+    foreach (const polar::v2::SampleTable::Column &column, tables.first().columns()) {
+        for (int row = 0; row < column.size(); ++row) {
+            if (column.name() == QLatin1String("heartrate")) {
+                heartrate << QString::fromLatin1(column.toString(row));
+            } else if (column.name() == QLatin1String("altitude")) {
+                altitude << QString::fromLatin1(column.toString(row));
+            }
+        }
+    }
+    QCOMPARE(heartrate, QStringList() << QLatin1String("60") << QString() << QLatin1String("62"));
+    QCOMPARE(altitude, QStringList() << QLatin1String("10.5") << QString() << QLatin1String("11.5"));
+}
+
 void TestTrainingSession::toTCX_data()
 {
     QTest::addColumn<QString>("baseName");
@@ -1938,6 +2350,50 @@ void TestTrainingSession::toTCX_GarminCourse()
     }
 }
 
+void TestTrainingSession::toTCX_KilometreLaps_data()
+{
+    toTCX_data();
+}
+
+void TestTrainingSession::toTCX_KilometreLaps()
+{
+    QFETCH(QString, baseName);
+
+    QVERIFY2(!baseName.isEmpty(), "failed to find testdata");
+
+    polar::v2::TrainingSession * const session = getTrainingSession(baseName);
+    QVERIFY(session->isValid() || session->parse());
+    session->setTcxOption(polar::v2::TrainingSession::KilometreTcxLaps);
+    const QDomDocument tcx = session->toTCX(QLatin1String("Jul 17 2014 21:02:38"));
+
+    // Each Activity (one per exercise with 'create' data) should begin with its first kilometre split.
+    const QDomNodeList activities = tcx.elementsByTagName(QLatin1String("Activity"));
+    int activityIndex = 0;
+    foreach (const QVariant &exercise, session->snapshot().exercises()) {
+        if (!exercise.toMap().contains(QLatin1String("create"))) {
+            continue;
+        }
+        QVERIFY(activityIndex < activities.size());
+        const QDomElement lap = activities.at(activityIndex++).firstChildElement(QLatin1String("Lap"));
+        const QVariantList splits = polar::v2::TrainingSession::splitLaps(
+            exercise.toMap(), polar::v2::TrainingSession::DistanceSplits, 1000);
+        if ((lap.isNull()) || (splits.isEmpty())) {
+            continue;
+        }
+        const QVariantMap duration = splits.first().toMap().value(QLatin1String("header")).toList()
+            .value(0).toMap().value(QLatin1String("duration")).toList().value(0).toMap();
+        const qint64 expected =
+            ((duration.value(QLatin1String("hours")).toList().value(0).toLongLong() * 60
+              + duration.value(QLatin1String("minutes")).toList().value(0).toLongLong()) * 60
+              + duration.value(QLatin1String("seconds")).toList().value(0).toLongLong()) * 1000
+              + duration.value(QLatin1String("milliseconds")).toList().value(0).toLongLong();
+        QCOMPARE(qRound64(lap.firstChildElement(QLatin1String("TotalTimeSeconds")).text().toDouble() * 1000.0),
+                 expected);
+        QVERIFY(lap.firstChildElement(QLatin1String("DistanceMeters")).text().toDouble() <= 1000.5);
+    }
+    QCOMPARE(activityIndex, activities.size());
+}
+
 void TestTrainingSession::toTCX_UTC_data()
 {
     QTest::addColumn<QString>("baseName");
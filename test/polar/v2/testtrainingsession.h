@@ -34,6 +34,9 @@ private slots:
     void parseCreateSession_data();
     void parseCreateSession();
 
+    void parseInputFiles_data();
+    void parseInputFiles();
+
     void parseLaps_data();
     void parseLaps();
 
@@ -43,6 +46,9 @@ private slots:
     void parseRoute_data();
     void parseRoute();
 
+    void parseRRIntervals_data();
+    void parseRRIntervals();
+
     void parseRRSamples_data();
     void parseRRSamples();
 
@@ -55,6 +61,15 @@ private slots:
     void parseZones_data();
     void parseZones();
 
+    void snapshot_data();
+    void snapshot();
+
+    void splitLaps_data();
+    void splitLaps();
+
+    void toFIT_data();
+    void toFIT();
+
     void toGPX_data();
     void toGPX();
 
@@ -73,6 +88,9 @@ private slots:
     void toHRM_data();
     void toHRM();
 
+    void toHRM_HrvAnalysis_data();
+    void toHRM_HrvAnalysis();
+
     void toHRM_LapNames_data();
     void toHRM_LapNames();
 
@@ -82,6 +100,11 @@ private slots:
     void toHRM_RR_data();
     void toHRM_RR();
 
+    void toSampleTables_data();
+    void toSampleTables();
+
+    void toSampleTables_Intervalled();
+
     void toTCX_data();
     void toTCX();
 
@@ -94,6 +117,9 @@ private slots:
     void toTCX_GarminCourse_data();
     void toTCX_GarminCourse();
 
+    void toTCX_KilometreLaps_data();
+    void toTCX_KilometreLaps();
+
     void toTCX_UTC_data();
     void toTCX_UTC();
 
@@ -2,7 +2,11 @@
 # SPDX-License-Identifier: GPL-3.0-or-later
 
 VPATH += $$PWD
-HEADERS += testtrainingsession.h
-SOURCES += testtrainingsession.cpp
+HEADERS += testarchivewriter.h   testarrowwriter.h   testchunkedformatter.h   testfitencoder.h   testgzipcompressor.h   testgzipdecompressor.h   testhrvmetrics.h   testlapaggregator.h   testoutputfileindex.h   testparallelmap.h   testrrintervals.h   testsamplecalibration.h   testsamplechannels.h   testsamplesummary.h   testsessioncache.h   testtimeline.h   testtimestampformatter.h   testtrainingsession.h
+SOURCES += testarchivewriter.cpp testarrowwriter.cpp testchunkedformatter.cpp testfitencoder.cpp testgzipcompressor.cpp testgzipdecompressor.cpp testhrvmetrics.cpp testlapaggregator.cpp testoutputfileindex.cpp testparallelmap.cpp testrrintervals.cpp testsamplecalibration.cpp testsamplechannels.cpp testsamplesummary.cpp testsessioncache.cpp testtimeline.cpp testtimestampformatter.cpp testtrainingsession.cpp
 
 include(../../../src/polar/v2/v2.pri)
+
+# The output file index has no dependencies on the rest of src/threads.
+HEADERS += $$TOPDIR/src/threads/outputfileindex.h
+SOURCES += $$TOPDIR/src/threads/outputfileindex.cpp
@@ -3,6 +3,7 @@
 
 #include "testmessage.h"
 
+#include "../../src/protobuf/lazymessage.h"
 #include "../../src/protobuf/message.h"
 #include "tools/variant.h"
 
@@ -120,3 +121,30 @@ void TestMessage::parse()
     // Compare the result.
     QCOMPARE(result, expected);
 }
+
+void TestMessage::parseLazy_data()
+{
+    parse_data();
+}
+
+void TestMessage::parseLazy()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(ProtoBuf::Message::FieldInfoMap, fieldInfo);
+    QFETCH(QVariantMap, expected);
+
+    QVERIFY2(!data.isEmpty(), "failed to load testdata");
+
+    // Parse the protobuf message, deferring all embedded messages.
+    ProtoBuf::Message message(fieldInfo);
+    for (ProtoBuf::Message::FieldInfoMap::const_iterator iter = fieldInfo.constBegin();
+         iter != fieldInfo.constEnd(); ++iter) {
+        if (iter.value().scalarType == ProtoBuf::Types::EmbeddedMessage) {
+            message.setLazy(iter.key());
+        }
+    }
+    const QVariantMap result = ProtoBuf::LazyMessage::expand(message.parse(data)).toMap();
+
+    // Compare the result, which should be identical to the eager parse.
+    QCOMPARE(result, expected);
+}
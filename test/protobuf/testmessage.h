@@ -15,4 +15,7 @@ private slots:
     void parse_data();
     void parse();
 
+    void parseLazy_data();
+    void parseLazy();
+
 };
@@ -301,3 +301,44 @@ void TestVarint::parseUnsignedInts()
         QCOMPARE(ProtoBuf::parseUnsignedVarints(data, size), expected.mid(0, size));
     }
 }
+
+void TestVarint::readVarint_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<bool>("expectedResult");
+    QTest::addColumn<quint64>("expectedValue");
+    QTest::addColumn<int>("expectedLength");
+
+    QTest::newRow("1")
+        << QByteArray("\x01") << true << Q_UINT64_C(1) << 1;
+    QTest::newRow("300")
+        << QByteArray("\xAC\x02") << true << Q_UINT64_C(300) << 2;
+    QTest::newRow("300;1")
+        << QByteArray("\xAC\x02" "\x01") << true << Q_UINT64_C(300) << 2;
+    QTest::newRow("uint64::max")
+        << QByteArray("\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x01")
+        << true << std::numeric_limits<quint64>::max() << 10;
+
+    // Some malformed cases.
+    QTest::newRow("empty")
+        << QByteArray() << false << Q_UINT64_C(0) << 0;
+    QTest::newRow("truncated")
+        << QByteArray("\xAC") << false << Q_UINT64_C(44) << 1;
+    QTest::newRow("overlong")
+        << QByteArray("\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x01")
+        << false << std::numeric_limits<quint64>::max() << 10;
+}
+
+void TestVarint::readVarint()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(bool, expectedResult);
+    QFETCH(quint64, expectedValue);
+    QFETCH(int, expectedLength);
+
+    const char * pos = data.constData();
+    quint64 value = 0;
+    QCOMPARE(ProtoBuf::readVarint(pos, data.constData() + data.size(), value), expectedResult);
+    QCOMPARE(value, expectedValue);
+    QCOMPARE(static_cast<int>(pos - data.constData()), expectedLength);
+}
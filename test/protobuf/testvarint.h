@@ -22,4 +22,7 @@ private slots:
     void parseUnsignedInts_data();
     void parseUnsignedInts();
 
+    void readVarint_data();
+    void readVarint();
+
 };
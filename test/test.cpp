@@ -1,6 +1,23 @@
 // SPDX-FileCopyrightText: 2014-2019 Paul Colby <git@colby.id.au>
 // SPDX-License-Identifier: GPL-3.0-or-later
 
+#include "polar/v2/testarchivewriter.h"
+#include "polar/v2/testarrowwriter.h"
+#include "polar/v2/testchunkedformatter.h"
+#include "polar/v2/testfitencoder.h"
+#include "polar/v2/testgzipcompressor.h"
+#include "polar/v2/testgzipdecompressor.h"
+#include "polar/v2/testhrvmetrics.h"
+#include "polar/v2/testlapaggregator.h"
+#include "polar/v2/testoutputfileindex.h"
+#include "polar/v2/testparallelmap.h"
+#include "polar/v2/testrrintervals.h"
+#include "polar/v2/testsamplecalibration.h"
+#include "polar/v2/testsamplechannels.h"
+#include "polar/v2/testsamplesummary.h"
+#include "polar/v2/testsessioncache.h"
+#include "polar/v2/testtimeline.h"
+#include "polar/v2/testtimestampformatter.h"
 #include "polar/v2/testtrainingsession.h"
 #include "protobuf/testfixnum.h"
 #include "protobuf/testmessage.h"
@@ -53,8 +70,25 @@ int main(int argc, char *argv[]) {
 
     // Setup our tests factory object.
     ObjectFactory testFactory;
+    testFactory.registerClass<TestArchiveWriter>();
+    testFactory.registerClass<TestArrowWriter>();
+    testFactory.registerClass<TestChunkedFormatter>();
+    testFactory.registerClass<TestFitEncoder>();
     testFactory.registerClass<TestFixnum>();
+    testFactory.registerClass<TestGzipCompressor>();
+    testFactory.registerClass<TestGzipDecompressor>();
+    testFactory.registerClass<TestHrvMetrics>();
+    testFactory.registerClass<TestLapAggregator>();
     testFactory.registerClass<TestMessage>();
+    testFactory.registerClass<TestOutputFileIndex>();
+    testFactory.registerClass<TestParallelMap>();
+    testFactory.registerClass<TestRRIntervals>();
+    testFactory.registerClass<TestSampleCalibration>();
+    testFactory.registerClass<TestSampleChannels>();
+    testFactory.registerClass<TestSampleSummary>();
+    testFactory.registerClass<TestSessionCache>();
+    testFactory.registerClass<TestTimeline>();
+    testFactory.registerClass<TestTimestampFormatter>();
     testFactory.registerClass<TestTrainingSession>();
     testFactory.registerClass<TestVarint>();
 